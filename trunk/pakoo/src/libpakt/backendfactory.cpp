@@ -19,6 +19,7 @@
  ***************************************************************************/
 
 #include "base/core/packageselector.h"
+#include "base/core/packagesearchindex.h"
 #include "base/loader/multiplepackageloader.h"
 
 #include "backendfactory.h"
@@ -30,13 +31,24 @@ BackendFactory::BackendFactory()
 {}
 
 PackageSelector* BackendFactory::createPackageSelector() {
-	return new PackageSelector();
+	PackageSelector* selector = new PackageSelector();
+	selector->setWorkerThreadCount( workerThreadCount() );
+	return selector;
+}
+
+PackageSearchIndex* BackendFactory::createPackageSearchIndex() {
+	return new PackageSearchIndex();
 }
 
 MultiplePackageLoader* BackendFactory::createMultiplePackageLoader(
 	PackageLoader* packageLoader )
 {
-	return new MultiplePackageLoader( packageLoader );
+	MultiplePackageLoader* loader = new MultiplePackageLoader( packageLoader );
+
+	for( int i = 1; i < workerThreadCount(); i++ )
+		loader->addPackageLoader( createPackageLoader() );
+
+	return loader;
 }
 
 
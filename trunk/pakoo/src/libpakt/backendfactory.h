@@ -26,10 +26,12 @@ namespace libpakt {
 
 class PackageList;
 class PackageSelector;
+class PackageSearchIndex;
 class MultiplePackageLoader;
 class PackageCategory;
 class InitialLoader;
 class PackageLoader;
+class DependencyResolver;
 
 /**
  * This is the abstract factory that's supposed to be derived
@@ -59,6 +61,12 @@ public:
 	//! Determine if the backend supports configuration widgets.
 	virtual bool hasConfigClasses() = 0;
 
+	/**
+	 * Return the number of threads that loaders may use for working
+	 * in parallel. The default implementation returns 1.
+	 */
+	virtual int workerThreadCount() { return 1; }
+
 
 	//
 	// Core classes.
@@ -86,11 +94,19 @@ public:
 	virtual PackageCategory* createPackageCategory() = 0;
 
 	/**
-	 * Creates a PackageSelector object.
+	 * Creates a PackageSelector object. The default implementation
+	 * lets it use as many threads as workerThreadCount() returns.
 	 * @see PackageSelector
 	 */
 	virtual PackageSelector* createPackageSelector();
 
+	/**
+	 * Creates a PackageSearchIndex object. The default implementation
+	 * indexes package names and descriptions.
+	 * @see PackageSearchIndex
+	 */
+	virtual PackageSearchIndex* createPackageSearchIndex();
+
 
 	//
 	// Loader classes.
@@ -111,12 +127,21 @@ public:
 	virtual PackageLoader* createPackageLoader() = 0;
 
 	/**
-	 * Creates a MultiplePackageLoader object.
+	 * Creates a MultiplePackageLoader object. The default implementation
+	 * adds another loader from createPackageLoader() for each additional
+	 * worker thread, so that packages are loaded in parallel.
 	 * @see MultiplePackageLoader
 	 */
 	virtual MultiplePackageLoader* createMultiplePackageLoader(
 		PackageLoader* packageLoader );
 
+	/**
+	 * Creates a DependencyResolver object, which computes the install
+	 * order of a PackageQueue including all missing dependencies.
+	 * @see DependencyResolver
+	 */
+	virtual DependencyResolver* createDependencyResolver() = 0;
+
 };
 
 }
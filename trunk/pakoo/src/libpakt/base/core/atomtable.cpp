@@ -0,0 +1,171 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "atomtable.h"
+
+#include <qmap.h>
+#include <qmutex.h>
+
+// The atoms' strings are stored in blocks of fixed size that are never
+// moved, so that string() can work without locking the mutex.
+#define ATOMBLOCKSIZE 1024
+#define ATOMMAXBLOCKS 4096
+
+
+namespace libpakt {
+
+//! Guards the atom map and the allocation of new atoms.
+static QMutex atomMutex;
+//! Maps strings to their atoms.
+static QMap<QString,Q_UINT32> atomMap;
+//! The blocks containing the strings, in atom order.
+static QString* atomBlocks[ATOMMAXBLOCKS];
+//! The number of atoms in the table (not counting the empty string).
+static Q_UINT32 atomCount = 0;
+//! Returned for the atom 0 and for invalid atoms.
+static const QString emptyAtomString;
+
+
+/**
+ * Return the atom of a string, adding the string to the table
+ * if it's not in there yet.
+ *
+ * @param string  The string that should be interned.
+ * @return  The atom that identifies the string.
+ */
+Q_UINT32 AtomTable::atom( const QString& string )
+{
+	if( string.isEmpty() )
+		return 0;
+
+	QMutexLocker locker( &atomMutex );
+
+	QMap<QString,Q_UINT32>::iterator atomIterator = atomMap.find( string );
+	if( atomIterator != atomMap.end() )
+		return *atomIterator;
+
+	Q_UINT32 newAtom = atomCount + 1;
+	Q_UINT32 block = newAtom / ATOMBLOCKSIZE;
+
+	if( block >= ATOMMAXBLOCKS )
+		return 0; // the table is full, which shouldn't ever happen
+
+	if( atomBlocks[block] == NULL )
+		atomBlocks[block] = new QString[ATOMBLOCKSIZE];
+
+	// Store a copy that doesn't share its data with the argument,
+	// which might be deleted in another thread
+	QString internedString( string.unicode(), string.length() );
+	atomBlocks[block][newAtom % ATOMBLOCKSIZE] = internedString;
+	atomMap.insert( internedString, newAtom );
+	atomCount = newAtom;
+
+	return newAtom;
+}
+
+/**
+ * Look up the atom of a string without adding the string to the table.
+ *
+ * @param string  The string that should be looked up.
+ * @param atom    Is set to the string's atom, if it has been found.
+ * @return  true if the string is in the table, false otherwise.
+ */
+bool AtomTable::find( const QString& string, Q_UINT32* atom )
+{
+	if( string.isEmpty() ) {
+		*atom = 0;
+		return true;
+	}
+
+	QMutexLocker locker( &atomMutex );
+
+	QMap<QString,Q_UINT32>::iterator atomIterator = atomMap.find( string );
+	if( atomIterator == atomMap.end() )
+		return false;
+
+	*atom = *atomIterator;
+	return true;
+}
+
+/**
+ * Return the string that is identified by the given atom.
+ * If the atom is invalid, an empty string is returned.
+ */
+const QString& AtomTable::string( Q_UINT32 atom )
+{
+	if( atom == 0 || atom > atomCount )
+		return emptyAtomString;
+	else
+		return atomBlocks[atom / ATOMBLOCKSIZE][atom % ATOMBLOCKSIZE];
+}
+
+/**
+ * Return a copy of the string that is identified by the given atom,
+ * which doesn't share its data with the table's string. Use this
+ * instead of string() if you need to keep a copy in another thread
+ * than the main one.
+ */
+QString AtomTable::detachedString( Q_UINT32 atom )
+{
+	const QString& atomString = string( atom );
+	return QString( atomString.unicode(), atomString.length() );
+}
+
+/**
+ * Return the number of strings in the table.
+ */
+Q_UINT32 AtomTable::count()
+{
+	return atomCount;
+}
+
+/**
+ * Convert a list of strings into a list of atoms,
+ * adding strings to the table if needed.
+ */
+AtomList AtomTable::atomList( const QStringList& strings )
+{
+	AtomList atoms( strings.count() );
+	uint i = 0;
+
+	for( QStringList::const_iterator stringIterator = strings.begin();
+	     stringIterator != strings.end(); ++stringIterator )
+	{
+		atoms[i++] = atom( *stringIterator );
+	}
+	return atoms;
+}
+
+/**
+ * Convert a list of atoms back into a list of strings. The strings are
+ * detached copies, so the list can be used in any thread.
+ */
+QStringList AtomTable::stringList( const AtomList& atoms )
+{
+	QStringList strings;
+
+	for( AtomList::const_iterator atomIterator = atoms.begin();
+	     atomIterator != atoms.end(); ++atomIterator )
+	{
+		strings.append( detachedString(*atomIterator) );
+	}
+	return strings;
+}
+
+} // namespace
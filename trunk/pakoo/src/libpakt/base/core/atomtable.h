@@ -0,0 +1,72 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTATOMTABLE_H
+#define LIBPAKTATOMTABLE_H
+
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qvaluevector.h>
+
+
+namespace libpakt {
+
+/** A list of atoms, as returned by AtomTable::atom(). */
+typedef QValueVector<Q_UINT32> AtomList;
+
+/**
+ * AtomTable is a process-wide table of interned strings. Strings that
+ * occur over and over again in the package tree, like keywords,
+ * licenses, USE flags or category names, are stored only once and
+ * identified by a small integer, the atom. Comparing two atoms is
+ * a lot cheaper than comparing the strings, and an AtomList takes
+ * up only a fraction of the memory of an equivalent QStringList.
+ *
+ * Atoms are never removed from the table, so an atom stays valid
+ * for the whole lifetime of the process. The empty string always has
+ * the atom 0. All functions can be called from any thread.
+ *
+ * Note that the strings returned by string() are shared, and copying
+ * a QString isn't thread-safe in Qt 3. Code that runs outside of
+ * the main thread should therefore rather compare the returned strings
+ * (or use detachedString()) than keep copies of them. The lists returned
+ * by stringList() contain detached copies and are safe to use anywhere.
+ *
+ * @short  A process-wide table of shared strings, identified by integers.
+ */
+class AtomTable
+{
+public:
+	static Q_UINT32 atom( const QString& string );
+	static bool find( const QString& string, Q_UINT32* atom );
+	static const QString& string( Q_UINT32 atom );
+	static QString detachedString( Q_UINT32 atom );
+	static Q_UINT32 count();
+
+	static AtomList atomList( const QStringList& strings );
+	static QStringList stringList( const AtomList& atoms );
+
+private:
+	// only static functions, no objects
+	AtomTable();
+};
+
+}
+
+#endif // LIBPAKTATOMTABLE_H
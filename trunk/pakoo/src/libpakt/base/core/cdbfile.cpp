@@ -0,0 +1,236 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "cdbfile.h"
+
+#include <string.h>
+
+
+namespace libpakt {
+
+/**
+ * The size of the header, which contains position and size
+ * of the 256 hash tables.
+ */
+static const uint CDB_HEADER_SIZE = 2048;
+
+
+/**
+ * Initialize this object without opening a file.
+ */
+CdbFile::CdbFile()
+{
+	m_recordsEnd = 0;
+}
+
+/**
+ * Initialize this object and open the given file.
+ * Use isOpen() to check if it has succeeded.
+ */
+CdbFile::CdbFile( const QString& filename )
+{
+	m_recordsEnd = 0;
+	open( filename );
+}
+
+/**
+ * Open a CDB file. A file that has been opened before is closed first.
+ *
+ * @param filename  The database file.
+ * @return  true if the file has been opened and has a valid header,
+ *          false otherwise.
+ */
+bool CdbFile::open( const QString& filename )
+{
+	close();
+
+	if( m_file.open(filename) == false )
+		return false;
+
+	if( m_file.size() < CDB_HEADER_SIZE ) {
+		m_file.close();
+		return false;
+	}
+
+	// the records end where the first hash table begins
+	m_recordsEnd = m_file.size();
+	for( uint table = 0; table < 256; table++ )
+	{
+		uint tablePosition = number( table * 8 );
+		if( tablePosition < m_recordsEnd )
+			m_recordsEnd = tablePosition;
+	}
+
+	if( m_recordsEnd < CDB_HEADER_SIZE ) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Close the file. Pointers that have been retrieved
+ * by find() or nextRecord() are invalid afterwards.
+ */
+void CdbFile::close()
+{
+	m_file.close();
+	m_recordsEnd = 0;
+}
+
+/**
+ * Returns true if a file is currently open, false otherwise.
+ */
+bool CdbFile::isOpen() const
+{
+	return m_file.isOpen();
+}
+
+/**
+ * Look up the value of a key. If a key is contained more than once,
+ * the first value is returned.
+ *
+ * @param key         The key, which doesn't need to be null-terminated.
+ * @param keyLength   The length of the key in bytes.
+ * @param data        Is set to the beginning of the value, if found.
+ *                    The value is not null-terminated.
+ * @param dataLength  Is set to the length of the value, if found.
+ * @return  true if the key has been found, false otherwise.
+ */
+bool CdbFile::find( const char* key, uint keyLength,
+                    const char** data, uint* dataLength ) const
+{
+	if( isOpen() == false )
+		return false;
+
+	Q_UINT32 keyHash = hash( key, keyLength );
+	uint tablePosition = number( (keyHash & 255) * 8 );
+	uint slotCount = number( (keyHash & 255) * 8 + 4 );
+
+	if( slotCount == 0 )
+		return false;
+
+	uint slot = (keyHash >> 8) % slotCount;
+
+	// linear probing, until an empty slot is found
+	for( uint probed = 0; probed < slotCount; probed++ )
+	{
+		uint slotPosition = tablePosition + slot * 8;
+		Q_UINT32 slotHash = number( slotPosition );
+		uint recordPosition = number( slotPosition + 4 );
+
+		if( recordPosition == 0 )
+			return false;
+
+		if( slotHash == keyHash )
+		{
+			uint position = recordPosition;
+			const char* recordKey;
+			uint recordKeyLength;
+
+			if( nextRecord( &position, &recordKey, &recordKeyLength,
+			                data, dataLength )
+			    && recordKeyLength == keyLength
+			    && memcmp( recordKey, key, keyLength ) == 0 )
+			{
+				return true;
+			}
+		}
+
+		slot++;
+		if( slot == slotCount )
+			slot = 0;
+	}
+	return false;
+}
+
+/**
+ * Read the record at the given position and advance the position
+ * to the next record. Start with a position of 0 to iterate through
+ * all records of the file.
+ *
+ * @param position    The position of the record. 0 stands for the first one.
+ * @param key         Is set to the beginning of the record's key.
+ * @param keyLength   Is set to the length of the key.
+ * @param data        Is set to the beginning of the record's value.
+ * @param dataLength  Is set to the length of the value.
+ * @return  true if a record has been read, false if there are no
+ *          more records (or if the file is corrupt).
+ */
+bool CdbFile::nextRecord( uint* position, const char** key, uint* keyLength,
+                          const char** data, uint* dataLength ) const
+{
+	if( *position == 0 )
+		*position = CDB_HEADER_SIZE;
+
+	if( isOpen() == false || *position + 8 > m_recordsEnd )
+		return false;
+
+	uint recordKeyLength = number( *position );
+	uint recordDataLength = number( *position + 4 );
+	uint keyPosition = *position + 8;
+
+	// the sizes must fit into the record area
+	if( recordKeyLength > m_recordsEnd - keyPosition
+	    || recordDataLength > m_recordsEnd - keyPosition - recordKeyLength )
+	{
+		return false;
+	}
+
+	*key = m_file.data() + keyPosition;
+	*keyLength = recordKeyLength;
+	*data = *key + recordKeyLength;
+	*dataLength = recordDataLength;
+
+	*position = keyPosition + recordKeyLength + recordDataLength;
+	return true;
+}
+
+/**
+ * The CDB hash function.
+ */
+Q_UINT32 CdbFile::hash( const char* key, uint keyLength )
+{
+	Q_UINT32 keyHash = 5381;
+
+	for( uint i = 0; i < keyLength; i++ )
+		keyHash = ((keyHash << 5) + keyHash) ^ (unsigned char) key[i];
+
+	return keyHash;
+}
+
+/**
+ * Read a little-endian 32-bit number from the file.
+ * Returns 0 if the position is outside of the file.
+ */
+Q_UINT32 CdbFile::number( uint position ) const
+{
+	if( position + 4 > m_file.size() || position + 4 < position )
+		return 0;
+
+	const unsigned char* bytes =
+		(const unsigned char*) m_file.data() + position;
+
+	return (Q_UINT32) bytes[0]
+		| ((Q_UINT32) bytes[1] << 8)
+		| ((Q_UINT32) bytes[2] << 16)
+		| ((Q_UINT32) bytes[3] << 24);
+}
+
+} // namespace
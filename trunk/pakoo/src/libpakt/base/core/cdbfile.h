@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTCDBFILE_H
+#define LIBPAKTCDBFILE_H
+
+#include "mappedfile.h"
+
+#include <qstring.h>
+
+
+namespace libpakt {
+
+/**
+ * CdbFile reads constant databases in the CDB format of D. J. Bernstein.
+ * A CDB file maps keys to values with a two-level hash table, so that
+ * looking up a key costs at most two accesses to the file (one for the
+ * hash table slot, one for the record), no matter how many records
+ * the database contains. The file is mapped into memory, so opening
+ * it doesn't read anything yet.
+ *
+ * Apart from looking up single keys, all records can be iterated in the
+ * order they have been written, using nextRecord().
+ *
+ * @short  A reader for constant databases (CDB files).
+ */
+class CdbFile
+{
+public:
+	CdbFile();
+	CdbFile( const QString& filename );
+
+	bool open( const QString& filename );
+	void close();
+	bool isOpen() const;
+
+	bool find( const char* key, uint keyLength,
+	           const char** data, uint* dataLength ) const;
+
+	bool nextRecord( uint* position, const char** key, uint* keyLength,
+	                 const char** data, uint* dataLength ) const;
+
+	static Q_UINT32 hash( const char* key, uint keyLength );
+
+private:
+	Q_UINT32 number( uint position ) const;
+
+	//! The mapped database file.
+	MappedFile m_file;
+	//! The position after the last record, where the hash tables start.
+	uint m_recordsEnd;
+
+	// no copying, because of the mapped file
+	CdbFile( const CdbFile& );
+	CdbFile& operator=( const CdbFile& );
+};
+
+}
+
+#endif // LIBPAKTCDBFILE_H
@@ -0,0 +1,163 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "directoryreader.h"
+
+#include <qfile.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+
+namespace libpakt {
+
+#if defined(__linux__) && defined(SYS_getdents64)
+/**
+ * The directory entry format of getdents64(),
+ * which is not declared in any of the system headers.
+ */
+struct LinuxDirent64
+{
+	Q_UINT64 d_ino;
+	Q_INT64 d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[1];
+};
+
+/**
+ * The size of the buffer that receives the directory entries,
+ * enough for a few hundred of them per system call.
+ */
+static const int DIRENT_BUFFER_SIZE = 32768;
+#endif
+
+
+/**
+ * Retrieve the entries of a directory, sorted by name.
+ * Hidden entries, including "." and "..", are left out.
+ *
+ * @param path     The directory that will be read.
+ * @param entries  Receives the names of the entries. Previous contents
+ *                 are removed.
+ * @param filter   A combination of EntryType values that determines
+ *                 which entries are returned. Symbolic links are only
+ *                 returned if AllEntries is given.
+ * @return  true if the directory has been read, false if it
+ *          couldn't be opened.
+ */
+bool DirectoryReader::entryList( const QString& path, QStringList& entries,
+                                 int filter )
+{
+	entries.clear();
+
+#if defined(__linux__) && defined(SYS_getdents64)
+	int fd = ::open( QFile::encodeName(path), O_RDONLY | O_DIRECTORY );
+	if( fd == -1 )
+		return false;
+
+	char buffer[DIRENT_BUFFER_SIZE];
+
+	while( true )
+	{
+		int bytes = syscall( SYS_getdents64, fd, buffer, sizeof(buffer) );
+		if( bytes <= 0 )
+			break; // end of directory, or an error
+
+		for( int offset = 0; offset < bytes; )
+		{
+			LinuxDirent64* entry = (LinuxDirent64*) (buffer + offset);
+			offset += entry->d_reclen;
+
+			if( entry->d_name[0] == '.' )
+				continue;
+
+			if( filter != AllEntries )
+			{
+				int type;
+				if( entry->d_type == DT_REG )
+					type = Files;
+				else if( entry->d_type == DT_DIR )
+					type = Dirs;
+				else if( entry->d_type == DT_UNKNOWN )
+					type = entryType( path, entry->d_name );
+				else
+					type = 0; // symbolic links and special files
+
+				if( (type & filter) == 0 )
+					continue;
+			}
+			entries.append( QFile::decodeName(entry->d_name) );
+		}
+	}
+	::close( fd );
+
+#else
+	DIR* dir = opendir( QFile::encodeName(path) );
+	if( dir == NULL )
+		return false;
+
+	struct dirent* entry;
+	while( (entry = readdir(dir)) != NULL )
+	{
+		if( entry->d_name[0] == '.' )
+			continue;
+
+		if( filter != AllEntries
+		    && (entryType(path, entry->d_name) & filter) == 0 )
+		{
+			continue;
+		}
+		entries.append( QFile::decodeName(entry->d_name) );
+	}
+	closedir( dir );
+#endif
+
+	entries.sort();
+	return true;
+}
+
+/**
+ * Determine the type of a directory entry with lstat().
+ *
+ * @return  Files or Dirs, or 0 for all other kinds of entries.
+ */
+int DirectoryReader::entryType( const QString& path, const char* name )
+{
+	struct stat entryInfo;
+	QCString entryPath = QFile::encodeName(path) + "/" + name;
+
+	if( lstat( entryPath, &entryInfo ) != 0 )
+		return 0;
+	else if( S_ISREG(entryInfo.st_mode) )
+		return Files;
+	else if( S_ISDIR(entryInfo.st_mode) )
+		return Dirs;
+	else
+		return 0;
+}
+
+} // namespace
@@ -0,0 +1,59 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTDIRECTORYREADER_H
+#define LIBPAKTDIRECTORYREADER_H
+
+#include <qstringlist.h>
+
+
+namespace libpakt {
+
+/**
+ * DirectoryReader retrieves the entries of a directory with as few
+ * system calls as possible. On Linux, it uses getdents64() to read
+ * many directory entries at once, and it uses the file type that is
+ * stored in the directory itself instead of calling stat() for each
+ * entry. On other systems, it falls back to readdir().
+ *
+ * Unlike QDir::entryList(), hidden entries (including "." and "..")
+ * are always left out, and no QFileInfo objects are created.
+ *
+ * @short  Fast retrieval of directory entries.
+ */
+class DirectoryReader
+{
+public:
+	//! Filter flags for entryList().
+	enum EntryType {
+		Files = 1,
+		Dirs = 2,
+		AllEntries = 3
+	};
+
+	static bool entryList( const QString& path, QStringList& entries,
+	                       int filter = AllEntries );
+
+private:
+	static int entryType( const QString& path, const char* name );
+};
+
+}
+
+#endif // LIBPAKTDIRECTORYREADER_H
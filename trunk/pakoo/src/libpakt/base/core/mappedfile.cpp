@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "mappedfile.h"
+
+#include <qfile.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace libpakt {
+
+/**
+ * Initialize this object without mapping a file.
+ */
+MappedFile::MappedFile()
+{
+	m_data = NULL;
+	m_size = 0;
+}
+
+/**
+ * Initialize this object and map the given file.
+ * Use isOpen() to check if the mapping has succeeded.
+ */
+MappedFile::MappedFile( const QString& filename )
+{
+	m_data = NULL;
+	m_size = 0;
+	open( filename );
+}
+
+/**
+ * Deinitialize this object, releasing the mapping.
+ */
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+/**
+ * Map a file into memory. A file that has been mapped before
+ * is released first.
+ *
+ * @param filename  The file that will be mapped.
+ * @return  true if the file has been mapped, false otherwise.
+ *          Empty files can't be mapped.
+ */
+bool MappedFile::open( const QString& filename )
+{
+	close();
+
+	int fd = ::open( QFile::encodeName(filename), O_RDONLY );
+	if( fd == -1 )
+		return false;
+
+	struct stat fileInfo;
+	if( fstat(fd, &fileInfo) != 0 || fileInfo.st_size <= 0 ) {
+		::close( fd );
+		return false;
+	}
+
+	void* data = mmap( NULL, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	::close( fd ); // the mapping stays valid without the descriptor
+
+	if( data == MAP_FAILED )
+		return false;
+
+	m_data = (const char*) data;
+	m_size = fileInfo.st_size;
+	return true;
+}
+
+/**
+ * Release the mapping. Pointers that have been retrieved
+ * by data() are invalid afterwards.
+ */
+void MappedFile::close()
+{
+	if( m_data != NULL )
+		munmap( (void*) m_data, m_size );
+
+	m_data = NULL;
+	m_size = 0;
+}
+
+/**
+ * Returns true if a file is currently mapped, false otherwise.
+ */
+bool MappedFile::isOpen() const
+{
+	return ( m_data != NULL );
+}
+
+/**
+ * Returns a pointer to the beginning of the mapped file contents,
+ * or NULL if no file is mapped. The data is not null-terminated,
+ * use size() to determine where it ends.
+ */
+const char* MappedFile::data() const
+{
+	return m_data;
+}
+
+/**
+ * Returns the size of the mapped file in bytes,
+ * or 0 if no file is mapped.
+ */
+unsigned long MappedFile::size() const
+{
+	return m_size;
+}
+
+} // namespace
@@ -0,0 +1,66 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTMAPPEDFILE_H
+#define LIBPAKTMAPPEDFILE_H
+
+#include <qstring.h>
+
+
+namespace libpakt {
+
+/**
+ * MappedFile maps a whole file into memory in read-only mode, so that
+ * it can be accessed like a plain character array. The pages are loaded
+ * by the operating system on demand, which makes it a fast way to read
+ * binary caches and large text files that are only scanned once.
+ *
+ * The mapping is private and read-only, the file itself is never changed.
+ * It is released when calling close() or when the object is destroyed.
+ *
+ * @short  A read-only memory mapping of a file.
+ */
+class MappedFile
+{
+public:
+	MappedFile();
+	MappedFile( const QString& filename );
+	~MappedFile();
+
+	bool open( const QString& filename );
+	void close();
+
+	bool isOpen() const;
+	const char* data() const;
+	unsigned long size() const;
+
+private:
+	//! The start of the mapped memory area, or NULL if no file is mapped.
+	const char* m_data;
+	//! The size of the mapped file in bytes.
+	unsigned long m_size;
+
+	// no copying, the mapping is owned by exactly one object
+	MappedFile( const MappedFile& );
+	MappedFile& operator=( const MappedFile& );
+};
+
+}
+
+#endif // LIBPAKTMAPPEDFILE_H
@@ -22,29 +22,41 @@
 
 #include "packageversion.h"
 
+#include <qmutex.h>
+
 
 namespace libpakt {
 
+/**
+ * Guards the derived state of all packages. Packages are modified by
+ * loader threads and read by selector threads, and one mutex for all
+ * of them is cheaper than one per package. It's recursive because the
+ * derived state is computed using the accessors that lock it.
+ */
+static QMutex packageStateMutex( true );
+
 /**
  * Initialize the package with name and category.
- * Note that you mustn't delete the given category object,
- * because it is now considered to be owned by this Package object.
+ * Note that you mustn't use the given category object afterwards,
+ * because it's taken over by PackageCategory::shared(). Use the one
+ * returned by category() instead.
  */
 Package::Package( PackageCategory* category, const QString& name )
-	: m_name(name)
+	: m_name(name), m_latestVersionAvailable(NULL),
+	  m_containsInstalledVersion(false), m_canUpdate(false),
+	  m_derivedStateValid(false), m_derivedStateUpdating(false)
 {
 	if( category == NULL )
-		m_category = new PackageCategory();
+		m_category = PackageCategory::shared( new PackageCategory() );
 	else
-		m_category = category;
+		m_category = PackageCategory::shared( category );
 }
 
 /**
- * Destructor. Deletes the category object.
+ * Destructor. The shared category object stays alive.
  */
 Package::~Package()
 {
-	delete m_category;
 }
 
 /**
@@ -59,7 +71,8 @@ const QString& Package::name() const
 }
 
 /**
- * Get the category of this package.
+ * Get the category of this package. It's a shared category,
+ * so don't modify or delete it.
  */
 PackageCategory* Package::category()
 {
@@ -81,6 +94,7 @@ QString Package::uniqueName() const
 void Package::clear()
 {
 	m_versions.clear();
+	invalidateDerivedState();
 }
 
 /**
@@ -97,6 +111,7 @@ void Package::removeVersion( const QString& versionString )
 		delete *iterator;
 
 	m_versions.remove( versionString );
+	invalidateDerivedState();
 }
 
 /**
@@ -117,6 +132,7 @@ PackageVersion* Package::insertVersion( const QString& versionString )
 	PackageVersion* version = createPackageVersion( versionString );
 	PackageVersionMap::iterator versionIterator =
 		m_versions.insert( version->version(), version );
+	invalidateDerivedState();
 
 	if( versionIterator == m_versions.end() )
 		return NULL; // could not be inserted into m_versions
@@ -157,16 +173,9 @@ bool Package::containsVersion( const QString& versionString )
  */
 bool Package::containsInstalledVersion()
 {
-	PackageVersionMap::iterator versionIterator;
-
-	for( versionIterator = m_versions.begin();
-	     versionIterator != m_versions.end(); versionIterator++ )
-	{
-		if( (*versionIterator)->isInstalled() == true ) {
-			return true;
-		}
-	}
-	return false;
+	QMutexLocker locker( derivedStateMutex() );
+	ensureDerivedState();
+	return m_containsInstalledVersion;
 }
 
 /**
@@ -177,16 +186,9 @@ bool Package::containsInstalledVersion()
  */
 bool Package::containsAvailableVersion()
 {
-	PackageVersionMap::iterator versionIterator;
-
-	for( versionIterator = m_versions.begin();
-			versionIterator != m_versions.end(); versionIterator++ )
-	{
-		if( (*versionIterator)->isAvailable() == true ) {
-			return true;
-		}
-	}
-	return false;
+	QMutexLocker locker( derivedStateMutex() );
+	ensureDerivedState();
+	return ( m_latestVersionAvailable != NULL );
 }
 
 /**
@@ -216,44 +218,19 @@ PackageVersion* Package::version( const QString& versionString )
 /**
  * Return a list of PackageVersion objects sorted by their version numbers,
  * with the oldest version at the beginning and the latest version at the end
- * of the list.
+ * of the list. The order is computed only once for each set of versions.
  */
 QValueList<PackageVersion*> Package::sortedVersionList()
 {
-	QValueList<PackageVersion*> sortedVersions;
-	QValueList<PackageVersion*>::iterator sortedVersionIterator;
-	PackageVersionMap::iterator versionIterator;
+	QMutexLocker locker( derivedStateMutex() );
+	ensureDerivedState();
 
-	for( versionIterator = m_versions.begin();
-	     versionIterator != m_versions.end(); versionIterator++ )
-	{
-		if( versionIterator == m_versions.begin() ) {
-			sortedVersions.append( *versionIterator );
-			continue; // if there is only one version, it can't be compared
-		}
+	QValueList<PackageVersion*> sortedVersions;
+	for( uint i = 0; i < m_sortedVersions.count(); i++ )
+		sortedVersions.append( m_sortedVersions[i] );
 
-		// reverse iteration through the sorted version list
-		sortedVersionIterator = sortedVersions.end();
-		while( true )
-		{
-			if( sortedVersionIterator == sortedVersions.begin() )
-			{
-				sortedVersions.prepend( *versionIterator );
-				break;
-			}
-
-			sortedVersionIterator--;
-			if( (*versionIterator)->isNewerThan(
-			      (*sortedVersionIterator)->version() ) )
-			{
-				sortedVersionIterator++; // insert after the compared one, not before
-				sortedVersions.insert( sortedVersionIterator, *versionIterator );
-				break;
-			}
-		}
-	}
 	return sortedVersions;
-} // end of sortedVersionList()
+}
 
 /**
  * Retrieve the latest version of this package, not taking stability
@@ -262,11 +239,13 @@ QValueList<PackageVersion*> Package::sortedVersionList()
  */
 PackageVersion* Package::latestVersion()
 {
-	if( m_versions.count() == 0 )
-		return NULL;
+	QMutexLocker locker( derivedStateMutex() );
+	ensureDerivedState();
 
-	QValueList<PackageVersion*> sortedVersions = this->sortedVersionList();
-	return sortedVersions.last();
+	if( m_sortedVersions.isEmpty() )
+		return NULL;
+	else
+		return m_sortedVersions.back();
 }
 
 /**
@@ -275,53 +254,121 @@ PackageVersion* Package::latestVersion()
  */
 PackageVersion* Package::latestVersionAvailable()
 {
-	if( m_versions.count() == 0 )
-		return NULL;
+	QMutexLocker locker( derivedStateMutex() );
+	ensureDerivedState();
+	return m_latestVersionAvailable;
+}
 
-	QValueList<PackageVersion*> sortedVersions = this->sortedVersionList();
-	QValueList<PackageVersion*>::iterator versionIterator
-		= sortedVersions.end();
+/**
+ * Check if there is an update available for any version of the package.
+ * The result is taken from the derived state, which uses
+ * canUpdate(PackageVersion*) on each installed version to see
+ * if it's actually updatable.
+ *
+ * @returns  true if there is any update on arch, false otherwise.
+ */
+bool Package::canUpdate()
+{
+	QMutexLocker locker( derivedStateMutex() );
+	ensureDerivedState();
+	return m_canUpdate;
+}
 
-	// Iterate through the versions, starting at the latest one.
-	// If it's stable, we have a result.
-	while(true)
-	{
-		versionIterator--;
+/**
+ * Mark the sorted version order and the values computed from it as
+ * outdated, so that they are computed again when they're needed next time.
+ * This is done automatically when versions are inserted or removed,
+ * PackageVersion subclasses call it when a property changes that
+ * the derived state depends on (like being installed or masked).
+ */
+void Package::invalidateDerivedState()
+{
+	QMutexLocker locker( derivedStateMutex() );
+	m_derivedStateValid = false;
+}
 
-		if( (*versionIterator)->isAvailable() )
-			return (*versionIterator);
+/**
+ * Returns the mutex that guards the derived state of all packages.
+ * Lock it before calling ensureDerivedState() or reading derived members.
+ */
+QMutex* Package::derivedStateMutex()
+{
+	return &packageStateMutex;
+}
 
-		if( versionIterator == sortedVersions.begin() )
-			break;
-	}
+/**
+ * Compute the derived state if it's not valid anymore.
+ * While updateDerivedState() is running, this returns immediately, so
+ * that it can use the accessors for the parts that it already has
+ * computed. The state only becomes valid when it's complete.
+ * Callers have to lock the derived state mutex, which keeps other
+ * threads out until then.
+ */
+void Package::ensureDerivedState()
+{
+	if( m_derivedStateValid == true || m_derivedStateUpdating == true )
+		return;
 
-	return NULL; // if there is no stable version
+	m_derivedStateUpdating = true;
+	updateDerivedState();
+	m_derivedStateUpdating = false;
+	m_derivedStateValid = true;
 }
 
 /**
- * Check if there is an update available for any version of the package.
- * This default implementation skips installed packages and checks
- * canUpdate(PackageVersion*) to see if it's actually updatable.
- *
- * @returns  true if there is any update on arch, false otherwise.
+ * Compute the sorted version order and the other state that is derived
+ * from the package's versions. Subclasses can overload this function to
+ * cache more values, but have to call this implementation first.
+ * Called with the derived state mutex being locked.
  */
-bool Package::canUpdate()
+void Package::updateDerivedState()
 {
+	m_sortedVersions.clear();
+	m_sortedVersions.reserve( m_versions.count() );
+	m_latestVersionAvailable = NULL;
+	m_containsInstalledVersion = false;
+	m_canUpdate = false;
+
 	PackageVersionMap::iterator versionIterator;
 
+	// insertion sort, as most versions are already in the right order
 	for( versionIterator = m_versions.begin();
 	     versionIterator != m_versions.end(); versionIterator++ )
 	{
-		if( (*versionIterator)->isInstalled() == false )
-			continue;
+		PackageVersion* version = *versionIterator;
+		uint position = m_sortedVersions.count();
 
-		// only installed versions are checked for an update
-		if( this->canUpdate( *versionIterator ) == true )
-			return true;
+		while( position > 0
+		       && version->isNewerThan( m_sortedVersions[position - 1] ) == false )
+		{
+			position--;
+		}
+		m_sortedVersions.insert( m_sortedVersions.begin() + position, version );
+
+		if( version->isInstalled() == true )
+			m_containsInstalledVersion = true;
 	}
-	// if the loop hasn't already returned true, there are no updates
-	return false;
-}
+
+	// the latest available version is searched from the end
+	for( uint i = m_sortedVersions.count(); i > 0; i-- )
+	{
+		if( m_sortedVersions[i - 1]->isAvailable() ) {
+			m_latestVersionAvailable = m_sortedVersions[i - 1];
+			break;
+		}
+	}
+
+	// only installed versions are checked for an update
+	for( uint i = 0; i < m_sortedVersions.count(); i++ )
+	{
+		if( m_sortedVersions[i]->isInstalled() == true
+		    && this->canUpdate( m_sortedVersions[i] ) == true )
+		{
+			m_canUpdate = true;
+			break;
+		}
+	}
+} // end of updateDerivedState()
 
 
 /**
@@ -336,37 +383,22 @@ bool Package::canUpdate()
  */
 bool Package::canUpdate( PackageVersion* version )
 {
-	QValueList<PackageVersion*> sortedVersions = this->sortedVersionList();
-	QValueList<PackageVersion*>::iterator versionIterator;
-	bool check = false;
+	QMutexLocker locker( derivedStateMutex() );
+	ensureDerivedState();
 
-	// go through each version and check if it's newer than the given one
-	for( versionIterator = sortedVersions.begin();
-	     versionIterator != sortedVersions.end(); versionIterator++ )
+	// go through the versions newer than the given one, from the latest
+	for( uint i = m_sortedVersions.count(); i > 0; i-- )
 	{
-		// Don't check versions that are not newer than the given one
-		if( check == false
-		    && (*versionIterator)->version() != version->version() )
-		{
-			continue;
-		}
-		else if( check == true )
-		{
-			// If we get here, the versionIterator is newer
-			// than the given version.
-
-			if( (*versionIterator)->isInstalled() == true ) {
-				continue; // if it's installed, it's not upgradable. next one.
-			}
-			if( (*versionIterator)->isAvailable() ) {
-				return true;
-			}
+		PackageVersion* newerVersion = m_sortedVersions[i - 1];
+
+		if( newerVersion == version )
+			break; // all remaining versions are older
+
+		if( newerVersion->isInstalled() == true ) {
+			continue; // if it's installed, it's not upgradable. next one.
 		}
-		else // if( (*versionIterator).version == versionString )
-		{
-			// From the next iteration on,
-			// all versions are newer than the given one:
-			check = true;
+		if( newerVersion->isAvailable() ) {
+			return true;
 		}
 	}
 	// if the loop hasn't already returned true, there are no updates
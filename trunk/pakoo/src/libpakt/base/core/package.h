@@ -24,6 +24,7 @@
 #include <qstring.h>
 #include <qmap.h>
 #include <qvaluelist.h>
+#include <qvaluevector.h>
 #include <qstringlist.h>
 
 #include <ksharedptr.h>
@@ -31,6 +32,8 @@
 #include "packagecategory.h"
 
 
+class QMutex;
+
 namespace libpakt {
 
 class PackageVersion;
@@ -83,6 +86,8 @@ public:
 	// other retrieval functions
 	QString uniqueName() const;
 
+	void invalidateDerivedState();
+
 	/**
 	 * A rather detailed description of the package.
 	 * If there is no distinction between detailed and short descriptions,
@@ -105,14 +110,34 @@ protected:
 	 */
 	virtual PackageVersion* createPackageVersion( const QString& versionString ) = 0;
 
+	virtual void updateDerivedState();
+	void ensureDerivedState();
+	static QMutex* derivedStateMutex();
+
 	typedef QMap<QString,PackageVersion*> PackageVersionMap;
+	typedef QValueVector<PackageVersion*> PackageVersionVector;
 
 	//! The name of the package, e.g. "pakoo"
 	const QString m_name;
-	//! The package category, for example, "app-portage" in Gentoo
+	//! The (shared) package category, for example, "app-portage" in Gentoo
 	PackageCategory* m_category;
 	//! The internal list of package versions.
 	PackageVersionMap m_versions;
+
+	//! The versions sorted from oldest to latest. Part of the derived state.
+	PackageVersionVector m_sortedVersions;
+	//! The latest available version, or NULL. Part of the derived state.
+	PackageVersion* m_latestVersionAvailable;
+	//! true if any version is installed. Part of the derived state.
+	bool m_containsInstalledVersion;
+	//! true if any version can be updated. Part of the derived state.
+	bool m_canUpdate;
+
+private:
+	//! false if the derived state has to be computed again before use.
+	bool m_derivedStateValid;
+	//! true while updateDerivedState() is computing the derived state.
+	bool m_derivedStateUpdating;
 };
 
 }
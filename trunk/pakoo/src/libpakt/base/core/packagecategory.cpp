@@ -19,6 +19,10 @@
  ***************************************************************************/
 
 #include "packagecategory.h"
+#include "atomtable.h"
+
+#include <qmap.h>
+#include <qmutex.h>
 
 #include <klocale.h>
 
@@ -30,18 +34,31 @@
 
 namespace libpakt {
 
+//! Guards the map of shared categories.
+static QMutex sharedCategoryMutex;
+//! The shared categories, with the atoms of their unique names as keys.
+static QMap<Q_UINT32,PackageCategory*> sharedCategories;
+
 /**
  * The empty constructor just calls the QStringList constructor.
  */
-PackageCategory::PackageCategory() : QStringList()
+PackageCategory::PackageCategory() : QStringList(), m_atom( 0 )
 {}
 
 /**
  * A copy constructor for getting the category name parts
- * from QStringList values (which can also be another PackageCategory).
+ * from QStringList values.
  */
 PackageCategory::PackageCategory( const QStringList& list )
-	: QStringList( list )
+	: QStringList( list ), m_atom( 0 )
+{}
+
+/**
+ * The copy constructor. The new category is not shared,
+ * even if the original one is.
+ */
+PackageCategory::PackageCategory( const PackageCategory& category )
+	: QStringList( category ), m_atom( 0 )
 {}
 
 /**
@@ -50,10 +67,72 @@ PackageCategory::PackageCategory( const QStringList& list )
  */
 PackageCategory& PackageCategory::operator=( const QStringList& list )
 {
-	*this = list;
+	QStringList::operator=( list );
+	return *this;
+}
+
+/**
+ * The assignment operator copies the category name parts of another
+ * category. Whether this category is shared or not doesn't change.
+ */
+PackageCategory& PackageCategory::operator=( const PackageCategory& category )
+{
+	QStringList::operator=( category );
 	return *this;
 }
 
+/**
+ * Return the shared category object that is equal to the given one.
+ * If there is no such shared category yet, the given one becomes
+ * the shared category. Otherwise, the given category is deleted.
+ * Either way, the given category is taken over by this function,
+ * so only use the returned pointer afterwards.
+ *
+ * @param category  The category that should be shared. If it's already
+ *                  a shared category, it is returned unchanged.
+ * @return  The shared category, which must not be modified or deleted.
+ */
+PackageCategory* PackageCategory::shared( PackageCategory* category )
+{
+	if( category == NULL || category->isShared() )
+		return category;
+
+	Q_UINT32 atom = AtomTable::atom( category->uniqueName() );
+
+	QMutexLocker locker( &sharedCategoryMutex );
+
+	QMap<Q_UINT32,PackageCategory*>::iterator categoryIterator =
+		sharedCategories.find( atom );
+
+	if( categoryIterator != sharedCategories.end() ) {
+		delete category;
+		return *categoryIterator;
+	}
+	else {
+		category->m_atom = atom;
+		sharedCategories.insert( atom, category );
+		return category;
+	}
+}
+
+/**
+ * Returns true if this is a shared category, as returned by shared().
+ */
+bool PackageCategory::isShared() const
+{
+	return ( m_atom != 0 );
+}
+
+/**
+ * Return the atom of this category's unique name, which identifies
+ * the category. Only shared categories have got an atom,
+ * for other categories 0 is returned.
+ */
+Q_UINT32 PackageCategory::atom() const
+{
+	return m_atom;
+}
+
 /**
  * Determine if this category is contained in another one,
  * which means it's either the same or a subset of the other category.
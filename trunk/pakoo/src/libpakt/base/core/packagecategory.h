@@ -34,21 +34,36 @@ namespace libpakt {
  * a subset of the "all packages" category, and a list containing more
  * elements (e.g. "app"->"portage") is an even smaller subset and
  * shows the tree structure of the package tree quite well.
+ *
+ * The categories of packages are shared: there is only one category
+ * object for all packages of a category, retrieved with shared().
+ * Shared categories live as long as the process, and must not be
+ * modified or deleted.
  */
 class PackageCategory : public QStringList
 {
 public:
 	PackageCategory();
 	PackageCategory( const QStringList& list );
+	PackageCategory( const PackageCategory& category );
 	virtual ~PackageCategory() {};
 
 	PackageCategory& operator=( const QStringList& list );
+	PackageCategory& operator=( const PackageCategory& category );
 
 	bool isContainedIn( PackageCategory& otherCategory );
 
 	virtual QString userVisibleName() const;
 	virtual QString uniqueName() const;
 	virtual bool loadFromUniqueName( const QString& uniqueName );
+
+	static PackageCategory* shared( PackageCategory* category );
+	bool isShared() const;
+	Q_UINT32 atom() const;
+
+private:
+	//! The atom of the unique name if this category is shared, 0 otherwise.
+	Q_UINT32 m_atom;
 };
 
 }
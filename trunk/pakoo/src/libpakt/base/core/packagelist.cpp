@@ -23,6 +23,9 @@
 #include "packageversion.h"
 #include "package.h"
 #include "packagecategory.h"
+#include "atomtable.h"
+
+#include <qtl.h>
 
 #include <klocale.h>
 #include <kdebug.h>
@@ -30,11 +33,63 @@
 
 namespace libpakt {
 
+/**
+ * An entry of the ordered package list, used for sorting it.
+ */
+struct PackageOrderEntry
+{
+	QString key;
+	Package* package;
+
+	bool operator<( const PackageOrderEntry& other ) const {
+		return key < other.key;
+	}
+};
+
 /**
  * Initialize this object with an empty package list.
  */
 PackageList::PackageList()
 {
+	m_count = 0;
+	m_removedCount = 0;
+	m_orderDirty = false;
+}
+
+/**
+ * Initialize this object with the packages of another list.
+ * The Package objects are shared, not copied.
+ */
+PackageList::PackageList( const PackageList& other )
+{
+	copyFrom( other );
+}
+
+/**
+ * Replace the packages of this list with the ones of another list.
+ * The Package objects are shared, not copied.
+ */
+PackageList& PackageList::operator=( const PackageList& other )
+{
+	if( this != &other )
+		copyFrom( other );
+
+	return *this;
+}
+
+/**
+ * Copy the hash table, the ordered list and the counters from another
+ * list. The mutex stays the one of this list.
+ */
+void PackageList::copyFrom( const PackageList& other )
+{
+	QMutexLocker locker( &other.m_orderMutex );
+
+	m_slots = other.m_slots;
+	m_count = other.m_count;
+	m_removedCount = other.m_removedCount;
+	m_order = other.m_order;
+	m_orderDirty = other.m_orderDirty;
 }
 
 /**
@@ -42,7 +97,7 @@ PackageList::PackageList()
  */
 int PackageList::count()
 {
-	return m_packages.count();
+	return m_count;
 }
 
 /**
@@ -50,7 +105,11 @@ int PackageList::count()
  */
 void PackageList::clear()
 {
-	m_packages.clear();
+	m_slots.clear();
+	m_order.clear();
+	m_count = 0;
+	m_removedCount = 0;
+	m_orderDirty = false;
 }
 
 /**
@@ -65,15 +124,38 @@ Package* PackageList::insert( Package* package )
 	if( package == NULL || package->name() == "" )
 		return NULL;
 
-	PackageMap::iterator packageIterator = m_packages.insert(
-		package->category()->uniqueName() + package->name(),
-		KSharedPtr<Package>( package )
-	);
+	// keep at least half of the slots really empty,
+	// so that probing sequences stay short
+	if( (m_count + m_removedCount + 1) * 2 > m_slots.size() )
+		rehash( QMAX(m_slots.size(), 32) * 2 );
+
+	Q_UINT32 categoryAtom = package->category()->atom();
+	Q_UINT32 packageHash = hash( categoryAtom, package->name() );
+	int index = findSlot( categoryAtom, package->name(), packageHash );
+
+	if( index >= 0 ) {
+		// replace the existing package
+		m_slots[index].package = KSharedPtr<Package>( package );
+		m_orderDirty = true;
+		return package;
+	}
 
-	if( packageIterator == m_packages.end() )
-		return NULL; // could not be inserted into m_packages
-	else // return the real pointer, not the KSharedPtr object
-		return (*packageIterator).data();
+	// insert into the first free slot of the probing sequence
+	uint mask = m_slots.size() - 1;
+	uint i = packageHash & mask;
+	while( m_slots[i].package != NULL )
+		i = (i + 1) & mask;
+
+	if( m_slots[i].removed ) {
+		m_slots[i].removed = false;
+		m_removedCount--;
+	}
+	m_slots[i].package = KSharedPtr<Package>( package );
+	m_slots[i].hash = packageHash;
+	m_count++;
+	m_orderDirty = true;
+
+	return package;
 }
 
 /**
@@ -105,10 +187,34 @@ Package* PackageList::insert( PackageCategory* category,
 bool PackageList::contains( PackageCategory* category,
                             const QString& name )
 {
-	if( category == NULL )
-		return false;
+	return ( find(category, name) != NULL );
+}
+
+/**
+ * Return the Package object for a given package name and category,
+ * if it's in the list. In contrast to package(), this function
+ * doesn't create any packages and doesn't take over the category.
+ *
+ * @param category  The category containing the requested package.
+ * @param name      The requested package name string.
+ * @return  The Package object, or NULL if there is no such package.
+ */
+Package* PackageList::find( PackageCategory* category,
+                            const QString& name )
+{
+	Q_UINT32 atom;
+
+	if( m_count == 0 || category == NULL
+	    || categoryAtom( category, &atom ) == false )
+	{
+		return NULL;
+	}
 
-	return m_packages.contains( category->uniqueName() + name );
+	int index = findSlot( atom, name, hash(atom, name) );
+	if( index < 0 )
+		return NULL;
+	else
+		return m_slots[index].package.data();
 }
 
 /**
@@ -117,10 +223,11 @@ bool PackageList::contains( PackageCategory* category,
  * (taking the arguments as default initialization values).
  *
  * By calling this function, you give up ownership and control of
- * the given category, which is now owned and held by the new
- * Package object. So, do not delete the category after calling this
- * function. You can get this category by calling the category()
- * function of the returned Package object.
+ * the given category, which is taken over by PackageCategory::shared().
+ * So, do not use or delete the category after calling this function.
+ * You can get the shared category by calling the category() function
+ * of the returned Package object. Passing a category that is already
+ * shared avoids the lookup of the shared category.
  *
  * @param category  The category containing the requested package.
  * @param name      The requested package name string.
@@ -140,38 +247,205 @@ Package* PackageList::package( PackageCategory* category,
 		return NULL;
 	}
 
-	PackageMap::iterator packageIterator =
-		m_packages.find( category->uniqueName() + name );
+	category = PackageCategory::shared( category );
+
+	Package* package = find( category, name );
 
-	// if there is no such package, then create one and retrieve again:
-	if( packageIterator == m_packages.end() ) {
+	// if there is no such package, then create one
+	if( package == NULL )
 		return insert( category, name ); // returns the new package pointer
+	else
+		return package;
+}
+
+/**
+ * Remove a package from the tree. The Package object is deleted
+ * as soon as no one else holds a reference to it.
+ * The given category is not taken over, so you still have to
+ * delete it yourself (unless it's a shared category).
+ *
+ * @param category  The category containing the package.
+ * @param name      The name string of the package that will be removed.
+ * @return  true if the package has been removed,
+ *          false if it wasn't in the tree.
+ */
+bool PackageList::remove( PackageCategory* category, const QString& name )
+{
+	Q_UINT32 atom;
+
+	if( m_count == 0 || category == NULL
+	    || categoryAtom( category, &atom ) == false )
+	{
+		return false;
+	}
+
+	int index = findSlot( atom, name, hash(atom, name) );
+	if( index < 0 )
+		return false;
+
+	m_slots[index].package = NULL;
+	m_slots[index].removed = true;
+	m_count--;
+	m_removedCount++;
+	m_orderDirty = true;
+	return true;
+}
+
+/**
+ * Calculate the hash value of a package from its category atom
+ * and its name.
+ */
+Q_UINT32 PackageList::hash( Q_UINT32 categoryAtom, const QString& name )
+{
+	Q_UINT32 hash = categoryAtom * 2654435761U;
+	const QChar* character = name.unicode();
+	uint length = name.length();
+
+	for( uint i = 0; i < length; i++ )
+		hash = (hash * 31) + character[i].unicode();
+
+	// mix the bits a little, as only the lower ones are used as index
+	hash ^= (hash >> 16);
+	return hash;
+}
+
+/**
+ * Retrieve the atom of a category, which is used for hashing.
+ * Shared categories already know their atom, for other ones
+ * it is looked up by their unique name.
+ *
+ * @return  true if the category has got an atom, false if there is
+ *          no such category at all (so there are no such packages).
+ */
+bool PackageList::categoryAtom( PackageCategory* category, Q_UINT32* atom )
+{
+	if( category->isShared() ) {
+		*atom = category->atom();
+		return true;
+	}
+	else {
+		return AtomTable::find( category->uniqueName(), atom );
+	}
+}
+
+/**
+ * Search the hash table for a package.
+ *
+ * @return  The index of the slot containing the package,
+ *          or -1 if the package is not in the table.
+ */
+int PackageList::findSlot( Q_UINT32 categoryAtom, const QString& name,
+                           Q_UINT32 hash ) const
+{
+	if( m_slots.empty() )
+		return -1;
+
+	uint mask = m_slots.size() - 1;
+	uint i = hash & mask;
+
+	// linear probing until an unused slot is found
+	while( m_slots[i].package != NULL || m_slots[i].removed )
+	{
+		const Slot& slot = m_slots[i];
+
+		if( slot.package != NULL && slot.hash == hash
+		    && slot.package->category()->atom() == categoryAtom
+		    && slot.package->name() == name )
+		{
+			return i;
+		}
+		i = (i + 1) & mask;
+	}
+	return -1;
+}
+
+/**
+ * Move all packages into a new hash table with the given number of slots,
+ * discarding all removed slots.
+ *
+ * @param capacity  The new number of slots, must be a power of two.
+ */
+void PackageList::rehash( uint capacity )
+{
+	QValueVector<Slot> oldSlots = m_slots;
+	m_slots = QValueVector<Slot>( capacity );
+	m_removedCount = 0;
+
+	uint mask = capacity - 1;
+
+	for( QValueVector<Slot>::iterator slotIterator = oldSlots.begin();
+	     slotIterator != oldSlots.end(); ++slotIterator )
+	{
+		if( (*slotIterator).package == NULL )
+			continue;
+
+		uint i = (*slotIterator).hash & mask;
+		while( m_slots[i].package != NULL )
+			i = (i + 1) & mask;
+
+		m_slots[i] = *slotIterator;
 	}
-	else { // The package already exists, delete the superfluous category
-		delete category;
-		return (*packageIterator).data(); // the real pointer to the package
+}
+
+/**
+ * Rebuild the ordered package list if the hash table has been
+ * modified since it was last built.
+ */
+void PackageList::ensureOrder() const
+{
+	QMutexLocker locker( &m_orderMutex );
+
+	if( m_orderDirty == false )
+		return;
+
+	QValueVector<PackageOrderEntry> entries( m_count );
+	uint entryIndex = 0;
+
+	for( QValueVector<Slot>::const_iterator slotIterator = m_slots.begin();
+	     slotIterator != m_slots.end(); ++slotIterator )
+	{
+		if( (*slotIterator).package == NULL )
+			continue;
+
+		Package* package = (*slotIterator).package.data();
+		entries[entryIndex].key =
+			package->category()->uniqueName() + package->name();
+		entries[entryIndex].package = package;
+		entryIndex++;
 	}
+
+	qHeapSort( entries );
+
+	m_order = QValueVector<KSharedPtr<Package> >( m_count );
+	for( uint i = 0; i < m_count; i++ )
+		m_order[i] = entries[i].package;
+
+	m_orderDirty = false;
 }
 
 
 PackageList::iterator PackageList::begin()
 {
-	return m_packages.begin();
+	ensureOrder();
+	return m_order.begin();
 }
 
 PackageList::iterator PackageList::end()
 {
-	return m_packages.end();
+	ensureOrder();
+	return m_order.end();
 }
 
 PackageList::const_iterator PackageList::begin() const
 {
-	return m_packages.begin();
+	ensureOrder();
+	return m_order.begin();
 }
 
 PackageList::const_iterator PackageList::end() const
 {
-	return m_packages.end();
+	ensureOrder();
+	return m_order.end();
 }
 
 } // namespace
@@ -22,8 +22,8 @@
 #define LIBPAKTPACKAGELIST_H
 
 #include <qstring.h>
-#include <qmap.h>
-#include <qvaluelist.h>
+#include <qvaluevector.h>
+#include <qmutex.h>
 
 #include <ksharedptr.h>
 
@@ -40,16 +40,27 @@ class PackageCategory;
  * PackageList is a class for managing Package objects.
  * It can be used as a representation of the package tree,
  * or to store package search results, or whatever.
+ *
+ * Packages are stored in an open addressing hash table which is indexed
+ * by the atom of the (shared) package category and the package name,
+ * so looking up a package doesn't need to build any temporary strings.
+ * For iteration, an ordered list of the packages (sorted by category
+ * and name) is built when it's first needed after a modification.
+ * Iterators are invalidated by any modification of the list,
+ * but several threads can iterate an unmodified list at the same time.
  */
 class PackageList
 {
 public:
-	typedef QMapIterator<QString,KSharedPtr<Package> > iterator;
-	typedef QMapConstIterator<QString,KSharedPtr<Package> > const_iterator;
+	typedef QValueVector<KSharedPtr<Package> >::iterator iterator;
+	typedef QValueVector<KSharedPtr<Package> >::const_iterator const_iterator;
 
 	PackageList();
+	PackageList( const PackageList& other );
 	virtual ~PackageList() {};
 
+	PackageList& operator=( const PackageList& other );
+
 	int count();
 	void clear();
 
@@ -57,7 +68,9 @@ public:
 	Package* insert( PackageCategory* category, const QString& name );
 
 	bool contains( PackageCategory* category, const QString& name );
+	Package* find( PackageCategory* category, const QString& name );
 	Package* package( PackageCategory* category, const QString& name );
+	bool remove( PackageCategory* category, const QString& name );
 
 	iterator begin();
 	iterator end();
@@ -69,10 +82,42 @@ protected:
 	                                const QString& name ) = 0;
 
 private:
-	typedef QMap<QString,KSharedPtr<Package> > PackageMap;
-
-	//! The internal list of packages in the tree.
-	PackageMap m_packages;
+	/**
+	 * A slot of the hash table. A slot that has never been used contains
+	 * a NULL package and is not marked as removed.
+	 */
+	struct Slot
+	{
+		Slot() : hash( 0 ), removed( false ) {};
+
+		KSharedPtr<Package> package;
+		Q_UINT32 hash;
+		bool removed;
+	};
+
+	static Q_UINT32 hash( Q_UINT32 categoryAtom, const QString& name );
+	static bool categoryAtom( PackageCategory* category, Q_UINT32* atom );
+
+	int findSlot( Q_UINT32 categoryAtom, const QString& name,
+	              Q_UINT32 hash ) const;
+	void rehash( uint capacity );
+	void ensureOrder() const;
+	void copyFrom( const PackageList& other );
+
+	//! The hash table, its size is always a power of two (or zero).
+	QValueVector<Slot> m_slots;
+	//! The number of packages in the hash table.
+	uint m_count;
+	//! The number of slots that are marked as removed.
+	uint m_removedCount;
+
+	//! The packages in the order of their unique names, for iteration.
+	mutable QValueVector<KSharedPtr<Package> > m_order;
+	//! true if m_order has to be rebuilt before it's used.
+	mutable bool m_orderDirty;
+	//! Guards the rebuilding of m_order, which might be iterated by several threads.
+	//! Each list has its own one, it's not copied together with the packages.
+	mutable QMutex m_orderMutex;
 };
 
 /**
@@ -93,7 +138,7 @@ public:
 
 	T* insert( Package* package )
 	{
-		return PackageList::package( (T*) package );
+		return (T*) PackageList::insert( package );
 	}
 
 	T* insert( PackageCategory* category, const QString& name )
@@ -101,6 +146,11 @@ public:
 		return package( category, name );
 	}
 
+	T* find( PackageCategory* category, const QString& name )
+	{
+		return (T*) PackageList::find( category, name );
+	}
+
 	T* package( PackageCategory* category, const QString& name )
 	{
 		return (T*) PackageList::package( category, name );
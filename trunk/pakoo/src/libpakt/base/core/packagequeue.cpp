@@ -84,7 +84,7 @@ PackageQueue::iterator PackageQueue::appendPackage( Package* package )
 PackageQueue::iterator PackageQueue::appendPackageVersion(
 	PackageVersion* version )
 {
-	return append( QueuedItem( PackageType,
+	return append( QueuedItem( PackageVersionType,
 	                           KSharedPtr<KShared>(version) ) );
 }
 
@@ -0,0 +1,299 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "packagesearchindex.h"
+
+#include "package.h"
+#include "packagelist.h"
+
+#include <qstringlist.h>
+#include <qtl.h>
+
+
+namespace libpakt {
+
+/**
+ * The number of posting lists. Trigrams are hashed into these, and
+ * different trigrams with the same hash only cost a few more text
+ * comparisons. Should be a prime number.
+ */
+#define TRIGRAMBUCKETS 65521
+
+
+/**
+ * Initialize an empty index.
+ */
+PackageSearchIndex::PackageSearchIndex()
+{
+}
+
+PackageSearchIndex::~PackageSearchIndex()
+{
+}
+
+/**
+ * Remove all packages from the index.
+ */
+void PackageSearchIndex::clear()
+{
+	m_packages.clear();
+	m_texts.clear();
+	m_entries.clear();
+	m_postings.clear();
+}
+
+/**
+ * Rebuild the index so that it contains all packages of the given list,
+ * with the details that they have at the moment.
+ */
+void PackageSearchIndex::setPackageList( PackageList* packages )
+{
+	clear();
+	if( packages == NULL )
+		return;
+
+	m_packages.reserve( packages->count() );
+	m_texts.reserve( packages->count() );
+
+	PackageList::iterator packageIteratorEnd = packages->end();
+
+	for( PackageList::iterator packageIterator = packages->begin();
+	     packageIterator != packageIteratorEnd; ++packageIterator )
+	{
+		insertPackage( (*packageIterator).data() );
+	}
+}
+
+/**
+ * Add a package to the index, with the details that it has at the moment.
+ * The package must not be in the index already.
+ */
+void PackageSearchIndex::insertPackage( Package* package )
+{
+	insertPackage( package, packageText(package) );
+}
+
+/**
+ * Add a package to the index with the given text, which has to be
+ * the one that packageText() returns. This doesn't read the package,
+ * so it can be done in another thread while the package is changing.
+ * The package must not be in the index already.
+ */
+void PackageSearchIndex::insertPackage( Package* package,
+                                        const QString& text )
+{
+	if( m_postings.isEmpty() )
+		m_postings.resize( TRIGRAMBUCKETS );
+
+	uint entry = m_packages.count();
+
+	m_packages.append( package );
+	m_texts.append( text );
+	m_entries.insert( package, entry );
+
+	insertTrigrams( entry, m_texts[entry], QString::null );
+}
+
+/**
+ * Update the text of a package that has got new details, like its
+ * description after it has been loaded by a PackageLoader.
+ * Packages that are not in the index are ignored.
+ */
+void PackageSearchIndex::updatePackage( Package* package )
+{
+	QMap<Package*,uint>::iterator entryIterator = m_entries.find( package );
+	if( entryIterator == m_entries.end() )
+		return;
+
+	uint entry = *entryIterator;
+	QString text = packageText( package );
+
+	if( text == m_texts[entry] )
+		return;
+
+	// trigrams of the old text stay in the posting lists, they
+	// just cause one more text comparison if they're searched for
+	insertTrigrams( entry, text, m_texts[entry] );
+	m_texts[entry] = text;
+}
+
+/**
+ * Return the number of packages in the index.
+ */
+uint PackageSearchIndex::count() const
+{
+	return m_packages.count();
+}
+
+/**
+ * Find the packages whose text contains all words of the search text,
+ * case insensitively. The packages are returned in the order of the
+ * package list that has been indexed. If the search text doesn't contain
+ * any words, all packages are returned.
+ */
+QValueVector<Package*> PackageSearchIndex::find(
+	const QString& searchText ) const
+{
+	uint entryCount = m_packages.count();
+	if( entryCount == 0 )
+		return QValueVector<Package*>();
+
+	QValueVector<bool> matches( entryCount, true );
+	QStringList words = QStringList::split(
+		' ', searchText.simplifyWhiteSpace().lower() );
+
+	for( QStringList::iterator wordIterator = words.begin();
+	     wordIterator != words.end(); ++wordIterator )
+	{
+		const QString& word = *wordIterator;
+
+		if( word.length() >= 3 )
+		{
+			// count for each entry how many of the word's trigrams
+			// it contains, only entries with all of them can match
+			QValueVector<uint> buckets = trigramBuckets( word );
+			QValueVector<uint> hits( entryCount, 0 );
+
+			for( uint i = 0; i < buckets.count(); i++ )
+			{
+				const QValueVector<uint>& postings = m_postings[buckets[i]];
+
+				for( uint p = 0; p < postings.count(); p++ ) {
+					if( hits[postings[p]] == i )
+						hits[postings[p]] = i + 1;
+				}
+			}
+
+			for( uint entry = 0; entry < entryCount; entry++ )
+			{
+				if( matches[entry] == false )
+					continue;
+
+				matches[entry] = ( hits[entry] == buckets.count()
+					&& m_texts[entry].find(word) != -1 );
+			}
+		}
+		else // too short for trigrams
+		{
+			for( uint entry = 0; entry < entryCount; entry++ )
+			{
+				if( matches[entry] == true )
+					matches[entry] = ( m_texts[entry].find(word) != -1 );
+			}
+		}
+	}
+
+	QValueVector<Package*> packages;
+	for( uint entry = 0; entry < entryCount; entry++ )
+	{
+		if( matches[entry] == true )
+			packages.append( m_packages[entry] );
+	}
+	return packages;
+}
+
+/**
+ * Return the lower case text of a package as it is stored in the index.
+ * The text doesn't share its data with strings of the package, so it
+ * can be handed to another thread.
+ */
+QString PackageSearchIndex::packageText( Package* package )
+{
+	return searchableText( package ).lower();
+}
+
+/**
+ * Retrieve the text of a package that should be searchable.
+ * The default implementation returns the package name and the
+ * description, backends may add whatever else is worth searching.
+ */
+QString PackageSearchIndex::searchableText( Package* package )
+{
+	const QString& name = package->name();
+	QString text( name.unicode(), name.length() );
+	return text + "\n" + package->description();
+}
+
+/**
+ * Add an entry to the posting lists of all trigrams in the given text,
+ * except for those that are also contained in the previous text.
+ */
+void PackageSearchIndex::insertTrigrams( uint entry, const QString& text,
+                                         const QString& previousText )
+{
+	QValueVector<uint> buckets = trigramBuckets( text );
+	QValueVector<uint> previousBuckets = trigramBuckets( previousText );
+
+	uint previous = 0;
+
+	for( uint i = 0; i < buckets.count(); i++ )
+	{
+		// both bucket lists are sorted
+		while( previous < previousBuckets.count()
+		       && previousBuckets[previous] < buckets[i] )
+		{
+			previous++;
+		}
+		if( previous < previousBuckets.count()
+		    && previousBuckets[previous] == buckets[i] )
+		{
+			continue;
+		}
+
+		m_postings[buckets[i]].append( entry );
+	}
+}
+
+/**
+ * Return the sorted posting list indices of all trigrams in a text,
+ * each of them only once.
+ */
+QValueVector<uint> PackageSearchIndex::trigramBuckets( const QString& text )
+{
+	QValueVector<uint> buckets;
+	if( text.length() < 3 )
+		return buckets;
+
+	const QChar* chars = text.unicode();
+	uint trigramCount = text.length() - 2;
+	buckets.reserve( trigramCount );
+
+	for( uint i = 0; i < trigramCount; i++ )
+	{
+		uint hash = chars[i].unicode();
+		hash = hash * 31 + chars[i+1].unicode();
+		hash = hash * 31 + chars[i+2].unicode();
+		buckets.append( hash % TRIGRAMBUCKETS );
+	}
+
+	qHeapSort( buckets );
+
+	// remove duplicates
+	uint uniqueCount = 0;
+	for( uint i = 0; i < buckets.count(); i++ )
+	{
+		if( uniqueCount == 0 || buckets[uniqueCount-1] != buckets[i] )
+			buckets[uniqueCount++] = buckets[i];
+	}
+	buckets.resize( uniqueCount );
+
+	return buckets;
+}
+
+} // namespace
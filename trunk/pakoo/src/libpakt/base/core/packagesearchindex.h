@@ -0,0 +1,94 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTPACKAGESEARCHINDEX_H
+#define LIBPAKTPACKAGESEARCHINDEX_H
+
+#include <qstring.h>
+#include <qmap.h>
+#include <qvaluevector.h>
+
+
+namespace libpakt {
+
+class Package;
+class PackageList;
+
+/**
+ * PackageSearchIndex is a full-text index over the packages of a
+ * package list. For each package, it stores a lower case text made up
+ * of its name, its description and whatever else searchableText()
+ * returns, and it keeps a posting list of packages for each trigram
+ * (three consecutive characters) of these texts.
+ *
+ * find() looks up the trigrams of the search words and only compares
+ * the texts of those packages that contain all of them, so a search
+ * over the whole tree doesn't have to look at every single package.
+ * Words shorter than three characters are compared with all texts
+ * that are still in question.
+ *
+ * Package details are usually loaded after the index has been built,
+ * so call updatePackage() when a package has got new details.
+ * The index only stores pointers to the packages, which is why the
+ * package list has to live longer than the index contents.
+ * An index can be filled in another thread by PackageSearchIndexBuilder,
+ * as long as it's not used anywhere else in the meantime. The texts
+ * are taken in the main thread beforehand, so that the packages aren't
+ * read while their details are being loaded. Otherwise, the functions
+ * have to be called from the main thread.
+ *
+ * @short  A trigram index for searching package names and descriptions.
+ */
+class PackageSearchIndex
+{
+public:
+	PackageSearchIndex();
+	virtual ~PackageSearchIndex();
+
+	void clear();
+	void setPackageList( PackageList* packages );
+	void insertPackage( Package* package );
+	void insertPackage( Package* package, const QString& text );
+	void updatePackage( Package* package );
+	QString packageText( Package* package );
+
+	uint count() const;
+	QValueVector<Package*> find( const QString& searchText ) const;
+
+protected:
+	virtual QString searchableText( Package* package );
+
+private:
+	void insertTrigrams( uint entry, const QString& text,
+	                     const QString& previousText );
+	static QValueVector<uint> trigramBuckets( const QString& text );
+
+	//! The indexed packages, the position is the entry number.
+	QValueVector<Package*> m_packages;
+	//! The lower case searchable text of each entry.
+	QValueVector<QString> m_texts;
+	//! The entry number of each indexed package.
+	QMap<Package*,uint> m_entries;
+	//! The entries containing each trigram, indexed by trigram hash.
+	QValueVector< QValueVector<uint> > m_postings;
+};
+
+}
+
+#endif // LIBPAKTPACKAGESEARCHINDEX_H
@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "packagesearchindexbuilder.h"
+
+#include "packagesearchindex.h"
+
+
+namespace libpakt {
+
+/**
+ * Initialize the job with the index that is going to be filled
+ * and the packages that it will contain, and take the current texts
+ * of these packages. The job keeps its own copies of the package
+ * pointers and texts, so none of their data is shared with the
+ * calling thread when the job is started.
+ */
+PackageSearchIndexBuilder::PackageSearchIndexBuilder(
+	PackageSearchIndex* index, const QValueVector<Package*>& packages )
+	: ThreadedJob(), m_index( index )
+{
+	m_packages.reserve( packages.count() );
+	m_texts.reserve( packages.count() );
+
+	for( uint i = 0; i < packages.count(); i++ )
+	{
+		m_packages.append( packages[i] );
+		if( m_index != NULL )
+			m_texts.append( m_index->packageText(packages[i]) );
+	}
+}
+
+/**
+ * Return the index that is filled by this job.
+ */
+PackageSearchIndex* PackageSearchIndexBuilder::index()
+{
+	return m_index;
+}
+
+/**
+ * Clear the index and insert all packages with their texts, in the order
+ * that they have been given.
+ *
+ * @see ThreadedJob::start()
+ * @see ThreadedJob::perform()
+ */
+IJob::JobResult PackageSearchIndexBuilder::performThread()
+{
+	if( m_index == NULL )
+		return Failure;
+
+	m_index->clear();
+
+	for( uint i = 0; i < m_packages.count(); i++ )
+	{
+		if( aborting() )
+			return Failure;
+
+		m_index->insertPackage( m_packages[i], m_texts[i] );
+	}
+	return Success;
+}
+
+} // namespace
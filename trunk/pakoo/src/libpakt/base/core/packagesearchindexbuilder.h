@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTPACKAGESEARCHINDEXBUILDER_H
+#define LIBPAKTPACKAGESEARCHINDEXBUILDER_H
+
+#include "threadedjob.h"
+
+#include <qvaluevector.h>
+#include <qstring.h>
+
+
+namespace libpakt {
+
+class Package;
+class PackageSearchIndex;
+
+/**
+ * PackageSearchIndexBuilder fills a PackageSearchIndex with a set of
+ * packages in its own thread, so that building the index for the whole
+ * tree doesn't block the user interface. The texts of the packages are
+ * taken by the constructor, which has to be called in the main thread.
+ * The thread itself only builds the trigram lists and never reads the
+ * packages, whose details may be loaded by other threads meanwhile.
+ *
+ * The index must not be used by anyone else while the job is running.
+ * When it has finished, the caller can take it over, and update the
+ * packages that have changed in the meantime with
+ * PackageSearchIndex::updatePackage().
+ *
+ * @short  A job for building a PackageSearchIndex in the background.
+ */
+class PackageSearchIndexBuilder : public ThreadedJob
+{
+public:
+	PackageSearchIndexBuilder( PackageSearchIndex* index,
+	                           const QValueVector<Package*>& packages );
+
+	PackageSearchIndex* index();
+
+protected:
+	JobResult performThread();
+
+private:
+	//! The index that is filled by the job.
+	PackageSearchIndex* m_index;
+	//! The packages that are inserted into the index.
+	QValueVector<Package*> m_packages;
+	//! The index text of each package, as returned by packageText().
+	QValueVector<QString> m_texts;
+};
+
+}
+
+#endif // LIBPAKTPACKAGESEARCHINDEXBUILDER_H
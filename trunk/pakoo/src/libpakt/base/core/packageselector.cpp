@@ -17,11 +17,16 @@
  *   Free Software Foundation, Inc.,                                       *
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
-
 #include "packageselector.h"
 
 #include "package.h"
+#include "packageversion.h"
 #include "packagelist.h"
+#include "atomtable.h"
+
+#include <qthread.h>
+#include <qptrlist.h>
+#include <qtl.h>
 
 #include <klocale.h>
 #include <kdebug.h>
@@ -61,15 +66,52 @@
 
 namespace libpakt {
 
+/**
+ * Chunks of packages that are tested in parallel have at least this size,
+ * smaller package lists are not worth starting additional threads.
+ */
+static const uint MIN_CHUNK_SIZE = 2048;
+
+
+/**
+ * A thread that tests one chunk of the packages against the compiled plan.
+ */
+class PackageSelector::Worker : public QThread
+{
+public:
+	Worker( PackageSelector* selector, uint begin, uint end )
+		: QThread(), m_selector( selector ), m_begin( begin ), m_end( end ) {}
+
+protected:
+	void run() { m_selector->evaluateRange( m_begin, m_end ); }
+
+private:
+	PackageSelector* m_selector;
+	uint m_begin;
+	uint m_end;
+};
+
+
 /**
  * Initialize this object without setting filters or package lists.
  */
 PackageSelector::PackageSelector() : ThreadedJob()
 {
+	m_sourceList = NULL;
+	m_destList = NULL;
+	m_workerThreadCount = 1;
 	m_includedCategories = NULL;
 	m_excludedCategories = NULL;
-	m_includeInstalledPackages = NULL;
-	m_excludeInstalledPackages = NULL;
+	m_includedKeywords = NULL;
+	m_excludedKeywords = NULL;
+	m_includedLicenses = NULL;
+	m_excludedLicenses = NULL;
+	m_includedPackages = NULL;
+	m_excludedPackages = NULL;
+	m_includedPropertyMask = NoProperty;
+	m_includedPropertyValues = NoProperty;
+	m_excludedPropertyMask = NoProperty;
+	m_excludedPropertyValues = NoProperty;
 	clearFilters();
 }
 
@@ -80,6 +122,17 @@ PackageSelector::PackageSelector() : ThreadedJob()
 PackageSelector::PackageSelector( const PackageSelector& otherSelector )
 	: ThreadedJob()
 {
+	m_sourceList = NULL;
+	m_destList = NULL;
+	m_workerThreadCount = 1;
+	m_includedCategories = NULL;
+	m_excludedCategories = NULL;
+	m_includedKeywords = NULL;
+	m_excludedKeywords = NULL;
+	m_includedLicenses = NULL;
+	m_excludedLicenses = NULL;
+	m_includedPackages = NULL;
+	m_excludedPackages = NULL;
 	copyFrom( otherSelector );
 }
 
@@ -113,6 +166,17 @@ void PackageSelector::setDestinationList( PackageList* destList )
 	m_destList = destList;
 }
 
+/**
+ * Set the maximum number of threads that test packages in parallel.
+ * Additional threads are only started for large package lists.
+ * The default is 1, which means that all packages are tested
+ * in the selector's own thread.
+ */
+void PackageSelector::setWorkerThreadCount( int count )
+{
+	m_workerThreadCount = QMAX( count, 1 );
+}
+
 /**
  * Delete all filters that have been previously set,
  * and call setAllPackagesFilter( Exclude ).
@@ -123,7 +187,11 @@ void PackageSelector::clearFilters()
 {
 	setAllPackagesFilter( Exclude );
 	clearCategoryFilters();
-	clearIsInstalledFilters();
+	clearPropertyFilters( InstalledProperty | UpdatableProperty
+	                      | MaskedProperty | OverlayProperty );
+	clearKeywordFilters();
+	clearLicenseFilters();
+	clearPackageSetFilters();
 }
 
 /**
@@ -181,24 +249,161 @@ void PackageSelector::clearCategoryFilters()
  */
 void PackageSelector::addIsInstalledFilter( FilterType filterType,
                                             bool installed )
+{
+	addPropertyFilter( filterType, InstalledProperty, installed );
+}
+
+/**
+ * Delete all filters checking for a package's status of installation.
+ */
+void PackageSelector::clearIsInstalledFilters()
+{
+	clearPropertyFilters( InstalledProperty );
+}
+
+
+/**
+ * Add a filter for a package property, like being installed or
+ * being updatable. The filter matches if the package has the property
+ * and 'hasProperty' is true, or if it doesn't have the property and
+ * 'hasProperty' is false. A new filter for the same property and
+ * filter type replaces the previous one.
+ *
+ * @see FilterType
+ * @see PackageProperty
+ */
+void PackageSelector::addPropertyFilter( FilterType filterType,
+                                         PackageProperty property,
+                                         bool hasProperty )
 {
 	if( filterType == Include ) {
-		ENSURE_EXISTANCE( m_includeInstalledPackages, bool );
-		*m_includeInstalledPackages = installed;
+		m_includedPropertyMask |= property;
+		if( hasProperty )
+			m_includedPropertyValues |= property;
+		else
+			m_includedPropertyValues &= ~property;
 	}
 	else if( filterType == Exclude ) {
-		ENSURE_EXISTANCE( m_excludeInstalledPackages, bool );
-		*m_excludeInstalledPackages = installed;
+		m_excludedPropertyMask |= property;
+		if( hasProperty )
+			m_excludedPropertyValues |= property;
+		else
+			m_excludedPropertyValues &= ~property;
 	}
 }
 
 /**
- * Delete all filters checking for a package's status of installation.
+ * Delete all filters for the given package properties,
+ * which may be several PackageProperty flags combined.
  */
-void PackageSelector::clearIsInstalledFilters()
+void PackageSelector::clearPropertyFilters( uint properties )
 {
-	SAFEDELETE( m_includeInstalledPackages );
-	SAFEDELETE( m_excludeInstalledPackages );
+	m_includedPropertyMask &= ~properties;
+	m_includedPropertyValues &= ~properties;
+	m_excludedPropertyMask &= ~properties;
+	m_excludedPropertyValues &= ~properties;
+}
+
+
+/**
+ * Add a filter for keywords (like "x86" or "~ppc" in Gentoo). The filter
+ * matches a package if at least one of its versions has the given keyword.
+ * For inclusion, all keyword filters have to match.
+ * Backends without keywords never match this filter.
+ *
+ * @see FilterType
+ */
+void PackageSelector::addKeywordFilter( FilterType filterType,
+                                        const QString& keyword )
+{
+	if( filterType == Include ) {
+		ENSURE_EXISTANCE( m_includedKeywords, QStringList );
+		m_includedKeywords->append( keyword );
+	}
+	else if( filterType == Exclude ) {
+		ENSURE_EXISTANCE( m_excludedKeywords, QStringList );
+		m_excludedKeywords->append( keyword );
+	}
+}
+
+/**
+ * Delete all keyword filters that have been previously set.
+ */
+void PackageSelector::clearKeywordFilters()
+{
+	SAFEDELETE( m_includedKeywords );
+	SAFEDELETE( m_excludedKeywords );
+}
+
+
+/**
+ * Add a filter for licenses. The filter matches a package if at least
+ * one of its versions uses the given license. For inclusion, all license
+ * filters have to match. Backends without licenses never match this filter.
+ *
+ * @see FilterType
+ */
+void PackageSelector::addLicenseFilter( FilterType filterType,
+                                        const QString& license )
+{
+	if( filterType == Include ) {
+		ENSURE_EXISTANCE( m_includedLicenses, QStringList );
+		m_includedLicenses->append( license );
+	}
+	else if( filterType == Exclude ) {
+		ENSURE_EXISTANCE( m_excludedLicenses, QStringList );
+		m_excludedLicenses->append( license );
+	}
+}
+
+/**
+ * Delete all license filters that have been previously set.
+ */
+void PackageSelector::clearLicenseFilters()
+{
+	SAFEDELETE( m_includedLicenses );
+	SAFEDELETE( m_excludedLicenses );
+}
+
+
+/**
+ * Add a filter for a fixed set of packages, like the results of a
+ * PackageSearchIndex query. The filter matches a package if it's
+ * contained in the given set. A new set filter replaces the previous
+ * one of the same filter type.
+ *
+ * @see FilterType
+ * @see PackageSearchIndex::find
+ */
+void PackageSelector::addPackageSetFilter( FilterType filterType,
+                                           const QValueVector<Package*>& packages )
+{
+	QValueVector<Package*>* packageSet;
+
+	if( filterType == Include ) {
+		ENSURE_EXISTANCE( m_includedPackages, QValueVector<Package*> );
+		packageSet = m_includedPackages;
+	}
+	else if( filterType == Exclude ) {
+		ENSURE_EXISTANCE( m_excludedPackages, QValueVector<Package*> );
+		packageSet = m_excludedPackages;
+	}
+	else {
+		return;
+	}
+
+	// sorted by pointer, for looking up packages with a binary search
+	*packageSet = packages;
+	qHeapSort( *packageSet );
+}
+
+/**
+ * Delete all filters for fixed sets of packages.
+ */
+void PackageSelector::clearPackageSetFilters()
+{
+	SAFEDELETE( m_includedPackages );
+	SAFEDELETE( m_excludedPackages );
 }
 
 
@@ -210,12 +415,20 @@ void PackageSelector::clearIsInstalledFilters()
 void PackageSelector::copyFrom( const PackageSelector& otherSelector )
 {
 	m_allPackagesFilter = otherSelector.m_allPackagesFilter;
-	DEEPCOPY( otherSelector, m_includeInstalledPackages, bool );
-	DEEPCOPY( otherSelector, m_excludeInstalledPackages, bool );
+	m_includedPropertyMask = otherSelector.m_includedPropertyMask;
+	m_includedPropertyValues = otherSelector.m_includedPropertyValues;
+	m_excludedPropertyMask = otherSelector.m_excludedPropertyMask;
+	m_excludedPropertyValues = otherSelector.m_excludedPropertyValues;
 	DEEPCOPY( otherSelector,
 	          m_includedCategories, QValueList<PackageCategory> );
 	DEEPCOPY( otherSelector,
 	          m_excludedCategories, QValueList<PackageCategory> );
+	DEEPCOPY( otherSelector, m_includedKeywords, QStringList );
+	DEEPCOPY( otherSelector, m_excludedKeywords, QStringList );
+	DEEPCOPY( otherSelector, m_includedLicenses, QStringList );
+	DEEPCOPY( otherSelector, m_excludedLicenses, QStringList );
+	DEEPCOPY( otherSelector, m_includedPackages, QValueVector<Package*> );
+	DEEPCOPY( otherSelector, m_excludedPackages, QValueVector<Package*> );
 }
 
 
@@ -250,27 +463,162 @@ IJob::JobResult PackageSelector::performThread()
 	}
 	m_destList->clear();
 
+	compilePlan();
+
+	// split the packages into chunks and test them in parallel
+	uint packageCount = m_planPackages.count();
+	uint workerCount = QMIN( (uint) m_workerThreadCount,
+	                         packageCount / MIN_CHUNK_SIZE );
+
+	if( workerCount < 1 )
+		workerCount = 1;
+
+	QPtrList<Worker> workers;
+	workers.setAutoDelete( true );
+
+	for( uint i = 1; i < workerCount; i++ )
+	{
+		Worker* worker = new Worker( this,
+			(packageCount * i) / workerCount,
+			(packageCount * (i + 1)) / workerCount );
+		workers.append( worker );
+		worker->start();
+	}
+
+	// the first chunk is done in this thread
+	evaluateRange( 0, packageCount / workerCount );
+
+	for( Worker* worker = workers.first(); worker != NULL;
+	     worker = workers.next() )
+	{
+		worker->wait();
+	}
+	workers.clear();
+
+	if( aborting() )
+	{
+		kdDebug() << i18n( "PackageSelector debug output",
+			"PackageSelector::performThread(): "
+			"Aborting on user request" )
+			<< endl;
+		clearPlan();
+		return Failure;
+	}
+
+	// merge the results, in the order of the source list
+	for( uint i = 0; i < packageCount; i++ )
+	{
+		if( m_planResults[i] == 1 )
+			m_destList->insert( m_planPackages[i] );
+	}
+
+	clearPlan();
+	return Success;
+}
+
+/**
+ * Prepare the filters for testing lots of packages. Category filters are
+ * decided once for each category, and stored in m_planResults so that
+ * the workers don't need to touch any category objects. Keyword and
+ * license filters are converted to atoms.
+ */
+void PackageSelector::compilePlan()
+{
+	m_planPackages.clear();
+	m_planPackages.reserve( m_sourceList->count() );
+	m_planResults.clear();
+	m_planResults.reserve( m_sourceList->count() );
+	m_planDerivedProperties.clear();
+
+	bool hasCategoryFilters =
+		( m_includedCategories != NULL || m_excludedCategories != NULL );
+
+	// the packages of one category come one after another,
+	// so each verdict is only computed once in most cases
+	PackageCategory* lastCategory = NULL;
+	uint lastVerdict = 0;
+
+	m_planProperties = m_includedPropertyMask | m_excludedPropertyMask;
+
+	// The masked and updatable properties come from the derived package
+	// state, which copies strings when it's computed. So they are retrieved
+	// here, and the workers only read the copies in the plan.
+	bool needsDerivedState =
+		( m_planProperties & (MaskedProperty | UpdatableProperty) );
+	if( needsDerivedState )
+		m_planDerivedProperties.reserve( m_sourceList->count() );
+
 	PackageList::iterator packageIteratorEnd = m_sourceList->end();
 
-	// Iterate through all packages
 	for( PackageList::iterator packageIterator = m_sourceList->begin();
 	     packageIterator != packageIteratorEnd; ++packageIterator )
 	{
-		// test the current package
-		if( includePackage( *packageIterator ) == true )
-			m_destList->insert( *packageIterator );
+		Package* package = (*packageIterator).data();
+		m_planPackages.append( package );
+
+		if( hasCategoryFilters && package->category() != lastCategory ) {
+			lastCategory = package->category();
+			lastVerdict = categoryVerdict( lastCategory );
+		}
+		m_planResults.append( lastVerdict );
 
-		if( aborting() )
+		if( needsDerivedState )
 		{
-			kdDebug() << i18n( "PackageSelector debug output",
-				"PackageSelector::performThread(): "
-				"Aborting on user request" )
-				<< endl;
-			return Failure;
+			uint derivedProperties = NoProperty;
+			if( package->containsAvailableVersion() == false )
+				derivedProperties |= MaskedProperty;
+			if( package->canUpdate() )
+				derivedProperties |= UpdatableProperty;
+
+			m_planDerivedProperties.append( derivedProperties );
 		}
 	}
 
-	return Success;
+	m_includedKeywordAtoms = atoms( m_includedKeywords );
+	m_excludedKeywordAtoms = atoms( m_excludedKeywords );
+	m_includedLicenseAtoms = atoms( m_includedLicenses );
+	m_excludedLicenseAtoms = atoms( m_excludedLicenses );
+}
+
+/**
+ * Release the memory that has been used by the compiled plan.
+ */
+void PackageSelector::clearPlan()
+{
+	m_planPackages.clear();
+	m_planResults.clear();
+	m_planDerivedProperties.clear();
+	m_includedKeywordAtoms.clear();
+	m_excludedKeywordAtoms.clear();
+	m_includedLicenseAtoms.clear();
+	m_excludedLicenseAtoms.clear();
+}
+
+/**
+ * Test the packages from begin to end (excluding) against the compiled
+ * plan. Afterwards, m_planResults contains 1 for each of these packages
+ * that matches, and 0 for the others. Called from the worker threads.
+ */
+void PackageSelector::evaluateRange( uint begin, uint end )
+{
+	if( begin >= end )
+		return;
+
+	// only read through the const operators, so that the vectors
+	// are never detached while other threads are using them
+	const QValueVector<Package*>& packages = m_planPackages;
+	const QValueVector<uint>& derivedProperties = m_planDerivedProperties;
+	bool hasDerivedProperties = ( derivedProperties.isEmpty() == false );
+	uint* results = &m_planResults[0];
+
+	for( uint i = begin; i < end; i++ )
+	{
+		results[i] = includePackage( packages[i], results[i],
+			hasDerivedProperties ? derivedProperties[i] : NoProperty ) ? 1 : 0;
+
+		if( (i & 255) == 0 && aborting() )
+			return;
+	}
 }
 
 /**
@@ -278,74 +626,197 @@ IJob::JobResult PackageSelector::performThread()
  * will be included in the result package list. Do this check for each package
  * and you know which ones to take. true means the package should be included,
  * false means it shouldn't be.
+ *
+ * @param categoryVerdict    The CategoryVerdict flags of the package's category.
+ * @param derivedProperties  The masked and updatable properties of the
+ *                           package, as retrieved by compilePlan().
  */
-bool PackageSelector::includePackage( Package* package )
+bool PackageSelector::includePackage( Package* package, uint categoryVerdict,
+                                      uint derivedProperties )
 {
-	// exclusion filters first, they have higher priority
-	if( exclusionFilterMatches(package) )
+	uint properties = ( m_planProperties == NoProperty ) ? NoProperty
+		: packageProperties( package, derivedProperties, m_planProperties );
+
+	// exclusion filters first, they have higher priority.
+	// The property filter matches if any of its properties matches.
+	if( (categoryVerdict & CategoryExcluded)
+	    || (~(properties ^ m_excludedPropertyValues) & m_excludedPropertyMask)
+	    || (m_excludedPackages != NULL
+	        && containsPackage(*m_excludedPackages, package)) )
+	{
 		return false;
+	}
+	for( uint i = 0; i < m_excludedKeywordAtoms.count(); i++ ) {
+		if( hasKeyword(package, m_excludedKeywordAtoms[i]) )
+			return false;
+	}
+	for( uint i = 0; i < m_excludedLicenseAtoms.count(); i++ ) {
+		if( hasLicense(package, m_excludedLicenseAtoms[i]) )
+			return false;
+	}
 
 	// all exclusions are done (and don't apply for this package,
-	// because otherwise we wouldn't come here): so, if any inclusion filter
-	// matches, then the package is in.
-	if( m_allPackagesFilter == Include || inclusionFilterMatches(package) )
+	// because otherwise we wouldn't come here): so, if all inclusion
+	// filters match, then the package is in.
+	if( m_allPackagesFilter == Include )
 		return true;
-	else
+
+	if( (categoryVerdict & CategoryNotIncluded)
+	    || ((properties ^ m_includedPropertyValues) & m_includedPropertyMask)
+	    || (m_includedPackages != NULL
+	        && !containsPackage(*m_includedPackages, package)) )
+	{
 		return false;
+	}
+	for( uint i = 0; i < m_includedKeywordAtoms.count(); i++ ) {
+		if( !hasKeyword(package, m_includedKeywordAtoms[i]) )
+			return false;
+	}
+	for( uint i = 0; i < m_includedLicenseAtoms.count(); i++ ) {
+		if( !hasLicense(package, m_includedLicenseAtoms[i]) )
+			return false;
+	}
+	return true;
 }
 
 /**
- * Returns true if there is at least one inclusion filter that matches
- * the given package. The All Packages Filter is an exception which is
- * not checked in this function. If an inclusion filter matches (and
- * no exclusion filter does) then a package will be included in the
- * result package list. Returns false if there is no inclusion filter
- * matching this package.
+ * Retrieve the requested properties of a package, as PackageProperty
+ * flags, with a single walk over its versions. The masked and updatable
+ * properties are not retrieved from the package, they are taken from
+ * the given flags that compilePlan() has stored in the plan.
  */
-bool PackageSelector::inclusionFilterMatches( Package* package )
+uint PackageSelector::packageProperties( Package* package,
+                                         uint derivedProperties,
+                                         uint properties )
 {
-	// included categories filter
-	if( m_includedCategories != NULL )
-	{
-		FOREACH( categoryIterator, m_includedCategories, PackageCategory )
-		{
-			if( !package->category()->isContainedIn(*categoryIterator) )
-				return false;
-		}
-	}
-	// include packages with 'package.installed == given value' filter
-	if( m_includeInstalledPackages != NULL )
+	uint result = NoProperty;
+
+	Package::versioniterator versionIteratorEnd = package->versionEnd();
+
+	for( Package::versioniterator versionIterator = package->versionBegin();
+	     versionIterator != versionIteratorEnd; ++versionIterator )
 	{
-		if( !package->containsInstalledVersion() == *m_includeInstalledPackages )
-			return false;
+		result |= versionProperties( *versionIterator );
 	}
-	return true;
+
+	result |= derivedProperties & MaskedProperty;
+
+	if( result & InstalledProperty )
+		result |= derivedProperties & UpdatableProperty;
+
+	return result & properties;
+}
+
+/**
+ * Retrieve the properties of a single package version that carry over
+ * to the package, as PackageProperty flags. The default implementation
+ * returns InstalledProperty for installed versions. Backends may add
+ * more properties, like OverlayProperty. Called from the worker threads.
+ */
+uint PackageSelector::versionProperties( PackageVersion* version )
+{
+	return version->isInstalled() ? InstalledProperty : NoProperty;
+}
+
+/**
+ * Determine if at least one version of a package has the given keyword.
+ * The default implementation returns false, for backends without keywords.
+ * Called from the worker threads.
+ *
+ * @param keywordAtom  The keyword as atom of the AtomTable.
+ */
+bool PackageSelector::hasKeyword( Package*, Q_UINT32 )
+{
+	return false;
+}
+
+/**
+ * Determine if at least one version of a package uses the given license.
+ * The default implementation returns false, for backends without licenses.
+ * Called from the worker threads.
+ *
+ * @param licenseAtom  The license as atom of the AtomTable.
+ */
+bool PackageSelector::hasLicense( Package*, Q_UINT32 )
+{
+	return false;
 }
 
 /**
- * Returns true there is at least one exclusion filter that matches
- * the given package. The All Packages Filter is an exception which is
- * not checked in this function. If an exclusion filter matches,
- * the package will not be included in the result package list.
- * Returns false if no exclusion filter matches, which would mean
- * that the package still has chances to be included in the result list.
+ * Decide the category filters for a category, returning
+ * CategoryVerdict flags.
  */
-bool PackageSelector::exclusionFilterMatches( Package* package )
+uint PackageSelector::categoryVerdict( PackageCategory* category )
 {
+	uint verdict = 0;
+
 	// excluded categories filter
 	if( m_excludedCategories != NULL )
 	{
 		FOREACH( categoryIterator, m_excludedCategories, PackageCategory )
 		{
-			if( package->category()->isContainedIn(*categoryIterator) )
-				return true;
+			if( category->isContainedIn(*categoryIterator) ) {
+				verdict |= CategoryExcluded;
+				break;
+			}
 		}
 	}
-	// exclude packages with 'package.installed == given value' filter
-	if( m_excludeInstalledPackages != NULL )
+	// included categories filter
+	if( m_includedCategories != NULL )
+	{
+		FOREACH( categoryIterator, m_includedCategories, PackageCategory )
+		{
+			if( !category->isContainedIn(*categoryIterator) ) {
+				verdict |= CategoryNotIncluded;
+				break;
+			}
+		}
+	}
+	return verdict;
+}
+
+/**
+ * Convert a list of strings into atoms. Strings that are not in the
+ * AtomTable can't occur in any package, they get the atom of the empty
+ * string which is never used as keyword or license.
+ */
+QValueVector<Q_UINT32> PackageSelector::atoms( const QStringList* strings )
+{
+	QValueVector<Q_UINT32> result;
+	if( strings == NULL )
+		return result;
+
+	for( QStringList::const_iterator stringIterator = strings->begin();
+	     stringIterator != strings->end(); ++stringIterator )
+	{
+		Q_UINT32 atom;
+		if( AtomTable::find(*stringIterator, &atom) == false )
+			atom = 0;
+		result.append( atom );
+	}
+	return result;
+}
+
+/**
+ * Determine if a package is contained in a package set that is
+ * sorted by pointer.
+ */
+bool PackageSelector::containsPackage( const QValueVector<Package*>& packages,
+                                       Package* package )
+{
+	int low = 0;
+	int high = (int) packages.count() - 1;
+
+	while( low <= high )
 	{
-		if( package->containsInstalledVersion() == *m_excludeInstalledPackages )
+		int middle = (low + high) / 2;
+
+		if( packages[middle] == package )
 			return true;
+		else if( packages[middle] < package )
+			low = middle + 1;
+		else
+			high = middle - 1;
 	}
 	return false;
 }
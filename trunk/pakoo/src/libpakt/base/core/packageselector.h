@@ -24,10 +24,14 @@
 #include "threadedjob.h"
 #include "packagecategory.h"
 
+#include <qvaluevector.h>
+#include <qstringlist.h>
+
 
 namespace libpakt {
 
 class Package;
+class PackageVersion;
 class PackageList;
 class PackageCategory;
 
@@ -43,6 +47,18 @@ class PackageCategory;
  * have higher priority than inclusion filters (one exception:
  * the All Packages Filter, which always has least priority).
  *
+ * When the job runs, the filters are first compiled into a plan:
+ * category filters are decided once per category, keywords and licenses
+ * are looked up in the AtomTable, and the package properties that the
+ * filters ask for are collected into a bit set with one walk over the
+ * versions of each package. If more than one worker thread has been
+ * allowed with setWorkerThreadCount(), the packages are then tested in
+ * parallel chunks, and the matching ones are inserted into the
+ * destination list in their original order.
+ *
+ * Backends can derive from this class to provide backend specific
+ * package properties, keywords and licenses.
+ *
  * @short  Used for generating a package list containing a filtered subset of another list.
  */
 class PackageSelector : public ThreadedJob
@@ -63,6 +79,18 @@ public:
 		Exclude
 	};
 
+	/**
+	 * Package properties that can be used with addPropertyFilter(),
+	 * as bit flags.
+	 */
+	enum PackageProperty {
+		NoProperty = 0,
+		InstalledProperty = 1, /**< At least one version is installed. */
+		UpdatableProperty = 2, /**< An installed version can be updated. */
+		MaskedProperty = 4, /**< No version is available for installing. */
+		OverlayProperty = 8 /**< At least one version is from an overlay. */
+	};
+
 	PackageSelector();
 	PackageSelector( const PackageSelector& );
 	PackageSelector& operator=( const PackageSelector& otherSelector );
@@ -70,6 +98,7 @@ public:
 	// setting up
 	void setSourceList( PackageList* sourceList );
 	void setDestinationList( PackageList* destList );
+	void setWorkerThreadCount( int count );
 
 	// filters
 	void clearFilters();
@@ -80,20 +109,56 @@ public:
 	void addIsInstalledFilter( PackageSelector::FilterType filterType,
 	                           bool isPackageInstalled );
 	void clearIsInstalledFilters();
+	void addPropertyFilter( PackageSelector::FilterType filterType,
+	                        PackageSelector::PackageProperty property,
+	                        bool hasProperty );
+	void clearPropertyFilters( uint properties );
+	void addKeywordFilter( PackageSelector::FilterType filterType,
+	                       const QString& keyword );
+	void clearKeywordFilters();
+	void addLicenseFilter( PackageSelector::FilterType filterType,
+	                       const QString& license );
+	void clearLicenseFilters();
+	void addPackageSetFilter( PackageSelector::FilterType filterType,
+	                          const QValueVector<Package*>& packages );
+	void clearPackageSetFilters();
 
 protected:
 	JobResult performThread();
 
+	virtual uint versionProperties( PackageVersion* version );
+	virtual bool hasKeyword( Package* package, Q_UINT32 keywordAtom );
+	virtual bool hasLicense( Package* package, Q_UINT32 licenseAtom );
+
 private:
+	class Worker;
+	friend class Worker;
+
+	//! Bit flags for the category filters, decided once per category.
+	enum CategoryVerdict {
+		CategoryExcluded = 1,
+		CategoryNotIncluded = 2
+	};
+
 	void copyFrom( const PackageSelector& otherSelector );
-	bool includePackage( Package* package );
-	bool inclusionFilterMatches( Package* package );
-	bool exclusionFilterMatches( Package* package );
+	void compilePlan();
+	void clearPlan();
+	void evaluateRange( uint begin, uint end );
+	bool includePackage( Package* package, uint categoryVerdict,
+	                     uint derivedProperties );
+	uint packageProperties( Package* package, uint derivedProperties,
+	                        uint properties );
+	uint categoryVerdict( PackageCategory* category );
+	static QValueVector<Q_UINT32> atoms( const QStringList* strings );
+	static bool containsPackage( const QValueVector<Package*>& packages,
+	                             Package* package );
 
 	//! The list from where the packages are taken.
 	PackageList* m_sourceList;
 	//! The list where matching packages are inserted.
 	PackageList* m_destList;
+	//! The maximum number of threads that test packages in parallel.
+	int m_workerThreadCount;
 
 	//! Defines if all packages are normally included or excluded.
 	FilterType m_allPackagesFilter;
@@ -104,7 +169,29 @@ private:
 	// Otherwise the value is used by the specific filter code.
 	//
 	QValueList<PackageCategory> *m_includedCategories, *m_excludedCategories;
-	bool *m_includeInstalledPackages, *m_excludeInstalledPackages;
+	QStringList *m_includedKeywords, *m_excludedKeywords;
+	QStringList *m_includedLicenses, *m_excludedLicenses;
+	QValueVector<Package*> *m_includedPackages, *m_excludedPackages;
+
+	// Property filters, as PackageProperty bit flags. Only the properties
+	// in the mask are tested, and they have to be (or, for exclusion,
+	// must not be) the same as in the values.
+	uint m_includedPropertyMask, m_includedPropertyValues;
+	uint m_excludedPropertyMask, m_excludedPropertyValues;
+
+	//
+	// The compiled plan, only valid while the job is running.
+	//
+	//! The packages of the source list, in order.
+	QValueVector<Package*> m_planPackages;
+	//! Category verdicts first, then 1 for each package that matches.
+	QValueVector<uint> m_planResults;
+	//! The masked and updatable properties of each package, if needed.
+	QValueVector<uint> m_planDerivedProperties;
+	//! The properties that have to be retrieved for each package.
+	uint m_planProperties;
+	QValueVector<Q_UINT32> m_includedKeywordAtoms, m_excludedKeywordAtoms;
+	QValueVector<Q_UINT32> m_includedLicenseAtoms, m_excludedLicenseAtoms;
 };
 
 }
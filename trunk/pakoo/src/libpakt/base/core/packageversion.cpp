@@ -72,6 +72,21 @@ bool PackageVersion::isNewerThan( const QString& otherVersion ) const
 		return false;
 }
 
+/**
+ * Find out if this version has a higher version number than another
+ * version object. Derived classes can overload this function in order
+ * to compare pre-parsed version information instead of the version
+ * strings, which is the default implementation.
+ *
+ * @param otherVersion  The version that should be compared to this one.
+ * @return  true if this version is newer than the one given in the argument.
+ *          false if the other version is newer (or if they are equal).
+ */
+bool PackageVersion::isNewerThan( const PackageVersion* otherVersion ) const
+{
+	return isNewerThan( otherVersion->version() );
+}
+
 
 /**
  * Find out if this version has a lower version number than another one.
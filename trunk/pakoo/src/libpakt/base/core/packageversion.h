@@ -66,6 +66,7 @@ public:
 	 * which is not likely to be sufficient in all cases.
 	 */
 	virtual bool isNewerThan( const QString& otherVersion ) const;
+	virtual bool isNewerThan( const PackageVersion* otherVersion ) const;
 
 	bool isOlderThan( const QString& otherVersion ) const;
 
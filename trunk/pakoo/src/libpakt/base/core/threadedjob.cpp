@@ -47,13 +47,23 @@ ThreadedJob::~ThreadedJob()
  * create multiple instances.)
  */
 void ThreadedJob::start()
+{
+	start( QThread::InheritPriority );
+}
+
+/**
+ * Start execution of the thread with the given scheduling priority.
+ * Use a low priority for jobs that run in the background
+ * and shouldn't compete with the user interface.
+ */
+void ThreadedJob::start( QThread::Priority priority )
 {
 	if( running() )
 		wait();
 
 	m_aborting = false;
 
-	QThread::start();
+	QThread::start( priority );
 	emit started();
 }
 
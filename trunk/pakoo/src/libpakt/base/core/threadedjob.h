@@ -67,6 +67,7 @@ public:
 
 public slots:
 	void start();
+	void start( QThread::Priority priority );
 	void abort();
 	void pause();
 
@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "dependencyresolver.h"
+
+#include "packageloader.h"
+
+
+namespace libpakt {
+
+/**
+ * Initialize this object. The package list and the queue still
+ * have to be set before the resolver can be started.
+ */
+DependencyResolver::DependencyResolver() : ThreadedJob()
+{
+	m_packages = NULL;
+	m_loader = NULL;
+}
+
+/**
+ * Delete the package loader, if one has been set.
+ */
+DependencyResolver::~DependencyResolver()
+{
+	delete m_loader;
+}
+
+/**
+ * Set the package list containing all packages that might be
+ * requested or needed as dependency.
+ */
+void DependencyResolver::setPackageList( PackageList* packages )
+{
+	m_packages = packages;
+}
+
+/**
+ * Set the loader that is used for loading details of packages whose
+ * dependencies are not known yet. The loader is performed from within
+ * the resolver's thread, so don't use it for anything else. The resolver
+ * takes ownership of the loader and deletes it on destruction.
+ * If no loader is set (which is the default), packages without loaded
+ * details are treated as if they had no dependencies.
+ */
+void DependencyResolver::setPackageLoader( PackageLoader* loader )
+{
+	delete m_loader;
+	m_loader = loader;
+	if( m_loader != NULL )
+		m_loader->setEmitPackageLoaded( false );
+}
+
+/**
+ * Set the queue of packages that are requested to be installed.
+ * It may contain packages, package versions and the "world" and
+ * "system" package classes.
+ */
+void DependencyResolver::setQueue( const PackageQueue& queue )
+{
+	m_queue = queue;
+}
+
+/**
+ * Return the install queue, which contains the requested package versions
+ * and their dependencies in the order in which they have to be installed.
+ * Only call this after the job has finished.
+ */
+const PackageQueue& DependencyResolver::installQueue()
+{
+	return m_installQueue;
+}
+
+/**
+ * Return the atoms of dependencies that could not be satisfied by any
+ * available version, and the atoms of blockers that are in conflict
+ * with the install queue. Only call this after the job has finished.
+ */
+const QStringList& DependencyResolver::unresolvedDependencies()
+{
+	return m_unresolvedDependencies;
+}
+
+/**
+ * Return the names of the package versions in the install queue whose
+ * dependencies could not be determined, because the source of their
+ * details doesn't contain any. Their dependencies are missing from the
+ * install queue. Only call this after the job has finished.
+ */
+const QStringList& DependencyResolver::unknownDependencies()
+{
+	return m_unknownDependencies;
+}
+
+} // namespace
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTDEPENDENCYRESOLVER_H
+#define LIBPAKTDEPENDENCYRESOLVER_H
+
+#include "../core/threadedjob.h"
+#include "../core/packagequeue.h"
+
+#include <qstringlist.h>
+
+
+namespace libpakt {
+
+class PackageList;
+class PackageLoader;
+
+/**
+ * DependencyResolver is a job that computes the complete install queue
+ * for a queue of requested packages. The install queue contains all
+ * package versions that have to be installed, including dependencies
+ * that are not yet installed, in the order in which they can be installed.
+ *
+ * Set up the resolver with setPackageList() and setQueue(), and optionally
+ * with setPackageLoader() for loading missing package details. Then call
+ * start() or perform(). After the job has finished, the result can be
+ * retrieved with installQueue(), unresolvedDependencies() and
+ * unknownDependencies(). If the latter isn't empty, the install queue
+ * might be missing some dependencies.
+ *
+ * @short  A threaded job computing the install order of packages.
+ */
+class DependencyResolver : public ThreadedJob
+{
+	Q_OBJECT
+
+public:
+	DependencyResolver();
+	~DependencyResolver();
+
+	void setPackageList( PackageList* packages );
+	void setPackageLoader( PackageLoader* loader );
+	void setQueue( const PackageQueue& queue );
+
+	const PackageQueue& installQueue();
+	const QStringList& unresolvedDependencies();
+	const QStringList& unknownDependencies();
+
+protected:
+	//! The package list containing all packages.
+	PackageList* m_packages;
+	//! The loader for package details that are needed but not loaded yet, or NULL.
+	PackageLoader* m_loader;
+	//! The requested packages.
+	PackageQueue m_queue;
+	//! The resulting install queue, containing only package versions.
+	PackageQueue m_installQueue;
+	//! Dependencies that could not be satisfied, and blocking packages.
+	QStringList m_unresolvedDependencies;
+	//! Package versions in the install queue whose dependencies are not known.
+	QStringList m_unknownDependencies;
+};
+
+}
+
+#endif // LIBPAKTDEPENDENCYRESOLVER_H
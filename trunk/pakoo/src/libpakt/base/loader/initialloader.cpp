@@ -54,6 +54,16 @@ void InitialLoader::emitFinishedLoading( PackageList* packages )
 	QApplication::postEvent( this, event );
 }
 
+/**
+ * From within the thread, emit a partiallyLoaded() signal to the main thread.
+ */
+void InitialLoader::emitPartiallyLoaded( PackageList* packages )
+{
+	PartiallyLoadedEvent* event = new PartiallyLoadedEvent();
+	event->packages = packages;
+	QApplication::postEvent( this, event );
+}
+
 /**
  * Translates QCustomEvents into signals. This function is called from Qt
  * in the main thread, which guarantees safety for emitting signals.
@@ -62,6 +72,10 @@ void InitialLoader::customEvent( QCustomEvent* event )
 {
 	switch( event->type() )
 	{
+	case (int) PartiallyLoadedEventType:
+		emit partiallyLoaded( ((PartiallyLoadedEvent*)event)->packages );
+		break;
+
 	case (int) FinishedLoadingEventType:
 		emit finishedLoading( ((FinishedLoadingEvent*)event)->packages );
 
@@ -52,8 +52,19 @@ signals:
 	 */
 	void finishedLoading( PackageList* packages );
 
+	/**
+	 * Emitted before finishedLoading() if a part of the packages can
+	 * already be shown while loading goes on, like the installed ones.
+	 * The given PackageList object is a separate one which isn't used
+	 * by the loader anymore and won't be filled any further, so it may
+	 * be displayed until finishedLoading() delivers the complete list.
+	 * The receiver is responsible for deleting it.
+	 */
+	void partiallyLoaded( PackageList* packages );
+
 protected slots:
 	void emitFinishedLoading( PackageList* packages );
+	void emitPartiallyLoaded( PackageList* packages );
 
 protected:
 	void customEvent(QCustomEvent* event);
@@ -64,7 +75,8 @@ protected:
 private:
 	enum InitialLoaderEventType
 	{
-		FinishedLoadingEventType = QEvent::User + 14344
+		FinishedLoadingEventType = QEvent::User + 14344,
+		PartiallyLoadedEventType = QEvent::User + 14350
 	};
 
 
@@ -79,6 +91,13 @@ private:
 		PackageList* packages;
 	};
 
+	class PartiallyLoadedEvent : public QCustomEvent
+	{
+	public:
+		PartiallyLoadedEvent() : QCustomEvent( PartiallyLoadedEventType ) {};
+		PackageList* packages;
+	};
+
 };
 
 }
@@ -21,7 +21,12 @@
 #include "multiplepackageloader.h"
 
 #include "../core/packagelist.h"
+#include "../core/package.h"
 #include "packageloader.h"
+#include "packageloaderworker.h"
+
+#include <qapplication.h>
+#include <qptrlist.h>
 
 #include <klocale.h>
 #include <kdebug.h>
@@ -29,6 +34,19 @@
 
 namespace libpakt {
 
+/**
+ * The number of loaded packages that are collected before they are
+ * announced to the main thread with a single event.
+ */
+static const uint PACKAGE_BATCH_SIZE = 32;
+
+/**
+ * The maximum time in milliseconds that loaded packages are held back
+ * before they are announced to the main thread.
+ */
+static const int PACKAGE_BATCH_INTERVAL = 250;
+
+
 /**
  * Empty constructor. The setPackageLoader() and setPackageList() member
  * functions have yet to be called.
@@ -43,8 +61,20 @@ MultiplePackageLoader::MultiplePackageLoader( PackageLoader* loader )
 
 MultiplePackageLoader::~ MultiplePackageLoader( )
 {
-	if( m_autoDeleteLoader == true && m_loader != NULL ) {
+	if( m_autoDeleteLoader == false )
+		return;
+
+	if( m_loader != NULL )
 		m_loader->deleteLater();
+
+	QValueList<PackageLoader*>::iterator loaderIteratorEnd =
+		m_additionalLoaders.end();
+
+	for( QValueList<PackageLoader*>::iterator loaderIterator =
+	         m_additionalLoaders.begin();
+	     loaderIterator != loaderIteratorEnd; ++loaderIterator )
+	{
+		(*loaderIterator)->deleteLater();
 	}
 }
 
@@ -61,7 +91,8 @@ PackageLoader* MultiplePackageLoader::packageLoader()
  * This object was given a pointer to a PackageLoader object which
  * does the actual work when loading package details.
  * Calling this function with 'true' means that this PackageLoader
- * object will automatically be deleted when this MultiplePackageLoader
+ * object (and all the ones added with addPackageLoader())
+ * will automatically be deleted when this MultiplePackageLoader
  * is destroyed.
  *
  * By default, auto-delete is turned off (autoDelete == false).
@@ -80,6 +111,46 @@ void MultiplePackageLoader::setPackageLoader( PackageLoader* loader )
 	m_loader = loader;
 }
 
+/**
+ * Add another PackageLoader which is used in an additional thread,
+ * so that packages are loaded in parallel. The loader must be of the
+ * same kind and have the same settings as the main one, and it must not
+ * be used by anyone else while this object is running.
+ */
+void MultiplePackageLoader::addPackageLoader( PackageLoader* loader )
+{
+	if( loader != NULL )
+		m_additionalLoaders.append( loader );
+}
+
+/**
+ * Specify packages that should be loaded before all others, for example
+ * the ones that are currently visible in a list view. The list replaces
+ * the one from the previous call, so packages that are not in the new
+ * list any more go back to their normal position. This function may be
+ * called at any time, also while the loader is running. Packages that
+ * are not in the package list are ignored.
+ *
+ * @param packages  The preferred packages, the most important one first.
+ */
+void MultiplePackageLoader::setPriorityPackages(
+	const QValueList<Package*>& packages )
+{
+	QMutexLocker locker( &m_mutex );
+
+	// copy element by element, so that the worker threads never
+	// touch the reference count of a list that belongs to the caller
+	m_priorityPackages.clear();
+	QValueList<Package*>::const_iterator packageIteratorEnd = packages.end();
+
+	for( QValueList<Package*>::const_iterator packageIterator =
+	         packages.begin();
+	     packageIterator != packageIteratorEnd; ++packageIterator )
+	{
+		m_priorityPackages.append( *packageIterator );
+	}
+}
+
 /**
  * Set the PackageList object that whose packages will be filled
  * with detailed package info.
@@ -115,30 +186,269 @@ IJob::JobResult MultiplePackageLoader::performThread()
 		return Failure;
 	}
 
+	// Collect all packages and give each worker its own part of them.
+	// Installed packages come first, they are the ones that
+	// users are most likely interested in.
+	m_queue.clear();
+	m_queue.reserve( m_packages->count() );
+
 	PackageList::iterator packageIteratorEnd = m_packages->end();
 
-	// Iterate through all packages
 	for( PackageList::iterator packageIterator = m_packages->begin();
 	     packageIterator != packageIteratorEnd; ++packageIterator )
 	{
-		// scan the current package
-		m_loader->setPackage( *packageIterator );
-		m_loader->perform();
+		if( (*packageIterator)->containsInstalledVersion() )
+			m_queue.append( *packageIterator );
+	}
+	for( PackageList::iterator packageIterator = m_packages->begin();
+	     packageIterator != packageIteratorEnd; ++packageIterator )
+	{
+		if( (*packageIterator)->containsInstalledVersion() == false )
+			m_queue.append( *packageIterator );
+	}
 
-		if( aborting() ) {
-			kdDebug() << i18n( "MultiplePackageLoader debug output",
-				"MultiplePackageLoader::performThread(): "
-				"Aborting on user request" )
-				<< endl;
-			return Failure;
-		}
+	m_queueIndices.clear();
+	for( uint i = 0; i < m_queue.count(); i++ )
+		m_queueIndices.insert( m_queue[i], i );
+
+	m_taken.clear();
+	m_taken.insert( m_taken.end(), m_queue.count(), false );
+
+	QValueVector<PackageLoader*> loaders;
+	loaders.append( m_loader );
+
+	QValueList<PackageLoader*>::iterator loaderIteratorEnd =
+		m_additionalLoaders.end();
+
+	for( QValueList<PackageLoader*>::iterator loaderIterator =
+	         m_additionalLoaders.begin();
+	     loaderIterator != loaderIteratorEnd; ++loaderIterator )
+	{
+		loaders.append( *loaderIterator );
+	}
+
+	uint workerCount = loaders.count();
+	uint packageCount = m_queue.count();
+
+	m_ranges.resize( workerCount );
+	for( uint i = 0; i < workerCount; i++ )
+	{
+		m_ranges[i].begin = (packageCount * i) / workerCount;
+		m_ranges[i].end = (packageCount * (i + 1)) / workerCount;
+	}
+
+	m_loadedPackages.clear();
+	m_batchTime.start();
+
+	// the loaders' own signals would flood the event loop,
+	// we're sending them in batches instead
+	for( uint i = 0; i < workerCount; i++ )
+		loaders[i]->setEmitPackageLoaded( false );
+
+	// start the additional workers as threads,
+	// and do the first worker's share in this thread
+	QPtrList<PackageLoaderWorker> workers;
+	workers.setAutoDelete( true );
+
+	for( uint i = 1; i < workerCount; i++ )
+	{
+		PackageLoaderWorker* worker =
+			new PackageLoaderWorker( this, loaders[i], i );
+		workers.append( worker );
+		worker->start();
+	}
+
+	PackageLoaderWorker mainWorker( this, m_loader, 0 );
+	mainWorker.loadPackages();
+
+	for( PackageLoaderWorker* worker = workers.first();
+	     worker != NULL; worker = workers.next() )
+	{
+		worker->wait();
 	}
+	workers.clear();
 
-	// make sure no one tries to access it when it might already be deleted
-	m_loader->setPackage( NULL );
+	for( uint i = 0; i < workerCount; i++ )
+		loaders[i]->setEmitPackageLoaded( true );
+
+	// announce the remaining packages
+	m_mutex.lock();
+	emitPackagesLoaded();
+	m_mutex.unlock();
+
+	m_queue.clear();
+	m_queueIndices.clear();
+	m_taken.clear();
+	m_ranges.clear();
+
+	if( aborting() ) {
+		kdDebug() << i18n( "MultiplePackageLoader debug output",
+			"MultiplePackageLoader::performThread(): "
+			"Aborting on user request" )
+			<< endl;
+		return Failure;
+	}
 
 	// all packages have been scanned
 	return Success;
 }
 
+/**
+ * Hand out the next package to the worker with the given index.
+ * Packages passed to setPriorityPackages() are handed out first.
+ * Apart from those, each worker loads the packages of its own range.
+ * If that one is exhausted, it takes over the second half of the largest
+ * range that is left, which is taken from the end so that the worker
+ * owning that range can go on uninterrupted. Called from the worker threads.
+ *
+ * @param workerIndex  The index of the worker's own work range.
+ * @param package      Is set to the next package that should be loaded.
+ * @return  true if a package has been handed out, false if there are
+ *          no more packages left to load.
+ */
+bool MultiplePackageLoader::takePackage( int workerIndex, Package** package )
+{
+	QMutexLocker locker( &m_mutex );
+
+	while( m_priorityPackages.isEmpty() == false )
+	{
+		Package* priorityPackage = m_priorityPackages.first();
+		m_priorityPackages.remove( m_priorityPackages.begin() );
+
+		QMap<Package*,uint>::iterator indexIterator =
+			m_queueIndices.find( priorityPackage );
+
+		if( indexIterator == m_queueIndices.end()
+		    || m_taken[*indexIterator] == true )
+		{
+			continue; // not in this run, or already loaded
+		}
+
+		m_taken[*indexIterator] = true;
+		*package = priorityPackage;
+		return true;
+	}
+
+	while( true )
+	{
+		WorkRange& range = m_ranges[workerIndex];
+
+		while( range.begin < range.end )
+		{
+			uint index = range.begin;
+			range.begin++;
+
+			if( m_taken[index] == false ) {
+				m_taken[index] = true;
+				*package = m_queue[index];
+				return true;
+			}
+		}
+
+		if( stealRange( workerIndex ) == false )
+			return false; // nothing left anywhere
+	}
+}
+
+/**
+ * Give the worker with the given index the second half of the
+ * largest range that is left. The mutex has to be locked when
+ * calling this function.
+ *
+ * @return  true if the worker got a new range, false if all ranges are empty.
+ */
+bool MultiplePackageLoader::stealRange( int workerIndex )
+{
+	// find the range with the most remaining packages
+	uint largestIndex = 0;
+	uint largestSize = 0;
+
+	for( uint i = 0; i < m_ranges.count(); i++ )
+	{
+		uint size = m_ranges[i].end - m_ranges[i].begin;
+		if( size > largestSize ) {
+			largestIndex = i;
+			largestSize = size;
+		}
+	}
+
+	if( largestSize == 0 )
+		return false;
+
+	WorkRange& range = m_ranges[workerIndex];
+	WorkRange& victim = m_ranges[largestIndex];
+	uint middle = victim.end - (largestSize + 1) / 2;
+
+	range.begin = middle;
+	range.end = victim.end;
+	victim.end = middle;
+	return true;
+}
+
+/**
+ * Register a package as loaded. The package is sent to the main thread
+ * together with other loaded packages, as soon as enough of them have
+ * been collected or when the last batch has been sent long enough ago.
+ * Called from the worker threads.
+ */
+void MultiplePackageLoader::addLoadedPackage( Package* package )
+{
+	QMutexLocker locker( &m_mutex );
+	m_loadedPackages.append( package );
+
+	if( m_loadedPackages.count() >= PACKAGE_BATCH_SIZE
+	    || m_batchTime.elapsed() >= PACKAGE_BATCH_INTERVAL )
+	{
+		emitPackagesLoaded();
+	}
+}
+
+/**
+ * From within the thread, send the collected loaded packages to the
+ * main thread, where a packageLoaded() signal is emitted for each of them.
+ * The mutex has to be locked when calling this function.
+ */
+void MultiplePackageLoader::emitPackagesLoaded()
+{
+	m_batchTime.restart();
+
+	if( m_loadedPackages.isEmpty() )
+		return;
+
+	// hand the list over without leaving a shared copy in this thread
+	PackagesLoadedEvent* event = new PackagesLoadedEvent();
+	event->packages = m_loadedPackages;
+	m_loadedPackages = QValueList<Package*>();
+	QApplication::postEvent( this, event );
+}
+
+/**
+ * Translates QCustomEvents into signals. This function is called from Qt
+ * in the main thread, which guarantees safety for emitting signals.
+ */
+void MultiplePackageLoader::customEvent( QCustomEvent* event )
+{
+	switch( event->type() )
+	{
+	case (int) PackagesLoadedEventType:
+	{
+		QValueList<Package*>& packages =
+			((PackagesLoadedEvent*)event)->packages;
+		QValueList<Package*>::iterator packageIteratorEnd = packages.end();
+
+		for( QValueList<Package*>::iterator packageIterator =
+		         packages.begin();
+		     packageIterator != packageIteratorEnd; ++packageIterator )
+		{
+			emit packageLoaded( *packageIterator );
+		}
+		break;
+	}
+
+	default:
+		ThreadedJob::customEvent( event );
+		break;
+	}
+}
+
 } // namespace
@@ -23,11 +23,19 @@
 
 #include "../core/threadedjob.h"
 
+#include <qvaluelist.h>
+#include <qmap.h>
+#include <qvaluevector.h>
+#include <qmutex.h>
+#include <qdatetime.h>
+
 
 namespace libpakt {
 
+class Package;
 class PackageLoader;
 class PackageList;
+class PackageLoaderWorker;
 
 /**
  * MultiplePackageLoader is a threaded job which uses a PackageLoader
@@ -38,8 +46,22 @@ class PackageList;
  * setPackageList() member functions) you can call start() or perform()
  * to begin loading the packages.
  *
- * You might want to connect to the PackageLoader's packageLoaded() signal
- * if you want to know which packages now contain detailed package info.
+ * If additional package loaders have been added with addPackageLoader(),
+ * the packages are loaded in parallel, with one thread per loader.
+ * Each thread starts with its own contiguous range of the package list.
+ * When a thread has finished its range, it takes over the second half
+ * of the largest range that is left, so that all threads stay busy
+ * until the very end.
+ *
+ * Installed packages are loaded before the other ones. Packages that
+ * need to be loaded even sooner (like the ones that are visible to the
+ * user) can be passed to setPriorityPackages(), also while loading.
+ *
+ * Connect to the packageLoaded() signal of this object if you want to
+ * know which packages now contain detailed package info. The signals
+ * are delivered to the main thread in batches, the package loaders
+ * themselves don't emit any packageLoaded() signals while they're used
+ * by this object.
  *
  * @short A threaded class for retrieving detail info of multiple packages.
  */
@@ -50,6 +72,7 @@ class MultiplePackageLoader : public ThreadedJob
 	// is NOT.
 
 	Q_OBJECT
+	friend class PackageLoaderWorker;
 
 public:
 	MultiplePackageLoader( PackageLoader* loader );
@@ -57,17 +80,76 @@ public:
 
 	PackageLoader* packageLoader();
 	void setPackageLoader( PackageLoader* loader );
+	void addPackageLoader( PackageLoader* loader );
 	void setAutoDeletePackageLoader( bool autoDelete );
 
 	void setPackageList( PackageList* packages );
+	void setPriorityPackages( const QValueList<Package*>& packages );
+
+signals:
+	/** Emitted every time when a package has successfully been scanned.
+	 * The scanned package is given as argument. */
+	void packageLoaded( Package* package );
 
 protected:
 	JobResult performThread();
+	void customEvent( QCustomEvent* event );
 
 private:
+	enum MultiplePackageLoaderEventType
+	{
+		PackagesLoadedEventType = QEvent::User + 14349
+	};
+
+	/** A range of packages in m_queue, from begin to end (excluding). */
+	struct WorkRange
+	{
+		uint begin;
+		uint end;
+	};
+
+	// called by the workers, possibly from several threads at once
+	bool takePackage( int workerIndex, Package** package );
+	bool stealRange( int workerIndex );
+	void addLoadedPackage( Package* package );
+
+	void emitPackagesLoaded();
+
+	//! The loader that is used in this object's own thread.
 	PackageLoader* m_loader;
+	//! Additional loaders, each of them is used in an additional thread.
+	QValueList<PackageLoader*> m_additionalLoaders;
 	PackageList* m_packages;
 	bool m_autoDeleteLoader;
+
+	//! The packages that are loaded, in the order of the package list.
+	QValueVector<Package*> m_queue;
+	//! The position of each package in m_queue.
+	QMap<Package*,uint> m_queueIndices;
+	//! true for each package in m_queue that has already been handed out.
+	QValueVector<bool> m_taken;
+	//! Packages that are handed out before the ones in the work ranges.
+	QValueList<Package*> m_priorityPackages;
+	//! The part of m_queue that each worker has still got to load.
+	QValueVector<WorkRange> m_ranges;
+	//! Loaded packages that haven't been announced to the main thread yet.
+	QValueList<Package*> m_loadedPackages;
+	//! Measures the time since the last batch of loaded packages was sent.
+	QTime m_batchTime;
+	//! Guards the work ranges, the priority list and the loaded packages.
+	QMutex m_mutex;
+
+
+	//
+	// nested event classes
+	//
+
+	class PackagesLoadedEvent : public QCustomEvent
+	{
+	public:
+		PackagesLoadedEvent() : QCustomEvent( PackagesLoadedEventType ) {};
+		QValueList<Package*> packages;
+	};
 };
 
 }
@@ -34,6 +34,7 @@ namespace libpakt {
 PackageLoader::PackageLoader() : ThreadedJob()
 {
 	m_package = NULL;
+	m_emitPackageLoaded = true;
 }
 
 /**
@@ -54,11 +55,27 @@ Package* PackageLoader::package()
 }
 
 
+/**
+ * Specify if the packageLoaded() signal is emitted after a package
+ * has been scanned. This is turned on by default. Objects that use
+ * this loader for many packages (like MultiplePackageLoader) may turn it
+ * off and send their own, more efficient notifications instead.
+ */
+void PackageLoader::setEmitPackageLoaded( bool emitSignal )
+{
+	m_emitPackageLoaded = emitSignal;
+}
+
+
 /**
  * From within the thread, emit a packageLoaded() signal to the main thread.
+ * Nothing is sent if this has been turned off with setEmitPackageLoaded().
  */
 void PackageLoader::emitPackageLoaded()
 {
+	if( m_emitPackageLoaded == false )
+		return;
+
 	PackageLoadedEvent* event  = new PackageLoadedEvent();
 	event->package = m_package;
 	QApplication::postEvent( this, event );
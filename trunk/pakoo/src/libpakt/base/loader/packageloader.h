@@ -49,6 +49,7 @@ public:
 	PackageLoader();
 	void setPackage( Package* package );
 	Package* package();
+	void setEmitPackageLoaded( bool emitSignal );
 
 signals:
 	/** Emitted every time when a package has successfully been scanned.
@@ -68,6 +69,8 @@ private:
 
 	//! The package that will be scanned.
 	Package* m_package;
+	//! Whether emitPackageLoaded() actually sends a signal.
+	bool m_emitPackageLoaded;
 
 
 	//
@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "packageloaderworker.h"
+
+#include "multiplepackageloader.h"
+#include "packageloader.h"
+
+
+namespace libpakt {
+
+/**
+ * Initialize this worker.
+ *
+ * @param multipleLoader  The MultiplePackageLoader handing out packages.
+ * @param loader          The loader that is used for loading the packages.
+ * @param index           The index of this worker's work range.
+ */
+PackageLoaderWorker::PackageLoaderWorker(
+	MultiplePackageLoader* multipleLoader, PackageLoader* loader, int index )
+: QThread()
+{
+	m_multipleLoader = multipleLoader;
+	m_loader = loader;
+	m_index = index;
+}
+
+/**
+ * Executed when the worker is started as thread.
+ */
+void PackageLoaderWorker::run()
+{
+	loadPackages();
+}
+
+/**
+ * Load packages until the MultiplePackageLoader has got no more left,
+ * or until it is aborting. Only packages that have been loaded
+ * successfully are handed back to the MultiplePackageLoader.
+ */
+void PackageLoaderWorker::loadPackages()
+{
+	Package* package;
+
+	while( m_multipleLoader->takePackage( m_index, &package ) )
+	{
+		m_loader->setPackage( package );
+
+		// packages without details are not reported as loaded,
+		// so that they can be requested again later
+		if( m_loader->perform() == IJob::Success )
+			m_multipleLoader->addLoadedPackage( package );
+
+		if( m_multipleLoader->aborting() )
+			break;
+	}
+
+	// make sure no one tries to access it when it might already be deleted
+	m_loader->setPackage( NULL );
+}
+
+} // namespace
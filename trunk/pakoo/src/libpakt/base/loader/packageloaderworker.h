@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTPACKAGELOADERWORKER_H
+#define LIBPAKTPACKAGELOADERWORKER_H
+
+#include <qthread.h>
+
+
+namespace libpakt {
+
+class MultiplePackageLoader;
+class PackageLoader;
+
+/**
+ * PackageLoaderWorker takes packages from a MultiplePackageLoader one by
+ * one and lets its own PackageLoader fill them with detailed info, until
+ * the MultiplePackageLoader has got no more packages left for it.
+ *
+ * The MultiplePackageLoader runs one of its workers in its own thread
+ * and starts the other ones as additional threads.
+ *
+ * @short  A (possibly threaded) helper that loads packages for MultiplePackageLoader.
+ */
+class PackageLoaderWorker : public QThread
+{
+public:
+	PackageLoaderWorker( MultiplePackageLoader* multipleLoader,
+	                     PackageLoader* loader, int index );
+
+	void loadPackages();
+
+protected:
+	void run();
+
+private:
+	//! The MultiplePackageLoader that hands out packages to this worker.
+	MultiplePackageLoader* m_multipleLoader;
+	//! The loader that is used for loading the packages.
+	PackageLoader* m_loader;
+	//! The index of this worker's work range in the MultiplePackageLoader.
+	int m_index;
+};
+
+}
+
+#endif // LIBPAKTPACKAGELOADERWORKER_H
@@ -0,0 +1,196 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Measures how many atoms per second DependAtom::parse() handles,
+ * compared to the QRegExp based parser that it replaced. The atoms
+ * are taken from a real package.mask file and parsed over and over
+ * again, so that the measured time is long enough to be meaningful.
+ *
+ * Usage: dependatombenchmark [package.mask file] [rounds]
+ */
+
+#include "portage/core/dependatom.h"
+
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qregexp.h>
+#include <qfile.h>
+#include <qtextstream.h>
+#include <qdatetime.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_MASKFILE "/usr/portage/profiles/package.mask"
+#define DEFAULT_ROUNDS   200
+
+#define POS_CALLSIGN    1
+#define POS_PREFIX      2
+#define POS_CATEGORY    3
+#define POS_SUBCATEGORY 4
+#define POS_PACKAGE     5
+#define POS_VERSION     6
+
+using namespace libpakt;
+
+
+/**
+ * The parsing part of DependAtom as it was before the tokenizer,
+ * with the same regular expression and the same captured strings.
+ */
+class OldDependAtom
+{
+public:
+	OldDependAtom()
+	: m_rxAtom("^"    // Start of the string
+	           "(!)?" // "Block these packages" flag, only occurring in ebuilds
+	           "(~|(?:<|>|=|<=|>=))?" // greater-than/less-than/equal, or "all revisions" prefix
+	           "((?:[a-z]|[0-9])+)-((?:[a-z]|[0-9])+)/"   // category and subcategory
+	           "((?:[a-z]|[A-Z]|[0-9]|-|\\+|_)+)" // package name
+	           "("            // start of the version part
+	           "(?:\\*$|-\\d+(?:\\.\\d+)*[a-z]?(?:\\*$)?)" // base version number,
+	                                    // including wildcard version matching (*)
+	           "(?:_(?:alpha|beta|pre|rc|p)\\d+)?" // version suffix
+	           "(?:-r\\d+)?"  // revision
+	           ")?$"          // end of the (optional) version part and the atom string
+	           )
+	{
+		m_callsign = false;
+	}
+
+	bool parse( const QString& atom )
+	{
+		if( m_rxAtom.exactMatch(atom) == false )
+			return false;
+
+		m_callsign    = m_rxAtom.cap( POS_CALLSIGN ).isEmpty() ? false : true;
+		m_prefix      = m_rxAtom.cap( POS_PREFIX );
+		m_package     = m_rxAtom.cap( POS_PACKAGE );
+		m_version     = m_rxAtom.cap( POS_VERSION );
+		m_category    = m_rxAtom.cap( POS_CATEGORY );
+		m_subcategory = m_rxAtom.cap( POS_SUBCATEGORY );
+
+		if( m_version.isEmpty() != m_prefix.isEmpty() )
+			return false;
+
+		if( !m_version.isEmpty() && m_version[0] == '-' )
+			m_version = m_version.mid(1);
+
+		return true;
+	}
+
+private:
+	QRegExp m_rxAtom;
+	bool m_callsign;
+	QString m_prefix, m_package, m_version, m_category, m_subcategory;
+};
+
+
+/**
+ * Read the atoms of a package.mask file, leaving out comments
+ * and empty lines.
+ */
+static QStringList readAtoms( const QString& filename )
+{
+	QStringList atoms;
+	QFile file( filename );
+	if( !file.open( IO_ReadOnly ) )
+		return atoms;
+
+	QTextStream stream( &file );
+	while( !stream.atEnd() )
+	{
+		QString line = stream.readLine().stripWhiteSpace();
+		if( !line.isEmpty() && line[0] != '#' )
+			atoms.append( line );
+	}
+	return atoms;
+}
+
+/**
+ * Print the throughput of one parser.
+ */
+static void printResult( const char* name, uint atomCount, int milliseconds,
+                         uint validCount )
+{
+	if( milliseconds < 1 )
+		milliseconds = 1;
+
+	printf( "%s %8.0f atoms per second (%u atoms in %d ms, %u valid)\n",
+	        name, atomCount * 1000.0 / milliseconds, atomCount,
+	        milliseconds, validCount );
+}
+
+int main( int argc, char** argv )
+{
+	QString filename = ( argc > 1 ) ? QString(argv[1]) : QString(DEFAULT_MASKFILE);
+	uint rounds = ( argc > 2 ) ? atoi( argv[2] ) : DEFAULT_ROUNDS;
+
+	QStringList atoms = readAtoms( filename );
+	if( atoms.isEmpty() || rounds == 0 ) {
+		fprintf( stderr, "Usage: %s [package.mask file] [rounds]\n"
+		         "No atoms found in %s\n",
+		         argv[0], (const char*) QFile::encodeName(filename) );
+		return 1;
+	}
+
+	uint atomCount = atoms.count() * rounds;
+	QStringList::iterator atomIteratorEnd = atoms.end();
+	QTime time;
+
+	OldDependAtom oldAtom;
+	uint oldValidCount = 0;
+	time.start();
+
+	for( uint round = 0; round < rounds; round++ )
+	{
+		for( QStringList::iterator atomIterator = atoms.begin();
+		     atomIterator != atomIteratorEnd; ++atomIterator )
+		{
+			if( oldAtom.parse( *atomIterator ) )
+				oldValidCount++;
+		}
+	}
+	int oldMilliseconds = time.elapsed();
+
+	DependAtom atom( NULL );
+	uint validCount = 0;
+	time.start();
+
+	for( uint round = 0; round < rounds; round++ )
+	{
+		for( QStringList::iterator atomIterator = atoms.begin();
+		     atomIterator != atomIteratorEnd; ++atomIterator )
+		{
+			if( atom.parse( *atomIterator ) )
+				validCount++;
+		}
+	}
+	int milliseconds = time.elapsed();
+
+	printf( "%u atoms from %s, %u rounds\n", atoms.count(),
+	        (const char*) QFile::encodeName(filename), rounds );
+	printResult( "QRegExp parser:   ", atomCount, oldMilliseconds,
+	             oldValidCount / rounds );
+	printResult( "tokenizer parser: ", atomCount, milliseconds,
+	             validCount / rounds );
+
+	return 0;
+}
@@ -31,6 +31,7 @@
 //#include "base/core/dependatom.h"
 #include "portage/loader/portagetreescanner.h"
 #include "base/loader/packageloader.h"
+#include "base/loader/dependencyresolver.h"
 #include "portage/loader/profileloader.h"
 #include "portage/loader/portageml.h"
 #include "portage/loader/filepackagemaskloader.h"
@@ -26,43 +26,51 @@
 
 // For more info on DEPEND atoms, see the DEPEND Atoms section of man 5 ebuild
 
-// capture positions inside the regexp. (like m_rxAtom.cap(POS_CALLSIGN))
-#define POS_CALLSIGN    1
-#define POS_PREFIX      2
-#define POS_CATEGORY    3
-#define POS_SUBCATEGORY 4
-#define POS_PACKAGE     5
-#define POS_VERSION     6
-
-// The complete atom regexp in non-escaped form (for testing, or similar):
-// ^(!)?(~|(?:<|>|=|<=|>=))?((?:[a-z]|[0-9])+)-((?:[a-z]|[0-9])+)/((?:[a-z]|[A-Z]|[0-9]|-|\+|_)+)((?:\*$|-\d+(?:\.\d+)*[a-z]?(?:\*$)?)(?:_(?:alpha|beta|pre|rc|p)\d+)?(?:-r\d+)?)?$
+// The accepted atom syntax, in regexp form (for testing, or similar):
+// ^(!!?)?(~|<|>|=|<=|>=)?([A-Za-z0-9+_.][A-Za-z0-9+_.-]*)/([A-Za-z0-9+_][A-Za-z0-9+_-]*?)
+//  (-<version>\*?|-?\*)?(:[A-Za-z0-9+_.-]*(/[A-Za-z0-9+_.-]+)?[=*]?)?(\[[^\]]+\])?$
+// where <version> is anything that PortageVersion accepts, and there must
+// be a version if (and only if) there is an operator.
 
 
 namespace libpakt {
 
+/**
+ * Returns true if the character may be part of a package name.
+ */
+static inline bool isNameChar( const QChar& c )
+{
+	char ch = c.latin1();
+	return ( ch >= 'a' && ch <= 'z' ) || ( ch >= 'A' && ch <= 'Z' )
+		|| ( ch >= '0' && ch <= '9' ) || ch == '+' || ch == '_' || ch == '-';
+}
+
+/**
+ * Returns true if the character may be part of a category or slot name,
+ * which is the same as for package names with the dot in addition.
+ */
+static inline bool isCategoryChar( const QChar& c )
+{
+	return isNameChar(c) || c == '.';
+}
+
+
 /**
  * Initialize this object.
  * @param packages  The package list which contains the packages
  *                  that will be filtered out.
  */
 DependAtom::DependAtom( TemplatedPackageList<PortagePackage>* packages )
-: m_rxAtom("^"    // Start of the string
-           "(!)?" // "Block these packages" flag, only occurring in ebuilds
-           "(~|(?:<|>|=|<=|>=))?" // greater-than/less-than/equal, or "all revisions" prefix
-           "((?:[a-z]|[0-9])+)-((?:[a-z]|[0-9])+)/"   // category and subcategory
-           "((?:[a-z]|[A-Z]|[0-9]|-|\\+|_)+)" // package name
-           "("            // start of the version part
-           "(?:\\*$|-\\d+(?:\\.\\d+)*[a-z]?(?:\\*$)?)" // base version number,
-                                    // including wildcard version matching (*)
-           "(?:_(?:alpha|beta|pre|rc|p)\\d+)?" // version suffix
-           "(?:-r\\d+)?"  // revision
-           ")?$"          // end of the (optional) version part and the atom string
-           )
 {
 	m_packages = packages;
 	m_matches = false;
-	m_callsign = false;
+	m_blocker = NoBlocker;
+	m_operator = AnyVersion;
 	m_category = new PortageCategory;
+	m_categoryRange.start = m_categoryRange.length = 0;
+	m_packageRange = m_versionRange = m_slotRange = m_categoryRange;
+	m_subslotRange = m_useRange = m_categoryRange;
+	m_slotAtom = 0;
 }
 
 DependAtom::~DependAtom()
@@ -77,6 +85,12 @@ DependAtom::~DependAtom()
  * If it's invalid, the result of the these functions is undefined.
  * So, make sure to check the return value.
  *
+ * The atom is scanned once from left to right, in the order of its parts:
+ * blocker, operator, category, package name and version, slot and
+ * USE dependencies. No strings are created while scanning, only
+ * the version string and the slot atom are set up for matching
+ * once the atom turned out to be valid.
+ *
  * @param atom  The atom string that should be parsed. This string is expected
  *              not to have leading or trailing whitespaces, otherwise it
  *              will not be considered valid in any case.
@@ -84,31 +98,186 @@ DependAtom::~DependAtom()
  */
 bool DependAtom::parse( const QString& atom )
 {
-	// Do the regexp match, which also prepares for text capture
-	if( m_rxAtom.exactMatch(atom) == false ) {
-		m_matches = false;
+	m_matches = false;
+	m_atom = atom;
+	m_blocker = NoBlocker;
+	m_operator = AnyVersion;
+	m_categoryRange.start = m_categoryRange.length = 0;
+	m_packageRange = m_versionRange = m_slotRange = m_categoryRange;
+	m_subslotRange = m_useRange = m_categoryRange;
+	m_versionString = QString::null;
+	m_slotAtom = 0;
+
+	const QChar* str = m_atom.unicode();
+	uint length = m_atom.length();
+	uint pos = 0;
+
+	// Blocker ("!" or "!!"), only occurring in ebuilds
+	if( pos < length && str[pos] == '!' ) {
+		pos++;
+		m_blocker = WeakBlocker;
+		if( pos < length && str[pos] == '!' ) {
+			pos++;
+			m_blocker = StrongBlocker;
+		}
+	}
+
+	// Greater-than/less-than/equal, or "all revisions" prefix
+	char prefix = ( pos < length ) ? str[pos].latin1() : 0;
+	if( prefix == '~' ) {
+		m_operator = AllRevisions;
+		pos++;
+	}
+	else if( prefix == '=' ) {
+		m_operator = Equal;
+		pos++;
+	}
+	else if( prefix == '<' || prefix == '>' ) {
+		pos++;
+		bool orEqual = ( pos < length && str[pos] == '=' );
+		if( orEqual )
+			pos++;
+
+		if( prefix == '<' )
+			m_operator = orEqual ? LessEqual : Less;
+		else
+			m_operator = orEqual ? GreaterEqual : Greater;
+	}
+	bool hasPrefix = ( m_operator != AnyVersion );
+
+	// Category, up to the slash
+	m_categoryRange.start = pos;
+	while( pos < length && isCategoryChar(str[pos]) )
+		pos++;
+	m_categoryRange.length = pos - m_categoryRange.start;
+
+	if( m_categoryRange.length == 0 || str[m_categoryRange.start] == '-'
+	    || pos >= length || str[pos] != '/' )
+	{
 		return false;
 	}
+	pos++;
+
+	// Package name and version, up to the slot or USE dependencies
+	uint nameEnd = pos;
+	while( nameEnd < length && str[nameEnd] != ':' && str[nameEnd] != '[' )
+		nameEnd++;
+
+	uint versionEnd = nameEnd;
+	bool wildcard = ( versionEnd > pos && str[versionEnd - 1] == '*' );
+	if( wildcard )
+		versionEnd--;
+
+	m_packageRange.start = pos;
+	m_packageRange.length = versionEnd - pos;
 
-	// Get the captured strings
-	m_callsign    = m_rxAtom.cap( POS_CALLSIGN ).isEmpty() ? false : true;
-	m_prefix      = m_rxAtom.cap( POS_PREFIX );
-	m_package     = m_rxAtom.cap( POS_PACKAGE );
-	m_version     = m_rxAtom.cap( POS_VERSION );
-	m_category->setCategory( m_rxAtom.cap(POS_CATEGORY),
-	                         m_rxAtom.cap(POS_SUBCATEGORY) );
-
-	// Additional check: If there is a version, there also must be a prefix
-	if( m_version.isEmpty() != m_prefix.isEmpty() ) {
-		m_matches = false;
+	if( hasPrefix )
+	{
+		// The version begins after the first hyphen that is followed by
+		// a valid version extending to the end of the name part
+		for( uint i = pos + 1; i + 1 < versionEnd; i++ )
+		{
+			if( str[i] != '-' || !str[i + 1].isDigit() )
+				continue;
+
+			if( m_versionKey.parse( str + i + 1, versionEnd - i - 1 ) ) {
+				m_packageRange.length = i - pos;
+				m_versionRange.start = i + 1;
+				m_versionRange.length = versionEnd - i - 1;
+				break;
+			}
+		}
+
+		if( m_versionRange.length == 0 )
+		{
+			// Without version, only "=category/package-*" is valid
+			if( !wildcard )
+				return false;
+
+			if( m_packageRange.length > 0 && str[versionEnd - 1] == '-' )
+				m_packageRange.length--;
+
+			m_operator = AnyVersion;
+		}
+		else if( wildcard ) {
+			m_operator = BaseVersion;
+		}
+	}
+	else if( wildcard ) {
+		// If there is a version, there also must be a prefix
+		return false;
+	}
+
+	if( !hasPrefix || m_versionRange.length == 0 )
+		m_versionKey.parse( str, 0 ); // make it invalid
+
+	if( m_packageRange.length == 0 || str[m_packageRange.start] == '-' )
 		return false;
+
+	for( uint i = m_packageRange.start;
+	     i < m_packageRange.start + m_packageRange.length; i++ )
+	{
+		if( !isNameChar(str[i]) )
+			return false;
+	}
+	pos = nameEnd;
+
+	// Slot, like ":2", with optional sub-slot (":2/2.1")
+	// and slot operator (":2=" or ":*")
+	if( pos < length && str[pos] == ':' )
+	{
+		pos++;
+		uint slotStart = pos;
+
+		m_slotRange.start = pos;
+		while( pos < length && isCategoryChar(str[pos]) )
+			pos++;
+		m_slotRange.length = pos - m_slotRange.start;
+
+		if( m_slotRange.length > 0 && pos < length && str[pos] == '/' )
+		{
+			pos++;
+			m_subslotRange.start = pos;
+			while( pos < length && isCategoryChar(str[pos]) )
+				pos++;
+			m_subslotRange.length = pos - m_subslotRange.start;
+
+			if( m_subslotRange.length == 0 )
+				return false;
+		}
+
+		if( pos < length && ( str[pos] == '=' || str[pos] == '*' ) )
+			pos++;
+
+		if( pos == slotStart )
+			return false;
+	}
+
+	// USE dependencies, like "[ssl,-gtk]"
+	if( pos < length && str[pos] == '[' )
+	{
+		pos++;
+		m_useRange.start = pos;
+		while( pos < length && str[pos] != ']' )
+			pos++;
+		m_useRange.length = pos - m_useRange.start;
+
+		if( pos >= length || m_useRange.length == 0 )
+			return false;
+		pos++;
 	}
 
-	// Strip the hyphen at the start of the version, except when it's a "*"
-	if( !m_version.isEmpty() && m_version[0] == '-' )
-		m_version = m_version.mid(1);
+	// Anything left means that the atom is invalid
+	if( pos != length )
+		return false;
+
+	// Not yet returned false, so it's a valid atom. The strings that
+	// matching needs are only created now, and only if there are any.
+	if( m_versionRange.length > 0 )
+		m_versionString = version();
+	if( m_slotRange.length > 0 )
+		m_slotAtom = AtomTable::atom( slot() );
 
-	// Not yet returned false, so it's a valid atom
 	m_matches = true;
 	return true;
 }
@@ -126,60 +295,164 @@ QValueList<PortagePackageVersion*> DependAtom::matchingVersions()
 	if( m_packages == NULL || m_matches == false )
 		return matchingVersions; // return an empty list
 
-	if( m_packages->contains(m_category, m_package) == false )
+	m_category->loadFromUniqueName( categoryName() );
+	PortagePackage* pkg = m_packages->find( m_category, packageName() );
+
+	if( pkg == NULL )
 		return matchingVersions; // return an empty list
 
-	PortagePackage* pkg = m_packages->package(
-		new PortageCategory(*m_category), m_package
-	);
+	// So, let's iterate through the versions to check if they match or not
+	for( Package::versioniterator versionIterator = pkg->versionBegin();
+	     versionIterator != pkg->versionEnd(); versionIterator++ )
+	{
+		PortagePackageVersion* version =
+			(PortagePackageVersion*) *versionIterator;
 
-	bool matchAllVersions;
-	if( m_version.isEmpty() || m_version == "*" )
-		matchAllVersions = true;
-	else
-		matchAllVersions = false;
+		if( matchesVersion( m_operator, m_versionString, m_versionKey,
+		                    m_slotAtom, version ) )
+			matchingVersions.append( version );
+	}
+	return matchingVersions;
 
-	bool matchBaseVersion;
-	if( m_version.endsWith("*") )
-	{
-		// remove the trailing star
-		m_version = m_version.left( m_version.length() - 1 );
-		matchBaseVersion = true;
+} // end of matchingVersions()
+
+/**
+ * Return true if the given version (which is expected to belong to
+ * the package described by the atom) matches the atom's version
+ * and slot parts. Only call this after parse() returned true.
+ * USE dependencies are not checked.
+ */
+bool DependAtom::matches( const PortagePackageVersion* version ) const
+{
+	return matchesVersion( m_operator, m_versionString, m_versionKey,
+	                       m_slotAtom, version );
+}
+
+/**
+ * Check a package version against a pre-parsed version part of an atom.
+ * This is the actual matching function used by matches() and
+ * matchingVersions(), and it's static so that pre-parsed atoms
+ * (like the ones of FileAtomLoaderBase) can be matched without creating
+ * a DependAtom object and parsing the atom string again.
+ *
+ * Versions are compared by their PortageVersion keys, falling back to
+ * string comparison if one of the version strings could not be parsed.
+ * If the atom has a slot, the version's slot has to be the same one,
+ * so versions whose slot is unknown (because their details haven't been
+ * loaded yet) don't match. Sub-slots are not compared, as versions
+ * don't know about them.
+ *
+ * @param versionOperator  The matching operator of the atom.
+ * @param versionString    The version string of the atom, without a
+ *                         trailing "*" in case of BaseVersion.
+ * @param versionKey       The parsed version key of versionString.
+ * @param slotAtom         The AtomTable atom of the atom's slot,
+ *                         or 0 if the atom has no slot.
+ * @param version          The package version that is checked.
+ */
+bool DependAtom::matchesVersion( VersionOperator versionOperator,
+	const QString& versionString, const PortageVersion& versionKey,
+	Q_UINT32 slotAtom, const PortagePackageVersion* version )
+{
+	if( slotAtom != 0 && version->slotAtom() != slotAtom )
+		return false;
+
+	if( versionOperator == AnyVersion )
+		return true;
+	else if( versionOperator == BaseVersion )
+		return version->version().startsWith( versionString );
+
+	int result;
+	if( versionKey.isValid() && version->versionKey().isValid() ) {
+		result = version->versionKey().compare(
+			versionKey, versionOperator == AllRevisions );
 	}
 	else {
-		matchBaseVersion = false;
+		result = version->version().compare( versionString );
+	}
+
+	switch( versionOperator )
+	{
+	case Equal:
+	case AllRevisions:
+		return ( result == 0 );
+	case Less:
+		return ( result < 0 );
+	case LessEqual:
+		return ( result <= 0 );
+	case Greater:
+		return ( result > 0 );
+	case GreaterEqual:
+		return ( result >= 0 );
+	default:
+		return false;
 	}
+}
+
+/**
+ * Return the unique name of the atom's category, like "app-portage".
+ */
+QString DependAtom::categoryName() const
+{
+	return part( m_categoryRange );
+}
+
+/**
+ * Return the atom's package name, like "portage".
+ */
+QString DependAtom::packageName() const
+{
+	return part( m_packageRange );
+}
 
-	// When this is set true, it will match all versions
-	// with exactly the same version string as the parsed one.
-	bool matchEqual = m_prefix.endsWith("=");
+/**
+ * Return the atom's version string, like "2.0.51-r2", or QString::null
+ * if the atom doesn't contain a version. For atoms with a trailing
+ * wildcard ("*"), the wildcard is not included.
+ */
+QString DependAtom::version() const
+{
+	return part( m_versionRange );
+}
 
-	// When this is set true, it will match all versions greater than
-	// (but not equalling) the parsed version from the atom.
-	// When false, it will match all versions less than
-	// (but not equalling, too) the parsed version.
-	bool matchGreaterThan = m_prefix.startsWith(">");
+/**
+ * Return the slot name that the atom is restricted to, like "2" for
+ * "x11-libs/gtk+:2", or QString::null if the atom doesn't specify one.
+ * Sub-slot and slot operator are not included.
+ */
+QString DependAtom::slot() const
+{
+	return part( m_slotRange );
+}
 
+/**
+ * Return the sub-slot name that the atom is restricted to, like "2.1" for
+ * "dev-libs/foo:2/2.1", or QString::null if there is none.
+ */
+QString DependAtom::subslot() const
+{
+	return part( m_subslotRange );
+}
 
-	// So, let's iterate through the versions to check if they match or not
-	for( Package::versioniterator versionIterator = pkg->versionBegin();
-	     versionIterator != pkg->versionBegin(); versionIterator++ )
-	{
-		if( ( matchAllVersions == true ) ||
-		    ( matchBaseVersion == true  && (*versionIterator)->version().startsWith(m_version) ) ||
-		    ( matchEqual       == true  && (*versionIterator)->version() == m_version   ) ||
-		    ( matchEqual == false && matchGreaterThan == true  && (*versionIterator)->isNewerThan(m_version) ) ||
-		    ( matchEqual == false && matchGreaterThan == false && (*versionIterator)->isOlderThan(m_version) )
-		  )
-		{
-			matchingVersions.append(
-				(PortagePackageVersion*) *versionIterator );
-			continue;
-		}
-	}
-	return matchingVersions;
+/**
+ * Return the USE dependencies of the atom, like "ssl" and "-gtk" for
+ * "net-misc/foo[ssl,-gtk]". If there are none, an empty list is returned.
+ */
+QStringList DependAtom::useDependencies() const
+{
+	return QStringList::split( ',', part(m_useRange) );
+}
 
-} // end of matchingVersions()
+/**
+ * Create a string out of the given part of the parsed atom string.
+ */
+QString DependAtom::part( const Range& range ) const
+{
+	if( range.length == 0 )
+		return QString::null;
+	else
+		return m_atom.mid( range.start, range.length );
+}
 
 
 /**
@@ -190,7 +463,7 @@ QValueList<PortagePackageVersion*> DependAtom::matchingVersions()
  */
 bool DependAtom::isBlocking()
 {
-	return m_callsign;
+	return ( m_blocker != NoBlocker );
 }
 
 } // namespace
@@ -22,8 +22,10 @@
 #define LIBPAKTDEPENDATOM_H
 
 #include "../../base/core/packagelist.h"
+#include "portageversion.h"
 
-#include <qregexp.h>
+#include <qstring.h>
+#include <qstringlist.h>
 #include <qvaluelist.h>
 
 namespace libpakt {
@@ -38,40 +40,108 @@ class PortagePackageVersion;
  * DEPEND atoms are the strings in files like package.keywords, and are
  * also (all should we say mainly) used in ebuilds to describe dependencies.
  *
+ * Atoms are parsed by a hand-written tokenizer in a single pass over the
+ * string: the parts of the atom (category, package name, version, slot
+ * and USE dependencies) are only stored as positions inside the atom
+ * string, and strings for them are only created when they're requested.
+ * The version string is the exception, it's created once so that
+ * matching versions doesn't need to allocate memory.
+ *
  * @short  A depend atom parser and matching package retriever.
  */
 class DependAtom
 {
 public:
+	//! The ways of matching versions, as given by the atom's prefix.
+	enum VersionOperator
+	{
+		AnyVersion = 0,   //!< no version, or "=category/package-*"
+		Equal = 1,        //!< "=", exactly the given version
+		BaseVersion = 2,  //!< "=" with a trailing "*", all versions starting with the given one
+		AllRevisions = 3, //!< "~", the given version with any revision
+		Less = 4,         //!< "<"
+		LessEqual = 5,    //!< "<="
+		Greater = 6,      //!< ">"
+		GreaterEqual = 7  //!< ">="
+	};
+
+	//! The kinds of blockers, as given by the "!" or "!!" prefix.
+	enum Blocker
+	{
+		NoBlocker = 0,    //!< not a blocker
+		WeakBlocker = 1,  //!< "!"
+		StrongBlocker = 2 //!< "!!"
+	};
+
 	DependAtom( TemplatedPackageList<PortagePackage>* packages );
 	~DependAtom();
 
 	bool parse( const QString& atom );
 
 	QValueList<PortagePackageVersion*> matchingVersions();
+	bool matches( const PortagePackageVersion* version ) const;
 
 	bool isBlocking();
+	Blocker blocker() const { return m_blocker; }
+
+	QString categoryName() const;
+	QString packageName() const;
+	VersionOperator versionOperator() const { return m_operator; }
+	QString version() const;
+	const PortageVersion& versionKey() const { return m_versionKey; }
+	QString slot() const;
+	Q_UINT32 slotAtom() const { return m_slotAtom; }
+	QString subslot() const;
+	QStringList useDependencies() const;
+	bool hasUseDependencies() const { return ( m_useRange.length > 0 ); }
+
+	static bool matchesVersion( VersionOperator versionOperator,
+		const QString& versionString, const PortageVersion& versionKey,
+		Q_UINT32 slotAtom, const PortagePackageVersion* version );
 
 private:
+	//! A part of the atom string, given by its position and length.
+	struct Range
+	{
+		uint start;
+		uint length;
+	};
+
+	QString part( const Range& range ) const;
+
 	//! A pointer to the portage tree from which the packages are retrieved.
 	TemplatedPackageList<PortagePackage>* m_packages;
-	//! The regular expression for the whole atom.
-	QRegExp m_rxAtom;
 	//! This is set to the result of parse().
 	bool m_matches;
+	//! The parsed atom string, which the ranges below refer to.
+	QString m_atom;
+	//! The category object for looking up the package, set by matchingVersions().
+	PortageCategory* m_category;
 
 	// These are the extracted parts of the atom.
 
-	//! true if the callsign prefix ("blocked by this package" in ebuild dependencies) is there.
-	bool m_callsign;
-	//! A compare sign (greater than / less than / equal) or the "all revisions" prefix ("~").
-	QString m_prefix;
-	//! The main category of the package.
-	PortageCategory* m_category;
+	//! The blocker prefix ("blocked by this package" in ebuild dependencies).
+	Blocker m_blocker;
+	//! The version matching operator, derived from the prefix and the version.
+	VersionOperator m_operator;
+	//! The category, like "app-portage".
+	Range m_categoryRange;
 	//! The package name.
-	QString m_package;
-	//! The complete version string.
-	QString m_version;
+	Range m_packageRange;
+	//! The version string, without the trailing "*" of base version matches.
+	Range m_versionRange;
+	//! The slot name, without sub-slot and slot operator.
+	Range m_slotRange;
+	//! The sub-slot name, like "2.1" in ":2/2.1".
+	Range m_subslotRange;
+	//! The USE dependencies between the square brackets, separated by commas.
+	Range m_useRange;
+	//! The pre-parsed comparison key of the version string.
+	PortageVersion m_versionKey;
+	//! The version string, created once by parse() for matching versions.
+	QString m_versionString;
+	//! The AtomTable atom of the slot, or 0 if the atom has no slot.
+	Q_UINT32 m_slotAtom;
 };
 
 }
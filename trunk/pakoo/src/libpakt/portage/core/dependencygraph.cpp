@@ -0,0 +1,389 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "dependencygraph.h"
+
+#include "portagepackage.h"
+#include "portagecategory.h"
+#include "portagepackageversion.h"
+#include "../../base/core/atomtable.h"
+
+// For more info on dependency strings, see the DEPEND section of man 5 ebuild
+
+
+namespace libpakt {
+
+/**
+ * Initialize an empty graph.
+ *
+ * @param packages  The package list that contains the versions
+ *                  which atoms are matched against.
+ */
+DependencyGraph::DependencyGraph( TemplatedPackageList<PortagePackage>* packages )
+	: m_atom( packages )
+{
+	m_packages = packages;
+}
+
+/**
+ * Remove all versions and nodes from the graph.
+ * Version ids and node indices are invalid afterwards.
+ */
+void DependencyGraph::clear()
+{
+	m_versions.clear();
+	m_versionIds.clear();
+	m_nodes.clear();
+	m_edges.clear();
+	m_atoms.clear();
+}
+
+/**
+ * Return the number of versions in the graph. Version ids range
+ * from 0 to versionCount() - 1.
+ */
+uint DependencyGraph::versionCount() const
+{
+	return m_versions.size();
+}
+
+/**
+ * Return the id of a package version, adding the version
+ * to the graph if it's not yet contained.
+ */
+Q_UINT32 DependencyGraph::versionId( PortagePackageVersion* version )
+{
+	QMap<PortagePackageVersion*,Q_UINT32>::iterator idIterator =
+		m_versionIds.find( version );
+
+	if( idIterator != m_versionIds.end() )
+		return idIterator.data();
+
+	VersionEntry entry;
+	entry.version = version;
+	entry.dependencyNode = NoNode;
+	entry.runtimeDependencyNode = NoNode;
+
+	Q_UINT32 id = m_versions.size();
+	m_versions.append( entry );
+	m_versionIds.insert( version, id );
+	return id;
+}
+
+/**
+ * Return the package version with the given id.
+ */
+PortagePackageVersion* DependencyGraph::version( Q_UINT32 id ) const
+{
+	return m_versions[id].version;
+}
+
+/**
+ * Returns true if the dependencies of the version with the given id
+ * have already been added with addDependencies(), false otherwise.
+ */
+bool DependencyGraph::hasDependencies( Q_UINT32 id ) const
+{
+	return ( m_versions[id].dependencyNode != NoNode );
+}
+
+/**
+ * Parse the dependency strings of a version and add them to the graph.
+ * Afterwards, dependencyNode() and runtimeDependencyNode() return the
+ * root nodes of the parsed dependencies, which are AllOfNode groups.
+ * Invalid atoms are left out.
+ *
+ * @param id                   The id of the version.
+ * @param dependencies         The DEPEND string of the version.
+ * @param runtimeDependencies  The RDEPEND string of the version.
+ */
+void DependencyGraph::addDependencies( Q_UINT32 id,
+	const QString& dependencies, const QString& runtimeDependencies )
+{
+	Q_UINT32 dependencyNode = parseDependencies( dependencies );
+	Q_UINT32 runtimeDependencyNode = parseDependencies( runtimeDependencies );
+
+	m_versions[id].dependencyNode = dependencyNode;
+	m_versions[id].runtimeDependencyNode = runtimeDependencyNode;
+}
+
+/**
+ * Return the root node of the build time dependencies of a version,
+ * or NoNode if they haven't been added yet.
+ */
+Q_UINT32 DependencyGraph::dependencyNode( Q_UINT32 id ) const
+{
+	return m_versions[id].dependencyNode;
+}
+
+/**
+ * Return the root node of the run time dependencies of a version,
+ * or NoNode if they haven't been added yet.
+ */
+Q_UINT32 DependencyGraph::runtimeDependencyNode( Q_UINT32 id ) const
+{
+	return m_versions[id].runtimeDependencyNode;
+}
+
+/**
+ * Add a single atom node that doesn't belong to any version,
+ * like the atoms of the "world" file.
+ *
+ * @return  The index of the new atom node, or NoNode if the atom is invalid.
+ */
+Q_UINT32 DependencyGraph::addAtom( const QString& atom )
+{
+	Q_UINT32 index = m_nodes.size();
+
+	if( appendAtom(atom) == false )
+		return NoNode;
+	else
+		return index;
+}
+
+/**
+ * Return the node with the given index.
+ */
+const DependencyGraph::Node& DependencyGraph::node( Q_UINT32 index ) const
+{
+	return m_nodes[index];
+}
+
+/**
+ * Return the version id of an atom node's candidate. The candidates of
+ * a node range from node.firstEdge to node.firstEdge + node.edgeCount - 1.
+ */
+Q_UINT32 DependencyGraph::edge( Q_UINT32 index ) const
+{
+	return m_edges[index];
+}
+
+/**
+ * Return the original string of an atom or blocker node.
+ */
+const QString& DependencyGraph::atomString( Q_UINT32 nodeIndex ) const
+{
+	return m_atoms[ m_nodes[nodeIndex].value ].text;
+}
+
+/**
+ * Return the slot that an atom or blocker node is restricted to,
+ * as AtomTable atom, or 0 if the atom can be in any slot.
+ */
+Q_UINT32 DependencyGraph::atomSlot( Q_UINT32 nodeIndex ) const
+{
+	return m_atoms[ m_nodes[nodeIndex].value ].slot;
+}
+
+/**
+ * Parse a complete dependency string into an AllOfNode group.
+ *
+ * @return  The index of the group node.
+ */
+Q_UINT32 DependencyGraph::parseDependencies( const QString& string )
+{
+	Q_UINT32 index = m_nodes.size();
+
+	Node node;
+	node.type = AllOfNode;
+	node.value = 0;
+	node.firstEdge = 0;
+	node.edgeCount = 0;
+	m_nodes.append( node );
+
+	// parseItems() only returns true on closing parentheses,
+	// which are skipped if there is no matching opening one
+	uint pos = 0;
+	while( parseItems( string, pos ) == true )
+		;
+
+	m_nodes[index].size = m_nodes.size() - index;
+	return index;
+}
+
+/**
+ * Parse dependency items starting at pos until the end of the string
+ * or a closing parenthesis, and append their nodes.
+ *
+ * @return  true if a closing parenthesis has been found,
+ *          false if the end of the string has been reached.
+ */
+bool DependencyGraph::parseItems( const QString& string, uint& pos )
+{
+	uint tokenStart, tokenLength;
+
+	while( nextToken( string, pos, &tokenStart, &tokenLength ) )
+	{
+		if( tokenLength == 1 && string[tokenStart] == ')' )
+			return true;
+
+		parseItem( string, pos, tokenStart, tokenLength );
+	}
+	return false;
+}
+
+/**
+ * Parse a single dependency item, which is either an atom or a group.
+ * The item starts with the given token, and pos points to the character
+ * after the token. For groups, the whole group is parsed.
+ *
+ * @return  true if the item has been added, false if it's invalid.
+ */
+bool DependencyGraph::parseItem( const QString& string, uint& pos,
+                                 uint tokenStart, uint tokenLength )
+{
+	const QChar* token = string.unicode() + tokenStart;
+
+	// a plain group, "( ... )"
+	if( tokenLength == 1 && token[0] == '(' ) {
+		parseGroup( AllOfNode, 0, string, pos );
+		return true;
+	}
+
+	// a group of alternatives or a USE-conditional group,
+	// which both have to be followed by an opening parenthesis
+	bool anyOf = ( tokenLength == 2 && token[0] == '|' && token[1] == '|' );
+	bool useConditional = ( tokenLength > 1 && token[tokenLength - 1] == '?' );
+
+	if( anyOf || useConditional )
+	{
+		uint groupPos = pos, groupStart, groupLength;
+
+		if( nextToken( string, groupPos, &groupStart, &groupLength ) == false
+		    || groupLength != 1 || string[groupStart] != '(' )
+		{
+			return false;
+		}
+		pos = groupPos;
+
+		if( anyOf ) {
+			parseGroup( AnyOfNode, 0, string, pos );
+		}
+		else {
+			bool negated = ( token[0] == '!' );
+			uint flagStart = negated ? tokenStart + 1 : tokenStart;
+			uint flagLength = tokenStart + tokenLength - 1 - flagStart;
+
+			parseGroup( negated ? NegatedUseNode : UseNode,
+			            AtomTable::atom( string.mid(flagStart, flagLength) ),
+			            string, pos );
+		}
+		return true;
+	}
+
+	// everything else is an atom
+	return appendAtom( string.mid( tokenStart, tokenLength ) );
+}
+
+/**
+ * Append a group node and parse its items until the closing parenthesis.
+ * pos is expected to point to the character after the opening parenthesis.
+ */
+void DependencyGraph::parseGroup( NodeType type, Q_UINT32 value,
+                                  const QString& string, uint& pos )
+{
+	Q_UINT32 index = m_nodes.size();
+
+	Node node;
+	node.type = type;
+	node.value = value;
+	node.firstEdge = 0;
+	node.edgeCount = 0;
+	m_nodes.append( node );
+
+	parseItems( string, pos );
+
+	m_nodes[index].size = m_nodes.size() - index;
+}
+
+/**
+ * Parse an atom and append an atom or blocker node for it,
+ * with all matching versions of the package list as candidates.
+ * Newer versions come first in the candidate list.
+ *
+ * @return  true if the atom has been added, false if it's invalid.
+ */
+bool DependencyGraph::appendAtom( const QString& atom )
+{
+	if( m_atom.parse(atom) == false )
+		return false;
+
+	Node node;
+	node.type = m_atom.isBlocking() ? BlockerNode : AtomNode;
+	node.size = 1;
+	node.value = m_atoms.size();
+	node.firstEdge = m_edges.size();
+
+	PortageCategory category;
+	category.loadFromUniqueName( m_atom.categoryName() );
+	PortagePackage* package = m_packages->find( &category, m_atom.packageName() );
+
+	if( package != NULL )
+	{
+		QValueList<PackageVersion*> versions = package->sortedVersionList();
+		QValueList<PackageVersion*>::iterator versionIterator = versions.end();
+
+		while( versionIterator != versions.begin() )
+		{
+			--versionIterator;
+			PortagePackageVersion* version =
+				(PortagePackageVersion*) *versionIterator;
+
+			if( m_atom.matches(version) )
+				m_edges.append( versionId(version) );
+		}
+	}
+	node.edgeCount = m_edges.size() - node.firstEdge;
+	m_nodes.append( node );
+
+	AtomInfo info;
+	info.text = atom;
+	info.slot = m_atom.slot().isEmpty() ? 0 : AtomTable::atom( m_atom.slot() );
+	m_atoms.append( info );
+
+	return true;
+}
+
+/**
+ * Find the next whitespace separated token in a dependency string,
+ * starting at pos. Afterwards, pos points to the character after
+ * the token.
+ *
+ * @return  true if a token has been found, false at the end of the string.
+ */
+bool DependencyGraph::nextToken( const QString& string, uint& pos,
+                                 uint* tokenStart, uint* tokenLength )
+{
+	uint length = string.length();
+
+	while( pos < length && string[pos].isSpace() )
+		pos++;
+
+	if( pos >= length )
+		return false;
+
+	*tokenStart = pos;
+	while( pos < length && !string[pos].isSpace() )
+		pos++;
+	*tokenLength = pos - *tokenStart;
+
+	return true;
+}
+
+} // namespace
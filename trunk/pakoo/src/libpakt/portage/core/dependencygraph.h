@@ -0,0 +1,161 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTDEPENDENCYGRAPH_H
+#define LIBPAKTDEPENDENCYGRAPH_H
+
+#include <qstring.h>
+#include <qmap.h>
+#include <qvaluevector.h>
+
+#include "dependatom.h"
+
+
+namespace libpakt {
+
+class PortagePackage;
+class PortagePackageVersion;
+
+/**
+ * DependencyGraph stores the dependencies of package versions in a
+ * compact, pre-parsed form. Each version that is part of the graph
+ * gets a version id, and its DEPEND and RDEPEND strings are parsed into
+ * a tree of nodes: groups of required items, "||" groups of alternatives,
+ * USE-conditional groups ("flag? ( ... )" and "!flag? ( ... )") and atoms.
+ * An atom node refers to its candidates, which are the ids of all versions
+ * matching the atom (newest first), so resolving dependencies doesn't
+ * need any string processing anymore.
+ *
+ * The nodes of all versions are stored in a single array in pre-order,
+ * so the children of a node directly follow it, and its next sibling
+ * is found by skipping the node's subtree size. Versions are added
+ * on demand by versionId(), and their dependencies are only parsed
+ * when addDependencies() is called, so the graph only contains the
+ * part of the tree that is actually needed.
+ *
+ * @short  A compact graph of package version dependencies.
+ */
+class DependencyGraph
+{
+public:
+	//! The types of dependency nodes.
+	enum NodeType
+	{
+		AllOfNode = 0,      //!< a group of items that are all required
+		AnyOfNode = 1,      //!< "|| ( ... )", one of the items is required
+		UseNode = 2,        //!< "flag? ( ... )", required if the USE flag is set
+		NegatedUseNode = 3, //!< "!flag? ( ... )", required if the USE flag is not set
+		AtomNode = 4,       //!< a package atom, one of its candidates is required
+		BlockerNode = 5     //!< a blocking atom, none of its candidates may be installed
+	};
+
+	enum { NoNode = 0xffffffff };
+
+	/**
+	 * A node of the dependency tree. For group nodes, the children follow
+	 * the node directly, and 'size' is the number of nodes of the whole
+	 * subtree (including the node itself). For atom and blocker nodes,
+	 * 'size' is 1.
+	 */
+	struct Node
+	{
+		//! The NodeType of this node.
+		Q_UINT8 type;
+		//! The number of nodes in this node's subtree, including itself.
+		Q_UINT32 size;
+		//! The USE flag atom for USE nodes, or the atom index for atom and blocker nodes.
+		Q_UINT32 value;
+		//! The index of the first candidate in the edge array.
+		Q_UINT32 firstEdge;
+		//! The number of candidates, which are the matching version ids.
+		Q_UINT32 edgeCount;
+	};
+
+	DependencyGraph( TemplatedPackageList<PortagePackage>* packages );
+
+	void clear();
+
+	uint versionCount() const;
+	Q_UINT32 versionId( PortagePackageVersion* version );
+	PortagePackageVersion* version( Q_UINT32 id ) const;
+
+	bool hasDependencies( Q_UINT32 id ) const;
+	void addDependencies( Q_UINT32 id, const QString& dependencies,
+	                      const QString& runtimeDependencies );
+	Q_UINT32 dependencyNode( Q_UINT32 id ) const;
+	Q_UINT32 runtimeDependencyNode( Q_UINT32 id ) const;
+
+	Q_UINT32 addAtom( const QString& atom );
+
+	const Node& node( Q_UINT32 index ) const;
+	Q_UINT32 edge( Q_UINT32 index ) const;
+	const QString& atomString( Q_UINT32 nodeIndex ) const;
+	Q_UINT32 atomSlot( Q_UINT32 nodeIndex ) const;
+
+private:
+	//! The graph data of a single package version.
+	struct VersionEntry
+	{
+		//! The version itself.
+		PortagePackageVersion* version;
+		//! The root node of the build time dependencies, or NoNode.
+		Q_UINT32 dependencyNode;
+		//! The root node of the run time dependencies, or NoNode.
+		Q_UINT32 runtimeDependencyNode;
+	};
+
+	//! Additional info about an atom node that's only needed occasionally.
+	struct AtomInfo
+	{
+		//! The atom string, for reporting unresolved dependencies.
+		QString text;
+		//! The slot that the atom is restricted to, as AtomTable atom (0 if none).
+		Q_UINT32 slot;
+	};
+
+	Q_UINT32 parseDependencies( const QString& string );
+	bool parseItems( const QString& string, uint& pos );
+	bool parseItem( const QString& string, uint& pos,
+	                uint tokenStart, uint tokenLength );
+	void parseGroup( NodeType type, Q_UINT32 value,
+	                 const QString& string, uint& pos );
+	bool appendAtom( const QString& atom );
+	static bool nextToken( const QString& string, uint& pos,
+	                       uint* tokenStart, uint* tokenLength );
+
+	//! The package list where the candidates of atoms are taken from.
+	TemplatedPackageList<PortagePackage>* m_packages;
+	//! The atom parser.
+	DependAtom m_atom;
+
+	//! The versions in the graph, indexed by version id.
+	QValueVector<VersionEntry> m_versions;
+	//! The version ids, for looking up versions.
+	QMap<PortagePackageVersion*,Q_UINT32> m_versionIds;
+	//! All nodes, in pre-order.
+	QValueVector<Node> m_nodes;
+	//! The candidate version ids of all atom nodes.
+	QValueVector<Q_UINT32> m_edges;
+	//! Atom strings and slots, indexed by the 'value' of atom nodes.
+	QValueVector<AtomInfo> m_atoms;
+};
+
+}
+
+#endif // LIBPAKTDEPENDENCYGRAPH_H
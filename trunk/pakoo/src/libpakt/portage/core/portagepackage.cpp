@@ -22,6 +22,8 @@
 
 #include "portagepackageversion.h"
 
+#include <qmutex.h>
+
 
 namespace libpakt {
 
@@ -134,46 +136,111 @@ QString PortagePackage::shortDescription()
 bool PortagePackage::canUpdate( PackageVersion* genericVersion )
 {
 	PortagePackageVersion* version = (PortagePackageVersion*) genericVersion;
-	QValueList<PackageVersion*> sortedVersions = this->sortedVersionList();
-	QValueList<PackageVersion*>::iterator versionIterator;
-	bool check = false;
+	Q_UINT32 slot = version->slotAtom();
+
+	QMutexLocker locker( derivedStateMutex() );
+	ensureDerivedState();
 
-	// go through each version and check if it's newer than the given one
-	for( versionIterator = sortedVersions.begin();
-	     versionIterator != sortedVersions.end(); versionIterator++ )
+	// go through the versions newer than the given one, from the latest
+	for( uint i = m_sortedVersions.count(); i > 0; i-- )
 	{
-		// Don't check versions that are not newer than the given one
-		if( check == false
-		    && (*versionIterator)->version() != version->version() )
-		{
-			continue;
-		}
-		else if( check == true )
-		{
-			// If we get here, the versionIterator is newer
-			// than the given version.
-
-			if( (*versionIterator)->isInstalled() == true ) {
-				continue; // if it's installed, it's not upgradable. next one.
-			}
-			if( version->slot() ==
-			        ((PortagePackageVersion*)(*versionIterator))->slot()
-			    && (*versionIterator)->isAvailable() )
-			{
-				return true;
-			}
+		PortagePackageVersion* newerVersion =
+			(PortagePackageVersion*) m_sortedVersions[i - 1];
+
+		if( newerVersion == version )
+			break; // all remaining versions are older
+
+		if( newerVersion->isInstalled() == true ) {
+			continue; // if it's installed, it's not upgradable. next one.
 		}
-		else // if( (*versionIterator).version == versionString )
-		{
-			// From the next iteration on,
-			// all versions are newer than the given one:
-			check = true;
+		if( newerVersion->slotAtom() == slot && newerVersion->isAvailable() ) {
+			return true;
 		}
 	}
 	// if the loop hasn't already returned true, there are no updates
 	return false;
 } // end of canUpdate()
 
+/**
+ * Retrieve the latest version of this package that is stable on the
+ * given architecture (e.g. "x86" or "~ppc"). The result is cached for each
+ * architecture until the versions change. If there is no stable version,
+ * NULL is returned.
+ */
+PortagePackageVersion* PortagePackage::latestStableVersion( const QString& arch )
+{
+	QMutexLocker locker( derivedStateMutex() );
+	ensureDerivedState();
+
+	QMap<QString,PortagePackageVersion*>::iterator stableIterator =
+		m_latestStableVersions.find( arch );
+
+	if( stableIterator != m_latestStableVersions.end() )
+		return *stableIterator;
+
+	PortagePackageVersion* stableVersion = NULL;
+
+	for( uint i = m_sortedVersions.count(); i > 0; i-- )
+	{
+		PortagePackageVersion* version =
+			(PortagePackageVersion*) m_sortedVersions[i - 1];
+
+		if( version->stability(arch) == PortagePackageVersion::Stable ) {
+			stableVersion = version;
+			break;
+		}
+	}
+
+	m_latestStableVersions.insert( arch, stableVersion );
+	return stableVersion;
+}
+
+/**
+ * Retrieve the latest version of this package that is in the given slot,
+ * not taking stability into account. If there is no version in this slot,
+ * NULL is returned.
+ */
+PortagePackageVersion* PortagePackage::latestVersionInSlot( const QString& slot )
+{
+	Q_UINT32 slotAtom;
+	if( slot.isEmpty() )
+		slotAtom = 0;
+	else if( AtomTable::find( slot, &slotAtom ) == false )
+		return NULL; // no version can use a slot that's not even an atom
+
+	QMutexLocker locker( derivedStateMutex() );
+	ensureDerivedState();
+
+	QMap<Q_UINT32,PortagePackageVersion*>::iterator slotIterator =
+		m_slotHeads.find( slotAtom );
+
+	if( slotIterator == m_slotHeads.end() )
+		return NULL;
+	else
+		return *slotIterator;
+}
+
+/**
+ * Overloaded to additionally find the latest version of each slot.
+ * The latest stable versions are looked up on demand in
+ * latestStableVersion(), so they are only reset here.
+ */
+void PortagePackage::updateDerivedState()
+{
+	Package::updateDerivedState();
+
+	m_slotHeads.clear();
+	m_latestStableVersions.clear();
+
+	// later versions overwrite older ones of the same slot
+	for( uint i = 0; i < m_sortedVersions.count(); i++ )
+	{
+		PortagePackageVersion* version =
+			(PortagePackageVersion*) m_sortedVersions[i];
+		m_slotHeads.replace( version->slotAtom(), version );
+	}
+}
+
 /**
  * Retrieves the list of slots that this package's versions use.
  */
@@ -206,15 +273,22 @@ QValueList<PackageVersion*> PortagePackage::sortedVersionListInSlot(
 {
 	QValueList<PackageVersion*> sortedVersionsInSlot;
 
-	QValueList<PackageVersion*> sortedVersions = this->sortedVersionList();
-	QValueList<PackageVersion*>::iterator versionIterator;
+	Q_UINT32 slotAtom;
+	if( slot.isEmpty() )
+		slotAtom = 0;
+	else if( AtomTable::find( slot, &slotAtom ) == false )
+		return sortedVersionsInSlot;
 
-	// go through each version and check if it's newer than the given one
-	for( versionIterator = sortedVersions.begin();
-	     versionIterator != sortedVersions.end(); versionIterator++ )
+	QMutexLocker locker( derivedStateMutex() );
+	ensureDerivedState();
+
+	for( uint i = 0; i < m_sortedVersions.count(); i++ )
 	{
-		if( ((PortagePackageVersion*)(*versionIterator))->slot() == slot )
-			sortedVersionsInSlot.append( *versionIterator );
+		PortagePackageVersion* version =
+			(PortagePackageVersion*) m_sortedVersions[i];
+
+		if( version->slotAtom() == slotAtom )
+			sortedVersionsInSlot.append( version );
 	}
 	return sortedVersionsInSlot;
 }
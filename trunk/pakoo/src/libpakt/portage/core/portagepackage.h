@@ -25,6 +25,7 @@
 #include "portagepackageversion.h"
 
 #include <qstring.h>
+#include <qmap.h>
 
 
 namespace libpakt {
@@ -45,6 +46,9 @@ public:
 
 	bool canUpdate( PackageVersion* version );
 
+	PortagePackageVersion* latestStableVersion( const QString& arch );
+	PortagePackageVersion* latestVersionInSlot( const QString& slot );
+
 	QString description();
 	QString shortDescription();
 
@@ -53,9 +57,15 @@ public:
 
 protected:
 	PortagePackageVersion* createPackageVersion( const QString& versionString );
+	void updateDerivedState();
 
 private:
 	QString m_cachedDescription;
+
+	//! The latest version of each slot, with the slot atom as key.
+	QMap<Q_UINT32,PortagePackageVersion*> m_slotHeads;
+	//! The latest stable version for each architecture that has been asked for.
+	QMap<QString,PortagePackageVersion*> m_latestStableVersions;
 };
 
 }
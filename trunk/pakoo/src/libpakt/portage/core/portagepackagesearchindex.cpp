@@ -0,0 +1,126 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "portagepackagesearchindex.h"
+
+#include "portagepackage.h"
+#include "portagepackageversion.h"
+
+#include "../../base/core/atomtable.h"
+
+#include <qvaluevector.h>
+
+
+namespace libpakt {
+
+PortagePackageSearchIndex::PortagePackageSearchIndex()
+: PackageSearchIndex()
+{
+}
+
+/**
+ * Append a copy of a string to a searchable text, separated by a space.
+ * The copy doesn't share its data with the original string, which is
+ * owned by the package or the AtomTable.
+ */
+static void appendDetached( QString& text, const QString& string )
+{
+	if( string.isEmpty() )
+		return;
+
+	text += ' ';
+	text += QString( string.unicode(), string.length() );
+}
+
+/**
+ * Return true if one of the strings in the list equals the given one.
+ */
+static bool containsString(
+	const QValueVector<const QString*>& strings, const QString& string )
+{
+	for( uint i = 0; i < strings.count(); i++ )
+	{
+		if( *strings[i] == string )
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Overloaded to add the descriptions and home pages of all versions,
+ * as well as their USE flags, to the name. Only versions whose details
+ * have already been loaded have got those. Duplicate strings are only
+ * compared, not copied, and the USE flags are read as atoms instead of
+ * converting them into string lists.
+ */
+QString PortagePackageSearchIndex::searchableText( Package* package )
+{
+	QValueVector<const QString*> descriptions, homepages;
+	AtomList useflags;
+
+	Package::versioniterator versionIteratorEnd = package->versionEnd();
+
+	for( Package::versioniterator versionIterator = package->versionBegin();
+	     versionIterator != versionIteratorEnd; ++versionIterator )
+	{
+		PortagePackageVersion* version =
+			(PortagePackageVersion*) *versionIterator;
+
+		const QString& description = version->description();
+		if( description.isEmpty() == false
+		    && containsString(descriptions, description) == false )
+		{
+			descriptions.append( &description );
+		}
+
+		const QString& homepage = version->homepage();
+		if( homepage.isEmpty() == false
+		    && containsString(homepages, homepage) == false )
+		{
+			homepages.append( &homepage );
+		}
+
+		const AtomList& versionUseflags = version->useflagAtoms();
+		for( AtomList::const_iterator useflagIterator = versionUseflags.begin();
+		     useflagIterator != versionUseflags.end(); ++useflagIterator )
+		{
+			if( useflags.contains(*useflagIterator) == 0 )
+				useflags.append( *useflagIterator );
+		}
+	}
+
+	const QString& name = package->name();
+	QString text( name.unicode(), name.length() );
+
+	text += '\n';
+	for( uint i = 0; i < descriptions.count(); i++ )
+		appendDetached( text, *descriptions[i] );
+
+	text += '\n';
+	for( uint i = 0; i < homepages.count(); i++ )
+		appendDetached( text, *homepages[i] );
+
+	text += '\n';
+	for( uint i = 0; i < useflags.count(); i++ )
+		appendDetached( text, AtomTable::string(useflags[i]) );
+
+	return text;
+}
+
+} // namespace
@@ -0,0 +1,94 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "portagepackageselector.h"
+
+#include "portagepackage.h"
+#include "portagepackageversion.h"
+
+#include <qtl.h>
+
+
+namespace libpakt {
+
+PortagePackageSelector::PortagePackageSelector()
+: PackageSelector()
+{
+}
+
+/**
+ * Overloaded to add OverlayProperty for versions from an overlay.
+ */
+uint PortagePackageSelector::versionProperties( PackageVersion* version )
+{
+	uint properties = PackageSelector::versionProperties( version );
+
+	if( ((PortagePackageVersion*) version)->isOverlay() )
+		properties |= OverlayProperty;
+
+	return properties;
+}
+
+/**
+ * Overloaded to look for the keyword in the KEYWORDS of all versions.
+ * Only the atom lists are compared, so this is safe to be called
+ * from the worker threads.
+ */
+bool PortagePackageSelector::hasKeyword( Package* package,
+                                         Q_UINT32 keywordAtom )
+{
+	Package::versioniterator versionIteratorEnd = package->versionEnd();
+
+	for( Package::versioniterator versionIterator = package->versionBegin();
+	     versionIterator != versionIteratorEnd; ++versionIterator )
+	{
+		const AtomList& keywords =
+			((PortagePackageVersion*) *versionIterator)->keywordAtoms();
+
+		if( qFind(keywords.begin(), keywords.end(), keywordAtom)
+		    != keywords.end() )
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Overloaded to look for the license in the LICENSE of all versions.
+ * Only the atom lists are compared, so this is safe to be called
+ * from the worker threads.
+ */
+bool PortagePackageSelector::hasLicense( Package* package,
+                                         Q_UINT32 licenseAtom )
+{
+	Package::versioniterator versionIteratorEnd = package->versionEnd();
+
+	for( Package::versioniterator versionIterator = package->versionBegin();
+	     versionIterator != versionIteratorEnd; ++versionIterator )
+	{
+		const AtomList& licenses =
+			((PortagePackageVersion*) *versionIterator)->licenseAtoms();
+
+		if( qFind(licenses.begin(), licenses.end(), licenseAtom)
+		    != licenses.end() )
+			return true;
+	}
+	return false;
+}
+
+} // namespace
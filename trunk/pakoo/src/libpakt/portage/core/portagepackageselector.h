@@ -0,0 +1,45 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTPORTAGEPACKAGESELECTOR_H
+#define LIBPAKTPORTAGEPACKAGESELECTOR_H
+
+#include "../../base/core/packageselector.h"
+
+
+namespace libpakt {
+
+/**
+ * A PackageSelector for Portage packages, which knows about overlays,
+ * keywords and licenses of the package versions.
+ */
+class PortagePackageSelector : public PackageSelector
+{
+public:
+	PortagePackageSelector();
+
+protected:
+	uint versionProperties( PackageVersion* version );
+	bool hasKeyword( Package* package, Q_UINT32 keywordAtom );
+	bool hasLicense( Package* package, Q_UINT32 licenseAtom );
+};
+
+}
+
+#endif // LIBPAKTPORTAGEPACKAGESELECTOR_H
@@ -20,8 +20,33 @@
 
 #include "portagepackageversion.h"
 
+#include "../../base/core/package.h"
+
 namespace libpakt {
 
+/** Returned by keywordAtoms(), licenseAtoms() and useflagAtoms()
+ * for versions without detailed info. */
+static const AtomList emptyAtomList;
+
+/**
+ * Find out if a list of atoms contains the atom of the given string.
+ */
+static bool containsAtom( const AtomList& atoms, const QString& string )
+{
+	Q_UINT32 atom;
+
+	if( AtomTable::find( string, &atom ) == false )
+		return false; // not even in the table
+
+	for( AtomList::const_iterator atomIterator = atoms.begin();
+	     atomIterator != atoms.end(); ++atomIterator )
+	{
+		if( *atomIterator == atom )
+			return true;
+	}
+	return false;
+}
+
 /**
  * Initialize the version with its version string.
  * Protected so that only PortagePackage can construct
@@ -29,26 +54,34 @@ namespace libpakt {
  */
 PortagePackageVersion::PortagePackageVersion( Package* parent,
                                               const QString& version )
-	: PackageVersion( parent, version ),
-	// Regexp for a simple number, for use as a version number part
-	rxNumber("\\d+"),
-	// Regexp for a revision number, which are everywhere
-	rxRevision("-r(\\d+)$"),
-	// Regexp for a version suffix, like in freetts-1.2_beta
-	rxSuffix("_(alpha|beta|pre|rc|p)(\\d?)(?:-r\\d+)?$"),
-	// Regexp for a trailing character, like in util-linux-2.12i
-	rxTrailingChar("\\d([a-z])(?:_(?:alpha|beta|pre|rc|p)\\d?)?(?:-r\\d+)?$")
+	: PackageVersion( parent, version ), m_versionKey( version )
 {
+	m_details = NULL;
 	m_installed = false;
 	m_overlay = false;
-	/* This is what QString does automatically:
-	m_date = "";
-	m_description = "";
-	m_homepage = "";
-	m_slot = "";*/
 	m_hasDetailedInfo = false;
-	m_size = 0;
 	m_isHardMasked = false;
+	m_hasDependencyInfo = false;
+}
+
+/**
+ * Deconstructor, frees the additional version information.
+ */
+PortagePackageVersion::~PortagePackageVersion()
+{
+	delete m_details;
+}
+
+/**
+ * Returns the additional version information of this version,
+ * allocating it if that hasn't been done yet.
+ */
+PortagePackageVersion::Details* PortagePackageVersion::details()
+{
+	if( m_details == NULL )
+		m_details = new Details();
+
+	return m_details;
 }
 
 /**
@@ -63,6 +96,9 @@ bool PortagePackageVersion::isAvailable() const
 
 /**
  * Find out if this version has a higher version number than another one.
+ * The other version string is parsed for that, so if you've got
+ * a PortagePackageVersion object, better use the overloaded function
+ * that takes a version object, which is much cheaper.
  *
  * @param otherVersion  Version string of the version that should be compared
  *                      to this one.
@@ -71,137 +107,45 @@ bool PortagePackageVersion::isAvailable() const
  */
 bool PortagePackageVersion::isNewerThan( const QString& otherVersion ) const
 {
-	// this* is for this->version, that* is for otherVersion
-	QString thisNum, thatNum;
-
-	// Numerical representation of the suffix.
-	// Higher number means higher precedence.
-	long thisSuffix, thatSuffix;
-
-	// Revision number. 0 means the version doesn't have a revision.
-	int thisRevision, thatRevision;
-	// Numerical representation for possible trailing characters.
-	int thisTrailingChar, thatTrailingChar;
-
-	uint pos; // multi-purpose position integer
-
-	// start index of revision, suffix, and trailing character
-	int revisionPos, suffixPos, trailingCharPos;
-
-	// Retrieve revision, suffix and their positions in the version string
-	thisRevision = PortagePackageVersion::revisionNumber( version(),
-	                                                      &revisionPos );
-	thisSuffix = PortagePackageVersion::suffixNumber( version(), &suffixPos );
-	thisTrailingChar = PortagePackageVersion::trailingCharNumber(
-		version(), &trailingCharPos );
-
-	// determine the first non-base-version character
-	if( trailingCharPos != -1 )
-		pos = trailingCharPos;
-	else if( suffixPos != -1 )
-		pos = suffixPos;
-	else if( revisionPos != -1 )
-		pos = revisionPos;
-	else
-		pos = version().length();
-
-	// So, now we have a version string stripped of suffix and revision
-	QString thisBaseVersion( version().left(pos) );
-
-	// Same procedure for the other version string
-	thatRevision = PortagePackageVersion::revisionNumber( otherVersion,
-	                                                      &revisionPos );
-	thatSuffix = PortagePackageVersion::suffixNumber( otherVersion,
-	                                                  &suffixPos );
-	thatTrailingChar = PortagePackageVersion::trailingCharNumber(
-		otherVersion, &trailingCharPos );
-
-	// determine the first non-base-version character
-	if( trailingCharPos != -1 )
-		pos = trailingCharPos;
-	else if( suffixPos != -1 )
-		pos = suffixPos;
-	else if( revisionPos != -1 )
-		pos = revisionPos;
-	else
-		pos = version().length();
-
-	// So, now we have a version string stripped of suffix and revision
-	QString thatBaseVersion( otherVersion.left(pos) );
-
+	PortageVersion otherVersionKey( otherVersion );
 
-	// Ok, let's compare the remaining version strings.
-	// This is done by step-by-step comparing the number parts
-	// of this->version and the otherVersion.
-	// For example: in "1.2.3" vs. "1.3.4", first "1" is compared with "1",
-	// then "2" is compared with "3", and the third part isn't considered.
-
-	pos = 0; // pos is the start index for number searches
-	do
-	{
-		rxNumber.search( version(), pos );
-		thisNum = (const_cast<PortagePackageVersion*>(this))->rxNumber.cap(0);
-		rxNumber.search( otherVersion, pos );
-		thatNum = (const_cast<PortagePackageVersion*>(this))->rxNumber.cap(0);
-
-		if( thisNum.isEmpty() || thatNum.isEmpty() )
-			return false; // should not happen, just to make sure
+	// invalid version strings can only be compared as strings
+	if( !m_versionKey.isValid() || !otherVersionKey.isValid() )
+		return PackageVersion::isNewerThan( otherVersion );
+	else
+		return ( m_versionKey.compare( otherVersionKey ) > 0 );
+}
 
-		if( thisNum != thatNum ) // the current version number parts differ
-		{
-		if( thisNum.toInt() > thatNum.toInt() ) // this->version is newer:
-			return true;
-			else // well, the otherVersion is newer.
-				return false;
-		}
-		else // thisNum == thatNum
-		{
-			pos += thisNum.length();
+/**
+ * Find out if this version has a higher version number than another one,
+ * using the versions' pre-parsed version keys.
+ * The other version is expected to be a PortagePackageVersion as well.
+ *
+ * @param otherVersion  The version that should be compared to this one.
+ * @return  true if this version is newer than the one given in the argument.
+ *          false if the other version is newer (or if they are equal).
+ */
+bool PortagePackageVersion::isNewerThan(
+	const PackageVersion* otherVersion ) const
+{
+	const PortageVersion& otherVersionKey =
+		((const PortagePackageVersion*) otherVersion)->m_versionKey;
 
-			// check if any base-version string ends here
-			if( thisBaseVersion.length() <= pos
-			    && thatBaseVersion.length() <= pos ) // both versions end here
-			{
-				// compare trailing characters, if they are the same,
-				// then suffixes, if they are also the same, then revisions
-				if( thisTrailingChar > thatTrailingChar )
-					return true;
-				else if( thisTrailingChar < thatTrailingChar )
-					return false;
-				else if( thisTrailingChar == thatTrailingChar )
-				{
-					if( thisSuffix > thatSuffix )
-						return true;
-					else if( thisSuffix < thatSuffix )
-						return false;
-					else if( thisSuffix == thatSuffix )
-					{
-						if( thisRevision > thatRevision )
-							return true;
-						else // if( thisRevision <= thatRevision )
-							return false;
-					}
-				}
-			}
-			else if( thisBaseVersion.length() <= pos ) { // but not the other one
-				return false; // because the other version continues, like ".1"
-			}
-			else if( thatBaseVersion.length() <= pos ) { // but not this one
-				return true; // because this version continues, like ".1"
-			}
-			// so, both strings are not finished yet? then, go on...
-			else
-			{
-				pos++; // skip the "." (to the start of the next number part)
-				continue;
-			}
-		}
-	}
-	while( true );
-	// infinite loops are prevented by the <= instead of ==
-	// at the length checks
+	// invalid version strings can only be compared as strings
+	if( !m_versionKey.isValid() || !otherVersionKey.isValid() )
+		return PackageVersion::isNewerThan( otherVersion->version() );
+	else
+		return ( m_versionKey.compare( otherVersionKey ) > 0 );
+}
 
-} // end of isNewerThan()
+/**
+ * Returns the pre-parsed version string, which can be used for
+ * comparing versions without parsing the version strings again.
+ */
+const PortageVersion& PortagePackageVersion::versionKey() const
+{
+	return m_versionKey;
+}
 
 
 /**
@@ -218,8 +162,14 @@ PortagePackageVersion::Stability PortagePackageVersion::stability(
 	if( m_isHardMasked == true )
 		return HardMasked;
 
+	if( m_details == NULL ) // no keywords at all
+		return NotAvailable;
+
+	const AtomList& versionKeywords = m_details->keywords;
+	const AtomList& versionAcceptedKeywords = m_details->acceptedKeywords;
+
 	// check for additional keywords
-	if( !m_acceptedKeywords.empty() )
+	if( !versionAcceptedKeywords.empty() )
 	{
 		QString pureArch( arch );
 		pureArch.remove('~');
@@ -228,46 +178,48 @@ PortagePackageVersion::Stability PortagePackageVersion::stability(
 		// against arch instead of all version keywords. Should be sufficient
 		// for normal use though, as people are not supposed to add anything
 		// but ~arch or -~arch to ACCEPT_KEYWORDS/package.keywords.
-		for( QStringList::const_iterator keywordIterator = m_acceptedKeywords.begin();
-		     keywordIterator != m_acceptedKeywords.end(); keywordIterator++ )
+		for( AtomList::const_iterator keywordIterator = versionAcceptedKeywords.begin();
+		     keywordIterator != versionAcceptedKeywords.end(); keywordIterator++ )
 		{
+			const QString& acceptedKeyword = AtomTable::string( *keywordIterator );
+
 			// Accept masked and stable packages
 			// when the accepted keyword is ~arch or ~*
-			if( ( *keywordIterator == "~*" || *keywordIterator == "~" + arch )
+			if( ( acceptedKeyword == "~*" || acceptedKeyword == "~" + arch )
 			    &&
-			    ( m_keywords.contains("~" + pureArch)
-			      || m_keywords.contains(pureArch)   )
+			    ( containsAtom( versionKeywords, "~" + pureArch )
+			      || containsAtom( versionKeywords, pureArch )   )
 			  )
 			{
 				return Stable;
 			}
 			// Don't accept packages when the accepted keyword is -arch
-			else if( *keywordIterator == "-" + arch
-			         && m_keywords.contains(arch) )
+			else if( acceptedKeyword == "-" + arch
+			         && containsAtom( versionKeywords, arch ) )
 			{
 				return NotAvailable;
 			}
 			// Accept stable packages for an accepted keyword named "*"
-			else if( *keywordIterator == "*"
-			         && m_keywords.contains(pureArch) )
+			else if( acceptedKeyword == "*"
+			         && containsAtom( versionKeywords, pureArch ) )
 			{
 				return Stable;
 			}
 			// Don't accept anything if it's got -* in it
-			else if( *keywordIterator == "-*" ) {
+			else if( acceptedKeyword == "-*" ) {
 				return NotAvailable;
 			}
 		}
 	}
 
 	// check if the architecture is in there "as is"
-	if( m_keywords.contains(arch) )
+	if( containsAtom( versionKeywords, arch ) )
 		return Stable;
 	// check if there is a masked version of the architecture in there
-	else if( m_keywords.contains( "~" + arch ) )
+	else if( containsAtom( versionKeywords, "~" + arch ) )
 		return Masked;
 	// if arch is masked, check if a stable version is in there
-	else if( (arch[0] == '~') && (m_keywords.contains( arch.mid(1) )) )
+	else if( (arch[0] == '~') && (containsAtom( versionKeywords, arch.mid(1) )) )
 		return Stable;
 	// well, no such arch in the version info
 	else // which is also "-*"
@@ -275,123 +227,6 @@ PortagePackageVersion::Stability PortagePackageVersion::stability(
 }
 
 
-/**
- * Search for a revision (like "-r1") at the end of a version string
- * and get its revision number.
- *
- * @param versionString  The version that maybe contains a revision.
- * @param foundPos  A pointer to an integer that will be filled with the
- *                  index of "-" (from "-rNUM") inside the string (if there
- *                  is a revision), or -1 if no revision has been found.
- *                  You can leave out this argument if you don't need it.
- * @returns  The revision number (NUM out of "-rNUM"),
- *           or 0 if no revision has been found.
- */
-int PortagePackageVersion::revisionNumber( const QString& versionString,
-                                           int* foundPos ) const
-{
-	// search for a possible revision
-	int pos = rxRevision.search( versionString );
-
-	if( foundPos != NULL ) // return the position inside the string
-		*foundPos = pos;
-
-	if( pos == -1 ) {  // no revision, which is essentially the same as -r0
-		return 0;
-	}
-	else { // has a revision, get its number
-		return (const_cast<PortagePackageVersion*>(this))->
-			rxRevision.cap(1).toInt();
-	}
-} // end of revisionNumber()
-
-/**
- * Search for a suffix (like "_rc1", or "_beta2") inside a version string
- * and get a numerical representation for it.
- *
- * @param versionString  The version that maybe contains a suffix.
- * @param foundPos  A pointer to an integer that will be filled with the
- *                  index of "_" (e.g., from "_beta") inside the string (if
- *                  there is a suffix), or -1 if no suffix has been found.
- *                  You can leave out this argument if you don't need it.
- * @returns  A numerical representation of the suffix. If there is no suffix
- *           then this is 0. Suffixes with lower precendence ("_alpha" up to
- *           "_rc") get numbers below 0, while suffixes with higher precedence
- *           (that's only "_p") get numbers above 0. Overall, a higher number
- *           means higher precedence.
- */
-long PortagePackageVersion::suffixNumber( const QString& versionString,
-                                          int* foundPos ) const
-{
-	// search for a possible suffix
-	int pos = rxSuffix.search( versionString );
-
-	if( foundPos != NULL ) // return the position inside the string
-		*foundPos = pos;
-
-	if( pos == -1 ) { // no suffix, which means no change in importance
-		return 0;
-	}
-	else // there is a suffix, check which one
-	{
-		// the regexps have to be casted to normal, because the const
-		// method signature makes them const too (which is not wanted)
-		QString suffix = (const_cast<PortagePackageVersion*>(this))->
-			rxSuffix.cap(1);
-		int suffixNumber = (const_cast<PortagePackageVersion*>(this))->
-			rxSuffix.cap(2).toInt(); // X in, say "_betaX"
-		// if it's just "_beta" (which is allowed), toInt("") returns 0.
-
-		// The big numbers are needed because some people use stuff like
-		// _p20041130 which is more than an integer can handle
-		if( suffix == "alpha" ) // alpha release
-			return -400000000 + suffixNumber;
-		else if( suffix == "beta" ) // beta release
-			return -300000000 + suffixNumber;
-		else if( suffix == "pre" ) // prerelease
-			return -200000000 + suffixNumber;
-		else if( suffix == "rc" ) // release candidate
-			return -100000000 + suffixNumber;
-		else if( suffix == "p" ) // patch level. better than a normal release.
-			return 100000000 + suffixNumber;
-		else // should not happen, but anyways
-			return 0;
-	}
-} // end of suffixNumber()
-
-/**
- * Search for a trailing character (like "a", "b" or "i") at the end of
- * a version string and get a numerical representation for it.
- *
- * @param versionString  The version that maybe contains a trailing character.
- * @param foundPos  A pointer to an integer that will be filled with the
- *                  index of the character inside the string (if there is
- *                  such a character), or -1 if no character has been found.
- *                  You can leave out this argument if you don't need it.
- * @returns  A numerical representation of the character (1 or more).
- *           or 0 if no revision has been found.
- */
-int PortagePackageVersion::trailingCharNumber( const QString& versionString,
-                                               int* foundPos ) const
-{
-	// search for a possible trailing character
-	int pos = rxTrailingChar.search( versionString );
-	if( pos != -1 )
-		pos++; // because the regexp starts one character left
-		       // of the actual position
-
-	if( foundPos != NULL ) // return the position inside the string
-		*foundPos = pos;
-
-	if( pos == -1 ) {  // no trailing character, so return 0
-		return 0;
-	}
-	else { // has a trailing character, get its number
-		return (int) versionString.at(pos).latin1();
-	}
-} // end of trailingCharNumber()
-
-
 //
 // Accessor methods
 //
@@ -402,7 +237,7 @@ int PortagePackageVersion::trailingCharNumber( const QString& versionString,
  */
 const QString& PortagePackageVersion::description() const
 {
-	return m_description;
+	return ( m_details == NULL ) ? QString::null : m_details->description;
 }
 
 /**
@@ -411,7 +246,7 @@ const QString& PortagePackageVersion::description() const
  */
 void PortagePackageVersion::setDescription( const QString& description )
 {
-	m_description = description;
+	details()->description = description;
 }
 
 /**
@@ -431,6 +266,7 @@ bool PortagePackageVersion::isInstalled() const
 void PortagePackageVersion::setInstalled( bool isInstalled )
 {
 	m_installed = isInstalled;
+	package()->invalidateDerivedState();
 }
 
 /**
@@ -459,7 +295,7 @@ void PortagePackageVersion::setOverlay( bool isOverlay )
  */
 const QString& PortagePackageVersion::date() const
 {
-	return m_date;
+	return ( m_details == NULL ) ? QString::null : m_details->date;
 }
 
 /**
@@ -468,7 +304,7 @@ const QString& PortagePackageVersion::date() const
  */
 void PortagePackageVersion::setDate( const QString& date )
 {
-	m_date = date;
+	details()->date = date;
 }
 
 /**
@@ -477,7 +313,7 @@ void PortagePackageVersion::setDate( const QString& date )
  */
 const QString& PortagePackageVersion::homepage() const
 {
-	return m_homepage;
+	return ( m_details == NULL ) ? QString::null : m_details->homepage;
 }
 
 /**
@@ -486,7 +322,49 @@ const QString& PortagePackageVersion::homepage() const
  */
 void PortagePackageVersion::setHomepage( const QString& homepage )
 {
-	m_homepage = homepage;
+	details()->homepage = homepage;
+}
+
+/**
+ * Get the build time dependencies of this package version,
+ * as DEPEND string (like "x11-libs/gtk+ ssl? ( dev-libs/openssl )").
+ * Only the Portage cache contains dependencies, so this is empty if
+ * the version details have been loaded from the ebuild.
+ * @see setDependencies
+ */
+const QString& PortagePackageVersion::dependencies() const
+{
+	return ( m_details == NULL ) ? QString::null : m_details->dependencies;
+}
+
+/**
+ * Set the build time dependencies (DEPEND) of this package version.
+ * @see dependencies
+ */
+void PortagePackageVersion::setDependencies( const QString& dependencies )
+{
+	details()->dependencies = dependencies;
+}
+
+/**
+ * Get the run time dependencies of this package version, as RDEPEND
+ * string. Like dependencies(), only the Portage cache contains them.
+ * @see setRuntimeDependencies
+ */
+const QString& PortagePackageVersion::runtimeDependencies() const
+{
+	return ( m_details == NULL )
+		? QString::null : m_details->runtimeDependencies;
+}
+
+/**
+ * Set the run time dependencies (RDEPEND) of this package version.
+ * @see runtimeDependencies
+ */
+void PortagePackageVersion::setRuntimeDependencies(
+	const QString& runtimeDependencies )
+{
+	details()->runtimeDependencies = runtimeDependencies;
 }
 
 /**
@@ -495,7 +373,8 @@ void PortagePackageVersion::setHomepage( const QString& homepage )
  */
 const QString& PortagePackageVersion::slot() const
 {
-	return m_slot;
+	return ( m_details == NULL )
+		? QString::null : AtomTable::string( m_details->slot );
 }
 
 /**
@@ -504,15 +383,36 @@ const QString& PortagePackageVersion::slot() const
  */
 void PortagePackageVersion::setSlot( const QString& slot )
 {
-	m_slot = slot;
+	details()->slot = AtomTable::atom( slot );
+	package()->invalidateDerivedState();
+}
+
+/**
+ * Get the slot that this package is in as atom of the AtomTable,
+ * which is cheaper than retrieving it as string. Versions without
+ * a slot return the atom of the empty string, which is 0.
+ */
+Q_UINT32 PortagePackageVersion::slotAtom() const
+{
+	return ( m_details == NULL ) ? 0 : m_details->slot;
 }
 
 /**
  * Get the licenses used for this package.
  */
-QStringList& PortagePackageVersion::licenses()
+QStringList PortagePackageVersion::licenses() const
 {
-	return m_licenses;
+	return ( m_details == NULL )
+		? QStringList() : AtomTable::stringList( m_details->licenses );
+}
+
+/**
+ * Get the licenses of this package as atoms of the AtomTable,
+ * which is cheaper than retrieving them as strings.
+ */
+const AtomList& PortagePackageVersion::licenseAtoms() const
+{
+	return ( m_details == NULL ) ? emptyAtomList : m_details->licenses;
 }
 
 /**
@@ -520,15 +420,25 @@ QStringList& PortagePackageVersion::licenses()
  */
 void PortagePackageVersion::setLicenses( const QStringList& licenses )
 {
-	m_licenses = licenses;
+	details()->licenses = AtomTable::atomList( licenses );
 }
 
 /**
  * Get the keywords of this package.
  */
-QStringList& PortagePackageVersion::keywords()
+QStringList PortagePackageVersion::keywords() const
+{
+	return ( m_details == NULL )
+		? QStringList() : AtomTable::stringList( m_details->keywords );
+}
+
+/**
+ * Get the keywords of this package as atoms of the AtomTable,
+ * which is cheaper than retrieving them as strings.
+ */
+const AtomList& PortagePackageVersion::keywordAtoms() const
 {
-	return m_keywords;
+	return ( m_details == NULL ) ? emptyAtomList : m_details->keywords;
 }
 
 /**
@@ -536,15 +446,38 @@ QStringList& PortagePackageVersion::keywords()
  */
 void PortagePackageVersion::setKeywords( const QStringList& keywords )
 {
-	m_keywords = keywords;
+	details()->keywords = AtomTable::atomList( keywords );
+	package()->invalidateDerivedState();
 }
 
 /**
  * Get the USE flags that this package can use.
  */
-QStringList& PortagePackageVersion::useflags()
+QStringList PortagePackageVersion::useflags() const
 {
-	return m_useflags;
+	return ( m_details == NULL )
+		? QStringList() : AtomTable::stringList( m_details->useflags );
+}
+
+/**
+ * Get the USE flags of this package as atoms of the AtomTable,
+ * which is cheaper than retrieving them as strings.
+ */
+const AtomList& PortagePackageVersion::useflagAtoms() const
+{
+	return ( m_details == NULL ) ? emptyAtomList : m_details->useflags;
+}
+
+/**
+ * Returns true if the package can use the given USE flag, which has to
+ * be given like in the IUSE variable (e.g. "+ssl" for flags that are
+ * enabled by default). Unlike useflags(), this doesn't copy any strings,
+ * so it's safe to be called from other threads than the main thread.
+ */
+bool PortagePackageVersion::hasUseflag( const QString& useflag ) const
+{
+	return ( m_details == NULL )
+		? false : containsAtom( m_details->useflags, useflag );
 }
 
 /**
@@ -552,7 +485,7 @@ QStringList& PortagePackageVersion::useflags()
  */
 void PortagePackageVersion::setUseflags( const QStringList& useflags )
 {
-	m_useflags = useflags;
+	details()->useflags = AtomTable::atomList( useflags );
 }
 
 /**
@@ -561,9 +494,10 @@ void PortagePackageVersion::setUseflags( const QStringList& useflags )
  * part of this list (which may be, for example, x86, ~amd64 and ~ia64)
  * then the ebuild is stable and can be installed.
  */
-QStringList& PortagePackageVersion::acceptedKeywords()
+QStringList PortagePackageVersion::acceptedKeywords() const
 {
-	return m_acceptedKeywords;
+	return ( m_details == NULL ) ? QStringList()
+		: AtomTable::stringList( m_details->acceptedKeywords );
 }
 
 /**
@@ -571,7 +505,20 @@ QStringList& PortagePackageVersion::acceptedKeywords()
  */
 void PortagePackageVersion::setAcceptedKeywords( const QStringList& keywords )
 {
-	m_acceptedKeywords = keywords;
+	details()->acceptedKeywords = AtomTable::atomList( keywords );
+	package()->invalidateDerivedState();
+}
+
+/**
+ * Add a keyword to the front of the list of accepted keywords
+ * marked for this package.
+ */
+void PortagePackageVersion::addAcceptedKeyword( const QString& keyword )
+{
+	AtomList& acceptedKeywords = details()->acceptedKeywords;
+	acceptedKeywords.insert( acceptedKeywords.begin(),
+	                         AtomTable::atom(keyword) );
+	package()->invalidateDerivedState();
 }
 
 /**
@@ -581,7 +528,7 @@ void PortagePackageVersion::setAcceptedKeywords( const QStringList& keywords )
  */
 long PortagePackageVersion::size() const
 {
-	return m_size;
+	return ( m_details == NULL ) ? 0 : m_details->size;
 }
 
 /**
@@ -589,7 +536,7 @@ long PortagePackageVersion::size() const
  */
 void PortagePackageVersion::setSize( long size )
 {
-	m_size = size;
+	details()->size = size;
 }
 
 /**
@@ -607,6 +554,7 @@ bool PortagePackageVersion::isHardMasked() const
 void PortagePackageVersion::setHardMasked( bool isHardMasked )
 {
 	m_isHardMasked = isHardMasked;
+	package()->invalidateDerivedState();
 }
 
 /**
@@ -629,4 +577,25 @@ void PortagePackageVersion::setHasDetailedInfo( bool hasDetailedInfo )
 	m_hasDetailedInfo = hasDetailedInfo;
 }
 
+/**
+ * Returns true if the dependencies of this version are known, false
+ * otherwise. Only the Portage caches contain dependencies, so versions
+ * whose details have been loaded from the ebuild don't have them, and
+ * empty dependency strings don't mean that there are no dependencies.
+ */
+bool PortagePackageVersion::hasDependencyInfo() const
+{
+	return m_hasDependencyInfo;
+}
+
+/**
+ * Set the value that is returned by hasDependencyInfo().
+ * Readers of the Portage caches set it when they have stored the
+ * dependencies of this version.
+ */
+void PortagePackageVersion::setHasDependencyInfo( bool hasDependencyInfo )
+{
+	m_hasDependencyInfo = hasDependencyInfo;
+}
+
 } // namespace
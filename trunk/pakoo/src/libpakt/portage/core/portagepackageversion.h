@@ -22,6 +22,8 @@
 #define LIBPAKTPORTAGEPACKAGEVERSION_H
 
 #include "../../base/core/packageversion.h"
+#include "../../base/core/atomtable.h"
+#include "portageversion.h"
 
 namespace libpakt {
 
@@ -46,7 +48,9 @@ public:
 
 	bool isAvailable() const;
 
-    bool isNewerThan( const QString& otherVersion ) const;
+	bool isNewerThan( const QString& otherVersion ) const;
+	bool isNewerThan( const PackageVersion* otherVersion ) const;
+	const PortageVersion& versionKey() const;
 
 	PortagePackageVersion::Stability stability( const QString& arch ) const;
 
@@ -55,79 +59,100 @@ public:
 	const QString& date() const;
 	const QString& description() const;
 	const QString& homepage() const;
+	const QString& dependencies() const;
+	const QString& runtimeDependencies() const;
 	const QString& slot() const;
-	QStringList& licenses();
-	QStringList& keywords();
-	QStringList& useflags();
-	QStringList& acceptedKeywords();
+	Q_UINT32 slotAtom() const;
+	QStringList licenses() const;
+	const AtomList& licenseAtoms() const;
+	QStringList keywords() const;
+	QStringList useflags() const;
+	const AtomList& useflagAtoms() const;
+	bool hasUseflag( const QString& useflag ) const;
+	QStringList acceptedKeywords() const;
+	const AtomList& keywordAtoms() const;
 	long size() const;
 	bool isHardMasked() const;
 	bool hasDetailedInfo() const;
+	bool hasDependencyInfo() const;
 
 	void setInstalled( bool isInstalled );
 	void setOverlay( bool isOverlay );
 	void setDate( const QString& date );
 	void setDescription( const QString& description );
 	void setHomepage( const QString& homepage );
+	void setDependencies( const QString& dependencies );
+	void setRuntimeDependencies( const QString& runtimeDependencies );
 	void setSlot( const QString& slot );
 	void setLicenses( const QStringList& licenses );
 	void setKeywords( const QStringList& keywords );
 	void setUseflags( const QStringList& useflags );
 	void setAcceptedKeywords( const QStringList& acceptedKeywords );
+	void addAcceptedKeyword( const QString& keyword );
 	void setSize( long size );
 	void setHardMasked( bool isHardMasked );
 	void setHasDetailedInfo( bool hasDetailedInfo );
+	void setHasDependencyInfo( bool hasDependencyInfo );
 
 protected:
 	PortagePackageVersion( Package* parent, const QString& version );
+	~PortagePackageVersion();
 
 private:
-	int revisionNumber( const QString& versionString, int* foundPos = NULL ) const;
-	long suffixNumber( const QString& versionString, int* foundPos = NULL ) const;
-	int trailingCharNumber( const QString& versionString, int* foundPos = NULL ) const;
+	/**
+	 * The part of the version information that is only known after
+	 * loading details from the ebuild, the digest or the mask files.
+	 * Most versions never get it, so it's allocated on first use.
+	 * Strings that are the same for lots of versions are stored
+	 * as atoms of the AtomTable.
+	 */
+	struct Details
+	{
+		Details() : slot( 0 ), size( 0 ) {};
+
+		/** Date of the ebuild file's last modification. */
+		QString date;
+		/** A short line describing the package. */
+		QString description;
+		/** URL of the package's home page. */
+		QString homepage;
+		/** Build time dependencies (DEPEND), if read from the Portage cache. */
+		QString dependencies;
+		/** Run time dependencies (RDEPEND), if read from the Portage cache. */
+		QString runtimeDependencies;
+		/** The slot for this version. Mostly a number, but only has to be interpreted as string. */
+		Q_UINT32 slot;
+		/** List of licenses that are used in the package. */
+		AtomList licenses;
+		/** List of keywords, like x86 or ~alpha. */
+		AtomList keywords;
+		/** List of use flags that influence compilation of the package. */
+		AtomList useflags;
+		/** A list of additionally accepted keywords for this specific package. */
+		AtomList acceptedKeywords;
+		/** Downloaded file size in bytes (retrievable by scanning the digest). */
+		long size;
+	};
 
+	Details* details();
 
-	// Info retrievable by retrieving QFileInfos for ebuilds
-	// (without parsing their contents):
+	/** The pre-parsed version string, used for comparing versions. */
+	PortageVersion m_versionKey;
+	/** Additional version information, or NULL if none has been set yet. */
+	Details* m_details;
 
-	/** Date of the ebuild file's last modification. */
-	QString m_date;
 	/** true if the package is installed, false otherwise. */
-	bool m_installed;
+	bool m_installed : 1;
 	/** true if the package is from the overlay tree, false otherwise. */
-	bool m_overlay;
-
-
-	// Info retrievable by scanning and parsing the contents of an ebuild file:
-
-	/** A short line describing the package. */
-	QString m_description;
-	/** URL of the package's home page. */
-	QString m_homepage;
-	/** The slot for this version. Mostly a number, but only has to be interpreted as string. */
-	QString m_slot;
-	/** List of licenses that are used in the package. */
-	QStringList m_licenses;
-	/** List of keywords, like x86 or ~alpha. */
-	QStringList m_keywords;
-	/** List of use flags that influence compilation of the package. */
-	QStringList m_useflags;
-	/** A list of additionally accepted keywords for this specific package. */
-	QStringList m_acceptedKeywords;
-
+	bool m_overlay : 1;
 	/** A flag which is true if the ebuild belonging to this package has been parsed. */
-	bool m_hasDetailedInfo;
-
-
-	// Info that's not in the ebuild:
-
-	/** Downloaded file size in bytes (retrievable by scanning the digest). */
-	long m_size;
+	bool m_hasDetailedInfo : 1;
 	/** true if this version is hardmasked, false otherwise.
 	 * Retrievable by scanning package.[un]mask and Co. */
-	bool m_isHardMasked;
-
-	QRegExp rxNumber, rxRevision, rxSuffix, rxTrailingChar;
+	bool m_isHardMasked : 1;
+	/** true if the dependencies have been read from a source that contains
+	 * them (the Portage cache), false if they are unknown. */
+	bool m_hasDependencyInfo : 1;
 };
 
 }
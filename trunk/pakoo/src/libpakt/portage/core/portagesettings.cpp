@@ -22,6 +22,8 @@
 
 #include <qregexp.h>
 
+#include <kglobalsettings.h>
+
 
 namespace libpakt {
 
@@ -316,6 +318,8 @@ void PortageSettings::setPreferredPackageSource( PackageSource packageSource )
 		setValue( "libpakt:preferredPackageSource", "PortageTree" );
 	else if( packageSource == CdbCache )
 		setValue( "libpakt:preferredPackageSource", "CdbCache" );
+	else if( packageSource == Md5Cache )
+		setValue( "libpakt:preferredPackageSource", "Md5Cache" );
 	else
 		m_configValues.remove( "libpakt:preferredPackageSource" );
 }
@@ -332,6 +336,8 @@ PackageSource PortageSettings::preferredPackageSource()
 		QString packageSource = value("libpakt:preferredPackageSource");
 		if( packageSource == "PortageTree" )
 			return PortageTree;
+		else if( packageSource == "Md5Cache" )
+			return Md5Cache;
 		else
 			return CdbCache;
 	}
@@ -339,4 +345,79 @@ PackageSource PortageSettings::preferredPackageSource()
 		return FlatCache;
 }
 
+/**
+ * Set the number of worker threads that jobs may use for scanning
+ * the tree in parallel. A value of 1 (or less) makes them work serially
+ * in their own thread, which is also the default.
+ * This is not a Portage setting and must therefore be set specifically.
+ */
+void PortageSettings::setWorkerThreadCount( int threadCount )
+{
+	if( threadCount <= 1 )
+		m_configValues.remove( "libpakt:workerThreadCount" );
+	else
+		setValue( "libpakt:workerThreadCount", QString::number(threadCount) );
+}
+
+/**
+ * Get the number of worker threads that jobs may use for scanning
+ * the tree in parallel. This is not a Portage setting and must therefore
+ * be set specifically. If there is no appropriate value, the function
+ * returns 1.
+ */
+int PortageSettings::workerThreadCount()
+{
+	bool ok;
+	int threadCount = value("libpakt:workerThreadCount").toInt( &ok );
+	if( ok == false || threadCount < 1 )
+		return 1;
+	else
+		return threadCount;
+}
+
+/**
+ * Set the atoms of the "system" package class, as found in the
+ * 'packages' files of the cascading profile. This is not a Portage
+ * setting and is filled in by the ProfileLoader.
+ */
+void PortageSettings::setSystemPackages( const QStringList& atoms )
+{
+	setValue( "libpakt:systemPackages", atoms.join(" ") );
+}
+
+/**
+ * Get the atoms of the "system" package class, like "sys-apps/baselayout".
+ * If the profile hasn't been loaded yet, the list is empty.
+ */
+QStringList PortageSettings::systemPackages()
+{
+	return QStringList::split( ' ', value("libpakt:systemPackages") );
+}
+
+/**
+ * Set the directory where libpakt stores its own data files,
+ * like the snapshot of the package list.
+ * This is not a Portage setting and must therefore be set specifically.
+ */
+void PortageSettings::setDataDirectory( const QString& directory )
+{
+	setValue( "libpakt:dataDir", directory );
+}
+
+/**
+ * Get the directory where libpakt stores its own data files,
+ * like the snapshot of the package list.
+ * This is not a Portage setting and must therefore be set specifically.
+ * If there is no appropriate value, the function returns the
+ * user's document directory.
+ */
+QString PortageSettings::dataDirectory()
+{
+	QString directory = value("libpakt:dataDir");
+	if( directory == QString::null )
+		return KGlobalSettings::documentPath();
+	else
+		return directory;
+}
+
 } // namespace
@@ -40,7 +40,8 @@ namespace libpakt {
 enum PackageSource { 
 	PortageTree /**< Get the packages from reading the portage tree (/usr/portage). */,
 	FlatCache /**< Get the packages from reading flat (normal) portage cache. */,
-	CdbCache /**< Get the packages from reading CDB portage cache. */
+	CdbCache /**< Get the packages from reading CDB portage cache. */,
+	Md5Cache /**< Get the packages and their details from the tree's metadata/md5-cache. */
 };
 
 /**
@@ -79,6 +80,12 @@ public:
 	QString cacheDirectory();
 	void setPreferredPackageSource( PackageSource packageSource );
 	PackageSource preferredPackageSource();
+	void setWorkerThreadCount( int threadCount );
+	int workerThreadCount();
+	void setSystemPackages( const QStringList& atoms );
+	QStringList systemPackages();
+	void setDataDirectory( const QString& directory );
+	QString dataDirectory();
 
 protected:
 	QString substituteShellVariables( const QString& value );
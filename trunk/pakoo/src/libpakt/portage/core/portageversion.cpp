@@ -0,0 +1,286 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "portageversion.h"
+
+
+namespace libpakt {
+
+/**
+ * Parse an unsigned decimal number starting at index pos of the
+ * given character array, and set pos to the index after the last digit.
+ * Numbers that don't fit into 32 bits are clamped to the maximum value.
+ */
+static Q_UINT32 parseNumber( const QChar* str, uint length, uint& pos )
+{
+	Q_UINT32 number = 0;
+	bool overflow = false;
+
+	while( pos < length && str[pos].isDigit() )
+	{
+		uint digit = str[pos].latin1() - '0';
+		if( number > (0xffffffffU - digit) / 10 )
+			overflow = true;
+		else
+			number = number * 10 + digit;
+		pos++;
+	}
+	return overflow ? 0xffffffffU : number;
+}
+
+/**
+ * Check if the character array contains the given keyword at index pos,
+ * and if so, set pos to the index after it.
+ */
+static bool parseKeyword( const QChar* str, uint length, uint& pos,
+                          const char* keyword )
+{
+	uint i = 0;
+	while( keyword[i] != '\0' )
+	{
+		if( pos + i >= length || str[pos + i] != keyword[i] )
+			return false;
+		i++;
+	}
+	pos += i;
+	return true;
+}
+
+
+/**
+ * Initialize an invalid version.
+ */
+PortageVersion::PortageVersion()
+{
+	parse( QString::null );
+}
+
+/**
+ * Initialize the version by parsing the given version string.
+ * Use isValid() to check if it has been parsed successfully.
+ */
+PortageVersion::PortageVersion( const QString& versionString )
+{
+	parse( versionString );
+}
+
+/**
+ * Parse a version string, replacing the current version.
+ *
+ * @param versionString  The version string, like "2.6.11_rc2-r6".
+ * @return  true if the string is a valid Portage version, false otherwise.
+ *          If false is returned, the parts that could be parsed
+ *          are still stored.
+ */
+bool PortageVersion::parse( const QString& versionString )
+{
+	return parse( versionString.unicode(), versionString.length() );
+}
+
+/**
+ * Parse a version string given as character array, replacing the
+ * current version. This is the same as parse( const QString& ), but
+ * can be used on a part of a larger string without copying it.
+ *
+ * @param versionString  The first character of the version string.
+ * @param length         The number of characters of the version string.
+ * @return  true if the string is a valid Portage version, false otherwise.
+ */
+bool PortageVersion::parse( const QChar* versionString, uint length )
+{
+	m_numberCount = 0;
+	m_suffixCount = 0;
+	m_letter = 0;
+	m_revision = 0;
+	m_valid = false;
+
+	uint pos = 0;
+
+	// numeric components, separated by dots
+	while( pos < length && versionString[pos].isDigit() )
+	{
+		Q_UINT32 number = parseNumber( versionString, length, pos );
+		if( m_numberCount < MaxNumbers )
+			m_numbers[m_numberCount] = number;
+		if( m_numberCount < 255 )
+			m_numberCount++;
+
+		if( pos + 1 < length && versionString[pos] == '.'
+		    && versionString[pos + 1].isDigit() )
+			pos++;
+		else
+			break;
+	}
+	if( m_numberCount == 0 )
+		return false;
+
+	// trailing letter
+	if( pos < length && versionString[pos] >= 'a' && versionString[pos] <= 'z' )
+	{
+		m_letter = versionString[pos].latin1();
+		pos++;
+	}
+
+	// suffixes
+	while( pos < length && versionString[pos] == '_' )
+	{
+		pos++;
+		SuffixType type;
+
+		// "pre" and "p" have to be checked in this order
+		if( parseKeyword( versionString, length, pos, "alpha" ) )
+			type = Alpha;
+		else if( parseKeyword( versionString, length, pos, "beta" ) )
+			type = Beta;
+		else if( parseKeyword( versionString, length, pos, "pre" ) )
+			type = Pre;
+		else if( parseKeyword( versionString, length, pos, "rc" ) )
+			type = Rc;
+		else if( parseKeyword( versionString, length, pos, "p" ) )
+			type = Patch;
+		else
+			return false;
+
+		Q_UINT32 number = parseNumber( versionString, length, pos );
+		if( m_suffixCount < MaxSuffixes ) {
+			m_suffixTypes[m_suffixCount] = type;
+			m_suffixNumbers[m_suffixCount] = number;
+			m_suffixCount++;
+		}
+	}
+
+	// revision
+	if( pos < length )
+	{
+		if( !parseKeyword( versionString, length, pos, "-r" )
+		    || pos >= length || !versionString[pos].isDigit() )
+			return false;
+
+		m_revision = parseNumber( versionString, length, pos );
+	}
+
+	m_valid = ( pos == length );
+	return m_valid;
+}
+
+/**
+ * Returns true if the version string has been parsed successfully,
+ * false otherwise.
+ */
+bool PortageVersion::isValid() const
+{
+	return m_valid;
+}
+
+/**
+ * Find the hyphen that separates package name and version in a string
+ * like "gentoo-sources-2.6.11-r6" (as found in the Portage cache and
+ * in the database of installed packages). That is the first hyphen
+ * which is followed by a valid version that extends to the end
+ * of the string.
+ *
+ * @param packageVersionName  The package name with the version appended.
+ * @return  The position of the separating hyphen, or -1 if there is none.
+ */
+int PortageVersion::versionSeparator( const QString& packageVersionName )
+{
+	const QChar* str = packageVersionName.unicode();
+	uint length = packageVersionName.length();
+	PortageVersion version;
+
+	for( uint pos = 1; pos + 1 < length; pos++ )
+	{
+		if( str[pos] != '-' || !str[pos + 1].isDigit() )
+			continue;
+
+		if( version.parse( str + pos + 1, length - pos - 1 ) )
+			return pos;
+	}
+	return -1;
+}
+
+/**
+ * Returns the revision number (like 6 in "2.6.11-r6"),
+ * or 0 if the version has no revision.
+ */
+uint PortageVersion::revision() const
+{
+	return m_revision;
+}
+
+/**
+ * Compare this version to another one, the same way Portage does.
+ * Numeric components are compared first (with a version that has more
+ * components being the newer one if all common ones are equal), then
+ * the trailing letter, then the suffixes one by one, and finally
+ * the revision.
+ *
+ * @param other           The version that this one is compared to.
+ * @param ignoreRevision  If true, the revisions are not compared, so that
+ *                        "1.0-r2" equals "1.0". This is what the "~"
+ *                        prefix of DEPEND atoms requires.
+ * @return  A negative value if this version is older than the other one,
+ *          0 if they are equal, and a positive value if this one is newer.
+ */
+int PortageVersion::compare( const PortageVersion& other,
+                             bool ignoreRevision ) const
+{
+	uint i;
+	uint numberCount = QMIN( m_numberCount, other.m_numberCount );
+	if( numberCount > MaxNumbers )
+		numberCount = MaxNumbers;
+
+	for( i = 0; i < numberCount; i++ )
+	{
+		if( m_numbers[i] != other.m_numbers[i] )
+			return ( m_numbers[i] > other.m_numbers[i] ) ? 1 : -1;
+	}
+	if( m_numberCount != other.m_numberCount )
+		return ( m_numberCount > other.m_numberCount ) ? 1 : -1;
+
+	if( m_letter != other.m_letter )
+		return ( m_letter > other.m_letter ) ? 1 : -1;
+
+	// a missing suffix compares like NoSuffix, which means that
+	// "1.0_p1" > "1.0" > "1.0_rc1", and "1.0_rc1_p1" > "1.0_rc1"
+	uint suffixCount = QMAX( m_suffixCount, other.m_suffixCount );
+	for( i = 0; i < suffixCount; i++ )
+	{
+		int thisType = ( i < m_suffixCount ) ? m_suffixTypes[i] : NoSuffix;
+		int thatType = ( i < other.m_suffixCount )
+			? other.m_suffixTypes[i] : NoSuffix;
+
+		if( thisType != thatType )
+			return ( thisType > thatType ) ? 1 : -1;
+
+		Q_UINT32 thisNumber = ( i < m_suffixCount ) ? m_suffixNumbers[i] : 0;
+		Q_UINT32 thatNumber = ( i < other.m_suffixCount )
+			? other.m_suffixNumbers[i] : 0;
+
+		if( thisNumber != thatNumber )
+			return ( thisNumber > thatNumber ) ? 1 : -1;
+	}
+
+	if( !ignoreRevision && m_revision != other.m_revision )
+		return ( m_revision > other.m_revision ) ? 1 : -1;
+
+	return 0;
+}
+
+} // namespace
@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTPORTAGEVERSION_H
+#define LIBPAKTPORTAGEVERSION_H
+
+#include <qstring.h>
+
+
+namespace libpakt {
+
+/**
+ * PortageVersion is a pre-parsed representation of a Portage version
+ * string like "2.6.11_rc2-r6", used as comparison key. It stores the
+ * numeric components, the trailing letter, the list of suffixes with
+ * their numbers and the revision inline, so that comparing two versions
+ * is a plain lexicographic comparison of integers without any string
+ * processing or memory allocation.
+ *
+ * The parsed format is the one of Portage:
+ * numbers separated by dots, an optional letter, any number of suffixes
+ * (_alpha, _beta, _pre, _rc and _p, each with an optional number),
+ * and an optional revision (-r followed by a number).
+ *
+ * Only the first MaxNumbers numeric components and MaxSuffixes suffixes
+ * are stored. Numbers that exceed 32 bits are clamped to the maximum
+ * value. Neither occurs in the Portage tree.
+ *
+ * @short  A comparable key for Portage version strings.
+ */
+class PortageVersion
+{
+public:
+	enum {
+		MaxNumbers = 8,
+		MaxSuffixes = 4
+	};
+
+	//! Suffix types, with the order of precedence Portage uses.
+	enum SuffixType {
+		Alpha = 0,
+		Beta = 1,
+		Pre = 2,
+		Rc = 3,
+		NoSuffix = 4,
+		Patch = 5
+	};
+
+	PortageVersion();
+	PortageVersion( const QString& versionString );
+
+	bool parse( const QString& versionString );
+	bool parse( const QChar* versionString, uint length );
+	bool isValid() const;
+
+	int compare( const PortageVersion& other,
+	             bool ignoreRevision = false ) const;
+
+	uint revision() const;
+
+	static int versionSeparator( const QString& packageVersionName );
+
+	bool operator<( const PortageVersion& other ) const
+	{ return compare( other ) < 0; }
+	bool operator>( const PortageVersion& other ) const
+	{ return compare( other ) > 0; }
+	bool operator==( const PortageVersion& other ) const
+	{ return compare( other ) == 0; }
+
+private:
+	//! The numeric components, like 2, 6 and 11 in "2.6.11".
+	Q_UINT32 m_numbers[MaxNumbers];
+	//! The number of each suffix, like 2 in "_rc2".
+	Q_UINT32 m_suffixNumbers[MaxSuffixes];
+	//! The revision number, 0 if there is no revision.
+	Q_UINT32 m_revision;
+	//! The type of each suffix, as SuffixType value.
+	Q_UINT8 m_suffixTypes[MaxSuffixes];
+	//! The number of numeric components in the version string.
+	Q_UINT8 m_numberCount;
+	//! The number of stored suffixes.
+	Q_UINT8 m_suffixCount;
+	//! The trailing letter, like 'i' in "2.12i", or 0 if there is none.
+	char m_letter;
+	//! false if the version string could not be parsed completely.
+	bool m_valid;
+};
+
+}
+
+#endif // LIBPAKTPORTAGEVERSION_H
@@ -0,0 +1,157 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "cdbcachereader.h"
+
+#include "../core/portagepackageversion.h"
+#include "../../base/core/cdbfile.h"
+
+#include <qfile.h>
+
+#include <string.h>
+
+
+namespace libpakt {
+
+/**
+ * Compose the path of the CDB file that contains a category.
+ *
+ * @param cacheDir         The cache directory, e.g. "/var/cache/edb/dep".
+ * @param mainlineTreeDir  The mainline tree directory, e.g. "/usr/portage".
+ * @param categoryDirName  The category directory name, e.g. "sys-kernel".
+ */
+QString CdbCacheReader::categoryFile( const QString& cacheDir,
+                                      const QString& mainlineTreeDir,
+                                      const QString& categoryDirName )
+{
+	return cacheDir + mainlineTreeDir + "/" + categoryDirName + ".cdb";
+}
+
+/**
+ * Retrieve the keys of all records in a CDB cache file, sorted by name.
+ * Returns an empty list if the file can't be opened.
+ */
+QStringList CdbCacheReader::entryNames( const QString& filename )
+{
+	QStringList entries;
+	CdbFile file;
+
+	if( file.open(filename) == false )
+		return entries;
+
+	uint position = 0;
+	const char* key;
+	const char* data;
+	uint keyLength, dataLength;
+
+	while( file.nextRecord( &position, &key, &keyLength, &data, &dataLength ) )
+		entries.append( QFile::decodeName( QCString(key, keyLength + 1) ) );
+
+	entries.sort();
+	return entries;
+}
+
+/**
+ * Look up a package version in an opened CDB cache file, and store
+ * its info into the given version object.
+ *
+ * @param version             The package version that will be filled in.
+ * @param file                The CDB file of the package's category.
+ * @param packageVersionName  The key, e.g. "gentoo-sources-2.6.11-r6".
+ * @return  true if the version has been found, false otherwise.
+ */
+bool CdbCacheReader::readEntry( PortagePackageVersion* version,
+                                const CdbFile& file,
+                                const QString& packageVersionName )
+{
+	QCString key = QFile::encodeName( packageVersionName );
+	const char* data;
+	uint length;
+
+	if( file.find( key.data(), key.length(), &data, &length ) == false )
+		return false;
+
+	parseEntry( version, data, length );
+	return true;
+}
+
+/**
+ * Extract package info from a cache entry and store it into an existing
+ * package version. Like in the flat cache, each line has a fixed meaning.
+ * Dependencies, description, homepage, package slot, keywords, licenses
+ * and useflags are extracted. The cache doesn't contain a date.
+ *
+ * @param version  The package version that will be filled in.
+ * @param data     The beginning of the entry, not null-terminated.
+ * @param length   The length of the entry in bytes.
+ */
+void CdbCacheReader::parseEntry( PortagePackageVersion* version,
+                                 const char* data, uint length )
+{
+	const char* end = data + length;
+	int lineNumber = 0;
+
+	for( const char* line = data; line < end && lineNumber < 11; )
+	{
+		const char* lineEnd = (const char*) memchr( line, '\n', end - line );
+		if( lineEnd == NULL )
+			lineEnd = end;
+
+		lineNumber++;
+
+		switch( lineNumber )
+		{
+		case 1: // build time dependencies
+			version->setDependencies( QString::fromLatin1( line, lineEnd - line ) );
+			break;
+		case 2: // run time dependencies
+			version->setRuntimeDependencies(
+				QString::fromLatin1( line, lineEnd - line ) );
+			break;
+		case 3: // the package slot
+			version->setSlot( QString::fromLatin1( line, lineEnd - line ) );
+			break;
+		case 6: // home page
+			version->setHomepage( QString::fromUtf8( line, lineEnd - line ) );
+			break;
+		case 7: // licenses
+			version->setLicenses( QStringList::split( ' ',
+				QString::fromLatin1( line, lineEnd - line ) ) );
+			break;
+		case 8: // description
+			version->setDescription( QString::fromUtf8( line, lineEnd - line ) );
+			break;
+		case 9: // keywords
+			version->setKeywords( QStringList::split( ' ',
+				QString::fromLatin1( line, lineEnd - line ) ) );
+			break;
+		case 11: // useflags
+			version->setUseflags( QStringList::split( ' ',
+				QString::fromLatin1( line, lineEnd - line ) ) );
+			break;
+		default:
+			break;
+		}
+
+		line = lineEnd + 1;
+	}
+	version->setHasDependencyInfo( true );
+}
+
+} // namespace
@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTCDBCACHEREADER_H
+#define LIBPAKTCDBCACHEREADER_H
+
+#include <qstring.h>
+#include <qstringlist.h>
+
+
+namespace libpakt {
+
+class CdbFile;
+class PortagePackageVersion;
+
+/**
+ * CdbCacheReader reads the Portage cache in CDB format. There is one
+ * CDB file per category, named like the category directory of the flat
+ * cache with ".cdb" appended (e.g. /var/cache/edb/dep/usr/portage/sys-kernel.cdb).
+ * Its keys are package names with the version appended
+ * ("gentoo-sources-2.6.11-r6"), and the values contain the same lines
+ * as the files of the flat cache.
+ *
+ * @short  A reader for the CDB variant of the Portage cache.
+ */
+class CdbCacheReader
+{
+public:
+	static QString categoryFile( const QString& cacheDir,
+	                             const QString& mainlineTreeDir,
+	                             const QString& categoryDirName );
+
+	static QStringList entryNames( const QString& filename );
+
+	static bool readEntry( PortagePackageVersion* version,
+	                       const CdbFile& file,
+	                       const QString& packageVersionName );
+	static void parseEntry( PortagePackageVersion* version,
+	                        const char* data, uint length );
+};
+
+}
+
+#endif // LIBPAKTCDBCACHEREADER_H
@@ -22,12 +22,22 @@
 
 #include "../../base/core/packagelist.h"
 #include "../core/dependatom.h"
+#include "../core/portagepackage.h"
+#include "../core/portagecategory.h"
+#include "../core/portagepackageversion.h"
 
 #include <qfile.h>
-#include <qtextstream.h>
+#include <qdatastream.h>
 
 #include <kdebug.h>
 #include <klocale.h>
+#include <ksavefile.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define ATOMINDEX_MAGIC         0x504b5441 // "PKTA"
+#define ATOMINDEX_FORMATVERSION 2
 
 
 namespace libpakt {
@@ -38,6 +48,8 @@ namespace libpakt {
 FileAtomLoaderBase::FileAtomLoaderBase() : FileLoaderBase()
 {
 	m_packages = NULL;
+	m_atom = NULL;
+	m_cacheDirectory = QString::null;
 }
 
 
@@ -52,6 +64,39 @@ void FileAtomLoaderBase::setPackageList(
 	m_packages = packages;
 }
 
+/**
+ * Set the directory where the compiled form of the file is cached.
+ * If this is QString::null (which is the default), the file is
+ * compiled on every run and the result is not stored.
+ */
+void FileAtomLoaderBase::setCacheDirectory( const QString& directory )
+{
+	m_cacheDirectory = directory;
+}
+
+/**
+ * Apply the file to the package list. If there is an up-to-date compiled
+ * index in the cache directory, it is applied directly. Otherwise,
+ * the file is read and compiled line by line, which is then applied
+ * and stored in the cache directory by finish().
+ */
+IJob::JobResult FileAtomLoaderBase::performThread()
+{
+	m_index.clear();
+
+	QString indexFilename = indexFileName();
+
+	if( !indexFilename.isNull() && check() == true
+	    && loadIndex(indexFilename) == true )
+	{
+		applyIndex();
+		m_index.clear();
+		return Success;
+	}
+
+	return FileLoaderBase::performThread();
+}
+
 /**
  * Check for a valid package list before processing the file.
  */
@@ -73,30 +118,40 @@ bool FileAtomLoaderBase::check()
 }
 
 /**
- * Initialize the 'atom' member variable.
+ * Initialize the 'atom' member variable and clear the index.
  */
 bool FileAtomLoaderBase::init()
 {
 	m_atom = new DependAtom( m_packages );
+	m_index.clear();
 	return true;
 }
 
 /**
- * Destroy the 'atom' member variable and return Success.
+ * Apply the compiled index, store it in the cache directory,
+ * destroy the 'atom' member variable and return Success.
  */
 IJob::JobResult FileAtomLoaderBase::finish()
 {
 	delete m_atom;
+	m_atom = NULL;
+
+	applyIndex();
+
+	QString indexFilename = indexFileName();
+	if( !indexFilename.isNull() )
+		saveIndex( indexFilename );
+
+	m_index.clear();
 	return Success;
 }
 
 /**
- * Scan and process the file, which most probably means modifying
- * some properties of packages inside the package list. For each line
- * of the given file, setAtomString() is called. setAtomString() extracts
- * the atom string from the line so that matching versions of this
- * DEPEND atom can be retrieved. Then processVersion() is called
- * for each version matching the DEPEND atom.
+ * Compile one line of the file. setAtomString() extracts the atom string
+ * from the line, which is then parsed and added to the index entries
+ * of the atom's package. Lines with invalid atoms are dropped, and so are
+ * atoms with USE dependencies, as they can't be checked against
+ * the versions.
  */
 void FileAtomLoaderBase::processLine( const QString& line )
 {
@@ -104,18 +159,189 @@ void FileAtomLoaderBase::processLine( const QString& line )
 	if( setAtomString(line) == false )
 		return;
 
-	if( m_atom->parse(m_atomString) == false )
+	if( m_atom->parse(m_atomString) == false
+	    || m_atom->hasUseDependencies() )
+	{
 		return;
+	}
+
+	AtomEntry entry;
+	entry.line = line;
+	entry.version = m_atom->version();
+	entry.versionKey = m_atom->versionKey();
+	entry.versionOperator = m_atom->versionOperator();
+	entry.slotAtom = m_atom->slotAtom();
+
+	m_index[ m_atom->categoryName() + "/" + m_atom->packageName() ]
+		.append( entry );
+}
+
+/**
+ * Modify the packages in the package list according to the compiled
+ * index. Each package is looked up once, and its versions are matched
+ * against the package's atoms by comparing version keys. For each atom,
+ * setAtomString() is called with the atom's line and processVersion()
+ * with each matching version, in the order of the lines in the file.
+ */
+void FileAtomLoaderBase::applyIndex()
+{
+	PortageCategory category;
+
+	for( QMap<QString,AtomEntryList>::iterator indexIterator = m_index.begin();
+	     indexIterator != m_index.end(); ++indexIterator )
+	{
+		const QString& key = indexIterator.key();
+		int separator = key.find( '/' );
+
+		if( category.loadFromUniqueName( key.left(separator) ) == false )
+			continue;
+
+		PortagePackage* package =
+			m_packages->find( &category, key.mid(separator + 1) );
+
+		if( package == NULL )
+			continue;
+
+		AtomEntryList& entries = indexIterator.data();
+
+		for( AtomEntryList::iterator entryIterator = entries.begin();
+		     entryIterator != entries.end(); ++entryIterator )
+		{
+			if( setAtomString( (*entryIterator).line ) == false )
+				continue;
+
+			for( Package::versioniterator versionIterator = package->versionBegin();
+			     versionIterator != package->versionEnd(); versionIterator++ )
+			{
+				PortagePackageVersion* version =
+					(PortagePackageVersion*) *versionIterator;
+
+				if( DependAtom::matchesVersion(
+					(DependAtom::VersionOperator) (*entryIterator).versionOperator,
+					(*entryIterator).version, (*entryIterator).versionKey,
+					(*entryIterator).slotAtom, version ) )
+				{
+					processVersion( version );
+				}
+			}
+		}
+	}
+}
 
-	// get the matching versions, and call process() on each of them
-	QValueList<PortagePackageVersion*> versions = m_atom->matchingVersions();
-	QValueList<PortagePackageVersion*>::iterator versionIterator;
+/**
+ * Return the file name of the cached index for the current file,
+ * or QString::null if no cache directory is set.
+ */
+QString FileAtomLoaderBase::indexFileName()
+{
+	if( m_cacheDirectory.isNull() || fileName().isNull() )
+		return QString::null;
+
+	QString name = fileName();
+	name.replace( '/', '_' );
+	return m_cacheDirectory + "/atomindex" + name;
+}
+
+/**
+ * Load the compiled index of the current file from a cache file.
+ * The index is only loaded if it has been compiled from the same file
+ * with the same modification time and size as the current one.
+ *
+ * @return  true if the index has been loaded, false if the cache file
+ *          doesn't exist, is invalid or out of date.
+ */
+bool FileAtomLoaderBase::loadIndex( const QString& indexFilename )
+{
+	struct stat fileInfo;
+	if( ::stat( QFile::encodeName(fileName()), &fileInfo ) != 0 )
+		return false;
+
+	QFile file( indexFilename );
+	if( !file.open( IO_ReadOnly ) )
+		return false;
+
+	QDataStream stream( &file );
+	Q_UINT32 magic, formatVersion, modificationTime, fileSize, packageCount;
+	QString filename;
+	stream >> magic >> formatVersion;
+
+	if( magic != ATOMINDEX_MAGIC || formatVersion != ATOMINDEX_FORMATVERSION )
+		return false;
+
+	stream >> filename >> modificationTime >> fileSize >> packageCount;
+
+	if( filename != fileName()
+	    || modificationTime != (Q_UINT32) fileInfo.st_mtime
+	    || fileSize != (Q_UINT32) fileInfo.st_size )
+	{
+		return false;
+	}
 
-	for( versionIterator = versions.begin();
-			versionIterator != versions.end(); versionIterator++ )
+	QString key;
+	Q_UINT32 entryCount;
+	Q_UINT8 versionOperator;
+	QString slot;
+	AtomEntry entry;
+
+	for( uint i = 0; i < packageCount && file.status() == IO_Ok; i++ )
+	{
+		stream >> key >> entryCount;
+		AtomEntryList& entries = m_index[key];
+
+		for( uint j = 0; j < entryCount && file.status() == IO_Ok; j++ )
+		{
+			stream >> entry.line >> entry.version >> versionOperator >> slot;
+			entry.versionKey.parse( entry.version );
+			entry.versionOperator = versionOperator;
+			entry.slotAtom = slot.isEmpty() ? 0 : AtomTable::atom( slot );
+			entries.append( entry );
+		}
+	}
+
+	if( file.status() != IO_Ok ) {
+		m_index.clear();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Save the compiled index of the current file to a cache file,
+ * together with the modification time and size of the file.
+ *
+ * @return  true if the index has been saved, false otherwise.
+ */
+bool FileAtomLoaderBase::saveIndex( const QString& indexFilename )
+{
+	struct stat fileInfo;
+	if( ::stat( QFile::encodeName(fileName()), &fileInfo ) != 0 )
+		return false;
+
+	KSaveFile file( indexFilename );
+	if( file.status() != 0 )
+		return false;
+
+	QDataStream& stream = *file.dataStream();
+	stream << (Q_UINT32) ATOMINDEX_MAGIC << (Q_UINT32) ATOMINDEX_FORMATVERSION
+	       << fileName() << (Q_UINT32) fileInfo.st_mtime
+	       << (Q_UINT32) fileInfo.st_size << (Q_UINT32) m_index.count();
+
+	for( QMap<QString,AtomEntryList>::iterator indexIterator = m_index.begin();
+	     indexIterator != m_index.end(); ++indexIterator )
 	{
-		processVersion( *versionIterator );
+		AtomEntryList& entries = indexIterator.data();
+		stream << indexIterator.key() << (Q_UINT32) entries.count();
+
+		for( AtomEntryList::iterator entryIterator = entries.begin();
+		     entryIterator != entries.end(); ++entryIterator )
+		{
+			stream << (*entryIterator).line << (*entryIterator).version
+			       << (Q_UINT8) (*entryIterator).versionOperator
+			       << AtomTable::string( (*entryIterator).slotAtom );
+		}
 	}
+
+	return file.close();
 }
 
 } // namespace
@@ -22,8 +22,11 @@
 #define LIBPAKTFILEATOMLOADERBASE_H
 
 #include <qstring.h>
+#include <qmap.h>
+#include <qvaluelist.h>
 
 #include "../../base/core/fileloaderbase.h"
+#include "../core/portageversion.h"
 
 
 namespace libpakt {
@@ -40,6 +43,13 @@ class DependAtom;
  *
  * To use it, set it up calling the setPackageList and setFileName
  * member functions, then call start() or perform() to process the file.
+ *
+ * The file is not applied line by line. Instead, it is compiled into
+ * an index of pre-parsed atoms grouped by package, and each affected
+ * package is looked up only once when the index is applied. If a cache
+ * directory is set, the compiled index is stored there and reused as
+ * long as the file's modification time and size don't change, so that
+ * unchanged files don't have to be parsed at all.
  */
 class FileAtomLoaderBase : public FileLoaderBase
 {
@@ -49,6 +59,9 @@ public:
 	FileAtomLoaderBase();
 
 	void setPackageList( TemplatedPackageList<PortagePackage>* packages );
+	void setCacheDirectory( const QString& directory );
+
+	IJob::JobResult performThread();
 
 protected:
 	//! A DEPEND atom validator / package version retriever
@@ -73,8 +86,10 @@ protected:
 	 * you might want to save them into a member variable, so that you can
 	 * access it when process() is called.
 	 *
-	 * Further, you can assume that the 'm_atom' member is a valid
-	 * DependAtom object, so use it if you need to.
+	 * This function is called when compiling the file, and again for each
+	 * entry when the compiled index is applied, with the line that the
+	 * entry originates from. So don't rely on the 'm_atom' member here,
+	 * it is not available when the index is loaded from the cache.
 	 */
 	virtual bool setAtomString( const QString& line ) = 0;
 
@@ -84,18 +99,48 @@ protected:
 	 * line in the file. In most cases, you will change some version
 	 * property here (like (un)hardmasking the version, for example).
 	 *
-	 * Further, you can assume that 'm_atom' is a valid DependAtom object
-	 * which is containing info about the current line's atom.
+	 * Before this function is called, setAtomString() has been called
+	 * with the line containing the matching atom, so member variables
+	 * that it sets up are valid.
 	 */
 	virtual void processVersion( PortagePackageVersion* version ) = 0;
 
 private:
+	/**
+	 * A pre-parsed atom of the compiled file. The category and package
+	 * name are not stored here, they are the key of the index.
+	 */
+	struct AtomEntry
+	{
+		//! The line containing the atom, for setAtomString().
+		QString line;
+		//! The atom's version string, without a trailing "*".
+		QString version;
+		//! The parsed comparison key of 'version'.
+		PortageVersion versionKey;
+		//! The DependAtom::VersionOperator for matching versions.
+		int versionOperator;
+		//! The AtomTable atom of the atom's slot, or 0 for any slot.
+		Q_UINT32 slotAtom;
+	};
+	typedef QValueList<AtomEntry> AtomEntryList;
+
 	bool check();
 	bool init();
 	void processLine( const QString& line );
 	JobResult finish();
+
+	void applyIndex();
+	QString indexFileName();
+	bool loadIndex( const QString& indexFilename );
+	bool saveIndex( const QString& indexFilename );
+
+	//! The compiled file, with atom entries grouped by "category/package".
+	QMap<QString,AtomEntryList> m_index;
+	//! The directory where compiled files are cached, or QString::null.
+	QString m_cacheDirectory;
 };
 
 }
 
-#endif // FLIBPAKTILEATOMLOADERBASE_H
+#endif // LIBPAKTFILEATOMLOADERBASE_H
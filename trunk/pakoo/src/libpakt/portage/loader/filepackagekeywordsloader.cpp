@@ -80,7 +80,7 @@ void FilePackageKeywordsLoader::processVersion(
 	for( QStringList::iterator keywordIterator = m_keywords.begin();
 	     keywordIterator != m_keywords.end(); keywordIterator++ )
 	{
-		version->acceptedKeywords().prepend( *keywordIterator );
+		version->addAcceptedKeyword( *keywordIterator );
 	}
 }
 
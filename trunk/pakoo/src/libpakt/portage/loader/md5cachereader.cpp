@@ -0,0 +1,161 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "md5cachereader.h"
+
+#include "../core/portagepackageversion.h"
+#include "../../base/core/mappedfile.h"
+
+#include <qfileinfo.h>
+#include <qdatetime.h>
+#include <qstringlist.h>
+
+#include <string.h>
+
+
+namespace libpakt {
+
+/**
+ * Compose the path of a category directory in the md5-cache of a tree.
+ *
+ * @param treeDir          The tree directory, e.g. "/usr/portage".
+ * @param categoryDirName  The category directory name, e.g. "sys-kernel".
+ */
+QString Md5CacheReader::categoryPath( const QString& treeDir,
+                                      const QString& categoryDirName )
+{
+	return treeDir + "/metadata/md5-cache/" + categoryDirName;
+}
+
+/**
+ * Extract package info from a file in the md5-cache and store it into
+ * an existing package version. Dependencies, description, homepage,
+ * package slot, keywords, licenses and useflags are extracted in a single
+ * pass over the file. The package size is not contained in the cache.
+ *
+ * @param version   The package version of the cache file.
+ * @param filename  The path to the cache file.
+ * @return  false if the file can't be read, true otherwise.
+ */
+bool Md5CacheReader::readEntry( PortagePackageVersion* version,
+                                const QString& filename )
+{
+	MappedFile file;
+	if( file.open(filename) == false )
+		return false; // an empty cache file is not valid either
+
+	const char* data = file.data();
+	const char* end = data + file.size();
+
+	for( const char* line = data; line < end; )
+	{
+		const char* lineEnd = (const char*) memchr( line, '\n', end - line );
+		if( lineEnd == NULL )
+			lineEnd = end;
+
+		const char* value;
+
+		switch( *line )
+		{
+		case 'D':
+			if( matchKey( line, lineEnd, "DESCRIPTION", &value ) )
+				version->setDescription(
+					QString::fromUtf8( value, lineEnd - value ) );
+			else if( matchKey( line, lineEnd, "DEPEND", &value ) )
+				version->setDependencies(
+					QString::fromLatin1( value, lineEnd - value ) );
+			break;
+		case 'R':
+			if( matchKey( line, lineEnd, "RDEPEND", &value ) )
+				version->setRuntimeDependencies(
+					QString::fromLatin1( value, lineEnd - value ) );
+			break;
+		case 'H':
+			if( matchKey( line, lineEnd, "HOMEPAGE", &value ) )
+				version->setHomepage(
+					QString::fromUtf8( value, lineEnd - value ) );
+			break;
+		case 'S':
+			if( matchKey( line, lineEnd, "SLOT", &value ) )
+			{
+				// leave out the sub-slot, as in "0/1.2"
+				const char* slotEnd =
+					(const char*) memchr( value, '/', lineEnd - value );
+				if( slotEnd == NULL )
+					slotEnd = lineEnd;
+				version->setSlot( QString::fromLatin1( value, slotEnd - value ) );
+			}
+			break;
+		case 'L':
+			if( matchKey( line, lineEnd, "LICENSE", &value ) )
+				version->setLicenses( QStringList::split( ' ',
+					QString::fromLatin1( value, lineEnd - value ) ) );
+			break;
+		case 'K':
+			if( matchKey( line, lineEnd, "KEYWORDS", &value ) )
+				version->setKeywords( QStringList::split( ' ',
+					QString::fromLatin1( value, lineEnd - value ) ) );
+			break;
+		case 'I':
+			if( matchKey( line, lineEnd, "IUSE", &value ) )
+				version->setUseflags( QStringList::split( ' ',
+					QString::fromLatin1( value, lineEnd - value ) ) );
+			break;
+		default:
+			break;
+		}
+
+		line = lineEnd + 1;
+	}
+	file.close();
+
+	QFileInfo fileInfo( filename );
+	version->setDate( fileInfo.lastModified().toString("yyyy MM dd") );
+
+	// keys with empty values are left out, so missing ones mean no dependencies
+	version->setHasDependencyInfo( true );
+	return true;
+}
+
+/**
+ * Check if a line of a cache file assigns a value to the given key,
+ * in the form of KEY=value.
+ *
+ * @param line     Points to the first character of the line.
+ * @param lineEnd  Points to the character after the end of the line.
+ * @param key      The key, e.g. "DESCRIPTION".
+ * @param value    Is set to the first character of the value, on success.
+ * @return  true if the line contains the given key, false otherwise.
+ */
+bool Md5CacheReader::matchKey( const char* line, const char* lineEnd,
+                               const char* key, const char** value )
+{
+	uint keyLength = strlen( key );
+
+	if( (uint) (lineEnd - line) < keyLength + 1
+	    || memcmp( line, key, keyLength ) != 0 || line[keyLength] != '=' )
+	{
+		return false;
+	}
+
+	*value = line + keyLength + 1;
+	return true;
+}
+
+} // namespace
@@ -0,0 +1,55 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTMD5CACHEREADER_H
+#define LIBPAKTMD5CACHEREADER_H
+
+#include <qstring.h>
+
+
+namespace libpakt {
+
+class PortagePackageVersion;
+
+/**
+ * Md5CacheReader reads the metadata cache that comes with the Portage
+ * tree, in metadata/md5-cache/<category>/<package>-<version>.
+ * Each of its files contains the metadata of one ebuild as lines of
+ * KEY=value pairs, so the package details can be read without
+ * looking at the ebuilds at all.
+ *
+ * @short  A reader for the md5-cache metadata files of the Portage tree.
+ */
+class Md5CacheReader
+{
+public:
+	static QString categoryPath( const QString& treeDir,
+	                             const QString& categoryDirName );
+
+	static bool readEntry( PortagePackageVersion* version,
+	                       const QString& filename );
+
+private:
+	static bool matchKey( const char* line, const char* lineEnd,
+	                      const char* key, const char** value );
+};
+
+}
+
+#endif // LIBPAKTMD5CACHEREADER_H
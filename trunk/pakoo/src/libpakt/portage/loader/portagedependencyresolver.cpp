@@ -0,0 +1,535 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "portagedependencyresolver.h"
+
+#include "../core/dependencygraph.h"
+#include "../core/portagepackage.h"
+#include "../core/portagepackageversion.h"
+#include "../core/portagesettings.h"
+#include "../../base/core/atomtable.h"
+#include "../../base/loader/packageloader.h"
+
+#include <qfile.h>
+#include <qtextstream.h>
+
+#include <klocale.h>
+#include <kdebug.h>
+
+
+namespace libpakt {
+
+/**
+ * Initialize this object.
+ */
+PortageDependencyResolver::PortageDependencyResolver() : DependencyResolver()
+{
+	m_settings = NULL;
+	m_graph = NULL;
+}
+
+/**
+ * Set the PortageSettings object that provides the accepted keyword,
+ * the USE flags and the "system" package class. The values are copied
+ * when calling this function, so call it from the main thread
+ * after the profile has been loaded.
+ */
+void PortageDependencyResolver::setSettingsObject( PortageSettings* settings )
+{
+	m_settings = settings;
+	m_arch = settings->acceptedKeyword();
+	m_systemPackages = settings->systemPackages();
+	m_useFlags.clear();
+
+	QStringList useFlags = QStringList::split( ' ', settings->value("USE") );
+	for( QStringList::iterator flagIterator = useFlags.begin();
+	     flagIterator != useFlags.end(); ++flagIterator )
+	{
+		if( *flagIterator == "-*" )
+			m_useFlags.clear();
+		else if( (*flagIterator).startsWith("-") )
+			m_useFlags[ AtomTable::atom( (*flagIterator).mid(1) ) ] = false;
+		else
+			m_useFlags[ AtomTable::atom( *flagIterator ) ] = true;
+	}
+}
+
+/**
+ * Compute the install queue for the requested packages.
+ */
+IJob::JobResult PortageDependencyResolver::performThread()
+{
+	if( m_packages == NULL || m_settings == NULL ) {
+		kdDebug() << i18n( "PortageDependencyResolver debug output",
+			"PortageDependencyResolver::performThread(): "
+			"Didn't start because the package list or the settings object "
+			"has not been set" )
+			<< endl;
+		return Failure;
+	}
+
+	m_graph = new DependencyGraph(
+		(TemplatedPackageList<PortagePackage>*) m_packages );
+	m_installQueue.clear();
+	m_unresolvedDependencies.clear();
+	m_unknownDependencies.clear();
+	m_states.clear();
+	m_selected.clear();
+	m_order.clear();
+	m_loadedPackages.clear();
+
+	for( PackageQueue::iterator itemIterator = m_queue.begin();
+	     itemIterator != m_queue.end(); ++itemIterator )
+	{
+		switch( (*itemIterator).type )
+		{
+		case PackageType:
+			requestPackage( (PortagePackage*) (*itemIterator).data.data() );
+			break;
+		case PackageVersionType:
+			requestVersion(
+				(PortagePackageVersion*) (*itemIterator).data.data() );
+			break;
+		case WorldClassType:
+			requestAtoms( worldPackages() );
+			break;
+		case SystemClassType:
+			requestAtoms( m_systemPackages );
+			break;
+		}
+
+		if( aborting() )
+			break;
+	}
+
+	for( QValueList<Q_UINT32>::iterator idIterator = m_order.begin();
+	     idIterator != m_order.end(); ++idIterator )
+	{
+		m_installQueue.appendPackageVersion( m_graph->version(*idIterator) );
+	}
+
+	delete m_graph;
+	m_graph = NULL;
+
+	return aborting() ? Failure : Success;
+}
+
+/**
+ * Add a requested package version and its dependencies
+ * to the install queue.
+ */
+void PortageDependencyResolver::requestVersion( PortagePackageVersion* version )
+{
+	Q_UINT32 id = m_graph->versionId( version );
+	select( id );
+	visit( id );
+}
+
+/**
+ * Add the newest available version of a requested package to the
+ * install queue, unless it's already installed.
+ */
+void PortageDependencyResolver::requestPackage( PortagePackage* package )
+{
+	QValueList<PackageVersion*> versions = package->sortedVersionList();
+	QValueList<PackageVersion*>::iterator versionIterator = versions.end();
+
+	while( versionIterator != versions.begin() )
+	{
+		--versionIterator;
+		PortagePackageVersion* version =
+			(PortagePackageVersion*) *versionIterator;
+		loadDetails( version );
+
+		if( version->isInstalled() )
+			return; // newest available version is already installed
+
+		if( version->stability(m_arch) == PortagePackageVersion::Stable ) {
+			requestVersion( version );
+			return;
+		}
+	}
+	addUnresolved( package->category()->uniqueName() + "/" + package->name() );
+}
+
+/**
+ * Add the newest available versions for a list of atoms to the
+ * install queue, unless they're already installed.
+ * This is used for the "world" and "system" package classes.
+ */
+void PortageDependencyResolver::requestAtoms( const QStringList& atoms )
+{
+	for( QStringList::const_iterator atomIterator = atoms.begin();
+	     atomIterator != atoms.end(); ++atomIterator )
+	{
+		Q_UINT32 nodeIndex = m_graph->addAtom( *atomIterator );
+		if( nodeIndex == DependencyGraph::NoNode )
+			continue;
+
+		Q_UINT32 id = bestCandidate( nodeIndex );
+
+		if( id == DependencyGraph::NoNode )
+			addUnresolved( *atomIterator );
+		else if( !m_graph->version(id)->isInstalled() && !isSelected(id) )
+			requestVersion( m_graph->version(id) );
+
+		if( aborting() )
+			return;
+	}
+}
+
+/**
+ * Resolve the dependencies of a selected version, and append the version
+ * to the install order after all of its dependencies. Circular
+ * dependencies are broken up at the version that's visited again.
+ */
+void PortageDependencyResolver::visit( Q_UINT32 id )
+{
+	if( id >= m_states.size() )
+		m_states.resize( m_graph->versionCount(), Unvisited );
+
+	if( m_states[id] != Unvisited || aborting() )
+		return;
+
+	m_states[id] = Visiting;
+
+	PortagePackageVersion* version = m_graph->version( id );
+	loadDetails( version );
+
+	if( version->hasDependencyInfo() == false )
+	{
+		kdDebug() << i18n( "PortageDependencyResolver debug output. "
+		                   "%1 is the package version.",
+			"PortageDependencyResolver::visit(): "
+			"The dependencies of %1 are not known" )
+				.arg( versionName(version) )
+			<< endl;
+		m_unknownDependencies.append( versionName(version) );
+	}
+	else if( m_graph->hasDependencies(id) == false ) {
+		m_graph->addDependencies( id, version->dependencies(),
+		                          version->runtimeDependencies() );
+	}
+
+	resolveNode( id, m_graph->dependencyNode(id) );
+	resolveNode( id, m_graph->runtimeDependencyNode(id) );
+
+	m_states[id] = Visited;
+	m_order.append( id );
+}
+
+/**
+ * Resolve a dependency node of the version with the given id,
+ * selecting and visiting the versions that it requires.
+ */
+void PortageDependencyResolver::resolveNode( Q_UINT32 id, Q_UINT32 nodeIndex )
+{
+	// copy the node, as visiting other versions may add nodes
+	DependencyGraph::Node node = m_graph->node( nodeIndex );
+
+	switch( node.type )
+	{
+	case DependencyGraph::AllOfNode:
+		resolveChildren( id, nodeIndex );
+		break;
+
+	case DependencyGraph::UseNode:
+	case DependencyGraph::NegatedUseNode:
+		if( useFlagEnabled( m_graph->version(id), node.value )
+		    == ( node.type == DependencyGraph::UseNode ) )
+		{
+			resolveChildren( id, nodeIndex );
+		}
+		break;
+
+	case DependencyGraph::AnyOfNode:
+	{
+		if( node.size == 1 )
+			break; // no alternatives at all
+
+		// take the first satisfied alternative, or the first one
+		Q_UINT32 chosenIndex = nodeIndex + 1;
+		for( Q_UINT32 childIndex = nodeIndex + 1;
+		     childIndex < nodeIndex + node.size;
+		     childIndex += m_graph->node(childIndex).size )
+		{
+			if( isSatisfied( id, childIndex ) ) {
+				chosenIndex = childIndex;
+				break;
+			}
+		}
+		resolveNode( id, chosenIndex );
+		break;
+	}
+
+	case DependencyGraph::AtomNode:
+	{
+		if( isSatisfied( id, nodeIndex ) )
+			break;
+
+		Q_UINT32 candidate = bestCandidate( nodeIndex );
+		if( candidate == DependencyGraph::NoNode ) {
+			addUnresolved( m_graph->atomString(nodeIndex) );
+		}
+		else {
+			select( candidate );
+			visit( candidate );
+		}
+		break;
+	}
+
+	case DependencyGraph::BlockerNode:
+		// blocked versions must neither be installed nor go into the queue
+		for( Q_UINT32 i = 0; i < node.edgeCount; i++ )
+		{
+			Q_UINT32 blockedId = m_graph->edge( node.firstEdge + i );
+
+			if( m_graph->version(blockedId)->isInstalled()
+			    || isSelected( blockedId ) )
+			{
+				addUnresolved( m_graph->atomString(nodeIndex) );
+				break;
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+/**
+ * Resolve all child nodes of a group node.
+ */
+void PortageDependencyResolver::resolveChildren( Q_UINT32 id, Q_UINT32 nodeIndex )
+{
+	Q_UINT32 end = nodeIndex + m_graph->node( nodeIndex ).size;
+
+	for( Q_UINT32 childIndex = nodeIndex + 1; childIndex < end;
+	     childIndex += m_graph->node(childIndex).size )
+	{
+		resolveNode( id, childIndex );
+	}
+}
+
+/**
+ * Returns true if the dependency node is already satisfied by installed
+ * or selected versions, so that no versions need to be added for it.
+ */
+bool PortageDependencyResolver::isSatisfied( Q_UINT32 id, Q_UINT32 nodeIndex )
+{
+	DependencyGraph::Node node = m_graph->node( nodeIndex );
+	Q_UINT32 childIndex;
+
+	switch( node.type )
+	{
+	case DependencyGraph::UseNode:
+	case DependencyGraph::NegatedUseNode:
+		if( useFlagEnabled( m_graph->version(id), node.value )
+		    != ( node.type == DependencyGraph::UseNode ) )
+		{
+			return true; // not required at all
+		}
+		// else: fall through, it's like an AllOfNode
+
+	case DependencyGraph::AllOfNode:
+		for( childIndex = nodeIndex + 1; childIndex < nodeIndex + node.size;
+		     childIndex += m_graph->node(childIndex).size )
+		{
+			if( isSatisfied( id, childIndex ) == false )
+				return false;
+		}
+		return true;
+
+	case DependencyGraph::AnyOfNode:
+		if( node.size == 1 )
+			return true;
+
+		for( childIndex = nodeIndex + 1; childIndex < nodeIndex + node.size;
+		     childIndex += m_graph->node(childIndex).size )
+		{
+			if( isSatisfied( id, childIndex ) )
+				return true;
+		}
+		return false;
+
+	case DependencyGraph::AtomNode:
+	{
+		Q_UINT32 slot = m_graph->atomSlot( nodeIndex );
+
+		for( Q_UINT32 i = 0; i < node.edgeCount; i++ )
+		{
+			Q_UINT32 candidate = m_graph->edge( node.firstEdge + i );
+			PortagePackageVersion* version = m_graph->version( candidate );
+
+			if( version->isInstalled() == false && isSelected(candidate) == false )
+				continue;
+
+			if( slot != 0 ) {
+				loadDetails( version );
+				if( version->slot() != AtomTable::string(slot) )
+					continue;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	default: // blockers don't need anything to be installed
+		return true;
+	}
+}
+
+/**
+ * Find the version that should be used for satisfying an atom node.
+ * That is the newest candidate that's installed, selected or available
+ * with the configured keywords, and in the slot that the atom requires.
+ *
+ * @return  The version id of the best candidate, or DependencyGraph::NoNode
+ *          if there is no suitable candidate.
+ */
+Q_UINT32 PortageDependencyResolver::bestCandidate( Q_UINT32 nodeIndex )
+{
+	DependencyGraph::Node node = m_graph->node( nodeIndex );
+	Q_UINT32 slot = m_graph->atomSlot( nodeIndex );
+
+	for( Q_UINT32 i = 0; i < node.edgeCount; i++ )
+	{
+		Q_UINT32 candidate = m_graph->edge( node.firstEdge + i );
+		PortagePackageVersion* version = m_graph->version( candidate );
+		loadDetails( version );
+
+		if( slot != 0 && version->slot() != AtomTable::string(slot) )
+			continue;
+
+		if( version->isInstalled() || isSelected(candidate)
+		    || version->stability(m_arch) == PortagePackageVersion::Stable )
+		{
+			return candidate;
+		}
+	}
+	return DependencyGraph::NoNode;
+}
+
+/**
+ * Returns true if the version with the given id goes into the install queue.
+ */
+bool PortageDependencyResolver::isSelected( Q_UINT32 id )
+{
+	return ( id < m_selected.size() && m_selected[id] == true );
+}
+
+/**
+ * Mark the version with the given id for the install queue.
+ */
+void PortageDependencyResolver::select( Q_UINT32 id )
+{
+	if( id >= m_selected.size() )
+		m_selected.resize( m_graph->versionCount(), false );
+
+	m_selected[id] = true;
+}
+
+/**
+ * Returns true if the given USE flag is enabled for a version.
+ * Flags that are not set or unset in the configuration are enabled
+ * if the version has them enabled by default in its IUSE.
+ */
+bool PortageDependencyResolver::useFlagEnabled(
+	PortagePackageVersion* version, Q_UINT32 flag )
+{
+	QMap<Q_UINT32,bool>::iterator flagIterator = m_useFlags.find( flag );
+
+	if( flagIterator != m_useFlags.end() )
+		return flagIterator.data();
+	else
+		return version->hasUseflag( "+" + AtomTable::string(flag) );
+}
+
+/**
+ * Load the details of a version's package if they haven't been loaded
+ * yet and a package loader has been set. Each package is only loaded once.
+ */
+void PortageDependencyResolver::loadDetails( PortagePackageVersion* version )
+{
+	if( m_loader == NULL || version->hasDetailedInfo() )
+		return;
+
+	Package* package = version->package();
+	if( m_loadedPackages.contains(package) )
+		return;
+
+	m_loadedPackages.insert( package, true );
+	m_loader->setPackage( package );
+	m_loader->perform();
+}
+
+/**
+ * Return the name of a package version as it's shown to the user,
+ * e.g. "sys-kernel/gentoo-sources-2.6.11-r6".
+ */
+QString PortageDependencyResolver::versionName( PortagePackageVersion* version )
+{
+	Package* package = version->package();
+	return package->category()->uniqueName() + "/" + package->name()
+		+ "-" + version->version();
+}
+
+/**
+ * Remember an atom that could not be resolved, if it's not yet in the list.
+ */
+void PortageDependencyResolver::addUnresolved( const QString& atom )
+{
+	if( m_unresolvedDependencies.contains(atom) == 0 )
+		m_unresolvedDependencies.append( atom );
+}
+
+/**
+ * Read the atoms of the "world" package class from the world file.
+ */
+QStringList PortageDependencyResolver::worldPackages()
+{
+	QStringList atoms;
+
+	// newer versions of Portage moved the world file to /var/lib/portage
+	QFile file( "/var/lib/portage/world" );
+	if( !file.exists() )
+		file.setName( "/var/cache/edb/world" );
+
+	if( !file.open( IO_ReadOnly ) ) {
+		kdDebug() << i18n( "PortageDependencyResolver debug output",
+			"PortageDependencyResolver::worldPackages(): "
+			"Couldn't open the world file" )
+			<< endl;
+		return atoms;
+	}
+
+	QString line;
+	QTextStream stream( &file );
+
+	while ( !stream.atEnd() )
+	{
+		line = stream.readLine().stripWhiteSpace();
+		if( line.isEmpty() == false && line.startsWith("#") == false )
+			atoms.append( line );
+	}
+	return atoms;
+}
+
+} // namespace
@@ -0,0 +1,124 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTPORTAGEDEPENDENCYRESOLVER_H
+#define LIBPAKTPORTAGEDEPENDENCYRESOLVER_H
+
+#include "../../base/loader/dependencyresolver.h"
+
+#include <qmap.h>
+#include <qvaluevector.h>
+#include <qvaluelist.h>
+
+
+namespace libpakt {
+
+class Package;
+class PortagePackage;
+class PortagePackageVersion;
+class PortageSettings;
+class DependencyGraph;
+
+/**
+ * The DependencyResolver implementation for Portage. It builds a
+ * DependencyGraph out of the DEPEND and RDEPEND strings of the involved
+ * package versions and walks it depth-first, so that dependencies come
+ * before the versions that need them. All of this happens in-process,
+ * without calling "emerge --pretend".
+ *
+ * Dependencies are resolved like emerge does without the --deep option:
+ * A dependency is satisfied if a matching version is installed or already
+ * in the install queue. Otherwise, the newest available version is added.
+ * For "|| ( ... )" groups, the first satisfied alternative is taken,
+ * or the first one if none is satisfied. USE-conditional groups are
+ * evaluated with the USE flags of the settings, and the IUSE defaults
+ * of the respective version. Requested packages and the entries of the
+ * "world" and "system" classes are updated to their newest available
+ * version.
+ *
+ * Dependencies are only known for package versions whose details
+ * have been loaded from the Portage cache (or the tree's md5-cache),
+ * not from the ebuild. Versions without them are reported by
+ * unknownDependencies() instead of being treated as having none.
+ * Blockers are checked against installed and selected versions.
+ */
+class PortageDependencyResolver : public DependencyResolver
+{
+	Q_OBJECT
+
+public:
+	PortageDependencyResolver();
+
+	void setSettingsObject( PortageSettings* settings );
+
+protected:
+	IJob::JobResult performThread();
+
+private:
+	//! The state of a version during the depth-first search.
+	enum VisitState
+	{
+		Unvisited = 0,
+		Visiting = 1, // its dependencies are being resolved
+		Visited = 2
+	};
+
+	void requestVersion( PortagePackageVersion* version );
+	void requestPackage( PortagePackage* package );
+	void requestAtoms( const QStringList& atoms );
+
+	void visit( Q_UINT32 id );
+	void resolveNode( Q_UINT32 id, Q_UINT32 nodeIndex );
+	void resolveChildren( Q_UINT32 id, Q_UINT32 nodeIndex );
+	bool isSatisfied( Q_UINT32 id, Q_UINT32 nodeIndex );
+	Q_UINT32 bestCandidate( Q_UINT32 nodeIndex );
+	bool isSelected( Q_UINT32 id );
+	void select( Q_UINT32 id );
+
+	bool useFlagEnabled( PortagePackageVersion* version, Q_UINT32 flag );
+	void loadDetails( PortagePackageVersion* version );
+	void addUnresolved( const QString& atom );
+	static QString versionName( PortagePackageVersion* version );
+	QStringList worldPackages();
+
+	//! The PortageSettings object that the configuration has been taken from.
+	PortageSettings* m_settings;
+	//! The graph of the currently resolved dependencies.
+	DependencyGraph* m_graph;
+
+	//! The accepted keyword, like "x86" or "~x86".
+	QString m_arch;
+	//! USE flags that are set (true) or unset (false) in the configuration.
+	QMap<Q_UINT32,bool> m_useFlags;
+	//! The atoms of the "system" package class.
+	QStringList m_systemPackages;
+
+	//! The VisitState of each version in the graph, indexed by version id.
+	QValueVector<Q_UINT8> m_states;
+	//! true for each version that goes into the install queue.
+	QValueVector<bool> m_selected;
+	//! The version ids of the install queue, in install order.
+	QValueList<Q_UINT32> m_order;
+	//! The packages that have been given to the package loader.
+	QMap<Package*,bool> m_loadedPackages;
+};
+
+}
+
+#endif // LIBPAKTPORTAGEDEPENDENCYRESOLVER_H
@@ -26,15 +26,23 @@
 #include "profileloader.h"
 #include "portagetreescanner.h"
 #include "portageml.h"
+#include "portagesnapshot.h"
+#include "portagetreestate.h"
+#include "portagereversedependencyindex.h"
 #include "filepackagemaskloader.h"
 #include "filepackagekeywordsloader.h"
 
 #include <qapplication.h>
+#include <qfile.h>
+#include <qstringlist.h>
+#include <qdeepcopy.h>
 
 #include <klocale.h>
 #include <kglobalsettings.h>
 #include <kdebug.h>
 
+#include <time.h>
+
 
 #define CHECK_ABORT if( aborting() ) { \
 	emitCurrentTaskChanged( \
@@ -56,7 +64,9 @@
 namespace libpakt {
 
 PortageInitialLoader::PortageInitialLoader() : InitialLoader()
-{}
+{
+	m_reverseDependencyIndex = NULL;
+}
 
 /**
  * Set the PortageSettings object that will be
@@ -67,6 +77,18 @@ void PortageInitialLoader::setSettingsObject( PortageSettings* settings )
 	m_settings = settings;
 }
 
+/**
+ * Set the index of reverse dependencies that will be loaded and brought
+ * up to date with the database of installed packages. If the tree
+ * scanner finds only a few changed versions, only those are read again.
+ * By default, no index is maintained.
+ */
+void PortageInitialLoader::setReverseDependencyIndex(
+	PortageReverseDependencyIndex* index )
+{
+	m_reverseDependencyIndex = index;
+}
+
 /**
  * Load everything that's needed for initially displaying the package
  * tree. In case of Portage, this is the global settings and the
@@ -90,11 +112,13 @@ IJob::JobResult PortageInitialLoader::performThread()
 	//TODO: Configuration values that should be
 	//      read from a configuration file (KConfigXT for the lib, please?)
 	//
+	QString snapshotFilename =
+		m_settings->dataDirectory() + "/portagetree.snapshot";
+	QString stateFilename =
+		m_settings->dataDirectory() + "/portagetree.state";
+	QString reverseDependencyIndexFilename =
+		m_settings->dataDirectory() + "/installed.revdeps";
 	QString filename = KGlobalSettings::documentPath() + "/portagetree.xml";
-	QString globalPackageMaskFile = "profiles/package.mask";
-	QString etcPackageMaskFile = "/etc/portage/package.mask";
-	QString etcPackageUnmaskFile = "/etc/portage/package.unmask";
-	QString etcPackageKeywordsFile = "/etc/portage/package.keywords";
 
 
 	//
@@ -116,6 +140,71 @@ IJob::JobResult PortageInitialLoader::performThread()
 	emitProgressChanged( 1, 10 );
 
 
+	//
+	// load the packages of the previous run, if the directory state
+	// of that run is available, so that only changes have to be scanned
+	//
+	PortageTreeState treeState;
+	bool snapshotLoaded = false;
+
+	if( treeState.load( stateFilename ) )
+	{
+		emitCurrentTaskChanged(
+			i18n("PortageInitialLoader task #3 (%1 is the filename)",
+				 "Loading packages from %1...")
+			.arg( snapshotFilename )
+		);
+		Q_UINT32 snapshotId;
+		snapshotLoaded =
+			( loadSnapshot( snapshotFilename, &snapshotId ) == Success );
+		CHECK_ABORT;
+
+		// if the snapshot has been written after the state, or if writing
+		// it didn't finish, the state doesn't describe the loaded packages
+		if( !snapshotLoaded || snapshotId != treeState.snapshotId() )
+			treeState.clear();
+	}
+
+
+	//
+	// If the whole tree has to be scanned, the installed packages are
+	// scanned first into a separate list, which takes only a fraction
+	// of the time. That list can be shown while the rest is loading.
+	// Its versions are also copied into the main package list,
+	// so that the tree scanner doesn't have to scan them again.
+	//
+	PortageTreeState installedPackagesState;
+	bool installedPackagesScanned = false;
+
+	if( treeState.isEmpty() )
+	{
+		emitCurrentTaskChanged(
+			i18n("PortageInitialLoader task #2b",
+			     "Loading installed packages...")
+		);
+		TemplatedPackageList<PortagePackage>* installedPackages =
+			new TemplatedPackageList<PortagePackage>();
+
+		result = scanInstalledPackages( installedPackages,
+		                                &installedPackagesState );
+		if( result == Success && !aborting() )
+		{
+			// a loaded snapshot doesn't fit the state, so it's replaced
+			portagePackages->clear();
+			snapshotLoaded = false;
+			addInstalledVersions( installedPackages, portagePackages );
+			installedPackagesScanned = true;
+
+			applyPackageFiles( installedPackages );
+			emitPartiallyLoaded( installedPackages );
+		}
+		else {
+			delete installedPackages;
+			CHECK_ABORT;
+		}
+	}
+
+
 	//
 	// set up the TreeScanner and load the package tree
 	//
@@ -126,6 +215,10 @@ IJob::JobResult PortageInitialLoader::performThread()
 	PortageTreeScanner* treeScanner = new PortageTreeScanner();
 	treeScanner->setPackageList( portagePackages );
 	treeScanner->setSettingsObject( m_settings );
+	treeScanner->setTreeState( &treeState );
+	treeScanner->setIncremental( snapshotLoaded );
+	if( installedPackagesScanned )
+		treeScanner->setInstalledPackagesState( &installedPackagesState );
 
 	connect( treeScanner, SIGNAL( packagesScanned(int,int) ),
 	         this,          SLOT( emitPackagesScanned(int,int) ) );
@@ -133,12 +226,57 @@ IJob::JobResult PortageInitialLoader::performThread()
 	         treeScanner,   SLOT( abort() ) );
 
 	result = treeScanner->perform();
+	bool treeChanged = treeScanner->treeChanged();
+	bool scannedIncrementally =
+		( result == Success && treeScanner->scannedIncrementally() );
+	QStringList changedVersions = treeScanner->changedVersions();
 	this->disconnect( treeScanner ); // disconnects abort()
 	treeScanner->deleteLater(); // disconnects everything else
 	CHECK_ABORT;
 
+	PortageSnapshot* snapshotWriter = NULL;
+
+	if( result == Success )
+	{
+		// store the scanned packages together with the directory state,
+		// so that the next run only has to scan what has changed.
+		// The state is only valid with the matching snapshot, which is
+		// composed now but written in the background after loading.
+		if( treeChanged )
+		{
+			Q_UINT32 snapshotId = (Q_UINT32) ::time( NULL );
+			if( snapshotId == treeState.snapshotId() )
+				snapshotId++;
+
+			snapshotWriter = composeSnapshot( snapshotFilename, snapshotId );
+
+			if( snapshotWriter != NULL ) {
+				treeState.setSnapshotId( snapshotId );
+				treeState.save( stateFilename );
+			}
+			else {
+				QFile::remove( stateFilename );
+			}
+		}
+	}
+	else if( snapshotLoaded )
+	{
+		result = Success; // the packages of the previous run will do
+	}
+	else // result == Failure
+	{
+		emitCurrentTaskChanged(
+			i18n("PortageInitialLoader task #3 (%1 is the filename)",
+				 "Loading packages from %1...")
+			.arg( snapshotFilename )
+		);
+		result = loadSnapshot( snapshotFilename );
+		CHECK_ABORT;
+	}
+
 	if( result == Failure )
 	{
+		// fall back to the older (and much slower) XML format
 		emitCurrentTaskChanged(
 			i18n("PortageInitialLoader task #3 (%1 is the filename)",
 				 "Loading packages from %1...")
@@ -171,8 +309,88 @@ IJob::JobResult PortageInitialLoader::performThread()
 	// modify the loaded packages according to the entries in
 	// package.keywords, package.mask and package.unmask
 	//
+	applyPackageFiles( portagePackages );
+
+
+	//
+	// bring the index of packages depending on installed packages up to
+	// date, reading only changed versions if the previous index is available
+	//
+	if( m_reverseDependencyIndex != NULL )
+	{
+		if( scannedIncrementally
+		    && m_reverseDependencyIndex->load( reverseDependencyIndexFilename ) )
+		{
+			m_reverseDependencyIndex->updateInstalledPackages(
+				m_settings->installedPackagesDirectory(), changedVersions );
+		}
+		else
+		{
+			m_reverseDependencyIndex->buildFromInstalledPackages(
+				m_settings->installedPackagesDirectory() );
+		}
+		// an outdated index must not be updated by the next run
+		if( m_reverseDependencyIndex->save( reverseDependencyIndexFilename ) == false )
+			QFile::remove( reverseDependencyIndexFilename );
+	}
+
+	// done!
+	emitFinishedLoading( m_packages );
+
+	// The package list is in use now, but the composed snapshot doesn't
+	// refer to it anymore, so it can be written without disturbing anyone.
+	if( snapshotWriter != NULL )
+	{
+		connect( snapshotWriter, SIGNAL( finished(IJob::JobResult) ),
+		         snapshotWriter,   SLOT( deleteLater() ) );
+		snapshotWriter->start( QThread::LowestPriority );
+	}
+
+	return Success;
+}
+
+/**
+ * Scan only the database of installed packages into the given list,
+ * forwarding abort requests to the scanning job. The modification times
+ * of the scanned directories are recorded in the given state.
+ */
+IJob::JobResult PortageInitialLoader::scanInstalledPackages(
+	TemplatedPackageList<PortagePackage>* packages, PortageTreeState* state )
+{
+	PortageTreeScanner* treeScanner = new PortageTreeScanner();
+	treeScanner->setPackageList( packages );
+	treeScanner->setSettingsObject( m_settings );
+	treeScanner->setScanAvailablePackages( false );
+	treeScanner->setTreeState( state );
+
+	connect( this,        SIGNAL( aborted() ),
+	         treeScanner,   SLOT( abort() ) );
+
+	JobResult result = treeScanner->perform();
+	this->disconnect( treeScanner ); // disconnects abort()
+	treeScanner->deleteLater(); // disconnects everything else
+	return result;
+}
+
+/**
+ * Modify the given packages according to the entries in package.mask,
+ * package.unmask and package.keywords. The compiled form of these files
+ * is cached in the data directory, so unchanged files don't need to be
+ * parsed again when this is done for more than one package list.
+ */
+void PortageInitialLoader::applyPackageFiles(
+	TemplatedPackageList<PortagePackage>* packages )
+{
+	//TODO: Configuration values that should be read from a
+	//      configuration file, like the ones in performThread()
+	QString globalPackageMaskFile = "profiles/package.mask";
+	QString etcPackageMaskFile = "/etc/portage/package.mask";
+	QString etcPackageUnmaskFile = "/etc/portage/package.unmask";
+	QString etcPackageKeywordsFile = "/etc/portage/package.keywords";
+
 	FilePackageMaskLoader* maskLoader = new FilePackageMaskLoader();
-	maskLoader->setPackageList( portagePackages );
+	maskLoader->setPackageList( packages );
+	maskLoader->setCacheDirectory( m_settings->dataDirectory() );
 
 	// package.mask files (in /usr/portage/profiles and /etc/portage)
 	maskLoader->setMode( FilePackageMaskLoader::Mask );
@@ -184,20 +402,109 @@ IJob::JobResult PortageInitialLoader::performThread()
 
 	// package.unmask file (in /etc/portage)
 	maskLoader->setMode( FilePackageMaskLoader::Unmask );
-	maskLoader->setFileName( etcPackageMaskFile );
+	maskLoader->setFileName( etcPackageUnmaskFile );
 	maskLoader->perform();
 
 	// package.keywords file (in /etc/portage)
 	FilePackageKeywordsLoader* keywordsLoader
 		= new FilePackageKeywordsLoader();
-	keywordsLoader->setPackageList( portagePackages );
+	keywordsLoader->setPackageList( packages );
+	keywordsLoader->setCacheDirectory( m_settings->dataDirectory() );
 	keywordsLoader->setFileName( etcPackageKeywordsFile );
 	keywordsLoader->perform();
 
-	// done!
-	emitFinishedLoading( m_packages );
+	maskLoader->deleteLater();
+	keywordsLoader->deleteLater();
+}
 
-	return Success;
+/**
+ * Copy the versions of separately scanned installed packages into the
+ * given package list. The strings are copied deeply, because the
+ * installed packages are handed out to another thread afterwards.
+ */
+void PortageInitialLoader::addInstalledVersions(
+	TemplatedPackageList<PortagePackage>* installedPackages,
+	TemplatedPackageList<PortagePackage>* packages )
+{
+	PackageList::iterator packageIteratorEnd = installedPackages->end();
+
+	for( PackageList::iterator packageIterator = installedPackages->begin();
+	     packageIterator != packageIteratorEnd; ++packageIterator )
+	{
+		PortagePackage* installedPackage =
+			(PortagePackage*) (*packageIterator).data();
+
+		PortagePackage* package = packages->package(
+			installedPackage->category(),
+			QDeepCopy<QString>( installedPackage->name() )
+		);
+
+		Package::versioniterator versionIteratorEnd =
+			installedPackage->versionEnd();
+
+		for( Package::versioniterator versionIterator =
+		         installedPackage->versionBegin();
+		     versionIterator != versionIteratorEnd; ++versionIterator )
+		{
+			PortagePackageVersion* version = package->version(
+				QDeepCopy<QString>( (*versionIterator)->version() ) );
+			version->setInstalled( true );
+		}
+	}
+}
+
+/**
+ * Load the package list from a snapshot file, forwarding progress
+ * information and abort requests to and from the loading job.
+ * If snapshotId is not NULL, it's set to the id of the loaded snapshot.
+ */
+IJob::JobResult PortageInitialLoader::loadSnapshot( const QString& filename,
+                                                   Q_UINT32* snapshotId )
+{
+	PortageSnapshot* snapshot = new PortageSnapshot();
+	snapshot->setAction( PortageSnapshot::LoadFile );
+	snapshot->setPackageList(
+		(TemplatedPackageList<PortagePackage>*) m_packages );
+	snapshot->setFileName( filename );
+
+	connect( snapshot, SIGNAL( packagesScanned(int,int) ),
+	         this,       SLOT( emitPackagesScanned(int,int) ) );
+	connect( this,     SIGNAL( aborted() ),
+	         snapshot,   SLOT( abort() ) );
+
+	JobResult result = snapshot->perform();
+	this->disconnect( snapshot ); // disconnects abort()
+
+	if( snapshotId != NULL )
+		*snapshotId = snapshot->snapshotId();
+
+	snapshot->deleteLater(); // disconnects everything else
+	return result;
+}
+
+/**
+ * Prepare saving the package list to a snapshot file. The snapshot is
+ * composed in the current thread, and the returned job only has to be
+ * started in order to write it to the file. The job doesn't access
+ * the package list anymore, so it can run while the list is being used.
+ *
+ * @return  The job writing the snapshot, or NULL if it couldn't be composed.
+ */
+PortageSnapshot* PortageInitialLoader::composeSnapshot(
+	const QString& filename, Q_UINT32 snapshotId )
+{
+	PortageSnapshot* snapshot = new PortageSnapshot();
+	snapshot->setAction( PortageSnapshot::SaveFile );
+	snapshot->setPackageList(
+		(TemplatedPackageList<PortagePackage>*) m_packages );
+	snapshot->setFileName( QDeepCopy<QString>(filename) );
+	snapshot->setSnapshotId( snapshotId );
+
+	if( snapshot->compose() == false ) {
+		delete snapshot;
+		return NULL;
+	}
+	return snapshot;
 }
 
 /**
@@ -29,6 +29,11 @@ namespace libpakt {
 class PortageSettings;
 class ProfileLoader;
 class PortageTreeScanner;
+class PortageSnapshot;
+class PortageTreeState;
+class PortagePackage;
+template<class T> class TemplatedPackageList;
+class PortageReverseDependencyIndex;
 
 /**
  * This is a job that initializes the package list with packages
@@ -38,7 +43,18 @@ class PortageTreeScanner;
  * there won't be any packages that you can access.
  *
  * The PortageInitialLoader itself makes use of the ProfileLoader
- * and the PortageTreeScanner.
+ * and the PortageTreeScanner. The package list of each run is stored
+ * as PortageSnapshot together with a PortageTreeState, which enables
+ * the next run to only rescan those parts of the tree that have changed.
+ * The same changes are used to update the reverse dependency index
+ * of installed packages, if one has been set. The snapshot is written
+ * by a low-priority thread after the packages have been handed over,
+ * so that saving doesn't delay startup.
+ *
+ * If the whole tree has to be scanned, the installed packages are scanned
+ * first and handed out with partiallyLoaded(), so that they can be shown
+ * before the available packages are complete. The full scan takes them
+ * over instead of scanning the installed packages database again.
  */
 class PortageInitialLoader : public InitialLoader
 {
@@ -48,6 +64,7 @@ public:
 	PortageInitialLoader();
 
 	void setSettingsObject( PortageSettings* settings ); // Portage specific
+	void setReverseDependencyIndex( PortageReverseDependencyIndex* index );
 
 	bool progressEnabled() { return true; }
 
@@ -73,8 +90,22 @@ private:
 		PortageFinishedLoadingEventType = QEvent::User + 14345
 	};
 
+	IJob::JobResult scanInstalledPackages(
+		TemplatedPackageList<PortagePackage>* packages,
+		PortageTreeState* state );
+	void addInstalledVersions(
+		TemplatedPackageList<PortagePackage>* installedPackages,
+		TemplatedPackageList<PortagePackage>* packages );
+	void applyPackageFiles( TemplatedPackageList<PortagePackage>* packages );
+	IJob::JobResult loadSnapshot( const QString& filename,
+	                              Q_UINT32* snapshotId = NULL );
+	PortageSnapshot* composeSnapshot( const QString& filename,
+	                                  Q_UINT32 snapshotId );
+
 	//! The PortageTree object that will be filled with configuration values.
 	PortageSettings* m_settings;
+	//! The index of installed packages' dependents that is kept up to date, or NULL.
+	PortageReverseDependencyIndex* m_reverseDependencyIndex;
 
 
 	//
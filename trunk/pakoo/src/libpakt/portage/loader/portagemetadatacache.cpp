@@ -0,0 +1,562 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "portagemetadatacache.h"
+
+#include "../core/portagepackageversion.h"
+
+#include <qfile.h>
+#include <qstringlist.h>
+#include <qdeepcopy.h>
+#include <qvaluevector.h>
+
+#include <kdebug.h>
+#include <klocale.h>
+#include <ksavefile.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string.h>
+
+#define METADATACACHE_MAGIC         0x504b544d // "PKTM"
+#define METADATACACHE_FORMATVERSION 1
+#define METADATACACHE_BYTEORDER     0x01020304
+
+
+namespace libpakt {
+
+/*
+ * The on-disk layout of the cache. The header is followed by any number
+ * of records, each of them consisting of a MetadataCacheRecord structure
+ * and the UTF-8 strings whose lengths it contains, padded to a multiple
+ * of four bytes. All numbers are 32-bit unsigned integers in native
+ * byte order.
+ */
+struct MetadataCacheHeader
+{
+	Q_UINT32 magic;
+	Q_UINT32 formatVersion;
+	Q_UINT32 byteOrder;
+	Q_UINT32 reserved;
+};
+
+enum MetadataCacheField
+{
+	PathField = 0,
+	DateField,
+	DescriptionField,
+	HomepageField,
+	SlotField,
+	LicensesField,
+	KeywordsField,
+	UseflagsField,
+	FieldCount
+};
+
+struct MetadataCacheRecord
+{
+	Q_UINT32 recordSize; // including this structure and the padding
+	Q_UINT32 modificationTime;
+	Q_UINT32 fileSize;
+	Q_UINT32 packageSize;
+	Q_UINT32 stringLengths[FieldCount];
+};
+
+/**
+ * New records are appended to the file as soon as they
+ * occupy this many bytes.
+ */
+static const uint FLUSH_SIZE = 65536;
+
+/**
+ * Join the strings of an atom list with spaces and encode them as UTF-8.
+ * The interned strings are only read, not copied, so this is safe to be
+ * called from the loader threads.
+ */
+static QCString joinAtoms( const AtomList& atoms )
+{
+	QCString joined;
+
+	for( AtomList::const_iterator atomIterator = atoms.begin();
+	     atomIterator != atoms.end(); ++atomIterator )
+	{
+		if( atomIterator != atoms.begin() )
+			joined += ' ';
+		joined += AtomTable::string( *atomIterator ).utf8();
+	}
+	return joined;
+}
+
+
+/**
+ * Initialize this object. The file is loaded when it's first needed,
+ * or when calling load().
+ *
+ * @param filename  The path of the cache file.
+ */
+PortageMetadataCache::PortageMetadataCache( const QString& filename )
+{
+	m_filename = filename;
+	m_loaded = false;
+	m_valid = false;
+	m_newRecordsSize = 0;
+}
+
+/**
+ * Deinitialize this object, writing any remaining new records to the file.
+ */
+PortageMetadataCache::~PortageMetadataCache()
+{
+	flush();
+}
+
+/**
+ * Load the cache file, or create it if it doesn't exist or is invalid.
+ * Calling this function is optional, the file is loaded anyways when the
+ * first entry is looked up or stored.
+ *
+ * @return  true if the cache can be used, false otherwise.
+ */
+bool PortageMetadataCache::load()
+{
+	QMutexLocker locker( &m_mutex );
+	return ensureLoaded();
+}
+
+/**
+ * Write the records that have been added since the last flush
+ * to the cache file.
+ *
+ * @return  false if there were errors writing the file, true otherwise.
+ */
+bool PortageMetadataCache::flush()
+{
+	QMutexLocker locker( &m_mutex );
+
+	if( m_loaded == false || m_valid == false )
+		return true; // nothing to write
+	else
+		return flushRecords();
+}
+
+/**
+ * Retrieve the package details of an ebuild from the cache.
+ * Nothing is retrieved if there is no entry for the ebuild, or if the
+ * ebuild's modification time or size have changed since storing it.
+ *
+ * @param version         The package version that will be filled in.
+ * @param ebuildFilename  The path of the version's ebuild.
+ * @return  true if the details have been retrieved, false otherwise.
+ */
+bool PortageMetadataCache::lookup( PortagePackageVersion* version,
+                                   const QString& ebuildFilename )
+{
+	Q_UINT32 modificationTime, fileSize;
+	if( fileStatus( ebuildFilename, &modificationTime, &fileSize ) == false )
+		return false;
+
+	QMutexLocker locker( &m_mutex );
+	if( ensureLoaded() == false )
+		return false;
+
+	const char* record = NULL;
+	QMap<QString,uint>::iterator recordIterator =
+		m_newRecordOffsets.find( ebuildFilename );
+
+	if( recordIterator != m_newRecordOffsets.end() ) {
+		record = m_newRecords.data() + *recordIterator;
+	}
+	else {
+		recordIterator = m_fileRecords.find( ebuildFilename );
+		if( recordIterator == m_fileRecords.end() )
+			return false;
+		record = m_file.data() + *recordIterator;
+	}
+
+	const MetadataCacheRecord* header = (const MetadataCacheRecord*) record;
+	if( header->modificationTime != modificationTime
+	    || header->fileSize != fileSize )
+	{
+		return false; // stale entry
+	}
+
+	readRecord( record, version );
+	return true;
+}
+
+/**
+ * Store the package details of an ebuild in the cache, replacing
+ * any previous entry for the same ebuild. The entry is written
+ * to the cache file together with other ones, later on.
+ *
+ * @param version         The package version containing the details.
+ * @param ebuildFilename  The path of the version's ebuild.
+ */
+void PortageMetadataCache::store( const PortagePackageVersion* version,
+                                  const QString& ebuildFilename )
+{
+	MetadataCacheRecord header;
+	if( fileStatus( ebuildFilename, &header.modificationTime,
+	                &header.fileSize ) == false )
+	{
+		return;
+	}
+
+	QCString strings[FieldCount];
+	strings[PathField] = QFile::encodeName( ebuildFilename );
+	strings[DateField] = version->date().utf8();
+	strings[DescriptionField] = version->description().utf8();
+	strings[HomepageField] = version->homepage().utf8();
+	strings[SlotField] = version->slot().utf8();
+	strings[LicensesField] = joinAtoms( version->licenseAtoms() );
+	strings[KeywordsField] = joinAtoms( version->keywordAtoms() );
+	strings[UseflagsField] = joinAtoms( version->useflagAtoms() );
+
+	header.packageSize = (Q_UINT32) version->size();
+	header.recordSize = sizeof(MetadataCacheRecord);
+	for( int field = 0; field < FieldCount; field++ ) {
+		header.stringLengths[field] = strings[field].length();
+		header.recordSize += strings[field].length();
+	}
+	header.recordSize = (header.recordSize + 3) & ~3; // padding
+
+	QMutexLocker locker( &m_mutex );
+	if( ensureLoaded() == false )
+		return;
+
+	// make room for the record, growing the buffer exponentially
+	if( m_newRecordsSize + header.recordSize > m_newRecords.size() )
+	{
+		uint size = ( m_newRecords.size() == 0 ) ? FLUSH_SIZE : m_newRecords.size();
+		while( size < m_newRecordsSize + header.recordSize )
+			size *= 2;
+		m_newRecords.resize( size );
+	}
+
+	char* record = m_newRecords.data() + m_newRecordsSize;
+	memset( record, 0, header.recordSize );
+	memcpy( record, &header, sizeof(MetadataCacheRecord) );
+
+	char* string = record + sizeof(MetadataCacheRecord);
+	for( int field = 0; field < FieldCount; field++ ) {
+		memcpy( string, strings[field].data(), strings[field].length() );
+		string += strings[field].length();
+	}
+
+	m_newRecordOffsets.insert( QDeepCopy<QString>(ebuildFilename),
+	                           m_newRecordsSize );
+	m_newRecordsSize += header.recordSize;
+
+	if( m_newRecordsSize >= FLUSH_SIZE )
+		flushRecords();
+}
+
+/**
+ * Load the cache file if that hasn't happened yet.
+ * The mutex has to be locked when calling this function.
+ *
+ * @return  true if the cache can be used, false otherwise.
+ */
+bool PortageMetadataCache::ensureLoaded()
+{
+	if( m_loaded == true )
+		return m_valid;
+
+	m_loaded = true;
+
+	if( m_file.open( m_filename ) == true )
+	{
+		// indexRecords() returns false if the file needs to be compacted
+		if( indexRecords() == true || compact() == true ) {
+			m_valid = true;
+			return true;
+		}
+	}
+
+	// no file or an invalid one, start over
+	m_file.close();
+	m_fileRecords.clear();
+	m_valid = createFile();
+	return m_valid;
+}
+
+/**
+ * Read the records of the mapped file into m_fileRecords.
+ *
+ * @return  true if the file can be used as it is, false if it's invalid,
+ *          contains a broken record or consists mostly of
+ *          replaced records (and should therefore be compacted).
+ */
+bool PortageMetadataCache::indexRecords()
+{
+	m_fileRecords.clear();
+
+	const char* data = m_file.data();
+	const char* end = data + m_file.size();
+
+	if( m_file.size() < sizeof(MetadataCacheHeader) )
+		return false;
+
+	const MetadataCacheHeader* header = (const MetadataCacheHeader*) data;
+	if( header->magic != METADATACACHE_MAGIC
+	    || header->formatVersion != METADATACACHE_FORMATVERSION
+	    || header->byteOrder != METADATACACHE_BYTEORDER )
+	{
+		return false;
+	}
+
+	uint recordCount = 0;
+	const char* record = data + sizeof(MetadataCacheHeader);
+
+	while( record < end )
+	{
+		const char* nextRecord = validRecord( record, end );
+		if( nextRecord == NULL ) {
+			// an interrupted write, don't append anything after it
+			return false;
+		}
+
+		const MetadataCacheRecord* recordHeader =
+			(const MetadataCacheRecord*) record;
+		QString path = QFile::decodeName( QCString(
+			record + sizeof(MetadataCacheRecord),
+			recordHeader->stringLengths[PathField] + 1 ) );
+
+		m_fileRecords.insert( path, record - data ); // replaces older ones
+		recordCount++;
+		record = nextRecord;
+	}
+
+	// compact if more than half of the records have been replaced
+	return ( m_fileRecords.count() * 2 >= recordCount );
+}
+
+/**
+ * Rewrite the cache file with only the live records of the
+ * currently mapped file, and map the new file instead.
+ *
+ * @return  true if the file has been compacted, false otherwise.
+ */
+bool PortageMetadataCache::compact()
+{
+	KSaveFile saveFile( m_filename );
+	if( saveFile.status() != 0 )
+		return false;
+
+	QFile& file = *saveFile.file();
+
+	MetadataCacheHeader header;
+	header.magic = METADATACACHE_MAGIC;
+	header.formatVersion = METADATACACHE_FORMATVERSION;
+	header.byteOrder = METADATACACHE_BYTEORDER;
+	header.reserved = 0;
+
+	bool written = file.writeBlock( (const char*) &header,
+	                                sizeof(MetadataCacheHeader) ) != -1;
+
+	QMap<QString,uint>::iterator recordIteratorEnd = m_fileRecords.end();
+	for( QMap<QString,uint>::iterator recordIterator = m_fileRecords.begin();
+	     recordIterator != recordIteratorEnd && written; ++recordIterator )
+	{
+		const char* record = m_file.data() + *recordIterator;
+		written = file.writeBlock( record,
+			((const MetadataCacheRecord*) record)->recordSize ) != -1;
+	}
+
+	if( !written ) {
+		saveFile.abort();
+		return false;
+	}
+	if( saveFile.close() == false )
+		return false;
+
+	kdDebug() << i18n( "PortageMetadataCache debug output. "
+	                   "%1 is the filename.",
+		"PortageMetadataCache::compact(): Compacted %1" )
+			.arg( m_filename )
+		<< endl;
+
+	return ( m_file.open( m_filename ) == true && indexRecords() == true );
+}
+
+/**
+ * Create an empty cache file, replacing an existing one.
+ *
+ * @return  true if the file has been created, false otherwise.
+ */
+bool PortageMetadataCache::createFile()
+{
+	QFile file( m_filename );
+	if( !file.open( IO_WriteOnly | IO_Truncate ) )
+		return false;
+
+	MetadataCacheHeader header;
+	header.magic = METADATACACHE_MAGIC;
+	header.formatVersion = METADATACACHE_FORMATVERSION;
+	header.byteOrder = METADATACACHE_BYTEORDER;
+	header.reserved = 0;
+
+	bool written = file.writeBlock( (const char*) &header,
+	                                sizeof(MetadataCacheHeader) ) != -1;
+	file.close();
+
+	return ( written && file.status() == IO_Ok );
+}
+
+/**
+ * Append the new records to the cache file. Afterwards, the file is
+ * mapped again, the appended records are looked up in there, and the
+ * memory of the new records is released.
+ * The mutex has to be locked when calling this function.
+ *
+ * @return  false if there were errors writing the file, true otherwise.
+ */
+bool PortageMetadataCache::flushRecords()
+{
+	if( m_newRecordsSize == 0 )
+		return true;
+
+	QFile file( m_filename );
+	if( !file.open( IO_WriteOnly | IO_Append ) )
+		return false;
+
+	uint fileSize = file.size();
+	bool written = file.writeBlock( m_newRecords.data(),
+	                                m_newRecordsSize ) != -1;
+	file.close();
+
+	if( !written || file.status() != IO_Ok )
+	{
+		kdDebug() << i18n( "PortageMetadataCache debug output.",
+			"PortageMetadataCache::flushRecords(): "
+			"Couldn't write the file %1" )
+				.arg( m_filename )
+			<< endl;
+		return false;
+	}
+
+	QMap<QString,uint>::iterator recordIteratorEnd = m_newRecordOffsets.end();
+	for( QMap<QString,uint>::iterator recordIterator =
+	         m_newRecordOffsets.begin();
+	     recordIterator != recordIteratorEnd; ++recordIterator )
+	{
+		m_fileRecords.insert( recordIterator.key(),
+		                      fileSize + *recordIterator );
+	}
+
+	m_newRecords.resize( 0 );
+	m_newRecordsSize = 0;
+	m_newRecordOffsets.clear();
+
+	if( m_file.open( m_filename ) == false )
+	{
+		// the records can't be read anymore, so don't use the cache
+		m_fileRecords.clear();
+		m_valid = false;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Retrieve modification time and size of a file.
+ *
+ * @return  true if the file exists, false otherwise.
+ */
+bool PortageMetadataCache::fileStatus( const QString& filename,
+	Q_UINT32* modificationTime, Q_UINT32* fileSize )
+{
+	struct stat fileInfo;
+
+	if( stat( QFile::encodeName(filename), &fileInfo ) != 0 )
+		return false;
+
+	*modificationTime = (Q_UINT32) fileInfo.st_mtime;
+	*fileSize = (Q_UINT32) fileInfo.st_size;
+	return true;
+}
+
+/**
+ * Check if a record is complete and consistent.
+ *
+ * @param record  The beginning of the record.
+ * @param end     The end of the data that contains the record.
+ * @return  The beginning of the next record, or NULL if the record
+ *          is invalid.
+ */
+const char* PortageMetadataCache::validRecord( const char* record,
+                                               const char* end )
+{
+	if( (unsigned long) (end - record) < sizeof(MetadataCacheRecord) )
+		return NULL;
+
+	const MetadataCacheRecord* header = (const MetadataCacheRecord*) record;
+	if( header->recordSize < sizeof(MetadataCacheRecord)
+	    || (header->recordSize & 3) != 0
+	    || header->recordSize > (unsigned long) (end - record) )
+	{
+		return NULL;
+	}
+
+	Q_UINT32 stringSize = 0;
+	for( int field = 0; field < FieldCount; field++ )
+	{
+		if( header->stringLengths[field] > header->recordSize )
+			return NULL;
+		stringSize += header->stringLengths[field];
+	}
+	if( stringSize > header->recordSize - sizeof(MetadataCacheRecord) )
+		return NULL;
+
+	return record + header->recordSize;
+}
+
+/**
+ * Store the details of a (valid) record into a package version.
+ */
+void PortageMetadataCache::readRecord( const char* record,
+                                       PortagePackageVersion* version )
+{
+	const MetadataCacheRecord* header = (const MetadataCacheRecord*) record;
+	const char* strings[FieldCount];
+
+	const char* string = record + sizeof(MetadataCacheRecord);
+	for( int field = 0; field < FieldCount; field++ ) {
+		strings[field] = string;
+		string += header->stringLengths[field];
+	}
+
+	version->setDate( QString::fromUtf8(
+		strings[DateField], header->stringLengths[DateField] ) );
+	version->setDescription( QString::fromUtf8(
+		strings[DescriptionField], header->stringLengths[DescriptionField] ) );
+	version->setHomepage( QString::fromUtf8(
+		strings[HomepageField], header->stringLengths[HomepageField] ) );
+	version->setSlot( QString::fromUtf8(
+		strings[SlotField], header->stringLengths[SlotField] ) );
+	version->setLicenses( QStringList::split( ' ', QString::fromUtf8(
+		strings[LicensesField], header->stringLengths[LicensesField] ) ) );
+	version->setKeywords( QStringList::split( ' ', QString::fromUtf8(
+		strings[KeywordsField], header->stringLengths[KeywordsField] ) ) );
+	version->setUseflags( QStringList::split( ' ', QString::fromUtf8(
+		strings[UseflagsField], header->stringLengths[UseflagsField] ) ) );
+	version->setSize( header->packageSize );
+}
+
+} // namespace
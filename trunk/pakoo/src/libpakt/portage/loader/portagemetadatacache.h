@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTPORTAGEMETADATACACHE_H
+#define LIBPAKTPORTAGEMETADATACACHE_H
+
+#include "../../base/core/mappedfile.h"
+
+#include <qstring.h>
+#include <qcstring.h>
+#include <qmap.h>
+#include <qmutex.h>
+
+
+namespace libpakt {
+
+class PortagePackageVersion;
+
+/**
+ * PortageMetadataCache is libpakt's own cache of package details that
+ * have been extracted from ebuilds and digests, for use when there is
+ * no Portage cache. Each entry is stored under the path of its ebuild,
+ * together with the modification time and size of the ebuild file.
+ * An entry is only used if the ebuild still has the same modification
+ * time and size, otherwise it's considered stale and the ebuild has to
+ * be scanned again. (Changes in digest files alone are not noticed.)
+ *
+ * The cache file is append-only: new and updated entries are collected
+ * in memory and appended in batches, later entries replace earlier ones
+ * with the same path. After appending a batch, the file is mapped again
+ * and the batch is released, so only unwritten entries take up memory. When the file is loaded, it is compacted if more
+ * than half of it consists of replaced entries. The file is mapped into
+ * memory, so looking up an entry costs a map lookup and decoding a few
+ * strings.
+ *
+ * All functions may be called from several threads at once.
+ *
+ * @short  A persistent cache for package details extracted from ebuilds.
+ */
+class PortageMetadataCache
+{
+public:
+	PortageMetadataCache( const QString& filename );
+	~PortageMetadataCache();
+
+	bool load();
+	bool flush();
+
+	bool lookup( PortagePackageVersion* version,
+	             const QString& ebuildFilename );
+	void store( const PortagePackageVersion* version,
+	            const QString& ebuildFilename );
+
+private:
+	bool ensureLoaded();
+	bool indexRecords();
+	bool compact();
+	bool createFile();
+	bool flushRecords();
+
+	static bool fileStatus( const QString& filename,
+	                        Q_UINT32* modificationTime, Q_UINT32* fileSize );
+	static const char* validRecord( const char* data, const char* end );
+	static void readRecord( const char* record,
+	                        PortagePackageVersion* version );
+
+	//! Guards all the members.
+	QMutex m_mutex;
+	//! The path of the cache file.
+	QString m_filename;
+	//! false until the file has been loaded (successfully or not).
+	bool m_loaded;
+	//! true if the file has been loaded or created successfully.
+	bool m_valid;
+
+	//! The cache file, as it has been after loading it or the last flush.
+	MappedFile m_file;
+	//! The offsets of the live records in m_file, by ebuild path.
+	QMap<QString,uint> m_fileRecords;
+
+	//! Records that have been added since the file has last been mapped.
+	QByteArray m_newRecords;
+	//! The number of bytes in m_newRecords that are in use.
+	uint m_newRecordsSize;
+	//! The offsets of the records in m_newRecords, by ebuild path.
+	QMap<QString,uint> m_newRecordOffsets;
+};
+
+}
+
+#endif // LIBPAKTPORTAGEMETADATACACHE_H
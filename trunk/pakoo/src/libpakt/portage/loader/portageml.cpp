@@ -27,17 +27,23 @@
 #include "../core/portagecategory.h"
 
 #include <qfile.h>
+#include <qtextstream.h>
+#include <qtextcodec.h>
+#include <qxml.h>
 #include <qdatetime.h>
 #include <qapplication.h>
 
 #include <kdebug.h>
 #include <klocale.h>
+#include <ksavefile.h>
 
 #define FILETYPESTRING    "portageML"
 #define TREEELEMENTSTRING "portagetree"
 #define PACKAGEELEMENTSTRING "package"
 #define VERSIONELEMENTSTRING "version"
 
+#define READBUFFERSIZE 65536
+
 
 namespace libpakt {
 
@@ -113,9 +119,96 @@ IJob::JobResult PortageML::performThread()
 		return Failure;
 }
 
+/**
+ * The SAX handler used by PortageML::loadFile(). It checks the tree
+ * element and hands package and version elements over to the PortageML
+ * object as they arrive, so no document tree is built up in memory.
+ */
+class PortageML::ContentHandler : public QXmlDefaultHandler
+{
+public:
+	ContentHandler( PortageML* job )
+	{
+		m_job = job;
+		m_treeFound = false;
+	}
+
+	/**
+	 * Returns true if the tree element has been found.
+	 */
+	bool treeFound()
+	{
+		return m_treeFound;
+	}
+
+	/**
+	 * Called by the parser for each start tag.
+	 */
+	bool startElement( const QString&, const QString&,
+	                   const QString& qName, const QXmlAttributes& attributes )
+	{
+		if( m_treeFound == false )
+		{
+			if( qName != TREEELEMENTSTRING )
+			{
+				kdDebug() << i18n( "PortageML debug output.",
+					"Aborting: The file %1 doesn't contain "
+					"an appropriate tree element" )
+						.arg( m_job->m_filename )
+					<< endl;
+				return false;
+			}
+			m_treeFound = true;
+			m_job->m_packages->clear();
+		}
+		else if( qName == PACKAGEELEMENTSTRING ) {
+			m_job->loadPackageElement( attributes );
+		}
+		else if( qName == VERSIONELEMENTSTRING && m_job->m_package != NULL ) {
+			m_job->loadVersionElement( attributes );
+		}
+		return true;
+	}
+
+	/**
+	 * Called by the parser for each end tag.
+	 */
+	bool endElement( const QString&, const QString&, const QString& qName )
+	{
+		if( qName == PACKAGEELEMENTSTRING )
+			m_job->finishPackageElement();
+		return true;
+	}
+
+	/**
+	 * Called by the parser if the file is not well-formed.
+	 */
+	bool fatalError( const QXmlParseException& exception )
+	{
+		kdDebug() << i18n( "PortageML debug output. "
+		                   "%1 is the filename, %2 the line number "
+		                   "and %3 the error message.",
+			"Aborting: Parse error in %1, line %2: %3" )
+				.arg( m_job->m_filename )
+				.arg( exception.lineNumber() )
+				.arg( exception.message() )
+			<< endl;
+		return false;
+	}
+
+private:
+	//! The job that creates the packages.
+	PortageML* m_job;
+	//! true if the tree element has been found.
+	bool m_treeFound;
+};
+
+
 /**
  * Load a package list from an XML file in portageML format.
  * Any previous Package objects in the PackageList will be deleted.
+ * The file is read in blocks that are fed to an incremental SAX parser,
+ * so memory usage doesn't depend on the size of the file.
  *
  * @return  false if there were errors loading the file, true otherwise
  */
@@ -123,6 +216,7 @@ bool PortageML::loadFile()
 {
 	m_packageCountAvailable = 0;
 	m_packageCountInstalled = 0;
+	m_package = NULL;
 
 	QDateTime startTime = QDateTime::currentDateTime();
 	QFile file( m_filename );
@@ -136,21 +230,62 @@ bool PortageML::loadFile()
 		return false;
 	}
 
-	QDomDocument doc( FILETYPESTRING );
-	if( !doc.setContent( &file ) ) {
-		// file doesn't have a portageML doctype
-		file.close();
-		kdDebug() << i18n( "PortageML debug output.",
-			"Aborting: The file %1 doesn't have an appropriate doctype" )
-				.arg( m_filename )
-			<< endl;
-		return false;
+	ContentHandler handler( this );
+	QXmlSimpleReader reader;
+	reader.setContentHandler( &handler );
+	reader.setErrorHandler( &handler );
+
+	// portageML files are written in UTF-8, and the decoder
+	// takes care of characters that are split between two blocks
+	QTextDecoder* decoder = QTextCodec::codecForName( "UTF-8" )->makeDecoder();
+	QXmlInputSource source;
+	QByteArray buffer( READBUFFERSIZE );
+	bool firstBlock = true;
+	bool result = true;
+
+	while( result == true )
+	{
+		if( aborting() ) {
+			kdDebug() << i18n( "PortageML debug output.",
+				"Aborting the file loading job on request" )
+				<< endl;
+			result = false;
+			break;
+		}
+
+		Q_LONG length = file.readBlock( buffer.data(), buffer.size() );
+		if( length <= 0 )
+			break;
+
+		source.setData( decoder->toUnicode( buffer.data(), length ) );
+
+		if( firstBlock ) {
+			result = reader.parse( &source, true );
+			firstBlock = false;
+		}
+		else {
+			result = reader.parseContinue();
+		}
 	}
+
+	// an empty data block tells the parser that the document has ended
+	if( result == true && firstBlock == false ) {
+		source.setData( QString("") );
+		result = reader.parseContinue();
+	}
+
+	delete decoder;
 	file.close();
 
-	QDomElement root = doc.documentElement();
-	if( loadTreeElement(root) == false ) {
-		return false; // it will output an error message by itself then
+	if( result == false || handler.treeFound() == false ) {
+		if( result == true ) { // the file is empty
+			kdDebug() << i18n( "PortageML debug output.",
+				"Aborting: The file %1 doesn't contain "
+				"an appropriate tree element" )
+					.arg( m_filename )
+				<< endl;
+		}
+		return false; // error messages are output by the handler
 	}
 	else {
 		// Inform main thread that loading has finished
@@ -167,112 +302,50 @@ bool PortageML::loadFile()
 }
 
 /**
- * Load a package tree from a XML data.
- * This function assumes that m_packages is not NULL.
- *
- * @param element  The element containing package tree data
- * @return  false if there are errors loading the tree element, true otherwise
- */
-bool PortageML::loadTreeElement( const QDomElement& element )
-{
-	if( element.isNull() || element.tagName() != TREEELEMENTSTRING )
-	{
-		kdDebug() << i18n( "PortageML debug output.",
-			"Aborting: The file %1 doesn't contain "
-			"an appropriate tree element" )
-				.arg( m_filename )
-			<< endl;
-		return false;
-	}
-
-	m_packages->clear();
-
-	QDomNodeList packageElements =
-		element.elementsByTagName( PACKAGEELEMENTSTRING );
-
-	for( uint i = 0; i < packageElements.count(); i++ )
-	{
-		if( aborting() ) {
-			kdDebug() << i18n( "PortageML debug output.",
-				"Aborting the file loading job on request" )
-				<< endl;
-			return false;
-		}
-		loadPackageElement( packageElements.item(i).toElement() );
-		m_packageCountAvailable++;
-
-		// send a progress event
-		if( (m_packageCountAvailable % 500) == 0 )
-			emitPackagesScanned();
-	}
-	return true;
-}
-
-/**
- * Load a package from a XML data and add it to the package list.
+ * Create the package of a package element and make it the current one,
+ * so that the following version elements are added to it.
  * This function assumes that m_packages is not NULL.
  *
- * @param element  The element containing package data
+ * @param attributes  The attributes of the package element.
  * @return  true if the package was valid and has been added, false otherwise
  */
-bool PortageML::loadPackageElement( const QDomElement& element )
+bool PortageML::loadPackageElement( const QXmlAttributes& attributes )
 {
-	if( element.isNull() || element.tagName() != PACKAGEELEMENTSTRING )
-	{
-		kdDebug() << i18n( "PortageML debug output.",
-			"Error that shouldn't happen (TM): "
-			"PortageML::loadPackageElement(): "
-			"The function parameter is not a package element" )
-			<< endl;
-		return false;
-	}
+	QString categoryName = attributes.value( "category" );
+	QString name = attributes.value( "name" );
 
-	if( !element.hasAttribute("category")
-	    || !element.hasAttribute("name") )
+	if( categoryName.isEmpty() || name.isEmpty() )
 	{
 		kdDebug() << i18n( "PortageML debug output.",
 			"Error: The package element is missing one of the "
 			"'name' or 'category' attributes. "
 			"Continuing with the next package element." )
 			<< endl;
+		m_package = NULL;
 		return false;
 	}
 
 	PortageCategory* category = new PortageCategory;
-	category->loadFromUniqueName( element.attribute("category","") );
+	category->loadFromUniqueName( categoryName );
 
-	m_package = m_packages->package( category, element.attribute("name","") );
+	m_package = m_packages->package( category, name );
 	m_package->clear();
-
-	QDomNodeList versionElements =
-		element.elementsByTagName( VERSIONELEMENTSTRING );
-
-	for( uint i = 0; i < versionElements.count(); i++ ) {
-		loadVersionElement( versionElements.item(i).toElement() );
-	}
 	return true;
 }
 
 /**
- * Load version info from XML data and add it to the current package.
+ * Load version info from the attributes of a version element
+ * and add it to the current package.
  * This function assumes that m_package is not NULL.
  *
- * @param element  The element containing version info.
+ * @param attributes  The attributes of the version element.
  * @return  true if the version was valid and has been added, false otherwise.
  */
-bool PortageML::loadVersionElement( const QDomElement& element )
+bool PortageML::loadVersionElement( const QXmlAttributes& attributes )
 {
-	if( element.isNull() || element.tagName() != VERSIONELEMENTSTRING )
-	{
-		kdDebug() << i18n( "PortageML debug output.",
-			"Error that shouldn't happen (TM): "
-			"PortageML::loadVersionElement(): "
-			"The function parameter is not a version element" )
-			<< endl;
-		return false;
-	}
+	QString versionString = attributes.value( "version" );
 
-	if( !element.hasAttribute("version") )
+	if( versionString.isEmpty() )
 	{
 		kdDebug() << i18n( "PortageML debug output.",
 			"Error: The version element is missing the 'version' "
@@ -281,27 +354,23 @@ bool PortageML::loadVersionElement( const QDomElement& element )
 		return false;
 	}
 
-	QString versionString = element.attribute( "version", "" );
-
 	// clean up before doing anything
 	m_package->removeVersion( versionString );
 
 	PortagePackageVersion* version = m_package->version( versionString );
 
-	if( element.hasAttribute( "installed" )
-		&& element.attribute( "installed", "" ) == "true" )
+	if( attributes.value( "installed" ) == "true" )
 	{
 		version->setInstalled( true );
 		m_packageCountInstalled++;
 	}
-	if( element.hasAttribute( "overlay" )
-		&& element.attribute( "overlay", "" ) == "true" )
+	if( attributes.value( "overlay" ) == "true" )
 	{
 		version->setOverlay( true );
 	}
-	if( element.hasAttribute("date") )
+	if( attributes.index( "date" ) != -1 )
 	{
-		version->setDate( element.attribute("date", "") );
+		version->setDate( attributes.value( "date" ) );
 	}
 	// Can be extended with other attributes, like description
 	// or the keyword list. As I don't need that now (will I ever?)
@@ -309,24 +378,33 @@ bool PortageML::loadVersionElement( const QDomElement& element )
 	return true;
 }
 
+/**
+ * Finish the current package when the end of its element is reached.
+ */
+void PortageML::finishPackageElement()
+{
+	m_package = NULL;
+	m_packageCountAvailable++;
+
+	// send a progress event
+	if( (m_packageCountAvailable % 500) == 0 )
+		emitPackagesScanned();
+}
+
 /**
  * Save the portage tree to an XML file in portageML format.
+ * Each package is written to the file as soon as its element has been
+ * created, instead of building up a whole document in memory first.
+ * An aborted or failed run doesn't leave a truncated file behind.
  *
  * @return  false if there were errors saving the file, true otherwise.
  */
 bool PortageML::saveFile()
 {
 	QDateTime startTime = QDateTime::currentDateTime();
-	QDomDocument doc( FILETYPESTRING );
-	QDomElement root = this->createTreeElement( doc );
-
-	if( root.isNull() )
-		return false;
-
-	doc.appendChild( root );
 
-	QFile file( m_filename );
-	if( !file.open( IO_WriteOnly ) )
+	KSaveFile file( m_filename );
+	if( file.status() != 0 )
 	{
 		kdDebug() << i18n( "PortageML debug output.",
 			"Aborting: Couldn't open the file %1 for writing" )
@@ -335,9 +413,18 @@ bool PortageML::saveFile()
 		return false;
 	}
 
-	QTextStream ts( &file );
-	ts << doc.toString();
-	file.close();
+	QTextStream& stream = *file.textStream();
+	stream.setEncoding( QTextStream::UnicodeUTF8 );
+
+	stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	       << "<!DOCTYPE " FILETYPESTRING ">\n";
+
+	if( writeTreeElement( stream ) == false ) {
+		file.abort();
+		return false;
+	}
+	if( file.close() == false )
+		return false;
 
 	// Inform main thread that saving has finished
 	emitFinishedSaving();
@@ -352,64 +439,46 @@ bool PortageML::saveFile()
 }
 
 /**
- * Create a DOM element that contains all information about a package tree
+ * Write an element that contains all information about a package tree
  * and its packages. This function assumes that m_packages is not NULL.
  *
- * @param doc  The node will be created using
- *             this document's createElement() function.
- * @return  The created DOM element (which can be written to an XML file,
- *          for example). A null element (element.isNull() == true)
- *          if the thread has been aborted.
+ * @param stream  The stream that the element is written to.
+ * @return  false if the thread has been aborted, true otherwise.
  */
-QDomElement PortageML::createTreeElement( QDomDocument& doc )
+bool PortageML::writeTreeElement( QTextStream& stream )
 {
-	QDomElement element = doc.createElement( TREEELEMENTSTRING );
-
-	//QValueList<Package*> packageValues = m_packages->values();
-	QDomElement packageNode;
+	stream << "<" TREEELEMENTSTRING ">\n";
 
 	for( PackageList::iterator packageIterator = m_packages->begin();
 	     packageIterator != m_packages->end(); packageIterator++ )
 	{
 		if( aborting() ) {
-			// return QDomElement::null; but there is no such constant
-
 			kdDebug() << i18n( "PortageML debug output.",
 			                   "Aborting the file saving job on request" )
 				<< endl;
-			return element.toDocument().toElement();
+			return false;
 		}
 
 		Package* pkg = *packageIterator;
 		m_package = (PortagePackage*) pkg;
-		packageNode = createPackageElement( doc );
-		element.appendChild( packageNode );
+		writePackageElement( stream );
 	}
-	return element;
+
+	stream << "</" TREEELEMENTSTRING ">\n";
+	return true;
 }
 
 /**
- * Create a DOM element that contains all information about a package
+ * Write an element that contains all information about a package
  * and its versions. This function assumes that m_package is not NULL.
  *
- * @param doc  The node will be created using
- *             this document's createElement() function.
- * @return  The created DOM element (which can be written to an XML file,
- *          for example).
+ * @param stream  The stream that the element is written to.
  */
-QDomElement PortageML::createPackageElement( QDomDocument& doc )
+void PortageML::writePackageElement( QTextStream& stream )
 {
-	QDomElement element = doc.createElement( PACKAGEELEMENTSTRING );
-
-	QDomAttr attr = doc.createAttribute( "category" );
-	attr.setValue( m_package->category()->uniqueName() );
-	element.setAttributeNode( attr );
-
-	attr = doc.createAttribute( "name" );
-	attr.setValue( m_package->name() );
-	element.setAttributeNode( attr );
-
-	QDomElement versionElement;
+	stream << " <" PACKAGEELEMENTSTRING " category=\""
+	       << escapeAttribute( m_package->category()->uniqueName() )
+	       << "\" name=\"" << escapeAttribute( m_package->name() ) << "\">\n";
 
 	for( PortagePackage::versioniterator versionIterator = m_package->versionBegin();
 	     versionIterator != m_package->versionEnd(); versionIterator++ )
@@ -417,37 +486,40 @@ QDomElement PortageML::createPackageElement( QDomDocument& doc )
 		PortagePackageVersion* version =
 			(PortagePackageVersion*) (*versionIterator);
 
-		versionElement = doc.createElement( VERSIONELEMENTSTRING );
+		stream << "  <" VERSIONELEMENTSTRING " version=\""
+		       << escapeAttribute( version->version() ) << "\"";
 
-		attr = doc.createAttribute( "version" );
-		attr.setValue( version->version() );
-		versionElement.setAttributeNode( attr );
+		if( version->isInstalled() )
+			stream << " installed=\"true\"";
 
-		if( version->isInstalled() ) {
-			attr = doc.createAttribute( "installed" );
-			attr.setValue( "true" );
-			versionElement.setAttributeNode( attr );
-		}
+		if( version->isOverlay() )
+			stream << " overlay=\"true\"";
 
-		if( version->isOverlay() ) {
-			attr = doc.createAttribute( "overlay" );
-			attr.setValue( "true" );
-			versionElement.setAttributeNode( attr );
-		}
+		if( version->date().isEmpty() == false )
+			stream << " date=\"" << escapeAttribute( version->date() ) << "\"";
 
-		if( version->date().isEmpty() == false ) {
-			attr = doc.createAttribute( "date" );
-			attr.setValue( version->date() );
-			versionElement.setAttributeNode( attr );
-		}
 		// Can be extended with other attributes, like description
 		// or the keyword list. As I don't need that now (will I ever?)
 		// I don't implement it at the moment.
 
-		element.appendChild( versionElement );
+		stream << "/>\n";
 	}
 
-	return element;
+	stream << " </" PACKAGEELEMENTSTRING ">\n";
+}
+
+/**
+ * Replace the characters that may not appear in an XML attribute value
+ * by their entities.
+ */
+QString PortageML::escapeAttribute( const QString& value )
+{
+	QString escaped = value;
+	escaped.replace( '&', "&amp;" );
+	escaped.replace( '<', "&lt;" );
+	escaped.replace( '>', "&gt;" );
+	escaped.replace( '"', "&quot;" );
+	return escaped;
 }
 
 
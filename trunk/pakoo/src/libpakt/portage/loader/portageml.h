@@ -23,7 +23,10 @@
 
 #include "../../base/core/threadedjob.h"
 
-#include <qdom.h>
+#include <qstring.h>
+
+class QTextStream;
+class QXmlAttributes;
 
 
 namespace libpakt {
@@ -40,6 +43,11 @@ class PackageList;
  * representation of the tree and its packages. That way a PackageList object
  * can be saved and restored fast.
  *
+ * Files are processed as a stream, so the whole document is never held
+ * in memory: when loading, packages and versions are created as their
+ * elements arrive from a SAX parser that is fed with small blocks of the
+ * file, and when saving, each package element is written out directly.
+ *
  * Before starting the thread using start(), you'll have to call
  * setTreeObject(), setFileName() and setAction().
  *
@@ -103,11 +111,12 @@ private:
 	bool loadFile();
 	bool saveFile();
 
-	bool loadTreeElement( const QDomElement& element );
-	bool loadPackageElement( const QDomElement& element );
-	bool loadVersionElement( const QDomElement& element );
-	QDomElement createTreeElement( QDomDocument& doc );
-	QDomElement createPackageElement( QDomDocument& doc );
+	bool loadPackageElement( const QXmlAttributes& attributes );
+	bool loadVersionElement( const QXmlAttributes& attributes );
+	void finishPackageElement();
+	bool writeTreeElement( QTextStream& stream );
+	void writePackageElement( QTextStream& stream );
+	static QString escapeAttribute( const QString& value );
 
 	void emitFinishedLoading();
 	void emitFinishedSaving();
@@ -129,9 +138,12 @@ private:
 
 
 	//
-	// nested event classes
+	// nested classes
 	//
 
+	class ContentHandler;
+	friend class ContentHandler;
+
 	class FinishedFileEvent : public QCustomEvent
 	{
 	public:
@@ -23,21 +23,24 @@
 #include "../core/portagepackageversion.h"
 #include "../core/portagepackage.h"
 #include "../core/portagecategory.h"
+#include "../../base/core/mappedfile.h"
+#include "../../base/core/atomtable.h"
+#include "md5cachereader.h"
+#include "cdbcachereader.h"
+#include "portagemetadatacache.h"
 
 #include <qdir.h>
+#include <qfile.h>
 #include <qfileinfo.h>
 #include <qdatetime.h>
+#include <qdeepcopy.h>
+#include <qmutex.h>
 
 #include <klocale.h>
 #include <kdebug.h>
 
-// QRegExp regular expression strings
-#define RXDESCRIPTION "^DESCRIPTION=\"(.*)\"\\s*$"
-#define RXHOMEPAGE       "^HOMEPAGE=\"(.*)\"\\s*$"
-#define RXSLOT               "^SLOT=\"(.*)\"\\s*$"
-#define RXLICENSES        "^LICENSE=\"(.*)\"\\s*$"
-#define RXKEYWORDS       "^KEYWORDS=\"(.*)\"\\s*$"
-#define RXUSEFLAGS           "^IUSE=\"(.*)\"\\s*$"
+#include <string.h>
+#include <ctype.h>
 
 
 namespace libpakt {
@@ -49,12 +52,10 @@ namespace libpakt {
  * @see setSettingsObject
  */
 PortagePackageLoader::PortagePackageLoader()
-	: PackageLoader(),
-	m_rxDescription(RXDESCRIPTION), m_rxHomepage(RXHOMEPAGE),
-	m_rxSlot(RXSLOT), m_rxLicenses(RXLICENSES),
-	m_rxKeywords(RXKEYWORDS), m_rxUseflags(RXUSEFLAGS)
+	: PackageLoader()
 {
 	m_settings = NULL;
+	m_metadataCache = NULL;
 }
 
 /**
@@ -65,6 +66,16 @@ void PortagePackageLoader::setSettingsObject( PortageSettings* settings )
 	m_settings = settings;
 }
 
+/**
+ * Set the cache that stores the details of scanned ebuilds,
+ * so that they don't need to be scanned again. The cache may be shared
+ * by several loaders. NULL (the default) means that no cache is used.
+ */
+void PortagePackageLoader::setMetadataCache( PortageMetadataCache* cache )
+{
+	m_metadataCache = cache;
+}
+
 
 /**
  * The function that is called when a new thread is started.
@@ -82,11 +93,19 @@ IJob::JobResult PortagePackageLoader::performThread()
 		return Failure;
 	}
 	else {
+		// Several loaders may run at once with the same settings object,
+		// and QString reference counting is not thread safe.
+		static QMutex settingsMutex;
+		QMutexLocker locker( &settingsMutex );
+
 		m_preferredPackageSource = m_settings->preferredPackageSource();
-		m_mainlineTreeDir = m_settings->mainlineTreeDirectory();
-		m_overlayTreeDirs = m_settings->overlayTreeDirectories();
-		m_installedPackagesDir = m_settings->installedPackagesDirectory();
-		m_cacheDir = m_settings->cacheDirectory();
+		m_mainlineTreeDir = QDeepCopy<QString>(
+			m_settings->mainlineTreeDirectory() );
+		m_overlayTreeDirs = QDeepCopy<QStringList>(
+			m_settings->overlayTreeDirectories() );
+		m_installedPackagesDir = QDeepCopy<QString>(
+			m_settings->installedPackagesDirectory() );
+		m_cacheDir = QDeepCopy<QString>( m_settings->cacheDirectory() );
 	}
 
 	if( package() == NULL )
@@ -139,6 +158,13 @@ bool PortagePackageLoader::scanPackage()
 {
 	QString filename;
 
+	// Private copies of the names, so that they can be used without
+	// touching the reference counts of strings from other threads.
+	m_categoryName = AtomTable::detachedString(
+		package()->category()->atom() );
+	m_packageName = QString(
+		package()->name().unicode(), package()->name().length() );
+
 	// Scan information for each package version
 	for( Package::versioniterator versionIterator = package()->versionBegin();
 	     versionIterator != package()->versionEnd(); versionIterator++ )
@@ -155,19 +181,63 @@ bool PortagePackageLoader::scanPackage()
 		if( version->isOverlay() == false )
 		{ // then it has an ebuild from the mainline tree
 
+			QString ebuildFilename = m_mainlineTreeDir + "/"
+				+ m_categoryName + "/"
+				+ m_packageName + "/" + m_packageName + "-"
+				+ version->version() + ".ebuild";
+
+			QString md5CacheFilename = Md5CacheReader::categoryPath(
+				m_mainlineTreeDir, m_categoryName )
+				+ "/" + m_packageName + "-" + version->version();
+
+			// without Portage cache, try our own one first. Except if the
+			// tree comes with an md5-cache entry, which is read further
+			// below, as only that one contains the dependencies.
+			if( m_preferredPackageSource == PortageTree
+			    && QFile::exists( md5CacheFilename ) == false
+			    && loadCachedEbuild( version, ebuildFilename ) == true )
+			{
+				continue; // no need to scan the installed package
+			}
+
 			// Get package size from the digest
 			filename = m_mainlineTreeDir + "/"
-				+ package()->category()->uniqueName() + "/"
-				+ package()->name() + "/files/digest-" + package()->name()
+				+ m_categoryName + "/"
+				+ m_packageName + "/files/digest-" + m_packageName
 				+ "-" + version->version();
 			scanDigest( version, filename );
 
-			//TODO: Add suport for CDB-cache here?
+			if( m_preferredPackageSource == CdbCache )
+			{
+				// consecutive packages are usually in the same category,
+				// so the file stays open until another one is needed
+				filename = CdbCacheReader::categoryFile(
+					m_cacheDir, m_mainlineTreeDir, m_categoryName );
+				if( filename != m_cdbFilename ) {
+					m_cdbFile.open( filename );
+					m_cdbFilename = filename;
+				}
+
+				// try to find the version in this cache file
+				if( CdbCacheReader::readEntry( version, m_cdbFile,
+				        m_packageName + "-" + version->version() ) == true )
+				{
+					continue; // no need to scan the installed package
+				}
+			}
+			if( m_preferredPackageSource == Md5Cache
+			    || m_preferredPackageSource == PortageTree )
+			{
+				// try to scan this cache file
+				if( Md5CacheReader::readEntry( version, md5CacheFilename ) == true ) {
+					continue; // no need to scan the installed package
+				}
+			}
 			if( m_preferredPackageSource == FlatCache )
 			{
 				filename = m_cacheDir + m_mainlineTreeDir + "/"
-					+ package()->category()->uniqueName() + "/"
-					+ package()->name() + "-" + version->version();
+					+ m_categoryName + "/"
+					+ m_packageName + "-" + version->version();
 
 				// try to scan this edb file
 				if( scanEdbFile( version, filename ) == true ) {
@@ -176,13 +246,9 @@ bool PortagePackageLoader::scanPackage()
 			}
 			else
 			{
-				filename = m_mainlineTreeDir + "/"
-					+ package()->category()->uniqueName() + "/"
-					+ package()->name() + "/" + package()->name() + "-"
-					+ version->version() + ".ebuild";
-
 				// try to scan this ebuild
-				if( scanEbuild( version, filename ) == true ) {
+				if( scanEbuild( version, ebuildFilename ) == true ) {
+					cacheEbuild( version, ebuildFilename );
 					continue; // no need to scan the installed package
 				}
 			}
@@ -197,9 +263,9 @@ bool PortagePackageLoader::scanPackage()
 		if( version->isInstalled() == true )
 		{
 			filename = m_installedPackagesDir + "/"
-				+ package()->category()->uniqueName() + "/"
-				+ package()->name() + "-" + version->version() + "/"
-				+ package()->name() + "-" + version->version()
+				+ m_categoryName + "/"
+				+ m_packageName + "-" + version->version() + "/"
+				+ m_packageName + "-" + version->version()
 				+ ".ebuild";
 
 			scanEbuild( version, filename );
@@ -225,31 +291,73 @@ bool PortagePackageLoader::scanOverlayPackage( PortagePackageVersion* version )
 	for( QStringList::iterator overlayIterator = m_overlayTreeDirs.begin();
 	     overlayIterator != m_overlayTreeDirs.end(); overlayIterator++ )
 	{
+		QString ebuildFilename = (*overlayIterator) + "/"
+			+ m_categoryName + "/" + m_packageName
+			+ "/" + m_packageName + "-" + version->version() + ".ebuild";
+
+		if( loadCachedEbuild( version, ebuildFilename ) == true )
+			return true;
+
 		// Get package size from the digest
 		filename = (*overlayIterator) + "/"
-			+ package()->category()->uniqueName() + "/" + package()->name()
-			+ "/files/digest-" + package()->name() + "-" + version->version();
+			+ m_categoryName + "/" + m_packageName
+			+ "/files/digest-" + m_packageName + "-" + version->version();
 		if( scanDigest( version, filename ) == false )
 			continue;
 
-		filename = (*overlayIterator) + "/"
-			+ package()->category()->uniqueName() + "/" + package()->name()
-			+ "/" + package()->name() + "-" + version->version() + ".ebuild";
-
 		// try to scan this ebuild
-		if( scanEbuild( version, filename ) == true )
+		if( scanEbuild( version, ebuildFilename ) == true ) {
+			cacheEbuild( version, ebuildFilename );
 			return true;
+		}
 	}
 	// none of the paths contains the package? well then:
 	return false;
 }
 
+/**
+ * Retrieve the details of an ebuild from the metadata cache,
+ * if there is one and if it contains an up-to-date entry.
+ *
+ * @param version         The package version of the ebuild.
+ * @param ebuildFilename  The path to the ebuild file.
+ * @return  true if the details have been retrieved, false otherwise.
+ */
+bool PortagePackageLoader::loadCachedEbuild( PortagePackageVersion* version,
+                                             const QString& ebuildFilename )
+{
+	if( m_metadataCache == NULL )
+		return false;
+	else
+		return m_metadataCache->lookup( version, ebuildFilename );
+}
+
+/**
+ * Store the details of a scanned ebuild in the metadata cache,
+ * if there is one.
+ *
+ * @param version         The package version of the ebuild.
+ * @param ebuildFilename  The path to the ebuild file.
+ */
+void PortagePackageLoader::cacheEbuild( PortagePackageVersion* version,
+                                        const QString& ebuildFilename )
+{
+	if( m_metadataCache != NULL )
+		m_metadataCache->store( version, ebuildFilename );
+}
+
 /**
  * Extract package info from an ebuild file and store it into an existing
  * package version info. Description, homepage, package slot, keywords,
  * licenses and useflags are extracted. This is most likely to be slower than
  * and not as correct as scanEdbFile(), which fulfills the same purpose.
  *
+ * The file is mapped into memory and scanned in a single pass. Only lines
+ * starting with one of the variable names are looked at more closely,
+ * and the scan stops as soon as all of the variables have been found.
+ * Like Portage itself, only single-line assignments in double quotes
+ * are recognized.
+ *
  * @param version   The package version of the ebuild file.
  * @param filename  The path to the package's ebuild file.
  * @return  false if the file can't be opened, true otherwise.
@@ -257,55 +365,98 @@ bool PortagePackageLoader::scanOverlayPackage( PortagePackageVersion* version )
 bool PortagePackageLoader::scanEbuild( PortagePackageVersion* version,
                                        const QString& filename )
 {
-	QFile file(filename);
+	QFileInfo fileInfo( filename );
+	MappedFile file;
 
-	if( !file.open(IO_ReadOnly) ) {
-		return false;
+	if( file.open(filename) == false )
+	{
+		// empty files can't be mapped, but they're valid nonetheless
+		if( fileInfo.isFile() == false || fileInfo.isReadable() == false )
+			return false;
 	}
 
-	QString line;
-	QTextStream stream( &file );
+	const char* data = file.data();
+	const char* end = data + file.size();
+	int foundFields = 0;
 
 	// Read out the package info strings
-	while ( !stream.atEnd() )
+	for( const char* line = data;
+	     line < end && foundFields != AllEbuildFields; )
 	{
-		line = stream.readLine();
+		const char* lineEnd = (const char*) memchr( line, '\n', end - line );
+		if( lineEnd == NULL )
+			lineEnd = end;
 
-		if( m_rxDescription.search(line) > -1 ) // found a description
-		{
-			// store the first (and, most probably, only) match
-			version->setDescription( m_rxDescription.cap(1) );
-			continue;
-		}
-		if( m_rxHomepage.search(line) > -1 ) // found a homepage string
-		{
-			version->setHomepage( m_rxHomepage.cap(1) );
-			continue;
-		}
-		if( m_rxSlot.search(line) > -1 ) // found a slot string
-		{
-			version->setSlot( m_rxSlot.cap(1) );
-			continue;
-		}
-		if( this->extractStringList( line, &m_rxLicenses,
-		                             &(version->licenses()) ) == true )
-		{
-			continue;
-		}
-		if( this->extractStringList( line, &m_rxKeywords,
-		                             &(version->keywords()) ) == true )
+		int field = NoEbuildField;
+		const char* value;
+		uint length;
+
+		switch( *line )
 		{
-			continue;
+		case 'D':
+			field = matchEbuildField( line, lineEnd, "DESCRIPTION",
+			                          DescriptionField, &value, &length );
+			break;
+		case 'H':
+			field = matchEbuildField( line, lineEnd, "HOMEPAGE",
+			                          HomepageField, &value, &length );
+			break;
+		case 'S':
+			field = matchEbuildField( line, lineEnd, "SLOT",
+			                          SlotField, &value, &length );
+			break;
+		case 'L':
+			field = matchEbuildField( line, lineEnd, "LICENSE",
+			                          LicensesField, &value, &length );
+			break;
+		case 'K':
+			field = matchEbuildField( line, lineEnd, "KEYWORDS",
+			                          KeywordsField, &value, &length );
+			break;
+		case 'I':
+			field = matchEbuildField( line, lineEnd, "IUSE",
+			                          UseflagsField, &value, &length );
+			break;
+		default:
+			break;
 		}
-		if( this->extractStringList( line, &m_rxUseflags,
-		                             &(version->useflags()) ) == true )
+
+		// store the first (and, most probably, only) match
+		if( field != NoEbuildField && (foundFields & field) == 0 )
 		{
-			continue;
+			// ebuilds are required to be UTF-8 encoded
+			QString string = QString::fromUtf8( value, length );
+
+			switch( field )
+			{
+			case DescriptionField:
+				version->setDescription( string );
+				break;
+			case HomepageField:
+				version->setHomepage( string );
+				break;
+			case SlotField:
+				version->setSlot( string );
+				break;
+			case LicensesField:
+				version->setLicenses( QStringList::split(' ', string) );
+				break;
+			case KeywordsField:
+				version->setKeywords( QStringList::split(' ', string) );
+				break;
+			case UseflagsField:
+				version->setUseflags( QStringList::split(' ', string) );
+				break;
+			default:
+				break;
+			}
+			foundFields |= field;
 		}
+
+		line = lineEnd + 1;
 	}
 	file.close();
 
-	QFileInfo fileInfo( filename );
 	QDateTime date = fileInfo.created();
 	version->setDate( date.toString("yyyy MM dd") );
 
@@ -313,10 +464,52 @@ bool PortagePackageLoader::scanEbuild( PortagePackageVersion* version,
 
 } // end of scanEbuild()
 
+/**
+ * Check if a line of an ebuild assigns a value to a given variable,
+ * in the form of VARIABLE="value" (with optional trailing whitespace).
+ *
+ * @param line      Points to the first character of the line.
+ * @param lineEnd   Points to the character after the end of the line.
+ * @param name      The variable name, e.g. "DESCRIPTION".
+ * @param field     The field constant that is returned on success.
+ * @param value     Is set to the first character of the value, on success.
+ * @param length    Is set to the length of the value in bytes, on success.
+ * @return  The given field constant if the line matches,
+ *          NoEbuildField otherwise.
+ */
+int PortagePackageLoader::matchEbuildField( const char* line,
+	const char* lineEnd, const char* name, int field,
+	const char** value, uint* length )
+{
+	uint nameLength = strlen( name );
+
+	// the line must start with VARIABLE="
+	if( (uint) (lineEnd - line) < nameLength + 3
+	    || memcmp( line, name, nameLength ) != 0
+	    || line[nameLength] != '=' || line[nameLength + 1] != '"' )
+	{
+		return NoEbuildField;
+	}
+
+	// the line must end with a double quote, apart from whitespace
+	const char* valueEnd = lineEnd;
+	while( valueEnd > line && isspace( (unsigned char) valueEnd[-1] ) )
+		valueEnd--;
+
+	const char* valueStart = line + nameLength + 2;
+	if( valueEnd <= valueStart || valueEnd[-1] != '"' )
+		return NoEbuildField;
+
+	*value = valueStart;
+	*length = (valueEnd - 1) - valueStart;
+	return field;
+}
+
 /**
  * Extract package info from a file in the portage cache (/var/cache/edb/dep)
- * and store it into an existing package version info. Description, homepage,
- * package slot, keywords, licenses and useflags are extracted.
+ * and store it into an existing package version info. Dependencies,
+ * description, homepage, package slot, keywords, licenses and useflags
+ * are extracted.
  *
  * @param version   The package version of the edb file.
  * @param filename  The path to the package's edb file.
@@ -345,9 +538,11 @@ bool PortagePackageLoader::scanEdbFile( PortagePackageVersion* version,
 		// so iterate through the lines and quick-get the info outta there.
 		switch( lineNumber )
 		{
-		case 1: // some dependency stuff
+		case 1: // build time dependencies
+			version->setDependencies( line );
 			break;
-		case 2: // some other dependency stuff
+		case 2: // run time dependencies
+			version->setRuntimeDependencies( line );
 			break;
 		case 3: // the package slot
 			version->setSlot( line );
@@ -382,6 +577,7 @@ bool PortagePackageLoader::scanEdbFile( PortagePackageVersion* version,
 	QFileInfo fileInfo(filename);
 	QDateTime date = fileInfo.created();
 	version->setDate( date.toString("yyyy MM dd") );
+	version->setHasDependencyInfo( true );
 
 	return true;
 
@@ -417,30 +613,4 @@ bool PortagePackageLoader::scanDigest( PortagePackageVersion* version,
 }
 
 
-/**
- * Split the first match of a given regexp into single strings,
- * using spaces as delimiter.
- *
- * @param string      The string that will be searched.
- * @param rx          The regular expression used for searching.
- * @param targetList  The QStringList that will be filled with matches.
- * @return  false if rx or targetList is NULL, true otherwise.
- */
-bool PortagePackageLoader::extractStringList( const QString& string,
-                                              QRegExp* rx,
-                                              QStringList* targetList )
-{
-	if( rx == NULL || targetList == NULL )
-		return false;
-
-	if( rx->exactMatch( string ) == false ) { // no match
-		return false;
-	}
-	else
-	{
-		*targetList = QStringList::split( ' ', rx->cap(1) );
-	}
-	return true;
-}
-
 } // namespace
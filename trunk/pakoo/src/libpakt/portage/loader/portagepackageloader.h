@@ -23,15 +23,16 @@
 
 #include "../../base/loader/packageloader.h"
 #include "../core/portagesettings.h"
+#include "../../base/core/cdbfile.h"
 
 #include <qstringlist.h>
-#include <qregexp.h>
 
 
 namespace libpakt {
 
 class PortagePackageVersion;
 class PortageSettings;
+class PortageMetadataCache;
 
 /**
  * PortagePackageLoader is a threaded job which is able to retrieve package
@@ -53,23 +54,43 @@ public:
 
 	// settings
 	void setSettingsObject( PortageSettings* settings );
+	void setMetadataCache( PortageMetadataCache* cache );
 
 protected:
 	JobResult performThread();
 
 private:
+	//! The variables that are extracted from ebuilds, as bit flags.
+	enum EbuildField
+	{
+		NoEbuildField = 0,
+		DescriptionField = 1,
+		HomepageField = 2,
+		SlotField = 4,
+		LicensesField = 8,
+		KeywordsField = 16,
+		UseflagsField = 32,
+		AllEbuildFields = 63
+	};
 
 	bool scanPackage();
 
 	bool scanEbuild( PortagePackageVersion* version, const QString& filename );
 	bool scanEdbFile( PortagePackageVersion* version, const QString& filename );
 	bool scanOverlayPackage( PortagePackageVersion* version );
+	bool loadCachedEbuild( PortagePackageVersion* version,
+	                       const QString& ebuildFilename );
+	void cacheEbuild( PortagePackageVersion* version,
+	                  const QString& ebuildFilename );
 	bool scanDigest( PortagePackageVersion* version, const QString& filename );
 
-	bool extractStringList( const QString& string, QRegExp* rx, QStringList* targetList );
+	static int matchEbuildField( const char* line, const char* lineEnd,
+		const char* name, int field, const char** value, uint* length );
 
 	//! The PortageSettings object used for retrieving directories and cache info.
 	PortageSettings* m_settings;
+	//! The cache for details of already scanned ebuilds, or NULL.
+	PortageMetadataCache* m_metadataCache;
 
 	//! The directory where PortagePackageLoader tries to find packages.
 	QString m_mainlineTreeDir;
@@ -83,9 +104,15 @@ private:
 	//! Set to what type of Portage cache to use.
 	PackageSource m_preferredPackageSource;
 
-	// Regexps for various line strings inside an ebuild.
-	QRegExp m_rxDescription, m_rxHomepage, m_rxSlot;
-	QRegExp m_rxLicenses, m_rxKeywords, m_rxUseflags;
+	//! The category name of the currently scanned package.
+	QString m_categoryName;
+	//! The name of the currently scanned package.
+	QString m_packageName;
+
+	//! The CDB cache file of the last scanned category, kept open.
+	CdbFile m_cdbFile;
+	//! The file name of m_cdbFile.
+	QString m_cdbFilename;
 };
 
 }
@@ -0,0 +1,494 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "portagereversedependencyindex.h"
+
+#include "../core/portagepackage.h"
+#include "../core/portagepackageversion.h"
+#include "../core/portagecategory.h"
+#include "../core/dependatom.h"
+#include "../core/portageversion.h"
+#include "../../base/core/directoryreader.h"
+
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qdatastream.h>
+
+#include <kdebug.h>
+#include <klocale.h>
+#include <ksavefile.h>
+
+#define REVDEPINDEX_MAGIC         0x504b5452 // "PKTR"
+#define REVDEPINDEX_FORMATVERSION 1
+
+
+namespace libpakt {
+
+/**
+ * Initialize this object with an empty index.
+ */
+PortageReverseDependencyIndex::PortageReverseDependencyIndex()
+{
+	m_modified = false;
+}
+
+/**
+ * Load the index from a file. The current index is discarded.
+ *
+ * @return  true if the index has been loaded, false if the file could
+ *          not be read or is not an index file. In the latter case, the
+ *          index is empty afterwards.
+ */
+bool PortageReverseDependencyIndex::load( const QString& filename )
+{
+	clear();
+
+	QFile file( filename );
+	if( !file.open( IO_ReadOnly ) )
+		return false;
+
+	QDataStream stream( &file );
+	Q_UINT32 magic, formatVersion;
+	stream >> magic >> formatVersion;
+
+	if( magic != REVDEPINDEX_MAGIC
+	    || formatVersion != REVDEPINDEX_FORMATVERSION )
+	{
+		kdDebug() << i18n( "PortageReverseDependencyIndex debug output.",
+			"The file %1 is not a valid reverse dependency index "
+			"or has been written by another version" )
+				.arg( filename )
+			<< endl;
+		return false;
+	}
+
+	stream >> m_dependencies;
+
+	if( file.status() != IO_Ok ) {
+		clear();
+		return false;
+	}
+
+	// rebuild the reverse map
+	QMap<QString,QStringList>::iterator versionIteratorEnd = m_dependencies.end();
+	for( QMap<QString,QStringList>::iterator versionIterator =
+	         m_dependencies.begin();
+	     versionIterator != versionIteratorEnd; ++versionIterator )
+	{
+		const QStringList& packages = versionIterator.data();
+
+		for( QStringList::const_iterator packageIterator = packages.begin();
+		     packageIterator != packages.end(); ++packageIterator )
+		{
+			m_dependents[*packageIterator].append( versionIterator.key() );
+		}
+	}
+	m_modified = false;
+	return true;
+}
+
+/**
+ * Save the index to a file, if it has been modified since it was loaded
+ * or saved.
+ *
+ * @return  true if the index has been saved or is unmodified,
+ *          false if it could not be saved.
+ */
+bool PortageReverseDependencyIndex::save( const QString& filename )
+{
+	if( m_modified == false && QFile::exists(filename) )
+		return true;
+
+	KSaveFile file( filename );
+	if( file.status() != 0 )
+		return false;
+
+	QDataStream& stream = *file.dataStream();
+	stream << (Q_UINT32) REVDEPINDEX_MAGIC
+	       << (Q_UINT32) REVDEPINDEX_FORMATVERSION;
+	stream << m_dependencies;
+
+	if( file.close() == false )
+		return false;
+
+	m_modified = false;
+	return true;
+}
+
+/**
+ * Remove all versions from the index.
+ */
+void PortageReverseDependencyIndex::clear()
+{
+	m_dependencies.clear();
+	m_dependents.clear();
+	m_modified = true;
+}
+
+/**
+ * Returns true if there are no versions in the index, false otherwise.
+ */
+bool PortageReverseDependencyIndex::isEmpty() const
+{
+	return m_dependencies.isEmpty();
+}
+
+/**
+ * Returns true if the index has been changed since it was loaded
+ * or saved the last time.
+ */
+bool PortageReverseDependencyIndex::isModified() const
+{
+	return m_modified;
+}
+
+/**
+ * Retrieve the versions that depend on the given package, as strings
+ * like "app-portage/pakoo-0.1". The list is empty if no indexed
+ * version depends on the package.
+ *
+ * @param category  The category name of the package, like "x11-libs".
+ * @param package   The package name, like "qt".
+ */
+QStringList PortageReverseDependencyIndex::dependents(
+	const QString& category, const QString& package ) const
+{
+	QMap<QString,QStringList>::const_iterator dependentsIterator =
+		m_dependents.find( category + "/" + package );
+
+	if( dependentsIterator == m_dependents.end() )
+		return QStringList();
+	else
+		return dependentsIterator.data();
+}
+
+/**
+ * Retrieve the packages that the given version depends on, as strings
+ * like "x11-libs/qt".
+ *
+ * @param version  The version string, like "app-portage/pakoo-0.1".
+ */
+QStringList PortageReverseDependencyIndex::dependencies(
+	const QString& version ) const
+{
+	QMap<QString,QStringList>::const_iterator dependenciesIterator =
+		m_dependencies.find( version );
+
+	if( dependenciesIterator == m_dependencies.end() )
+		return QStringList();
+	else
+		return dependenciesIterator.data();
+}
+
+/**
+ * Add a version to the index, or replace its dependencies if it is
+ * already indexed.
+ *
+ * @param version           The version string, like "app-portage/pakoo-0.1".
+ * @param dependencyString  The concatenated dependency strings
+ *                          (DEPEND, RDEPEND and PDEPEND) of the version.
+ */
+void PortageReverseDependencyIndex::setDependencies(
+	const QString& version, const QString& dependencyString )
+{
+	removeVersion( version );
+
+	QStringList packages = dependencyPackages( dependencyString );
+	m_dependencies.insert( version, packages );
+	m_modified = true;
+
+	for( QStringList::iterator packageIterator = packages.begin();
+	     packageIterator != packages.end(); ++packageIterator )
+	{
+		m_dependents[*packageIterator].append( version );
+	}
+}
+
+/**
+ * Remove a version from the index. The cost depends on the number of
+ * its dependencies, not on the size of the index.
+ *
+ * @param version  The version string, like "app-portage/pakoo-0.1".
+ */
+void PortageReverseDependencyIndex::removeVersion( const QString& version )
+{
+	QMap<QString,QStringList>::iterator dependenciesIterator =
+		m_dependencies.find( version );
+
+	if( dependenciesIterator == m_dependencies.end() )
+		return;
+
+	const QStringList& packages = dependenciesIterator.data();
+
+	for( QStringList::const_iterator packageIterator = packages.begin();
+	     packageIterator != packages.end(); ++packageIterator )
+	{
+		QMap<QString,QStringList>::iterator dependentsIterator =
+			m_dependents.find( *packageIterator );
+
+		if( dependentsIterator == m_dependents.end() )
+			continue;
+
+		dependentsIterator.data().remove( version );
+		if( dependentsIterator.data().isEmpty() )
+			m_dependents.remove( dependentsIterator );
+	}
+
+	m_dependencies.remove( dependenciesIterator );
+	m_modified = true;
+}
+
+/**
+ * Fill the index with all versions in the database of installed
+ * packages, reading their DEPEND, RDEPEND and PDEPEND files.
+ * The current index is discarded.
+ *
+ * @param installedPackagesDir  The database directory, like "/var/db/pkg/".
+ * @return  false if the database directory could not be read, true otherwise.
+ */
+bool PortageReverseDependencyIndex::buildFromInstalledPackages(
+	const QString& installedPackagesDir )
+{
+	clear();
+
+	QStringList categories;
+	if( DirectoryReader::entryList( installedPackagesDir, categories,
+	                                DirectoryReader::Dirs ) == false )
+	{
+		return false;
+	}
+
+	for( QStringList::iterator categoryIterator = categories.begin();
+	     categoryIterator != categories.end(); ++categoryIterator )
+	{
+		QStringList versions;
+		DirectoryReader::entryList( installedPackagesDir + "/" + *categoryIterator,
+		                            versions, DirectoryReader::Dirs );
+
+		for( QStringList::iterator versionIterator = versions.begin();
+		     versionIterator != versions.end(); ++versionIterator )
+		{
+			readInstalledVersion( installedPackagesDir,
+			                      *categoryIterator + "/" + *versionIterator );
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Update the index with versions that have been installed or uninstalled.
+ * Each of the given versions is read again from the database of installed
+ * packages if it is still installed, and removed from the index otherwise.
+ * Versions that are only available in the tree are not added.
+ *
+ * @param installedPackagesDir  The database directory, like "/var/db/pkg/".
+ * @param changedVersions  The changed versions, like "app-portage/pakoo-0.1",
+ *                         as returned by PortageTreeScanner::changedVersions().
+ */
+void PortageReverseDependencyIndex::updateInstalledPackages(
+	const QString& installedPackagesDir, const QStringList& changedVersions )
+{
+	for( QStringList::const_iterator versionIterator = changedVersions.begin();
+	     versionIterator != changedVersions.end(); ++versionIterator )
+	{
+		if( QFileInfo( installedPackagesDir + "/" + *versionIterator ).isDir() )
+			readInstalledVersion( installedPackagesDir, *versionIterator );
+		else
+			removeVersion( *versionIterator );
+	}
+}
+
+/**
+ * Fill the index with all versions of a package list, which makes it
+ * an index over the whole tree. Only versions with detailed info are
+ * indexed, because the others don't know their dependencies.
+ * The dependencies are available if the package list has been loaded
+ * from the Portage cache, or if the packages have been loaded with a
+ * PackageLoader. The current index is discarded.
+ */
+void PortageReverseDependencyIndex::buildFromPackageList(
+	TemplatedPackageList<PortagePackage>* packages )
+{
+	clear();
+
+	for( PackageList::iterator packageIterator = packages->begin();
+	     packageIterator != packages->end(); ++packageIterator )
+	{
+		PortagePackage* package = (PortagePackage*) (*packageIterator).data();
+		QString packagePrefix =
+			package->category()->uniqueName() + "/" + package->name() + "-";
+
+		for( Package::versioniterator versionIterator = package->versionBegin();
+		     versionIterator != package->versionEnd(); ++versionIterator )
+		{
+			PortagePackageVersion* version =
+				(PortagePackageVersion*) *versionIterator;
+
+			if( version->hasDetailedInfo() ) {
+				setDependencies( packagePrefix + version->version(),
+					version->dependencies() + " "
+					+ version->runtimeDependencies() );
+			}
+		}
+	}
+}
+
+/**
+ * Update an index over the whole tree with changed versions. Each of
+ * the given versions is read again from the package list if it's still
+ * contained there (and has detailed info), and removed from the index
+ * otherwise.
+ *
+ * @param changedVersions  The changed versions, like "app-portage/pakoo-0.1",
+ *                         as returned by PortageTreeScanner::changedVersions().
+ */
+void PortageReverseDependencyIndex::updateFromPackageList(
+	TemplatedPackageList<PortagePackage>* packages,
+	const QStringList& changedVersions )
+{
+	PortageCategory category;
+
+	for( QStringList::const_iterator versionIterator = changedVersions.begin();
+	     versionIterator != changedVersions.end(); ++versionIterator )
+	{
+		const QString& versionName = *versionIterator;
+		int categorySeparator = versionName.find( '/' );
+		QString packageVersionName = versionName.mid( categorySeparator + 1 );
+		int versionSeparator =
+			PortageVersion::versionSeparator( packageVersionName );
+
+		PortagePackageVersion* version = NULL;
+
+		if( categorySeparator != -1 && versionSeparator != -1
+		    && category.loadFromUniqueName( versionName.left(categorySeparator) ) )
+		{
+			PortagePackage* package = packages->find( &category,
+				packageVersionName.left(versionSeparator) );
+
+			if( package == NULL ) {
+				removeVersion( versionName );
+				continue;
+			}
+			QString versionString = packageVersionName.mid( versionSeparator + 1 );
+
+			// Package::version() would create missing versions, so search
+			for( Package::versioniterator packageVersionIterator =
+			         package->versionBegin();
+			     packageVersionIterator != package->versionEnd();
+			     ++packageVersionIterator )
+			{
+				if( (*packageVersionIterator)->version() == versionString ) {
+					version = (PortagePackageVersion*) *packageVersionIterator;
+					break;
+				}
+			}
+		}
+
+		if( version != NULL && version->hasDetailedInfo() ) {
+			setDependencies( versionName, version->dependencies() + " "
+			                              + version->runtimeDependencies() );
+		}
+		else {
+			removeVersion( versionName );
+		}
+	}
+}
+
+/**
+ * Extract the packages from a dependency string, as strings like
+ * "x11-libs/qt". Each package is only contained once. USE conditions
+ * and groups are skipped, so atoms of all branches are included.
+ * Blockers are not included.
+ */
+QStringList PortageReverseDependencyIndex::dependencyPackages(
+	const QString& dependencyString )
+{
+	QStringList packages;
+	DependAtom atom( NULL );
+
+	const QChar* str = dependencyString.unicode();
+	uint length = dependencyString.length();
+	uint pos = 0;
+
+	while( pos < length )
+	{
+		// skip whitespace, then take everything up to the next whitespace
+		while( pos < length && str[pos].isSpace() )
+			pos++;
+
+		uint tokenStart = pos;
+		while( pos < length && !str[pos].isSpace() )
+			pos++;
+
+		uint tokenLength = pos - tokenStart;
+
+		// parentheses, "||" and USE conditions like "qt?" or "!qt?"
+		if( tokenLength == 0 || str[tokenStart] == '(' || str[tokenStart] == ')'
+		    || str[tokenStart] == '|' || str[pos - 1] == '?' )
+		{
+			continue;
+		}
+
+		if( atom.parse( dependencyString.mid(tokenStart, tokenLength) ) == false
+		    || atom.isBlocking() )
+		{
+			continue;
+		}
+
+		QString package = atom.categoryName() + "/" + atom.packageName();
+		if( packages.contains(package) == 0 )
+			packages.append( package );
+	}
+
+	return packages;
+}
+
+/**
+ * Read the dependency files of an installed version and add it to the index.
+ *
+ * @param version  The version string, like "app-portage/pakoo-0.1",
+ *                 which is also its path inside the database directory.
+ */
+void PortageReverseDependencyIndex::readInstalledVersion(
+	const QString& installedPackagesDir, const QString& version )
+{
+	QString versionDir = installedPackagesDir + "/" + version + "/";
+
+	setDependencies( version,
+		readFile( versionDir + "DEPEND" ) + " "
+		+ readFile( versionDir + "RDEPEND" ) + " "
+		+ readFile( versionDir + "PDEPEND" ) );
+}
+
+/**
+ * Return the contents of a small text file, or an empty string
+ * if the file doesn't exist.
+ */
+QString PortageReverseDependencyIndex::readFile( const QString& filename )
+{
+	QFile file( filename );
+	if( !file.open( IO_ReadOnly ) )
+		return QString::null;
+
+	QByteArray data = file.readAll();
+	return QString::fromLatin1( data.data(), data.size() );
+}
+
+}
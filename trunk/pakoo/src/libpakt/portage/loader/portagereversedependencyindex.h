@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTPORTAGEREVERSEDEPENDENCYINDEX_H
+#define LIBPAKTPORTAGEREVERSEDEPENDENCYINDEX_H
+
+#include "../../base/core/packagelist.h"
+
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qmap.h>
+
+
+namespace libpakt {
+
+class PortagePackage;
+
+/**
+ * PortageReverseDependencyIndex knows which package versions depend
+ * on a given package, so that questions like "what will break if this
+ * package is uninstalled?" can be answered with a single map lookup
+ * instead of parsing the dependencies of all packages.
+ *
+ * For each indexed version (like "app-portage/pakoo-0.1"), the index
+ * stores the packages that appear in its DEPEND, RDEPEND and PDEPEND
+ * strings (like "x11-libs/qt"). Atoms inside USE-conditional and
+ * "|| ( ... )" groups are included, blockers are not, so the result
+ * contains all packages that might be needed.
+ *
+ * There are two sources for the index: the database of installed
+ * packages, which is the one that's normally used, and the dependency
+ * details of the packages in a PackageList, for an optional index
+ * over the whole tree. Both can be updated incrementally with the
+ * changed versions that the PortageTreeScanner reports.
+ *
+ * The index is not thread-safe. It's filled by the PortageInitialLoader,
+ * and should only be queried after that has finished loading.
+ *
+ * @short  An index of the packages depending on a package.
+ */
+class PortageReverseDependencyIndex
+{
+public:
+	PortageReverseDependencyIndex();
+
+	bool load( const QString& filename );
+	bool save( const QString& filename );
+	void clear();
+	bool isEmpty() const;
+	bool isModified() const;
+
+	QStringList dependents( const QString& category,
+	                        const QString& package ) const;
+	QStringList dependencies( const QString& version ) const;
+
+	void setDependencies( const QString& version,
+	                      const QString& dependencyString );
+	void removeVersion( const QString& version );
+
+	bool buildFromInstalledPackages( const QString& installedPackagesDir );
+	void updateInstalledPackages( const QString& installedPackagesDir,
+	                              const QStringList& changedVersions );
+
+	void buildFromPackageList( TemplatedPackageList<PortagePackage>* packages );
+	void updateFromPackageList( TemplatedPackageList<PortagePackage>* packages,
+	                            const QStringList& changedVersions );
+
+	static QStringList dependencyPackages( const QString& dependencyString );
+
+private:
+	void readInstalledVersion( const QString& installedPackagesDir,
+	                           const QString& version );
+	static QString readFile( const QString& filename );
+
+	/**
+	 * The dependencies of each indexed version, stored as "category/package"
+	 * strings and sorted by version ("category/package-version").
+	 * This is the part that is saved to the index file.
+	 */
+	QMap<QString,QStringList> m_dependencies;
+	/**
+	 * The reverse of m_dependencies, listing the depending versions for
+	 * each package. It's rebuilt from m_dependencies when loading the index.
+	 */
+	QMap<QString,QStringList> m_dependents;
+	//! true if the index has been changed since it was loaded or saved.
+	bool m_modified;
+};
+
+}
+
+#endif // LIBPAKTPORTAGEREVERSEDEPENDENCYINDEX_H
@@ -0,0 +1,730 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "portagesnapshot.h"
+
+#include "../core/portagepackageversion.h"
+#include "../core/portagepackage.h"
+#include "../../base/core/packagelist.h"
+#include "../../base/core/mappedfile.h"
+#include "../core/portagecategory.h"
+
+#include <qfile.h>
+#include <qcstring.h>
+#include <qvaluelist.h>
+#include <qdatetime.h>
+#include <qapplication.h>
+
+#include <kdebug.h>
+#include <klocale.h>
+#include <ksavefile.h>
+
+#include <string.h>
+
+#define SNAPSHOT_MAGIC         0x504b5453 // "PKTS"
+#define SNAPSHOT_FORMATVERSION 2
+#define SNAPSHOT_BYTEORDER     0x01020304
+
+
+namespace libpakt {
+
+/*
+ * The on-disk layout of a snapshot. All fields are 32-bit unsigned
+ * integers in native byte order, and all sections are arrays of these
+ * records. Offsets are counted in bytes from the beginning of the file.
+ * String index 0 always refers to the empty string.
+ */
+struct SnapshotHeader
+{
+	Q_UINT32 magic;
+	Q_UINT32 formatVersion;
+	Q_UINT32 byteOrder;
+	Q_UINT32 fileSize;
+	Q_UINT32 snapshotId;         // identifies the snapshot, see setSnapshotId()
+	Q_UINT32 stringCount;
+	Q_UINT32 stringIndexOffset;  // array of SnapshotString
+	Q_UINT32 stringDataOffset;   // UTF-8 data referenced by SnapshotString
+	Q_UINT32 stringDataSize;
+	Q_UINT32 packageCount;
+	Q_UINT32 packageOffset;      // array of SnapshotPackage
+	Q_UINT32 versionCount;
+	Q_UINT32 versionOffset;      // array of SnapshotVersion
+	Q_UINT32 keywordCount;
+	Q_UINT32 keywordOffset;      // array of string indices
+};
+
+struct SnapshotString
+{
+	Q_UINT32 offset; // relative to stringDataOffset
+	Q_UINT32 length;
+};
+
+struct SnapshotPackage
+{
+	Q_UINT32 category; // string index of the category's unique name
+	Q_UINT32 name;
+	Q_UINT32 firstVersion;
+	Q_UINT32 versionCount;
+};
+
+struct SnapshotVersion
+{
+	Q_UINT32 version;
+	Q_UINT32 date;
+	Q_UINT32 slot;
+	Q_UINT32 firstKeyword;
+	Q_UINT32 keywordCount;
+	Q_UINT32 flags;
+};
+
+enum SnapshotVersionFlags
+{
+	InstalledFlag = 1,
+	OverlayFlag = 2
+};
+
+/**
+ * Returns true if an array of count records with the given size fits
+ * into a file of fileSize bytes, starting at offset.
+ */
+static bool sectionFits( Q_UINT32 offset, Q_UINT32 count,
+                         unsigned long recordSize, unsigned long fileSize )
+{
+	if( offset > fileSize )
+		return false;
+	else
+		return ( (unsigned long) count <= (fileSize - offset) / recordSize );
+}
+
+
+/**
+ * Initialize this object.
+ */
+PortageSnapshot::PortageSnapshot() : ThreadedJob()
+{
+	m_packages = NULL;
+	m_action = LoadFile;
+	m_filename = QString::null;
+	m_snapshotId = 0;
+}
+
+/**
+ * Set the PackageList object that will be filled with packages
+ * (in case of loading from a file) or used as source of
+ * package information (in case of saving to a file).
+ */
+void PortageSnapshot::setPackageList(
+	TemplatedPackageList<PortagePackage>* packages )
+{
+	m_packages = packages;
+}
+
+/**
+ * Set the name of the file that is used for loading and saving
+ * the package list.
+ */
+void PortageSnapshot::setFileName( const QString& filename )
+{
+	m_filename = filename;
+}
+
+/**
+ * Specify if you want to load from the file or save to it.
+ * You can use one of the constants PortageSnapshot::LoadFile
+ * or PortageSnapshot::SaveFile as argument.
+ */
+void PortageSnapshot::setAction( Action action )
+{
+	m_action = action;
+}
+
+
+/**
+ * Set the number that identifies the snapshot when saving it, so that
+ * files which are written along with the snapshot (like the
+ * PortageTreeState) can tell if they belong to it. By default, it's 0.
+ */
+void PortageSnapshot::setSnapshotId( Q_UINT32 snapshotId )
+{
+	m_snapshotId = snapshotId;
+}
+
+/**
+ * Returns the number that identifies the snapshot, which has been read
+ * from the file when loading, or set with setSnapshotId() for saving.
+ */
+Q_UINT32 PortageSnapshot::snapshotId() const
+{
+	return m_snapshotId;
+}
+
+
+/**
+ * This function is called when a new thread is started,
+ * it initiates loading or saving the package list from/to the specified file.
+ */
+IJob::JobResult PortageSnapshot::performThread()
+{
+	// Check on a NULL list, which would be bad
+	if( m_packages == NULL ) {
+		kdDebug() << i18n( "PortageSnapshot debug output. %1 is the filename.",
+			"Didn't start loading %1 because "
+			"the PackageList object has not been set" )
+				.arg( m_filename )
+			<< endl;
+		return Failure;
+	}
+
+	bool result = false;
+
+	// load or save the file
+	if( m_action == LoadFile )
+		result = loadFile();
+	else if( m_action == SaveFile )
+		result = saveFile();
+
+	if( result == true )
+		return Success;
+	else
+		return Failure;
+}
+
+/**
+ * Load a package list from a snapshot file.
+ * Any previous Package objects in the PackageList will be deleted.
+ *
+ * @return  false if the file could not be read or is not a valid
+ *          snapshot, true otherwise
+ */
+bool PortageSnapshot::loadFile()
+{
+	m_packageCountAvailable = 0;
+	m_packageCountInstalled = 0;
+
+	QDateTime startTime = QDateTime::currentDateTime();
+	MappedFile file( m_filename );
+
+	if( !file.isOpen() || file.size() < sizeof(SnapshotHeader) )
+	{
+		kdDebug() << i18n( "PortageSnapshot debug output.",
+			"Aborting: Couldn't open the file %1 for reading" )
+				.arg( m_filename )
+			<< endl;
+		return false;
+	}
+
+	const char* data = file.data();
+	const SnapshotHeader* header = (const SnapshotHeader*) data;
+
+	if( header->magic != SNAPSHOT_MAGIC
+	    || header->formatVersion != SNAPSHOT_FORMATVERSION
+	    || header->byteOrder != SNAPSHOT_BYTEORDER
+	    || header->fileSize != file.size()
+	    || header->stringCount == 0
+	    || !sectionFits( header->stringIndexOffset, header->stringCount,
+	                     sizeof(SnapshotString), file.size() )
+	    || !sectionFits( header->stringDataOffset, header->stringDataSize,
+	                     1, file.size() )
+	    || !sectionFits( header->packageOffset, header->packageCount,
+	                     sizeof(SnapshotPackage), file.size() )
+	    || !sectionFits( header->versionOffset, header->versionCount,
+	                     sizeof(SnapshotVersion), file.size() )
+	    || !sectionFits( header->keywordOffset, header->keywordCount,
+	                     sizeof(Q_UINT32), file.size() ) )
+	{
+		kdDebug() << i18n( "PortageSnapshot debug output.",
+			"Aborting: The file %1 is not a valid snapshot "
+			"or has been written by another version" )
+				.arg( m_filename )
+			<< endl;
+		return false;
+	}
+
+	m_snapshotId = header->snapshotId;
+
+	const SnapshotPackage* packages =
+		(const SnapshotPackage*) (data + header->packageOffset);
+	const SnapshotVersion* versions =
+		(const SnapshotVersion*) (data + header->versionOffset);
+	const Q_UINT32* keywords =
+		(const Q_UINT32*) (data + header->keywordOffset);
+
+	m_strings.clear();
+	m_strings.resize( header->stringCount );
+	m_packages->clear();
+
+	bool valid = true;
+
+	for( Q_UINT32 p = 0; p < header->packageCount; p++ )
+	{
+		if( aborting() ) {
+			kdDebug() << i18n( "PortageSnapshot debug output.",
+				"Aborting the file loading job on request" )
+				<< endl;
+			valid = false;
+			break;
+		}
+
+		const SnapshotPackage& packageRecord = packages[p];
+
+		if( packageRecord.category >= header->stringCount
+		    || packageRecord.name >= header->stringCount
+		    || packageRecord.firstVersion > header->versionCount
+		    || packageRecord.versionCount
+		       > header->versionCount - packageRecord.firstVersion )
+		{
+			valid = false;
+			break;
+		}
+
+		// parse each category only once, and share it between the packages
+		PackageCategory* category;
+		QMap<Q_UINT32,PackageCategory*>::iterator categoryIterator =
+			m_categories.find( packageRecord.category );
+
+		if( categoryIterator == m_categories.end() ) {
+			category = new PortageCategory();
+			category->loadFromUniqueName(
+				snapshotString( file, packageRecord.category ) );
+			category = PackageCategory::shared( category );
+			m_categories.insert( packageRecord.category, category );
+		}
+		else {
+			category = *categoryIterator;
+		}
+
+		PortagePackage* package = m_packages->package(
+			category, snapshotString( file, packageRecord.name ) );
+
+		Q_UINT32 versionEnd =
+			packageRecord.firstVersion + packageRecord.versionCount;
+
+		for( Q_UINT32 v = packageRecord.firstVersion; v < versionEnd; v++ )
+		{
+			const SnapshotVersion& versionRecord = versions[v];
+
+			if( versionRecord.version >= header->stringCount
+			    || versionRecord.date >= header->stringCount
+			    || versionRecord.slot >= header->stringCount
+			    || versionRecord.firstKeyword > header->keywordCount
+			    || versionRecord.keywordCount
+			       > header->keywordCount - versionRecord.firstKeyword )
+			{
+				valid = false;
+				break;
+			}
+
+			PortagePackageVersion* version = package->version(
+				snapshotString( file, versionRecord.version ) );
+
+			if( versionRecord.flags & InstalledFlag ) {
+				version->setInstalled( true );
+				m_packageCountInstalled++;
+			}
+			if( versionRecord.flags & OverlayFlag )
+				version->setOverlay( true );
+
+			if( versionRecord.date != 0 )
+				version->setDate( snapshotString(file, versionRecord.date) );
+			if( versionRecord.slot != 0 )
+				version->setSlot( snapshotString(file, versionRecord.slot) );
+
+			if( versionRecord.keywordCount != 0 )
+			{
+				QStringList keywordList;
+				Q_UINT32 keywordEnd =
+					versionRecord.firstKeyword + versionRecord.keywordCount;
+
+				for( Q_UINT32 k = versionRecord.firstKeyword;
+				     k < keywordEnd; k++ )
+				{
+					if( keywords[k] >= header->stringCount ) {
+						valid = false;
+						break;
+					}
+					keywordList.append( snapshotString(file, keywords[k]) );
+				}
+				version->setKeywords( keywordList );
+			}
+		}
+
+		if( valid == false )
+			break;
+
+		m_packageCountAvailable++;
+
+		// send a progress event
+		if( (m_packageCountAvailable % 500) == 0 )
+			emitPackagesScanned();
+	}
+
+	// clean up the temporary tables (the categories are shared ones)
+	m_categories.clear();
+	m_strings.clear();
+
+	if( valid == false )
+	{
+		if( !aborting() ) {
+			kdDebug() << i18n( "PortageSnapshot debug output.",
+				"Aborting: The file %1 contains invalid records" )
+					.arg( m_filename )
+				<< endl;
+		}
+		m_packages->clear();
+		return false;
+	}
+
+	// Inform main thread that loading has finished
+	emitFinishedLoading();
+
+	kdDebug() << i18n( "PortageSnapshot debug output. "
+	                   "%1 is the filename, %2 are, well, the seconds.",
+		"Finished loading the packages from %1 in %2 seconds" )
+			.arg( m_filename )
+			.arg( startTime.secsTo(QDateTime::currentDateTime()) )
+		<< endl;
+	return true;
+}
+
+/**
+ * Return the string with the given index from the snapshot's
+ * string table. Each string is only decoded once, subsequent calls
+ * return an implicitly shared copy of the same string.
+ * This function assumes that the index has already been checked.
+ */
+const QString& PortageSnapshot::snapshotString( const MappedFile& file,
+                                                Q_UINT32 index )
+{
+	QString& str = m_strings[index];
+
+	if( str.isNull() )
+	{
+		const SnapshotHeader* header = (const SnapshotHeader*) file.data();
+		const SnapshotString& entry = ( (const SnapshotString*)
+			(file.data() + header->stringIndexOffset) )[index];
+
+		if( entry.offset > header->stringDataSize
+		    || entry.length > header->stringDataSize - entry.offset )
+		{
+			str = ""; // broken entry, better than reading beyond the file
+		}
+		else {
+			str = QString::fromUtf8(
+				file.data() + header->stringDataOffset + entry.offset,
+				entry.length
+			);
+		}
+	}
+	return str;
+}
+
+/**
+ * Build the contents of the snapshot file from the package list in memory,
+ * for writing it later with saveFile(). This is the part of saving that
+ * needs to access the package list, so it can be called from the thread
+ * that has loaded the packages, while the file is written in the background
+ * by running the job with the SaveFile action afterwards. When composing
+ * has finished, the job doesn't refer to any data of the package list.
+ *
+ * @return  false if the job has been aborted, true otherwise.
+ */
+bool PortageSnapshot::compose()
+{
+	m_composedData.resize( 0 );
+
+	QValueVector<SnapshotPackage> packageRecords;
+	QValueVector<SnapshotVersion> versionRecords;
+	QValueVector<Q_UINT32> keywordRecords;
+
+	m_stringIndices.clear();
+	m_stringIndices.insert( "", 0 );
+
+	packageRecords.reserve( m_packages->count() );
+
+	for( PackageList::iterator packageIterator = m_packages->begin();
+	     packageIterator != m_packages->end(); ++packageIterator )
+	{
+		if( aborting() ) {
+			kdDebug() << i18n( "PortageSnapshot debug output.",
+			                   "Aborting the file saving job on request" )
+				<< endl;
+			m_stringIndices.clear();
+			return false;
+		}
+
+		PortagePackage* package = (PortagePackage*) (*packageIterator).data();
+
+		SnapshotPackage packageRecord;
+		packageRecord.category =
+			internString( package->category()->uniqueName() );
+		packageRecord.name = internString( package->name() );
+		packageRecord.firstVersion = versionRecords.count();
+
+		for( PortagePackage::versioniterator versionIterator =
+		         package->versionBegin();
+		     versionIterator != package->versionEnd(); ++versionIterator )
+		{
+			const PortagePackageVersion* version =
+				(const PortagePackageVersion*) (*versionIterator);
+
+			SnapshotVersion versionRecord;
+			versionRecord.version = internString( version->version() );
+			versionRecord.date = internString( version->date() );
+			versionRecord.slot = internString( version->slot() );
+			versionRecord.firstKeyword = keywordRecords.count();
+
+			QStringList keywords = version->keywords();
+			for( QStringList::const_iterator keywordIterator = keywords.begin();
+			     keywordIterator != keywords.end(); ++keywordIterator )
+			{
+				keywordRecords.append( internString(*keywordIterator) );
+			}
+			versionRecord.keywordCount =
+				keywordRecords.count() - versionRecord.firstKeyword;
+
+			versionRecord.flags = 0;
+			if( version->isInstalled() )
+				versionRecord.flags |= InstalledFlag;
+			if( version->isOverlay() )
+				versionRecord.flags |= OverlayFlag;
+
+			versionRecords.append( versionRecord );
+		}
+
+		packageRecord.versionCount =
+			versionRecords.count() - packageRecord.firstVersion;
+		packageRecords.append( packageRecord );
+	}
+
+	// bring the string table into index order
+	QValueVector<QCString> strings( m_stringIndices.count() );
+	QMap<QString,Q_UINT32>::iterator stringIteratorEnd = m_stringIndices.end();
+	for( QMap<QString,Q_UINT32>::iterator stringIterator =
+	         m_stringIndices.begin();
+	     stringIterator != stringIteratorEnd; ++stringIterator )
+	{
+		strings[stringIterator.data()] = stringIterator.key().utf8();
+	}
+	m_stringIndices.clear();
+
+	QValueVector<SnapshotString> stringEntries( strings.count() );
+	Q_UINT32 stringDataSize = 0;
+	for( uint i = 0; i < strings.count(); i++ )
+	{
+		stringEntries[i].offset = stringDataSize;
+		stringEntries[i].length = strings[i].length();
+		stringDataSize += strings[i].length();
+	}
+
+	// compose the header, the sections follow each other without gaps
+	SnapshotHeader header;
+	header.magic = SNAPSHOT_MAGIC;
+	header.formatVersion = SNAPSHOT_FORMATVERSION;
+	header.byteOrder = SNAPSHOT_BYTEORDER;
+	header.stringCount = stringEntries.count();
+	header.stringIndexOffset = sizeof(SnapshotHeader);
+	header.packageCount = packageRecords.count();
+	header.packageOffset = header.stringIndexOffset
+		+ header.stringCount * sizeof(SnapshotString);
+	header.versionCount = versionRecords.count();
+	header.versionOffset = header.packageOffset
+		+ header.packageCount * sizeof(SnapshotPackage);
+	header.keywordCount = keywordRecords.count();
+	header.keywordOffset = header.versionOffset
+		+ header.versionCount * sizeof(SnapshotVersion);
+	header.stringDataOffset = header.keywordOffset
+		+ header.keywordCount * sizeof(Q_UINT32);
+	header.stringDataSize = stringDataSize;
+	header.fileSize = header.stringDataOffset + header.stringDataSize;
+	header.snapshotId = m_snapshotId;
+
+	// copy the sections into one block, in the order given by the header
+	QByteArray data( header.fileSize );
+	char* position = data.data();
+
+	memcpy( position, &header, sizeof(SnapshotHeader) );
+	position += sizeof(SnapshotHeader);
+
+	if( header.stringCount != 0 ) {
+		memcpy( position, &stringEntries[0],
+		        header.stringCount * sizeof(SnapshotString) );
+		position += header.stringCount * sizeof(SnapshotString);
+	}
+	if( header.packageCount != 0 ) {
+		memcpy( position, &packageRecords[0],
+		        header.packageCount * sizeof(SnapshotPackage) );
+		position += header.packageCount * sizeof(SnapshotPackage);
+	}
+	if( header.versionCount != 0 ) {
+		memcpy( position, &versionRecords[0],
+		        header.versionCount * sizeof(SnapshotVersion) );
+		position += header.versionCount * sizeof(SnapshotVersion);
+	}
+	if( header.keywordCount != 0 ) {
+		memcpy( position, &keywordRecords[0],
+		        header.keywordCount * sizeof(Q_UINT32) );
+		position += header.keywordCount * sizeof(Q_UINT32);
+	}
+	for( uint i = 0; i < strings.count(); i++ ) {
+		if( strings[i].length() != 0 ) {
+			memcpy( position, strings[i].data(), strings[i].length() );
+			position += strings[i].length();
+		}
+	}
+
+	m_composedData = data;
+	return true;
+}
+
+/**
+ * Save the package list to a snapshot file. If the snapshot has not
+ * been composed before, this is done first. KSaveFile makes sure that
+ * a concurrently loading job never sees a half-written snapshot.
+ *
+ * @return  false if there were errors saving the file, true otherwise.
+ */
+bool PortageSnapshot::saveFile()
+{
+	QDateTime startTime = QDateTime::currentDateTime();
+
+	if( m_composedData.isEmpty() && compose() == false )
+		return false;
+
+	KSaveFile file( m_filename );
+	if( file.status() != 0 )
+	{
+		kdDebug() << i18n( "PortageSnapshot debug output.",
+			"Aborting: Couldn't open the file %1 for writing" )
+				.arg( m_filename )
+			<< endl;
+		m_composedData.resize( 0 );
+		return false;
+	}
+
+	bool written = ( file.file()->writeBlock( m_composedData.data(),
+	                                          m_composedData.size() ) != -1 );
+	m_composedData.resize( 0 );
+
+	if( !written )
+		file.abort();
+
+	if( !written || file.close() == false )
+	{
+		kdDebug() << i18n( "PortageSnapshot debug output.",
+			"Aborting: Couldn't write the file %1" )
+				.arg( m_filename )
+			<< endl;
+		return false;
+	}
+
+	// Inform main thread that saving has finished
+	emitFinishedSaving();
+	kdDebug() << i18n( "PortageSnapshot debug output. "
+	                   "%1 is the filename, %2 are, well, the seconds.",
+		"PortageSnapshot::saveFile(): "
+		"Finished saving the packages to %1 in %2 seconds" )
+			.arg( m_filename )
+			.arg( startTime.secsTo(QDateTime::currentDateTime()) )
+		<< endl;
+	return true;
+}
+
+/**
+ * Add a string to the string table that is being built for saving,
+ * if it's not already in there.
+ *
+ * @return  The index of the string in the table.
+ */
+Q_UINT32 PortageSnapshot::internString( const QString& str )
+{
+	if( str.isEmpty() )
+		return 0;
+
+	QMap<QString,Q_UINT32>::iterator stringIterator =
+		m_stringIndices.find( str );
+
+	if( stringIterator != m_stringIndices.end() )
+		return stringIterator.data();
+
+	Q_UINT32 index = m_stringIndices.count();
+	m_stringIndices.insert( str, index );
+	return index;
+}
+
+
+/**
+ * From within the thread, emit a finishedLoading() signal to the main thread.
+ */
+void PortageSnapshot::emitFinishedLoading()
+{
+	FinishedFileEvent* event = new FinishedFileEvent();
+	event->action = LoadFile;
+	QApplication::postEvent( this, event );
+}
+
+/**
+ * From within the thread, emit a finishedSaving() signal to the main thread.
+ */
+void PortageSnapshot::emitFinishedSaving()
+{
+	FinishedFileEvent* event = new FinishedFileEvent();
+	event->action = SaveFile;
+	QApplication::postEvent( this, event );
+}
+
+/**
+ * From within the thread, emit a packagesScanned() signal to the main thread.
+ */
+void PortageSnapshot::emitPackagesScanned()
+{
+	PackagesScannedEvent* event  = new PackagesScannedEvent();
+	event->packageCountAvailable = m_packageCountAvailable;
+	event->packageCountInstalled = m_packageCountInstalled;
+	QApplication::postEvent( this, event );
+}
+
+/**
+ * Translates QCustomEvents into signals. This function is called from Qt
+ * in the main thread, which guarantees safety for emitting signals.
+ */
+void PortageSnapshot::customEvent( QCustomEvent* event )
+{
+	switch( event->type() )
+	{
+	case (int) PackagesScannedEventType:
+		emit packagesScanned(
+			((PackagesScannedEvent*)event)->packageCountAvailable,
+			((PackagesScannedEvent*)event)->packageCountInstalled
+		);
+		break;
+
+	case (int) FinishedFileEventType:
+		if( ((FinishedFileEvent*)event)->action == LoadFile )
+			emit finishedLoading( m_packages, m_filename );
+		else if( ((FinishedFileEvent*)event)->action == SaveFile )
+			emit finishedSaving( m_packages, m_filename );
+		break;
+
+	default:
+		ThreadedJob::customEvent( event );
+		break;
+	}
+}
+
+} // namespace
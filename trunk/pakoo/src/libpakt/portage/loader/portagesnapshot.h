@@ -0,0 +1,170 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTPORTAGESNAPSHOT_H
+#define LIBPAKTPORTAGESNAPSHOT_H
+
+#include "../../base/core/threadedjob.h"
+
+#include <qstring.h>
+#include <qcstring.h>
+#include <qvaluevector.h>
+#include <qmap.h>
+
+
+namespace libpakt {
+
+template<class T> class TemplatedPackageList;
+class PortagePackage;
+class PackageCategory;
+class MappedFile;
+
+/**
+ * PortageSnapshot reads and writes a compact binary representation of
+ * a PackageList object, which is a lot faster to load than both scanning
+ * the Portage tree and reading a PortageML file. It stores packages and
+ * versions together with the installed and overlay flags, the date,
+ * the slot and the keywords of each version.
+ *
+ * The file consists of fixed-size records in native byte order, so it is
+ * mapped into memory as a whole and read without any parsing step. All
+ * strings are stored only once in a common string table and referenced
+ * by their index, which keeps the file small. Snapshots written on a
+ * machine with another byte order or by another format version are
+ * rejected when loading, and have to be rewritten.
+ *
+ * Before starting the job, you'll have to call setPackageList(),
+ * setFileName() and setAction(). For saving in the background while
+ * the package list is already in use, call compose() beforehand in the
+ * thread that owns the package list.
+ *
+ * @short  A class to read and write a binary snapshot of a PackageList object.
+ */
+class PortageSnapshot : public ThreadedJob
+{
+	Q_OBJECT
+
+public:
+	enum Action {
+		LoadFile,
+		SaveFile
+	};
+
+	PortageSnapshot();
+
+	void setPackageList( TemplatedPackageList<PortagePackage>* packages );
+	void setFileName( const QString& filename );
+	void setAction( PortageSnapshot::Action action );
+	void setSnapshotId( Q_UINT32 snapshotId );
+	Q_UINT32 snapshotId() const;
+
+	bool compose();
+
+signals:
+	/**
+	 * Emitted every once in a while when packages have been added to the
+	 * PackageList object. The arguments specify the number of available
+	 * packages and the number of installed ones.
+	 */
+	void packagesScanned( int packageCountAvailable,
+	                      int packageCountInstalled );
+
+	/**
+	 * Emitted if the package list has successfully been loaded from the
+	 * specified file. The PackageList object now contains exactly the
+	 * packages and versions that have been read from the file.
+	 */
+	void finishedLoading( TemplatedPackageList<PortagePackage>* packages,
+	                      const QString& filename );
+
+	/**
+	 * Emitted if the package list has successfully been saved to the
+	 * specified file.
+	 */
+	void finishedSaving( TemplatedPackageList<PortagePackage>* packages,
+	                     const QString& filename );
+
+protected:
+	JobResult performThread();
+	void customEvent( QCustomEvent* event );
+
+private:
+	enum PortageSnapshotEventType
+	{
+		PackagesScannedEventType = QEvent::User + 14347,
+		FinishedFileEventType = QEvent::User + 14348
+	};
+
+	bool loadFile();
+	bool saveFile();
+
+	const QString& snapshotString( const MappedFile& file, Q_UINT32 index );
+	Q_UINT32 internString( const QString& str );
+
+	void emitFinishedLoading();
+	void emitFinishedSaving();
+	void emitPackagesScanned();
+
+	//! The PackageList object that will be filled (when loading) or read (when saving).
+	TemplatedPackageList<PortagePackage>* m_packages;
+	//! The action that will be performed when running as thread.
+	PortageSnapshot::Action m_action;
+	//! The file that will be read or written.
+	QString m_filename;
+	//! The number identifying the snapshot, stored in the file's header.
+	Q_UINT32 m_snapshotId;
+	//! The file contents built by compose(), until they are written.
+	QByteArray m_composedData;
+
+	//! Strings of the snapshot that have already been decoded, by index.
+	QValueVector<QString> m_strings;
+	//! The string table being built when saving, maps strings to indices.
+	QMap<QString,Q_UINT32> m_stringIndices;
+	//! Shared categories that have already been parsed when loading, by string index.
+	QMap<Q_UINT32,PackageCategory*> m_categories;
+
+	//! A counter that is incremented with each added package.
+	int m_packageCountAvailable;
+	//! A counter that is incremented with each added installed version.
+	int m_packageCountInstalled;
+
+
+	//
+	// nested event classes
+	//
+
+	class FinishedFileEvent : public QCustomEvent
+	{
+	public:
+		FinishedFileEvent() : QCustomEvent( FinishedFileEventType ) {};
+		Action action;
+	};
+
+	class PackagesScannedEvent : public QCustomEvent
+	{
+	public:
+		PackagesScannedEvent() : QCustomEvent( PackagesScannedEventType ) {};
+		int packageCountAvailable;
+		int packageCountInstalled;
+	};
+};
+
+}
+
+#endif // LIBPAKTPORTAGESNAPSHOT_H
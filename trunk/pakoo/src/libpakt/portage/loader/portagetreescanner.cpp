@@ -19,14 +19,22 @@
  ***************************************************************************/
 
 #include "portagetreescanner.h"
+#include "portagetreescanworker.h"
+#include "portagetreestate.h"
 
 #include "../core/portagepackageversion.h"
 #include "../core/portagepackage.h"
 #include "../../base/core/packagelist.h"
 #include "../core/portagecategory.h"
+#include "../core/portageversion.h"
+#include "md5cachereader.h"
+#include "cdbcachereader.h"
+#include "../../base/core/cdbfile.h"
 
 #include <qdatetime.h>
 #include <qapplication.h>
+#include <qptrlist.h>
+#include <qdeepcopy.h>
 
 #include <klocale.h>
 #include <kdebug.h>
@@ -42,12 +50,16 @@
 namespace libpakt {
 
 PortageTreeScanner::PortageTreeScanner()
-: ThreadedJob(),
-  m_rxVersion("(-\\d+(?:\\.\\d+)*[a-z]?)")
+: ThreadedJob()
 {
 	m_packages = NULL;
+	m_state = NULL;
 	m_scanAvailablePackages = true;
 	m_scanInstalledPackages = true;
+	m_incremental = false;
+	m_installedPackagesState = NULL;
+	m_treeChanged = false;
+	m_scannedIncrementally = false;
 }
 
 /**
@@ -91,6 +103,88 @@ void PortageTreeScanner::setScanInstalledPackages(
 	m_scanInstalledPackages = scanInstalledPackages;
 }
 
+/**
+ * Set the PortageTreeState object that will be filled with the
+ * modification times of the scanned directories. For incremental
+ * scanning, it also has to contain the state of the previous scan.
+ * By default, no directory state is used.
+ */
+void PortageTreeScanner::setTreeState( PortageTreeState* state )
+{
+	m_state = state;
+}
+
+/**
+ * Define if you'd like to rescan only the directories that have changed
+ * since the previous scan. This requires a tree state object containing
+ * the state of the previous scan, and a package list containing its
+ * packages. If the state doesn't fit the current settings, the package
+ * list is cleared and the tree is scanned completely.
+ * By default, this is set to false.
+ */
+void PortageTreeScanner::setIncremental( bool incremental )
+{
+	m_incremental = incremental;
+}
+
+/**
+ * Tell the scanner that the installed packages database has already
+ * been scanned into the package list, with the given directory state
+ * as result. A complete scan then takes over that state instead of
+ * scanning the database again. Incremental scans aren't affected,
+ * and neither are scans that don't include installed packages.
+ * By default, this is NULL, which means that the database is scanned.
+ */
+void PortageTreeScanner::setInstalledPackagesState(
+	const PortageTreeState* state )
+{
+	m_installedPackagesState = state;
+}
+
+/**
+ * Returns true if the last scan has found changes in the tree or
+ * has scanned the whole tree, which means that the package list and the
+ * tree state have changed and should be saved again. Returns false
+ * if an incremental scan has found the tree unchanged.
+ */
+bool PortageTreeScanner::treeChanged()
+{
+	return m_treeChanged;
+}
+
+/**
+ * Returns true if the last scan has been an incremental one, which means
+ * that changedVersions() contains all changes since the previous scan.
+ * Returns false if the whole tree has been scanned.
+ */
+bool PortageTreeScanner::scannedIncrementally()
+{
+	return m_scannedIncrementally;
+}
+
+/**
+ * Returns the package versions that have been added or removed by the
+ * last incremental scan, or whose installed or overlay status has changed.
+ * The strings are in the form "category/package-version", like
+ * "sys-kernel/gentoo-sources-2.6.11-r6". After a complete scan,
+ * this list is empty.
+ */
+QStringList PortageTreeScanner::changedVersions()
+{
+	QStringList versions;
+	QValueList<ChangedVersion>::iterator changeIteratorEnd =
+		m_changedVersions.end();
+
+	for( QValueList<ChangedVersion>::iterator changeIterator =
+	         m_changedVersions.begin();
+	     changeIterator != changeIteratorEnd; ++changeIterator )
+	{
+		versions.append( (*changeIterator).category + "/"
+			+ (*changeIterator).package + "-" + (*changeIterator).version );
+	}
+	return versions;
+}
+
 
 /**
  * Load a package list by scanning the portage tree for packages.
@@ -111,6 +205,7 @@ IJob::JobResult PortageTreeScanner::performThread()
 		m_overlayTreeDirs = m_settings->overlayTreeDirectories();
 		m_installedPackagesDir = m_settings->installedPackagesDirectory();
 		m_cacheDir = m_settings->cacheDirectory();
+		m_workerThreadCount = m_settings->workerThreadCount();
 	}
 
 	// initialize package count
@@ -125,6 +220,28 @@ IJob::JobResult PortageTreeScanner::performThread()
 		return Failure;
 	}
 
+	// a previous state is only usable if it's been created
+	// with the same settings
+	bool incremental = ( m_incremental && m_state != NULL
+		&& !m_state->isEmpty()
+		&& m_state->configuration() == configurationString() );
+
+	m_changedVersions.clear();
+	m_treeChanged = !incremental;
+	m_scannedIncrementally = incremental;
+
+	if( !incremental )
+	{
+		// the given package list doesn't fit the tree
+		if( m_incremental )
+			m_packages->clear();
+
+		if( m_state != NULL ) {
+			m_state->clear();
+			m_state->setConfiguration( configurationString() );
+		}
+	}
+
 	QDateTime startTime = QDateTime::currentDateTime();
 	kdDebug() << i18n( "PortageTreeScanner debug output",
 		"PortageTreeScanner::performThread(): "
@@ -134,22 +251,45 @@ IJob::JobResult PortageTreeScanner::performThread()
 	if( m_scanAvailablePackages == true )
 	{
 		// scan the mainline tree
-		if( !scanTree(m_mainlineTreeDir, Mainline) )
+		if( incremental ? !rescanTree(m_mainlineTreeDir, Mainline)
+		                : !scanTree(m_mainlineTreeDir, Mainline) )
 			DO_ABORT;
 
 		// scan the overlay trees
 		for( QStringList::iterator overlayIterator = m_overlayTreeDirs.begin();
 		     overlayIterator != m_overlayTreeDirs.end(); overlayIterator++ )
 		{
-			if( !scanTree(*overlayIterator, Overlay) )
+			if( incremental ? !rescanTree(*overlayIterator, Overlay)
+			                : !scanTree(*overlayIterator, Overlay) )
 				DO_ABORT;
 		}
 	}
 	if( m_scanInstalledPackages == true )
 	{
-		// scan the installed packages database
-		if( !scanTree(m_installedPackagesDir, Installed) )
+		// scan the installed packages database,
+		// unless that has already been done
+		if( !incremental && m_installedPackagesState != NULL )
+		{
+			if( m_state != NULL )
+				m_state->merge( *m_installedPackagesState );
+		}
+		else if( incremental ? !rescanTree(m_installedPackagesDir, Installed)
+		                     : !scanTree(m_installedPackagesDir, Installed) )
+		{
 			DO_ABORT;
+		}
+	}
+
+	if( incremental )
+	{
+		applyChangedVersions();
+
+		kdDebug() << i18n( "PortageTreeScanner debug output. "
+		                   "%1 is the number of changed versions.",
+			"PortageTreeScanner::performThread(): "
+			"Found %1 changed package versions" )
+				.arg( m_changedVersions.count() )
+			<< endl;
 	}
 
 
@@ -169,6 +309,12 @@ IJob::JobResult PortageTreeScanner::performThread()
  * that this object's packages member is a valid PackageList object
  * (especially not NULL).
  *
+ * The category directories are handed out to PortageTreeScanWorker
+ * objects one by one. With only one worker thread, the worker fills
+ * the package list directly in this thread. Otherwise, each worker runs
+ * in its own thread and fills a private package list, and those partial
+ * lists are merged into the main one when all workers have finished.
+ *
  * @param treeDir  The search directory containing package information
  * @param treeType  Defines which directory should be searched.
  *                  This is one of the Mainline, Overlay or Installed
@@ -182,7 +328,6 @@ bool PortageTreeScanner::scanTree( const QString& treeDir,
 {
 	QDateTime startTime = QDateTime::currentDateTime();
 	QDir d;
-	int pos;
 
 	// set the d directory to the treeDir string
 	d.setPath( treeDir );
@@ -190,117 +335,70 @@ bool PortageTreeScanner::scanTree( const QString& treeDir,
 		kdDebug() << i18n( "PortageTreeScanner debug output",
 			"PortageTreeScanner::performThread(): Invalid tree directory." )
 			<< endl;
+		if( m_state != NULL )
+			m_state->setDirectory( treeDir, 0, QStringList() );
 		return true;
 	}
 
-	if( treeType == Installed ) {
-		// Scan only folders, no files
-		// (the package name and version is contained in the folder name)
-		d.setFilter( QDir::Dirs | QDir::NoSymLinks );
-	}
-	else {
-		// Scan folders and (ebuild) files
-		d.setFilter( QDir::Dirs | QDir::NoSymLinks | QDir::Files );
-	}
-	d.setSorting( QDir::Name );
-
-	m_currentPackage = NULL;
-	m_currentVersion = NULL;
+	// Collect the available categories (e.g. sys-kernel)
+	uint modificationTime = PortageTreeState::currentModificationTime( treeDir );
+	QStringList categories = categoryDirectories( treeDir );
 
-	// Iterate through the available categories (e.g. sys-kernel)
-	QStringList categories = d.entryList();
-	QStringList::iterator categoryIteratorEnd = categories.end();
-	for ( QStringList::iterator categoryIterator = categories.begin();
-	      categoryIterator != categoryIteratorEnd; ++categoryIterator )
-	{
-		pos = (*categoryIterator).find('-', 1);
+	if( m_state != NULL )
+		m_state->setDirectory( treeDir, modificationTime, categories );
 
-		// don't process unwanted directories
-		if( pos == -1 ) { // doesn't contain '-', so it's a non-package dir
-			continue;
-		}
+	m_mutex.lock();
+	m_pendingCategories = categories;
+	m_mutex.unlock();
 
-		// Extract the category and subcategory from the folder name
+	int workerCount = QMIN( m_workerThreadCount,
+	                        (int) m_pendingCategories.count() );
 
-		m_currentCategory.setCategory( (*categoryIterator).left(pos),
-		                             (*categoryIterator).mid(pos+1) );
+	if( workerCount <= 1 )
+	{
+		// scan serially, filling m_packages from within this thread
+		PortageTreeScanWorker worker( this, treeDir, treeType,
+		                              m_packages, m_state );
+		worker.scanCategories();
+	}
+	else
+	{
+		QPtrList<PortageTreeScanWorker> workers;
+		workers.setAutoDelete( true );
 
-		// If the Portage cache is searched, do this
-		if( (treeType == Mainline) && ( m_preferredPackageSource == FlatCache ) )
+		for( int i = 0; i < workerCount; i++ )
 		{
-			// Compose the folder name of the current category
-			d.setPath( m_cacheDir + m_mainlineTreeDir + "/"
-			           + (*categoryIterator) );
-			if( !d.exists() )
-				continue;
+			PortageTreeScanWorker* worker = new PortageTreeScanWorker(
+				this, treeDir, treeType,
+				new TemplatedPackageList<PortagePackage>(),
+				(m_state == NULL) ? NULL : new PortageTreeState()
+			);
+			workers.append( worker );
+			worker->start();
+		}
 
-			scanCacheCategory(d);
+		// wait for all workers, and merge their results afterwards
+		PortageTreeScanWorker* worker;
+		for( worker = workers.first(); worker != NULL; worker = workers.next() )
+			worker->wait();
 
-			if( aborting() )
-				return false; // means: abort!
-		}
-		// If the normal portage tree is searched, do that
-		else
+		for( worker = workers.first(); worker != NULL; worker = workers.next() )
 		{
-			// Compose the folder name of the current category
-			d.setPath( treeDir + "/" + (*categoryIterator) );
-			if( !d.exists() ) {
-				continue;
+			if( !aborting() ) {
+				mergePackages( worker->packageList(), treeType );
+				if( m_state != NULL )
+					m_state->merge( *worker->treeState() );
 			}
 
-			// Iterate through the available package dirs
-			// in the current category
-			QStringList packageNames = d.entryList();
-			QStringList::iterator packageNameIterator = packageNames.begin();
-			QStringList::iterator packageNameIteratorEnd = packageNames.end();
-			for( ; packageNameIterator != packageNameIteratorEnd;
-			     ++packageNameIterator )
-			{
-				// no "." or ".." directories
-				if( (*packageNameIterator)[0] == '.' )
-					continue;
-
-				// Compose the folder name of the current package and check it
-				d.setPath( treeDir + "/" + (*categoryIterator)
-				           + "/" + (*packageNameIterator) );
-				if ( !d.exists() ) {
-					continue;
-				}
-
-				if( treeType == Mainline )
-				{
-					m_currentPackage = m_packages->package(
-						new PortageCategory(m_currentCategory),
-						*packageNameIterator
-					);
-					scanTreePackage( d, false );
-				}
-				else if( treeType == Overlay )
-				{
-					m_currentPackage = m_packages->package(
-						new PortageCategory(m_currentCategory),
-						*packageNameIterator
-					);
-					scanTreePackage( d, true );
-				}
-				else // if( treeType == Installed )
-				{
-					scanInstalledPackage( d );
-				}
-
-				// send a status update every 20 packages
-				if( (m_packageCountAvailable + m_packageCountInstalled) % 20
-				    == 0 )
-				{
-					emitPackagesScanned();
-				}
+			delete worker->packageList();
+			delete worker->treeState();
+		}
+	}
 
-				if( aborting() )
-					return false; // means: abort!
+	if( aborting() )
+		return false; // means: abort!
 
-			} // end of package iteration
-		} // end of if( mainline/edb )
-	} // end of category iteration
+	emitPackagesScanned();
 
 	// report success on this tree, using debug output
 	QString treeName;
@@ -330,113 +428,609 @@ bool PortageTreeScanner::scanTree( const QString& treeDir,
 		<< endl;
 
 	return true;
-} // end of scanPackageList()
+} // end of scanTree()
+
+/**
+ * Merge a partial package list that has been filled by a worker thread
+ * into the main package list. Packages that don't exist yet in the main
+ * list are taken over as a whole, otherwise the versions are added to
+ * the existing package, with the installed or overlay flag as if they
+ * had been scanned directly.
+ *
+ * @param packages  The partial package list filled by a worker.
+ * @param treeType  The type of the tree that the worker has scanned.
+ */
+void PortageTreeScanner::mergePackages(
+	TemplatedPackageList<PortagePackage>* packages, TreeType treeType )
+{
+	PackageList::iterator packageIteratorEnd = packages->end();
+
+	for( PackageList::iterator packageIterator = packages->begin();
+	     packageIterator != packageIteratorEnd; ++packageIterator )
+	{
+		PortagePackage* partialPackage =
+			(PortagePackage*) (*packageIterator).data();
+
+		PortagePackage* package = m_packages->find(
+			partialPackage->category(), partialPackage->name() );
+
+		if( package == NULL )
+		{
+			// the package is shared between both lists until
+			// the partial one is deleted
+			m_packages->insert( partialPackage );
+			continue;
+		}
+
+		Package::versioniterator versionIteratorEnd =
+			partialPackage->versionEnd();
+
+		for( Package::versioniterator versionIterator =
+		         partialPackage->versionBegin();
+		     versionIterator != versionIteratorEnd; ++versionIterator )
+		{
+			PortagePackageVersion* version =
+				package->version( (*versionIterator)->version() );
+
+			if( treeType == Installed )
+				version->setInstalled( true );
+			else
+				version->setOverlay( treeType == Overlay );
+		}
+	}
+}
+
+/**
+ * Rescan a search directory for changes since the previous scan, and
+ * record the changed package versions in m_changedVersions. Only the
+ * directories whose modification time has changed are read again.
+ * This function assumes that m_state is not NULL.
+ *
+ * @param treeDir   The search directory containing package information
+ * @param treeType  Defines which directory should be searched.
+ *
+ * @return false if the thread is aborting, true otherwise.
+ */
+bool PortageTreeScanner::rescanTree( const QString& treeDir,
+                                     TreeType treeType )
+{
+	uint modificationTime = PortageTreeState::currentModificationTime( treeDir );
+	QStringList oldCategories = m_state->entries( treeDir );
+	QStringList categories;
+
+	if( m_state->contains( treeDir )
+	    && m_state->modificationTime( treeDir ) == modificationTime )
+	{
+		categories = oldCategories;
+	}
+	else
+	{
+		categories = categoryDirectories( treeDir );
+		m_state->setDirectory( treeDir, modificationTime, categories );
+		m_treeChanged = true;
+	}
+
+	QStringList::iterator categoryIterator;
+
+	// categories that don't exist anymore are treated like empty ones
+	for( categoryIterator = oldCategories.begin();
+	     categoryIterator != oldCategories.end(); ++categoryIterator )
+	{
+		if( !categories.contains( *categoryIterator ) )
+			rescanCategory( treeDir, *categoryIterator, treeType, false );
+	}
+
+	for( categoryIterator = categories.begin();
+	     categoryIterator != categories.end(); ++categoryIterator )
+	{
+		rescanCategory( treeDir, *categoryIterator, treeType, true );
+
+		if( aborting() )
+			return false; // means: abort!
+	}
+	return true;
+}
+
+/**
+ * Rescan a single category directory for changes since the previous scan.
+ * Mainline categories are read from the package source that they have
+ * been scanned from before. If that has changed (because the preferred
+ * cache has got or lost the category), the versions of the previous
+ * source are treated as removed, and the ones of the new source as added.
+ *
+ * @param treeDir          The search directory containing the category.
+ * @param categoryDirName  The category directory name, e.g. "sys-kernel".
+ * @param treeType         Defines which kind of tree is scanned.
+ * @param exists           false if the category has been removed from
+ *                         the tree, true otherwise.
+ */
+void PortageTreeScanner::rescanCategory( const QString& treeDir,
+                                         const QString& categoryDirName,
+                                         TreeType treeType, bool exists )
+{
+	if( treeType != Mainline ) {
+		rescanCategorySource( treeDir, categoryDirName, treeType,
+		                      PortageTree, exists );
+		return;
+	}
+
+	PackageSource oldSource =
+		m_state->categorySource( categoryDirName, m_preferredPackageSource );
+	PackageSource source = exists
+		? currentCategorySource( treeDir, categoryDirName ) : oldSource;
+
+	if( source != oldSource )
+	{
+		rescanCategorySource( treeDir, categoryDirName, treeType,
+		                      oldSource, false );
+		m_state->setCategorySource( categoryDirName, source );
+		m_treeChanged = true;
+	}
+
+	rescanCategorySource( treeDir, categoryDirName, treeType, source, exists );
+}
+
+/**
+ * Find out which package source a mainline category would be read from
+ * by a complete scan. The md5-cache and CDB cache fall back to the tree
+ * if they don't contain the category.
+ */
+PackageSource PortageTreeScanner::currentCategorySource(
+	const QString& treeDir, const QString& categoryDirName )
+{
+	if( m_preferredPackageSource != Md5Cache
+	    && m_preferredPackageSource != CdbCache )
+	{
+		return m_preferredPackageSource;
+	}
+
+	QString path = categorySourcePath( m_preferredPackageSource,
+	                                   treeDir, categoryDirName );
 
+	if( PortageTreeState::currentModificationTime( path ) == 0 )
+		return PortageTree; // doesn't exist
+	else
+		return m_preferredPackageSource;
+}
 
 /**
- * Iterate through a directory's ebuild files and add the found
- * package versions to the m_currentPackage object.
+ * Return the path of the directory (or, for the CDB cache, the file)
+ * that contains a mainline category in the given package source.
+ */
+QString PortageTreeScanner::categorySourcePath( PackageSource source,
+                                                const QString& treeDir,
+                                                const QString& categoryDirName )
+{
+	if( source == FlatCache )
+		return m_cacheDir + m_mainlineTreeDir + "/" + categoryDirName;
+	else if( source == Md5Cache )
+		return Md5CacheReader::categoryPath( treeDir, categoryDirName );
+	else if( source == CdbCache )
+		return CdbCacheReader::categoryFile( m_cacheDir,
+			m_mainlineTreeDir, categoryDirName );
+	else
+		return treeDir + "/" + categoryDirName;
+}
+
+/**
+ * Rescan a single category of one package source for changes since the
+ * previous scan. The package directories of the category are only read
+ * again if their modification time has changed.
  *
- * @param d        The directory containing the ebuilds
- * @param overlay  The value for version->overlay
- *                 (set true if it's an overlay directory)
+ * @param treeDir          The search directory containing the category.
+ * @param categoryDirName  The category directory name, e.g. "sys-kernel".
+ * @param treeType         Defines which kind of tree is scanned.
+ * @param source           The package source that the category is read
+ *                         from, always PortageTree for other trees than
+ *                         the mainline one.
+ * @param exists           false if the category has been removed from
+ *                         the package source, true otherwise.
  */
-void PortageTreeScanner::scanTreePackage( QDir& d, bool overlay )
+void PortageTreeScanner::rescanCategorySource( const QString& treeDir,
+                                               const QString& categoryDirName,
+                                               TreeType treeType,
+                                               PackageSource source,
+                                               bool exists )
 {
-	// Iterate through all ebuild files of the current m_currentPackage
-	QStringList ebuilds = d.entryList( "*.ebuild" );
-	QStringList::iterator ebuildIteratorEnd = ebuilds.end();
+	// Installed packages and the Portage caches contain package versions
+	// directly in the category, the trees contain package directories.
+	bool containsVersions = ( treeType == Installed || source != PortageTree );
+
+	QString categoryPath = categorySourcePath( source, treeDir, categoryDirName );
+
+	QStringList oldEntries = m_state->entries( categoryPath );
+	QStringList entries;
+
+	if( exists )
+	{
+		uint modificationTime =
+			PortageTreeState::currentModificationTime( categoryPath );
+
+		if( m_state->contains( categoryPath )
+		    && m_state->modificationTime( categoryPath ) == modificationTime )
+		{
+			if( containsVersions )
+				return; // nothing has changed in here
+			else
+				entries = oldEntries; // but maybe in the package directories
+		}
+		else
+		{
+			if( source == CdbCache )
+			{
+				// the cache entries are records of a single file
+				entries = CdbCacheReader::entryNames( categoryPath );
+			}
+			else
+			{
+				int filterSpec = QDir::Dirs | QDir::NoSymLinks;
+				if( containsVersions && treeType != Installed )
+					filterSpec |= QDir::Files; // the cache entries are files
+
+				entries = directoryEntries( categoryPath, filterSpec );
+			}
+
+			m_state->setDirectory( categoryPath, modificationTime, entries );
+			m_treeChanged = true;
+		}
+	}
+	else
+	{
+		m_state->removeDirectory( categoryPath );
+		m_treeChanged = true;
+	}
+
+	if( containsVersions ) {
+		addChangedEntries( categoryDirName, oldEntries, entries );
+		return;
+	}
+
+	QStringList::iterator packageIterator;
+
+	// package directories that don't exist anymore
+	for( packageIterator = oldEntries.begin();
+	     packageIterator != oldEntries.end(); ++packageIterator )
+	{
+		if( entries.contains( *packageIterator ) )
+			continue;
+
+		QString packagePath = categoryPath + "/" + (*packageIterator);
+		addChangedEbuilds( categoryDirName, *packageIterator,
+		                   m_state->entries( packagePath ), QStringList() );
+		m_state->removeDirectory( packagePath );
+	}
 
-	for ( QStringList::iterator ebuildIterator = ebuilds.begin();
-	      ebuildIterator != ebuildIteratorEnd; ++ebuildIterator )
+	// existing package directories, only read them if they have changed
+	for( packageIterator = entries.begin();
+	     packageIterator != entries.end(); ++packageIterator )
 	{
-		// add version info
-		m_currentVersion = m_currentPackage->version(
+		QString packagePath = categoryPath + "/" + (*packageIterator);
+		uint modificationTime =
+			PortageTreeState::currentModificationTime( packagePath );
+
+		if( m_state->contains( packagePath )
+		    && m_state->modificationTime( packagePath ) == modificationTime )
+		{
+			continue;
+		}
+
+		QDir d( packagePath, "*.ebuild", QDir::Name,
+		        QDir::Dirs | QDir::NoSymLinks | QDir::Files );
+		QStringList ebuilds = d.entryList();
+
+		addChangedEbuilds( categoryDirName, *packageIterator,
+		                   m_state->entries( packagePath ), ebuilds );
+		m_state->setDirectory( packagePath, modificationTime, ebuilds );
+		m_treeChanged = true;
+	}
+}
+
+/**
+ * Record all old and new entries of a changed category directory that
+ * contains package versions (like "gentoo-sources-2.6.11-r6") as changed
+ * versions. Not only added or removed ones, because cache entries are also
+ * rewritten in place, for example when a version is marked stable.
+ */
+void PortageTreeScanner::addChangedEntries( const QString& categoryDirName,
+                                            const QStringList& oldEntries,
+                                            const QStringList& entries )
+{
+	QStringList changedEntries = oldEntries;
+	QStringList::const_iterator entryIterator;
+
+	for( entryIterator = entries.begin();
+	     entryIterator != entries.end(); ++entryIterator )
+	{
+		if( !oldEntries.contains( *entryIterator ) )
+			changedEntries.append( *entryIterator );
+	}
+
+	for( entryIterator = changedEntries.begin();
+	     entryIterator != changedEntries.end(); ++entryIterator )
+	{
+		int packageNameEndIndex =
+			PortageVersion::versionSeparator( *entryIterator );
+		if( packageNameEndIndex == -1 )
+			continue;
+
+		addChangedVersion( categoryDirName,
+			(*entryIterator).left( packageNameEndIndex ),
+			(*entryIterator).mid( packageNameEndIndex + 1 )
+		);
+	}
+}
+
+/**
+ * Record all old and new ebuilds of a changed package directory as changed
+ * versions. Like with addChangedEntries(), ebuilds that have been edited
+ * in place are included.
+ */
+void PortageTreeScanner::addChangedEbuilds( const QString& categoryDirName,
+                                            const QString& packageName,
+                                            const QStringList& oldEbuilds,
+                                            const QStringList& ebuilds )
+{
+	QStringList changedEbuilds = oldEbuilds;
+	QStringList::const_iterator ebuildIterator;
+
+	for( ebuildIterator = ebuilds.begin();
+	     ebuildIterator != ebuilds.end(); ++ebuildIterator )
+	{
+		if( !oldEbuilds.contains( *ebuildIterator ) )
+			changedEbuilds.append( *ebuildIterator );
+	}
+
+	for( ebuildIterator = changedEbuilds.begin();
+	     ebuildIterator != changedEbuilds.end(); ++ebuildIterator )
+	{
+		addChangedVersion( categoryDirName, packageName,
 			(*ebuildIterator).mid( // extract the package version string
-				(m_currentPackage->name()).length() + 1,
-				(*ebuildIterator).length() - 7
-					- ((m_currentPackage->name()).length() + 1)
+				packageName.length() + 1,
+				(*ebuildIterator).length() - 7 - (packageName.length() + 1)
 			)
 		);
-		m_currentVersion->setOverlay( overlay );
 	}
-	m_packageCountAvailable++;
-} // end of scanTreePackage()
+}
 
 /**
- * Search a category in the installed packages database (edb/dep/...)
- * and add the found packages and package versions the package list.
- *
- * @param d  The category directory containing the package files
+ * Record a package version that has been added to, changed in or removed
+ * from one of the trees.
  */
-void PortageTreeScanner::scanCacheCategory( QDir& d )
+void PortageTreeScanner::addChangedVersion( const QString& categoryDirName,
+                                            const QString& packageName,
+                                            const QString& versionString )
 {
-	QString packageName;
+	ChangedVersion change;
+	change.category = categoryDirName;
+	change.package = packageName;
+	change.version = versionString;
+	m_changedVersions.append( change );
+}
 
-	// Iterate through all ebuild files of the current m_currentPackage
-	QStringList files = d.entryList();
-	QStringList::iterator fileIteratorEnd = files.end();
+/**
+ * Bring the package list up to date with the changed versions that
+ * the incremental scan has found. For each of them, the tree state
+ * knows in which trees it exists now, so the version is either removed
+ * from the package list or gets the appropriate installed and overlay
+ * flags, like it would have been in a complete scan. The details of the
+ * remaining versions are read again from the md5-cache or CDB cache,
+ * or left to the PortagePackageLoader for the other package sources.
+ */
+void PortageTreeScanner::applyChangedVersions()
+{
+	// the changes of a category come one after another,
+	// so its CDB file only has to be opened once
+	CdbFile cdbFile;
+	QString cdbFilename;
 
-	for ( QStringList::iterator fileIterator = files.begin();
-	      fileIterator != fileIteratorEnd; ++fileIterator )
+	QValueList<ChangedVersion>::iterator changeIteratorEnd =
+		m_changedVersions.end();
+
+	for( QValueList<ChangedVersion>::iterator changeIterator =
+	         m_changedVersions.begin();
+	     changeIterator != changeIteratorEnd; ++changeIterator )
 	{
-		// no "." or ".." directories
-		if( (*fileIterator)[0] == '.' )
-			continue;
+		const ChangedVersion& change = *changeIterator;
+		QString packageVersionName = change.package + "-" + change.version;
 
+		bool inMainline = false, inOverlay = false, installed = false;
 
-		int packageNameEndIndex = (*fileIterator).findRev( m_rxVersion );
-		packageName = (*fileIterator).left( packageNameEndIndex );
+		// the category may have been read from the tree instead of the cache
+		PackageSource source = m_state->categorySource(
+			change.category, m_preferredPackageSource );
 
-		// See if it's a new package (if not, it's just another version)
-		if( (m_currentPackage == NULL)
-		    || (packageName != m_currentPackage->name()) )
+		if( m_scanAvailablePackages == true )
 		{
-			// Separate package name from version
-			m_currentPackage = m_packages->package(
-				new PortageCategory( m_currentCategory ),
-				packageName
-			);
-			m_packageCountAvailable++;
+			if( source == PortageTree ) {
+				inMainline = m_state->containsEntry( m_mainlineTreeDir
+					+ "/" + change.category + "/" + change.package,
+					packageVersionName + ".ebuild" );
+			}
+			else {
+				inMainline = m_state->containsEntry(
+					categorySourcePath( source, m_mainlineTreeDir,
+					                    change.category ),
+					packageVersionName );
+			}
 
-			// send a status update every 20 packages
-			if( (m_packageCountAvailable + m_packageCountInstalled) % 20
-			    == 0 )
+			for( QStringList::iterator overlayIterator =
+			         m_overlayTreeDirs.begin();
+			     overlayIterator != m_overlayTreeDirs.end(); ++overlayIterator )
 			{
-				emitPackagesScanned();
+				if( m_state->containsEntry( *overlayIterator
+				        + "/" + change.category + "/" + change.package,
+				        packageVersionName + ".ebuild" ) )
+				{
+					inOverlay = true;
+					break;
+				}
 			}
 		}
+		if( m_scanInstalledPackages == true )
+		{
+			installed = m_state->containsEntry(
+				m_installedPackagesDir + "/" + change.category,
+				packageVersionName );
+		}
 
-		// extract the package version string, and add version info
-		m_currentVersion = m_currentPackage->version(
-			(*fileIterator).mid( (m_currentPackage->name()).length() + 1 )
-		);
-		m_currentVersion->setOverlay( false );
+		int pos = change.category.find('-', 1);
+		PackageCategory* category = PackageCategory::shared(
+			new PortageCategory( change.category.left(pos),
+			                     change.category.mid(pos+1) ) );
+
+		if( inMainline || inOverlay || installed )
+		{
+			PortagePackageVersion* version = m_packages->package(
+				category, change.package )->version( change.version );
+
+			version->setInstalled( installed );
+			version->setOverlay( inOverlay );
+
+			bool hasDetailedInfo = false;
+
+			if( inMainline && source == Md5Cache )
+			{
+				hasDetailedInfo = Md5CacheReader::readEntry( version,
+					categorySourcePath( source, m_mainlineTreeDir,
+					                    change.category )
+					+ "/" + packageVersionName );
+			}
+			else if( inMainline && source == CdbCache )
+			{
+				QString filename = categorySourcePath( source,
+					m_mainlineTreeDir, change.category );
+
+				if( filename != cdbFilename ) {
+					cdbFile.open( filename );
+					cdbFilename = filename;
+				}
+				if( cdbFile.isOpen() ) {
+					hasDetailedInfo = CdbCacheReader::readEntry(
+						version, cdbFile, packageVersionName );
+				}
+			}
+
+			// otherwise, the details are loaded again when they're needed
+			version->setHasDetailedInfo( hasDetailedInfo );
+			continue;
+		}
+
+		PortagePackage* package = m_packages->find( category, change.package );
+		if( package != NULL )
+		{
+			// the version has vanished from all trees
+			package->removeVersion( change.version );
+			if( !package->containsVersions() )
+				m_packages->remove( category, change.package );
+		}
+	}
+}
+
+/**
+ * Retrieve the names of the category directories in a tree,
+ * sorted by name. Directories that don't contain a '-' (like "profiles"
+ * or "distfiles") are left out, as they are no categories.
+ */
+QStringList PortageTreeScanner::categoryDirectories( const QString& treeDir )
+{
+	QStringList categories = directoryEntries( treeDir,
+	                                           QDir::Dirs | QDir::NoSymLinks );
+	QStringList::iterator categoryIterator = categories.begin();
+
+	while( categoryIterator != categories.end() )
+	{
+		// doesn't contain '-', so it's a non-package dir
+		if( (*categoryIterator).find('-', 1) == -1 )
+			categoryIterator = categories.remove( categoryIterator );
+		else
+			++categoryIterator;
+	}
+	return categories;
+}
+
+/**
+ * Retrieve the entries of a directory, sorted by name,
+ * without the "." and ".." entries and other hidden ones.
+ *
+ * @param directory   The directory that will be read.
+ * @param filterSpec  A combination of QDir::FilterSpec values.
+ */
+QStringList PortageTreeScanner::directoryEntries( const QString& directory,
+                                                  int filterSpec )
+{
+	QDir d( directory, QString::null, QDir::Name, filterSpec );
+	if( directory.isEmpty() || !d.exists() )
+		return QStringList();
+
+	QStringList entries = d.entryList();
+	QStringList::iterator entryIterator = entries.begin();
+
+	while( entryIterator != entries.end() )
+	{
+		if( (*entryIterator)[0] == '.' )
+			entryIterator = entries.remove( entryIterator );
+		else
+			++entryIterator;
 	}
-} // end of scanCacheCategory()
+	return entries;
+}
 
 /**
- * Extract package name, version, and modification date from a directory name,
- * and add a corresponding package to the package list.
+ * Compose a string describing the settings that influence the scan.
+ * A tree state is only valid for a scan with the same settings.
+ */
+QString PortageTreeScanner::configurationString()
+{
+	return m_mainlineTreeDir + "\n"
+		+ m_overlayTreeDirs.join(":") + "\n"
+		+ m_installedPackagesDir + "\n"
+		+ m_cacheDir + "\n"
+		+ QString::number( (int) m_preferredPackageSource ) + "\n"
+		+ ( m_scanAvailablePackages ? "available " : "" )
+		+ ( m_scanInstalledPackages ? "installed" : "" );
+}
+
+/**
+ * Called by the workers to get the next category directory that is
+ * still to be scanned. The returned string is a deep copy, so it can
+ * safely be used in the worker's thread.
  *
- * @param d  The directory named after the (installed) package
+ * @param categoryDirName  Is set to the next category directory name.
+ * @return  true if a category has been handed out, false if there are
+ *          no more categories left (or the scanner is aborting).
  */
-void PortageTreeScanner::scanInstalledPackage( QDir& d )
+bool PortageTreeScanner::takeCategory( QString& categoryDirName )
 {
-	QString dirName = d.dirName();
-	int packageNameEndIndex = dirName.findRev( m_rxVersion );
-
-	// Separate package name from version
-	m_currentPackage = m_packages->package(
-		new PortageCategory( m_currentCategory ),
-		dirName.left( packageNameEndIndex ) // package name
-	);
-	m_currentVersion = m_currentPackage->version(
-		dirName.mid( packageNameEndIndex + 1 )
-	);
-	m_currentVersion->setInstalled( true );
-
-	m_packageCountInstalled++;
+	QMutexLocker locker( &m_mutex );
+
+	if( m_pendingCategories.isEmpty() || aborting() )
+		return false;
+
+	categoryDirName = QDeepCopy<QString>( m_pendingCategories.first() );
+	m_pendingCategories.remove( m_pendingCategories.begin() );
+	return true;
+}
+
+/**
+ * Called by the workers each time they have found a package.
+ * Increments the appropriate counter, and sends a status update
+ * every 20 packages.
+ *
+ * @param installed  true if the package has been found in the installed
+ *                   packages database, false if it's an available one.
+ */
+void PortageTreeScanner::countScannedPackage( bool installed )
+{
+	QMutexLocker locker( &m_mutex );
+
+	if( installed )
+		m_packageCountInstalled++;
+	else
+		m_packageCountAvailable++;
+
+	// send a status update every 20 packages
+	if( (m_packageCountAvailable + m_packageCountInstalled) % 20 == 0 )
+		emitPackagesScanned();
 }
 
 
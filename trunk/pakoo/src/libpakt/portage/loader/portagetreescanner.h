@@ -27,8 +27,8 @@
 #include "../../base/core/packagelist.h"
 
 #include <qstringlist.h>
-#include <qdir.h>
-#include <qregexp.h>
+#include <qvaluelist.h>
+#include <qmutex.h>
 
 
 namespace libpakt {
@@ -36,6 +36,8 @@ namespace libpakt {
 class PortagePackageVersion;
 class PortagePackage;
 class PortageSettings;
+class PortageTreeScanWorker;
+class PortageTreeState;
 
 /**
  * PortageTreeScanner is an optionally threaded class for scanning the portage
@@ -46,11 +48,27 @@ class PortageSettings;
  * After setting up the scanner (using the setPackageList member function)
  * you can call start() or perform() to begin scanning.
  *
+ * If the settings object specifies more than one worker thread, the
+ * categories of each tree are distributed among PortageTreeScanWorker
+ * threads that scan them concurrently. The partial package lists are
+ * merged into the given PackageList object afterwards.
+ *
+ * When given a PortageTreeState object, the scanner records the
+ * modification time of each directory it reads. If incremental scanning
+ * is enabled and the state matches the current settings, the scanner
+ * only rereads directories whose modification time has changed, and
+ * patches the given package list (which is expected to contain the
+ * packages of the previous scan) instead of filling it from scratch.
+ * If the installed packages have already been scanned into the package
+ * list beforehand, a complete scan can take them over instead of
+ * reading the installed packages database a second time.
+ *
  * @short  A threaded class for scanning the portage tree for packages.
  */
 class PortageTreeScanner : public ThreadedJob
 {
 	Q_OBJECT
+	friend class PortageTreeScanWorker;
 
 public:
 	PortageTreeScanner();
@@ -63,6 +81,14 @@ public:
 	void setScanAvailablePackages( bool scanAvailablePackages );
 	void setScanInstalledPackages( bool scanInstalledPackages );
 
+	// incremental scanning
+	void setTreeState( PortageTreeState* state );
+	void setIncremental( bool incremental );
+	void setInstalledPackagesState( const PortageTreeState* state );
+	bool treeChanged();
+	bool scannedIncrementally();
+	QStringList changedVersions();
+
 signals:
 	/**
 	 * Emitted every once in a while when packages have been added to the
@@ -102,10 +128,54 @@ private:
 		FinishedLoadingEventType = QEvent::User + 14341
 	};
 
+	/**
+	 * A package version that has been added or removed in one of the
+	 * trees during an incremental scan.
+	 */
+	struct ChangedVersion
+	{
+		QString category;
+		QString package;
+		QString version;
+	};
+
 	bool scanTree( const QString& treeDir, PortageTreeScanner::TreeType treeType );
-	void scanTreePackage( QDir& d, bool overlay );
-	void scanCacheCategory( QDir& d );
-	void scanInstalledPackage( QDir& d );
+	void mergePackages( TemplatedPackageList<PortagePackage>* packages,
+	                    PortageTreeScanner::TreeType treeType );
+
+	bool rescanTree( const QString& treeDir,
+	                 PortageTreeScanner::TreeType treeType );
+	void rescanCategory( const QString& treeDir,
+	                     const QString& categoryDirName,
+	                     PortageTreeScanner::TreeType treeType,
+	                     bool exists );
+	void rescanCategorySource( const QString& treeDir,
+	                           const QString& categoryDirName,
+	                           PortageTreeScanner::TreeType treeType,
+	                           PackageSource source, bool exists );
+	PackageSource currentCategorySource( const QString& treeDir,
+	                                     const QString& categoryDirName );
+	QString categorySourcePath( PackageSource source, const QString& treeDir,
+	                            const QString& categoryDirName );
+	void addChangedEntries( const QString& categoryDirName,
+	                        const QStringList& oldEntries,
+	                        const QStringList& entries );
+	void addChangedEbuilds( const QString& categoryDirName,
+	                        const QString& packageName,
+	                        const QStringList& oldEbuilds,
+	                        const QStringList& ebuilds );
+	void addChangedVersion( const QString& categoryDirName,
+	                        const QString& packageName,
+	                        const QString& versionString );
+	void applyChangedVersions();
+
+	QStringList categoryDirectories( const QString& treeDir );
+	QStringList directoryEntries( const QString& directory, int filterSpec );
+	QString configurationString();
+
+	// called by the workers, possibly from several threads at once
+	bool takeCategory( QString& categoryDirName );
+	void countScannedPackage( bool installed );
 
 	void emitPackagesScanned();
 	void emitFinishedLoading();
@@ -114,6 +184,8 @@ private:
 	TemplatedPackageList<PortagePackage>* m_packages;
 	//! The PortageSettings object used for retrieving directories and cache info.
 	PortageSettings* m_settings;
+	//! The directory state object that will be filled, or NULL.
+	PortageTreeState* m_state;
 
 	//! The directory where PortageTreeScanner tries to find packages.
 	QString m_mainlineTreeDir;
@@ -126,27 +198,33 @@ private:
 
 	//! Set to what type of Portage cache to use.
 	PackageSource m_preferredPackageSource;
+	//! The number of worker threads that scan categories concurrently.
+	int m_workerThreadCount;
 
 	//! Defines if mainline and overlay trees are searched.
 	bool m_scanAvailablePackages;
 	//! Defines if the installed packages database is searched.
 	bool m_scanInstalledPackages;
+	//! Defines if only changed directories should be scanned, if possible.
+	bool m_incremental;
+	//! The state of an earlier scan of the installed packages database, or NULL.
+	const PortageTreeState* m_installedPackagesState;
+	//! true if the last scan has found changes, or has been a complete one.
+	bool m_treeChanged;
+	//! true if the last scan has only rescanned the changed directories.
+	bool m_scannedIncrementally;
+	//! The versions that have been found changed by an incremental scan.
+	QValueList<ChangedVersion> m_changedVersions;
 
 	//! A counter, incremented with each found available package.
 	int m_packageCountAvailable;
 	//! A counter, incremented with each found installed package.
 	int m_packageCountInstalled;
 
-	//! The name of the current category
-	PortageCategory m_currentCategory;
-
-	//! An object used for temporarily storing package information.
-	PortagePackage* m_currentPackage;
-	//! An object used for temporarily storing package version information.
-	PortagePackageVersion* m_currentVersion;
-
-	//! Regexp for ebuild names (the part before the version string)
-	QRegExp m_rxVersion;
+	//! The category directories of the current tree that are not scanned yet.
+	QStringList m_pendingCategories;
+	//! Guards m_pendingCategories and the package counters.
+	QMutex m_mutex;
 
 
 	//
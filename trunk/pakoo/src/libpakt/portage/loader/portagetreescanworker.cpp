@@ -0,0 +1,497 @@
+/***************************************************************************
+ *   Copyright (C) 2004 by karye <karye@users.sourceforge.net>             *
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "portagetreescanworker.h"
+#include "portagetreestate.h"
+
+#include "../core/portagepackageversion.h"
+#include "../core/portagepackage.h"
+#include "../../base/core/packagelist.h"
+#include "../core/portagecategory.h"
+#include "../core/portageversion.h"
+#include "../../base/core/directoryreader.h"
+#include "md5cachereader.h"
+#include "cdbcachereader.h"
+#include "../../base/core/cdbfile.h"
+
+#include <qdeepcopy.h>
+#include <qfile.h>
+
+
+namespace libpakt {
+
+/**
+ * Initialize this worker. The directory strings are copied deeply from
+ * the scanner, so that the worker can safely use them in its own thread.
+ *
+ * @param scanner   The scanner handing out category names to this worker.
+ * @param treeDir   The directory of the tree that will be scanned.
+ * @param treeType  Defines which kind of tree is scanned.
+ * @param packages  The PackageList object that will be filled.
+ * @param state     The directory state object that will be filled,
+ *                  or NULL if directory states are not needed.
+ */
+PortageTreeScanWorker::PortageTreeScanWorker(
+	PortageTreeScanner* scanner, const QString& treeDir,
+	PortageTreeScanner::TreeType treeType,
+	TemplatedPackageList<PortagePackage>* packages, PortageTreeState* state )
+: QThread()
+{
+	m_scanner = scanner;
+	m_packages = packages;
+	m_state = state;
+	m_treeType = treeType;
+	m_treeDir = QDeepCopy<QString>( treeDir );
+	m_cacheDir = QDeepCopy<QString>( scanner->m_cacheDir );
+	m_mainlineTreeDir = QDeepCopy<QString>( scanner->m_mainlineTreeDir );
+	m_preferredPackageSource = scanner->m_preferredPackageSource;
+	m_currentCategory = NULL;
+	m_currentPackage = NULL;
+	m_currentVersion = NULL;
+}
+
+/**
+ * Return the PackageList object that is filled by this worker.
+ */
+TemplatedPackageList<PortagePackage>* PortageTreeScanWorker::packageList()
+{
+	return m_packages;
+}
+
+/**
+ * Return the directory state object that is filled by this worker,
+ * or NULL if there is none.
+ */
+PortageTreeState* PortageTreeScanWorker::treeState()
+{
+	return m_state;
+}
+
+/**
+ * Executed when the worker is started as thread.
+ */
+void PortageTreeScanWorker::run()
+{
+	scanCategories();
+}
+
+/**
+ * Scan categories until the scanner has got no more left,
+ * or until it is aborting.
+ */
+void PortageTreeScanWorker::scanCategories()
+{
+	QString categoryDirName;
+
+	while( m_scanner->takeCategory(categoryDirName) )
+	{
+		scanCategory( categoryDirName );
+
+		if( m_scanner->aborting() )
+			return;
+	}
+}
+
+/**
+ * Scan a single category directory of the tree (or of the cache, if the
+ * mainline tree is read from the Portage cache) and add the found
+ * packages to the package list.
+ *
+ * @param categoryDirName  The category directory name, e.g. "sys-kernel".
+ */
+void PortageTreeScanWorker::scanCategory( const QString& categoryDirName )
+{
+	QDir d;
+	int pos = categoryDirName.find('-', 1);
+
+	if( m_treeType == PortageTreeScanner::Installed ) {
+		// Scan only folders, no files
+		// (the package name and version is contained in the folder name)
+		d.setFilter( QDir::Dirs | QDir::NoSymLinks );
+	}
+	else {
+		// Scan folders and (ebuild) files
+		d.setFilter( QDir::Dirs | QDir::NoSymLinks | QDir::Files );
+	}
+	d.setSorting( QDir::Name );
+
+	// Extract the category and subcategory from the folder name,
+	// and retrieve the category object shared by all its packages
+	m_currentCategory = PackageCategory::shared( new PortageCategory(
+		categoryDirName.left(pos), categoryDirName.mid(pos+1) ) );
+	m_currentPackage = NULL;
+	m_currentVersion = NULL;
+
+	// If the Portage cache is searched, do this
+	if( (m_treeType == PortageTreeScanner::Mainline)
+	    && ( m_preferredPackageSource == FlatCache ) )
+	{
+		// Compose the folder name of the current category
+		QString cachePath = m_cacheDir + m_mainlineTreeDir + "/" + categoryDirName;
+		d.setPath( cachePath );
+		if( !d.exists() )
+			return;
+
+		scanCacheCategory( d, cachePath );
+		setCategorySource( categoryDirName, FlatCache );
+		return;
+	}
+
+	// The CDB cache has one file per category, containing all the details
+	if( (m_treeType == PortageTreeScanner::Mainline)
+	    && ( m_preferredPackageSource == CdbCache ) )
+	{
+		if( scanCdbCacheCategory( CdbCacheReader::categoryFile(
+		        m_cacheDir, m_mainlineTreeDir, categoryDirName ) ) )
+		{
+			setCategorySource( categoryDirName, CdbCache );
+			return;
+		}
+	}
+
+	// The md5-cache contains the package details as well,
+	// fall back to the tree if the cache is missing.
+	if( (m_treeType == PortageTreeScanner::Mainline)
+	    && ( m_preferredPackageSource == Md5Cache ) )
+	{
+		if( scanMd5CacheCategory(
+		        Md5CacheReader::categoryPath( m_treeDir, categoryDirName ) ) )
+		{
+			setCategorySource( categoryDirName, Md5Cache );
+			return;
+		}
+	}
+
+	// If the normal portage tree is searched, do that.
+	// Compose the folder name of the current category
+	QString categoryPath = m_treeDir + "/" + categoryDirName;
+	d.setPath( categoryPath );
+	uint modificationTime =
+		PortageTreeState::currentModificationTime( categoryPath );
+	if( !d.exists() )
+		return;
+
+	// Iterate through the available package dirs in the current category
+	QStringList packageNames = d.entryList();
+	QStringList scannedPackageNames;
+	QStringList::iterator packageNameIterator = packageNames.begin();
+	QStringList::iterator packageNameIteratorEnd = packageNames.end();
+	for( ; packageNameIterator != packageNameIteratorEnd;
+	     ++packageNameIterator )
+	{
+		// no "." or ".." directories
+		if( (*packageNameIterator)[0] == '.' )
+			continue;
+
+		// Compose the folder name of the current package and check it
+		QString packagePath = categoryPath + "/" + (*packageNameIterator);
+		d.setPath( packagePath );
+		if ( !d.exists() ) {
+			continue;
+		}
+		scannedPackageNames.append( *packageNameIterator );
+
+		if( m_treeType == PortageTreeScanner::Installed )
+		{
+			scanInstalledPackage( d );
+		}
+		else
+		{
+			m_currentPackage = m_packages->package(
+				m_currentCategory,
+				*packageNameIterator
+			);
+			scanTreePackage( d, packagePath,
+			                 m_treeType == PortageTreeScanner::Overlay );
+		}
+
+		if( m_scanner->aborting() )
+			return;
+	}
+
+	if( m_state != NULL ) {
+		m_state->setDirectory( categoryPath, modificationTime,
+		                       scannedPackageNames );
+	}
+	setCategorySource( categoryDirName, PortageTree );
+}
+
+/**
+ * Record the package source that a category has been read from in the
+ * directory state, so that an incremental rescan looks at the same place.
+ * Only the sources of the mainline tree are recorded, the other trees
+ * are always read directly.
+ */
+void PortageTreeScanWorker::setCategorySource( const QString& categoryDirName,
+                                               PackageSource source )
+{
+	if( m_state != NULL && m_treeType == PortageTreeScanner::Mainline )
+		m_state->setCategorySource( categoryDirName, source );
+}
+
+/**
+ * Iterate through a directory's ebuild files and add the found
+ * package versions to the m_currentPackage object.
+ *
+ * @param d        The directory containing the ebuilds
+ * @param path     The directory path, as it's stored in the directory state
+ * @param overlay  The value for version->overlay
+ *                 (set true if it's an overlay directory)
+ */
+void PortageTreeScanWorker::scanTreePackage( QDir& d, const QString& path,
+                                             bool overlay )
+{
+	uint modificationTime = ( m_state == NULL )
+		? 0 : PortageTreeState::currentModificationTime( path );
+
+	// Iterate through all ebuild files of the current m_currentPackage
+	QStringList ebuilds = d.entryList( "*.ebuild" );
+	QStringList::iterator ebuildIteratorEnd = ebuilds.end();
+
+	for ( QStringList::iterator ebuildIterator = ebuilds.begin();
+	      ebuildIterator != ebuildIteratorEnd; ++ebuildIterator )
+	{
+		// add version info
+		m_currentVersion = m_currentPackage->version(
+			(*ebuildIterator).mid( // extract the package version string
+				(m_currentPackage->name()).length() + 1,
+				(*ebuildIterator).length() - 7
+					- ((m_currentPackage->name()).length() + 1)
+			)
+		);
+		m_currentVersion->setOverlay( overlay );
+	}
+
+	if( m_state != NULL )
+		m_state->setDirectory( path, modificationTime, ebuilds );
+
+	m_scanner->countScannedPackage( false );
+} // end of scanTreePackage()
+
+/**
+ * Search a category in the Portage cache (edb/dep/...)
+ * and add the found packages and package versions the package list.
+ *
+ * @param d     The category directory containing the package files
+ * @param path  The directory path, as it's stored in the directory state
+ */
+void PortageTreeScanWorker::scanCacheCategory( QDir& d, const QString& path )
+{
+	uint modificationTime = ( m_state == NULL )
+		? 0 : PortageTreeState::currentModificationTime( path );
+	QString packageName;
+	QStringList scannedFiles;
+
+	// Iterate through all ebuild files of the current m_currentPackage
+	QStringList files = d.entryList();
+	QStringList::iterator fileIteratorEnd = files.end();
+
+	for ( QStringList::iterator fileIterator = files.begin();
+	      fileIterator != fileIteratorEnd; ++fileIterator )
+	{
+		// no "." or ".." directories
+		if( (*fileIterator)[0] == '.' )
+			continue;
+
+		int packageNameEndIndex =
+			PortageVersion::versionSeparator( *fileIterator );
+		if( packageNameEndIndex == -1 )
+			continue;
+
+		scannedFiles.append( *fileIterator );
+		packageName = (*fileIterator).left( packageNameEndIndex );
+
+		// See if it's a new package (if not, it's just another version)
+		if( (m_currentPackage == NULL)
+		    || (packageName != m_currentPackage->name()) )
+		{
+			// Separate package name from version
+			m_currentPackage = m_packages->package(
+				m_currentCategory,
+				packageName
+			);
+			m_scanner->countScannedPackage( false );
+		}
+
+		// extract the package version string, and add version info
+		m_currentVersion = m_currentPackage->version(
+			(*fileIterator).mid( (m_currentPackage->name()).length() + 1 )
+		);
+		m_currentVersion->setOverlay( false );
+	}
+
+	if( m_state != NULL )
+		m_state->setDirectory( path, modificationTime, scannedFiles );
+} // end of scanCacheCategory()
+
+/**
+ * Read a category of the tree's md5-cache and add the found packages
+ * and package versions to the package list. The cache files are read
+ * right away, so that the versions contain their details afterwards
+ * and don't need to be scanned by the PortagePackageLoader anymore.
+ *
+ * @param path  The category directory in the md5-cache.
+ * @return  false if the directory doesn't exist, true otherwise.
+ */
+bool PortageTreeScanWorker::scanMd5CacheCategory( const QString& path )
+{
+	uint modificationTime = ( m_state == NULL )
+		? 0 : PortageTreeState::currentModificationTime( path );
+
+	QStringList files;
+	if( DirectoryReader::entryList( path, files, DirectoryReader::Files )
+	    == false )
+	{
+		return false;
+	}
+
+	QStringList scannedFiles;
+	QStringList::iterator fileIteratorEnd = files.end();
+
+	for( QStringList::iterator fileIterator = files.begin();
+	     fileIterator != fileIteratorEnd; ++fileIterator )
+	{
+		int packageNameEndIndex =
+			PortageVersion::versionSeparator( *fileIterator );
+		if( packageNameEndIndex == -1 )
+			continue;
+
+		scannedFiles.append( *fileIterator );
+
+		// See if it's a new package (if not, it's just another version)
+		if( (m_currentPackage == NULL)
+		    || (m_currentPackage->name().length()
+		        != (uint) packageNameEndIndex)
+		    || ((*fileIterator).startsWith( m_currentPackage->name() ) == false) )
+		{
+			m_currentPackage = m_packages->package(
+				m_currentCategory,
+				(*fileIterator).left( packageNameEndIndex )
+			);
+			m_scanner->countScannedPackage( false );
+		}
+
+		m_currentVersion = m_currentPackage->version(
+			(*fileIterator).mid( packageNameEndIndex + 1 ) );
+		m_currentVersion->setOverlay( false );
+
+		if( Md5CacheReader::readEntry(
+		        m_currentVersion, path + "/" + (*fileIterator) ) )
+		{
+			m_currentVersion->setHasDetailedInfo( true );
+		}
+
+		if( m_scanner->aborting() )
+			return true;
+	}
+
+	if( m_state != NULL )
+		m_state->setDirectory( path, modificationTime, scannedFiles );
+
+	return true;
+} // end of scanMd5CacheCategory()
+
+/**
+ * Read the CDB cache file of a category and add the found packages
+ * and package versions to the package list. Like with the md5-cache,
+ * the package details are stored right away.
+ *
+ * @param filename  The CDB file containing the category.
+ * @return  false if the file can't be opened, true otherwise.
+ */
+bool PortageTreeScanWorker::scanCdbCacheCategory( const QString& filename )
+{
+	uint modificationTime = ( m_state == NULL )
+		? 0 : PortageTreeState::currentModificationTime( filename );
+
+	CdbFile file;
+	if( file.open(filename) == false )
+		return false;
+
+	QStringList scannedEntries;
+	uint position = 0;
+	const char* key;
+	const char* data;
+	uint keyLength, dataLength;
+
+	while( file.nextRecord( &position, &key, &keyLength, &data, &dataLength ) )
+	{
+		QString entry = QFile::decodeName( QCString(key, keyLength + 1) );
+
+		int packageNameEndIndex = PortageVersion::versionSeparator( entry );
+		if( packageNameEndIndex == -1 )
+			continue;
+
+		scannedEntries.append( entry );
+
+		// Records are not necessarily sorted, so look up the package
+		// each time (which is a hash lookup for existing ones),
+		// and only count it if it has just been created
+		int packageCount = m_packages->count();
+		m_currentPackage = m_packages->package(
+			m_currentCategory, entry.left( packageNameEndIndex ) );
+		if( m_packages->count() != packageCount )
+			m_scanner->countScannedPackage( false );
+
+		m_currentVersion = m_currentPackage->version(
+			entry.mid( packageNameEndIndex + 1 ) );
+		m_currentVersion->setOverlay( false );
+
+		CdbCacheReader::parseEntry( m_currentVersion, data, dataLength );
+		m_currentVersion->setHasDetailedInfo( true );
+
+		if( m_scanner->aborting() )
+			return true;
+	}
+
+	if( m_state != NULL ) {
+		scannedEntries.sort();
+		m_state->setDirectory( filename, modificationTime, scannedEntries );
+	}
+	return true;
+} // end of scanCdbCacheCategory()
+
+/**
+ * Extract package name, version, and modification date from a directory name,
+ * and add a corresponding package to the package list.
+ *
+ * @param d  The directory named after the (installed) package
+ */
+void PortageTreeScanWorker::scanInstalledPackage( QDir& d )
+{
+	QString dirName = d.dirName();
+	int packageNameEndIndex = PortageVersion::versionSeparator( dirName );
+	if( packageNameEndIndex == -1 )
+		return;
+
+	// Separate package name from version
+	m_currentPackage = m_packages->package(
+		m_currentCategory,
+		dirName.left( packageNameEndIndex ) // package name
+	);
+	m_currentVersion = m_currentPackage->version(
+		dirName.mid( packageNameEndIndex + 1 )
+	);
+	m_currentVersion->setInstalled( true );
+
+	m_scanner->countScannedPackage( true );
+}
+
+} // namespace
@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) 2004 by karye <karye@users.sourceforge.net>             *
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTPORTAGETREESCANWORKER_H
+#define LIBPAKTPORTAGETREESCANWORKER_H
+
+#include "portagetreescanner.h"
+
+#include <qthread.h>
+#include <qstring.h>
+#include <qdir.h>
+
+
+namespace libpakt {
+
+class PortagePackage;
+class PortagePackageVersion;
+class PortageTreeState;
+
+/**
+ * PortageTreeScanWorker does the actual directory walking for the
+ * PortageTreeScanner. It takes category directory names from its scanner
+ * one by one and adds the packages found there to its own package list,
+ * until the scanner has got no more categories left.
+ *
+ * When the scanner works serially, the worker's scanCategories()
+ * function is called directly and fills the scanner's package list.
+ * For parallel scanning, each worker runs in its own thread and fills
+ * a private partial list which is merged by the scanner afterwards.
+ * The same goes for the PortageTreeState, if one is given: the worker
+ * records the modification time and entries of each directory it reads,
+ * and the package source that each mainline category has been read from.
+ *
+ * @short  A (possibly threaded) helper that scans categories for PortageTreeScanner.
+ */
+class PortageTreeScanWorker : public QThread
+{
+public:
+	PortageTreeScanWorker( PortageTreeScanner* scanner,
+	                       const QString& treeDir,
+	                       PortageTreeScanner::TreeType treeType,
+	                       TemplatedPackageList<PortagePackage>* packages,
+	                       PortageTreeState* state = NULL );
+
+	TemplatedPackageList<PortagePackage>* packageList();
+	PortageTreeState* treeState();
+
+	void scanCategories();
+
+protected:
+	void run();
+
+private:
+	void scanCategory( const QString& categoryDirName );
+	void scanTreePackage( QDir& d, const QString& path, bool overlay );
+	void scanCacheCategory( QDir& d, const QString& path );
+	bool scanMd5CacheCategory( const QString& path );
+	bool scanCdbCacheCategory( const QString& filename );
+	void scanInstalledPackage( QDir& d );
+	void setCategorySource( const QString& categoryDirName,
+	                        PackageSource source );
+
+	//! The scanner that hands out categories and receives progress info.
+	PortageTreeScanner* m_scanner;
+	//! The PackageList object that will be filled.
+	TemplatedPackageList<PortagePackage>* m_packages;
+	//! The directory state object that will be filled, or NULL.
+	PortageTreeState* m_state;
+
+	//! The directory of the tree that is scanned.
+	QString m_treeDir;
+	//! Defines which kind of tree is scanned.
+	PortageTreeScanner::TreeType m_treeType;
+	//! The directory where the portage cache resides.
+	QString m_cacheDir;
+	//! The mainline tree directory, needed for composing cache paths.
+	QString m_mainlineTreeDir;
+	//! Set to what type of Portage cache to use.
+	PackageSource m_preferredPackageSource;
+
+	//! The (shared) category that is currently scanned.
+	PackageCategory* m_currentCategory;
+	//! An object used for temporarily storing package information.
+	PortagePackage* m_currentPackage;
+	//! An object used for temporarily storing package version information.
+	PortagePackageVersion* m_currentVersion;
+};
+
+}
+
+#endif // LIBPAKTPORTAGETREESCANWORKER_H
@@ -0,0 +1,328 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "portagetreestate.h"
+
+#include <qfile.h>
+#include <qdatastream.h>
+
+#include <kdebug.h>
+#include <klocale.h>
+#include <ksavefile.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define TREESTATE_MAGIC         0x504b5454 // "PKTT"
+#define TREESTATE_FORMATVERSION 3
+
+
+namespace libpakt {
+
+static QDataStream& operator<<( QDataStream& stream,
+                                const PortageTreeState::DirectoryState& state )
+{
+	stream << (Q_UINT32) state.modificationTime << state.entries;
+	return stream;
+}
+
+static QDataStream& operator>>( QDataStream& stream,
+                                PortageTreeState::DirectoryState& state )
+{
+	Q_UINT32 modificationTime;
+	stream >> modificationTime >> state.entries;
+	state.modificationTime = modificationTime;
+	return stream;
+}
+
+
+/**
+ * Initialize this object with an empty state.
+ */
+PortageTreeState::PortageTreeState()
+{
+	m_snapshotId = 0;
+}
+
+/**
+ * Load the state from a file. The current state is discarded.
+ *
+ * @return  true if the state has been loaded, false if the file could
+ *          not be read or is not a state file. In the latter case, the
+ *          state is empty afterwards.
+ */
+bool PortageTreeState::load( const QString& filename )
+{
+	clear();
+
+	QFile file( filename );
+	if( !file.open( IO_ReadOnly ) )
+		return false;
+
+	QDataStream stream( &file );
+	Q_UINT32 magic, formatVersion;
+	stream >> magic >> formatVersion;
+
+	if( magic != TREESTATE_MAGIC || formatVersion != TREESTATE_FORMATVERSION )
+	{
+		kdDebug() << i18n( "PortageTreeState debug output.",
+			"The file %1 is not a valid tree state "
+			"or has been written by another version" )
+				.arg( filename )
+			<< endl;
+		return false;
+	}
+
+	Q_UINT32 snapshotId;
+	stream >> snapshotId >> m_configuration >> m_directories
+	       >> m_categorySources;
+	m_snapshotId = snapshotId;
+
+	if( file.status() != IO_Ok ) {
+		clear();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Save the state to a file.
+ *
+ * @return  true if the state has been saved, false otherwise.
+ */
+bool PortageTreeState::save( const QString& filename ) const
+{
+	KSaveFile file( filename );
+	if( file.status() != 0 )
+		return false;
+
+	QDataStream& stream = *file.dataStream();
+	stream << (Q_UINT32) TREESTATE_MAGIC << (Q_UINT32) TREESTATE_FORMATVERSION;
+	stream << (Q_UINT32) m_snapshotId << m_configuration << m_directories
+	       << m_categorySources;
+
+	return file.close();
+}
+
+/**
+ * Forget about all directories, category sources, the configuration
+ * and the snapshot id.
+ */
+void PortageTreeState::clear()
+{
+	m_snapshotId = 0;
+	m_configuration = QString::null;
+	m_directories.clear();
+	m_categorySources.clear();
+}
+
+/**
+ * Returns true if there are no directories in the state, false otherwise.
+ */
+bool PortageTreeState::isEmpty() const
+{
+	return m_directories.isEmpty();
+}
+
+/**
+ * Returns the configuration string that this state has been created with.
+ */
+const QString& PortageTreeState::configuration() const
+{
+	return m_configuration;
+}
+
+/**
+ * Set the configuration string that this state is created with.
+ */
+void PortageTreeState::setConfiguration( const QString& configuration )
+{
+	m_configuration = configuration;
+}
+
+/**
+ * Returns the id of the PortageSnapshot that this state belongs to,
+ * or 0 if it doesn't belong to a particular snapshot.
+ */
+Q_UINT32 PortageTreeState::snapshotId() const
+{
+	return m_snapshotId;
+}
+
+/**
+ * Set the id of the PortageSnapshot that this state belongs to.
+ * The snapshot and the state can be written at different times,
+ * and comparing their ids tells if they still fit together.
+ */
+void PortageTreeState::setSnapshotId( Q_UINT32 snapshotId )
+{
+	m_snapshotId = snapshotId;
+}
+
+/**
+ * Returns true if the state of the given directory is known,
+ * false otherwise.
+ */
+bool PortageTreeState::contains( const QString& directory ) const
+{
+	return m_directories.contains( directory );
+}
+
+/**
+ * Returns the remembered modification time of the given directory,
+ * or 0 if the directory is not known.
+ */
+uint PortageTreeState::modificationTime( const QString& directory ) const
+{
+	DirectoryStateMap::const_iterator stateIterator =
+		m_directories.find( directory );
+
+	if( stateIterator == m_directories.end() )
+		return 0;
+	else
+		return (*stateIterator).modificationTime;
+}
+
+/**
+ * Returns the remembered entries of the given directory,
+ * or an empty list if the directory is not known.
+ */
+QStringList PortageTreeState::entries( const QString& directory ) const
+{
+	DirectoryStateMap::const_iterator stateIterator =
+		m_directories.find( directory );
+
+	if( stateIterator == m_directories.end() )
+		return QStringList();
+	else
+		return (*stateIterator).entries;
+}
+
+/**
+ * Returns true if the given directory is known and contained the
+ * given entry, false otherwise.
+ */
+bool PortageTreeState::containsEntry( const QString& directory,
+                                      const QString& entry ) const
+{
+	DirectoryStateMap::const_iterator stateIterator =
+		m_directories.find( directory );
+
+	if( stateIterator == m_directories.end() )
+		return false;
+	else
+		return (*stateIterator).entries.contains( entry );
+}
+
+/**
+ * Remember the state of a directory. A previous state
+ * of this directory is replaced.
+ */
+void PortageTreeState::setDirectory( const QString& directory,
+                                     uint modificationTime,
+                                     const QStringList& entries )
+{
+	DirectoryState state;
+	state.modificationTime = modificationTime;
+	state.entries = entries;
+	m_directories.insert( directory, state );
+}
+
+/**
+ * Forget about a directory.
+ */
+void PortageTreeState::removeDirectory( const QString& directory )
+{
+	m_directories.remove( directory );
+}
+
+/**
+ * Returns the package source that a mainline category has been read from,
+ * or the given default source if the category is not known.
+ *
+ * @param category  The category directory name, e.g. "sys-kernel".
+ */
+PackageSource PortageTreeState::categorySource( const QString& category,
+	PackageSource defaultSource ) const
+{
+	QMap<QString,Q_UINT32>::const_iterator sourceIterator =
+		m_categorySources.find( category );
+
+	if( sourceIterator == m_categorySources.end() )
+		return defaultSource;
+	else
+		return (PackageSource) *sourceIterator;
+}
+
+/**
+ * Remember the package source that a mainline category has been read from.
+ */
+void PortageTreeState::setCategorySource( const QString& category,
+                                          PackageSource source )
+{
+	m_categorySources.insert( category, (Q_UINT32) source );
+}
+
+/**
+ * Take over the directory states and category sources of another
+ * state object. Directories and categories that are known by both
+ * objects get the state of the other one.
+ */
+void PortageTreeState::merge( const PortageTreeState& other )
+{
+	DirectoryStateMap::const_iterator stateIteratorEnd =
+		other.m_directories.end();
+
+	for( DirectoryStateMap::const_iterator stateIterator =
+	         other.m_directories.begin();
+	     stateIterator != stateIteratorEnd; ++stateIterator )
+	{
+		m_directories.insert( stateIterator.key(), stateIterator.data() );
+	}
+
+	QMap<QString,Q_UINT32>::const_iterator sourceIteratorEnd =
+		other.m_categorySources.end();
+
+	for( QMap<QString,Q_UINT32>::const_iterator sourceIterator =
+	         other.m_categorySources.begin();
+	     sourceIterator != sourceIteratorEnd; ++sourceIterator )
+	{
+		m_categorySources.insert( sourceIterator.key(), sourceIterator.data() );
+	}
+}
+
+/**
+ * Retrieve the current modification time of a directory from the
+ * file system. This is cheaper than using QFileInfo, which matters
+ * when it's done for every package directory in the tree.
+ *
+ * @return  The modification time in seconds since the epoch,
+ *          or 0 if the directory doesn't exist.
+ */
+uint PortageTreeState::currentModificationTime( const QString& directory )
+{
+	struct stat fileInfo;
+
+	if( stat( QFile::encodeName(directory), &fileInfo ) != 0 )
+		return 0;
+	else
+		return (uint) fileInfo.st_mtime;
+}
+
+} // namespace
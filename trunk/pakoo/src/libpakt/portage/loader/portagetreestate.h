@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LIBPAKTPORTAGETREESTATE_H
+#define LIBPAKTPORTAGETREESTATE_H
+
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qmap.h>
+
+#include "../core/portagesettings.h"
+
+
+namespace libpakt {
+
+/**
+ * PortageTreeState remembers the modification time and the list of
+ * entries of each directory that the PortageTreeScanner has read.
+ * Stored next to the package list snapshot, it enables the scanner
+ * to find out which directories have changed since the last run, and to
+ * only rescan those instead of the whole tree.
+ *
+ * This works because a directory's modification time changes whenever
+ * an entry is added to it or removed from it, which is what happens
+ * for category directories when packages are added or removed, and for
+ * package directories when ebuilds are added or removed.
+ *
+ * For each category of the mainline tree, the state also remembers the
+ * package source that it has been read from. If the preferred cache
+ * doesn't contain a category, the scanner falls back to the tree itself,
+ * and a rescan has to look at the same place.
+ *
+ * The state also contains a configuration string that describes the
+ * settings it has been created with (like the tree directories).
+ * If that doesn't match the current configuration, the state is useless
+ * and the tree has to be scanned completely. The same goes for a state
+ * whose snapshot id doesn't match the one of the loaded PortageSnapshot.
+ *
+ * @short  The directory modification times of a scanned Portage tree.
+ */
+class PortageTreeState
+{
+public:
+	/**
+	 * The remembered state of a single directory.
+	 */
+	struct DirectoryState
+	{
+		//! The directory's modification time, in seconds since the epoch.
+		uint modificationTime;
+		//! The names of the entries that were read from the directory.
+		QStringList entries;
+	};
+
+	PortageTreeState();
+
+	bool load( const QString& filename );
+	bool save( const QString& filename ) const;
+	void clear();
+	bool isEmpty() const;
+
+	const QString& configuration() const;
+	void setConfiguration( const QString& configuration );
+
+	Q_UINT32 snapshotId() const;
+	void setSnapshotId( Q_UINT32 snapshotId );
+
+	bool contains( const QString& directory ) const;
+	uint modificationTime( const QString& directory ) const;
+	QStringList entries( const QString& directory ) const;
+	bool containsEntry( const QString& directory, const QString& entry ) const;
+
+	void setDirectory( const QString& directory, uint modificationTime,
+	                   const QStringList& entries );
+	void removeDirectory( const QString& directory );
+
+	PackageSource categorySource( const QString& category,
+	                              PackageSource defaultSource ) const;
+	void setCategorySource( const QString& category, PackageSource source );
+	void merge( const PortageTreeState& other );
+
+	static uint currentModificationTime( const QString& directory );
+
+private:
+	typedef QMap<QString,DirectoryState> DirectoryStateMap;
+
+	//! The id of the snapshot that this state belongs to.
+	Q_UINT32 m_snapshotId;
+	//! The settings that this state has been created with.
+	QString m_configuration;
+	//! The directory states, with the directory paths as keys.
+	DirectoryStateMap m_directories;
+	//! The package sources of the mainline categories, with the
+	//! category directory names as keys.
+	QMap<QString,Q_UINT32> m_categorySources;
+};
+
+}
+
+#endif // LIBPAKTPORTAGETREESTATE_H
@@ -81,6 +81,9 @@ IJob::JobResult ProfileLoader::performThread()
 	FileMakeConfigLoader makeConfigLoader;
 	makeConfigLoader.setSettingsObject( m_settings );
 
+	// the profile directories, beginning with the most abstract one
+	QStringList profileDirectories;
+
 	// beginning from the start directory,
 	// read all of the profile directories that the 'parent' files point to
 	while( true )
@@ -99,6 +102,8 @@ IJob::JobResult ProfileLoader::performThread()
 		makeConfigLoader.setFileName( dir.filePath("make.defaults") );
 		makeConfigLoader.perform();
 
+		profileDirectories.prepend( dir.path() );
+
 		// read other files (not implemented, don't need that for now)
 
 		// check if there are more profile directories to load
@@ -106,6 +111,16 @@ IJob::JobResult ProfileLoader::performThread()
 			break; // no more parent profile directories
 	}
 
+	// the system package class, which more specific profiles may modify
+	QStringList systemPackages;
+	for( QStringList::iterator directoryIterator = profileDirectories.begin();
+	     directoryIterator != profileDirectories.end(); ++directoryIterator )
+	{
+		readPackagesFile( QDir(*directoryIterator).filePath("packages"),
+		                  systemPackages );
+	}
+	m_settings->setSystemPackages( systemPackages );
+
 	// get additional info from /etc/make.globals and /etc/make.conf
 	makeConfigLoader.setFileName( "/etc/make.globals" );
 	makeConfigLoader.perform();
@@ -142,6 +157,44 @@ bool ProfileLoader::goToStartDirectory( QDir& dir )
 	}
 }
 
+/**
+ * Read a profile's 'packages' file and apply it to the list of atoms
+ * of the "system" package class. Lines like "*sys-apps/baselayout" add
+ * an atom to the system class, and lines like "-*sys-apps/baselayout"
+ * remove an atom that a parent profile has added. Other lines don't
+ * belong to the system class and are ignored.
+ *
+ * @return  false if the file doesn't exist, true otherwise.
+ */
+bool ProfileLoader::readPackagesFile( const QString& filename,
+                                      QStringList& systemPackages )
+{
+	QFile file( filename );
+
+	if( !file.open( IO_ReadOnly ) ) {
+		return false; // no such file
+	}
+
+	QString line;
+	QTextStream stream( &file );
+
+	while ( !stream.atEnd() )
+	{
+		line = stream.readLine().stripWhiteSpace();
+
+		if( line.startsWith("*") )
+		{
+			line = line.mid(1);
+			if( systemPackages.contains(line) == 0 )
+				systemPackages.append( line );
+		}
+		else if( line.startsWith("-*") ) {
+			systemPackages.remove( line.mid(2) );
+		}
+	}
+	return true;
+}
+
 /**
  * Navigate the given QDir object to the current directory's
  * parent profile directory. This is the one given in the
@@ -25,6 +25,7 @@
 
 class QString;
 class QDir;
+class QStringList;
 
 
 namespace libpakt {
@@ -53,6 +54,7 @@ public:
 private:
 	bool goToStartDirectory( QDir& dir );
 	bool goToParentDirectory( QDir& currentDir );
+	bool readPackagesFile( const QString& filename, QStringList& systemPackages );
 
 	//! The PortageSettings object that will be filled with configuration values.
 	PortageSettings* m_settings;
@@ -24,8 +24,15 @@
 #include "base/core/packagelist.h"
 #include "portage/core/portagesettings.h"
 #include "portage/core/portagecategory.h"
+#include "portage/core/portagepackagesearchindex.h"
+#include "portage/core/portagepackageselector.h"
 #include "portage/loader/portagepackageloader.h"
 #include "portage/loader/portageinitialloader.h"
+#include "portage/loader/portagemetadatacache.h"
+#include "portage/loader/portagedependencyresolver.h"
+#include "portage/loader/portagereversedependencyindex.h"
+
+#include <unistd.h>
 
 namespace libpakt {
 
@@ -34,6 +41,8 @@ PortageBackend::PortageBackend() : BackendFactory()
 	// The settings object is used internally
 	// for all kinds of Portage settings
 	portageSettings = new PortageSettings();
+	metadataCache = NULL;
+	installedDependents = new PortageReverseDependencyIndex();
 
 	// These settings can't be retrieved automatically
 	
@@ -50,9 +59,17 @@ PortageBackend::PortageBackend() : BackendFactory()
 	//TODO: Read these from a configuration file of some kind.
 	portageSettings->setInstalledPackagesDirectory("/var/db/pkg/");
 	portageSettings->setCacheDirectory("/var/cache/edb/dep/");
+
+	// Scan with one worker thread per processor, so that startup
+	// is not bound to a single core on multi-processor machines.
+	long processorCount = sysconf( _SC_NPROCESSORS_ONLN );
+	portageSettings->setWorkerThreadCount(
+		(processorCount > 1) ? (int) processorCount : 1 );
 }
 
 PortageBackend::~PortageBackend() {
+	delete metadataCache; // writes the remaining cache entries
+	delete installedDependents;
 	delete portageSettings;
 }
 
@@ -61,6 +78,24 @@ PortageSettings* PortageBackend::settings()
 	return portageSettings;
 }
 
+/**
+ * Return the index of packages depending on installed packages, for
+ * finding out what would break when a package is uninstalled. It's
+ * filled by the initial loader, so don't use it before that has finished.
+ */
+PortageReverseDependencyIndex* PortageBackend::reverseDependencyIndex()
+{
+	return installedDependents;
+}
+
+/**
+ * Return the number of worker threads from the settings object.
+ */
+int PortageBackend::workerThreadCount()
+{
+	return portageSettings->workerThreadCount();
+}
+
 PackageList* PortageBackend::createPackageList() {
 	return new TemplatedPackageList<PortagePackage>();
 }
@@ -70,18 +105,49 @@ PackageCategory* PortageBackend::createPackageCategory()
 	return new PortageCategory();
 }
 
+PackageSelector* PortageBackend::createPackageSelector()
+{
+	PortagePackageSelector* selector = new PortagePackageSelector();
+	selector->setWorkerThreadCount( workerThreadCount() );
+	return selector;
+}
+
+PackageSearchIndex* PortageBackend::createPackageSearchIndex()
+{
+	return new PortagePackageSearchIndex();
+}
+
 InitialLoader* PortageBackend::createInitialLoader()
 {
 	PortageInitialLoader* loader = new PortageInitialLoader();
 	loader->setSettingsObject( portageSettings );
+	loader->setReverseDependencyIndex( installedDependents );
 	return loader;
 }
 
 PackageLoader* PortageBackend::createPackageLoader()
 {
+	if( metadataCache == NULL ) {
+		metadataCache = new PortageMetadataCache(
+			portageSettings->dataDirectory() + "/portagemetadata.cache" );
+	}
+
 	PortagePackageLoader* loader = new PortagePackageLoader();
 	loader->setSettingsObject( portageSettings );
+	loader->setMetadataCache( metadataCache );
 	return loader;
 }
 
+/**
+ * Create a dependency resolver with its own package loader,
+ * for loading the dependencies of packages that haven't been loaded yet.
+ */
+DependencyResolver* PortageBackend::createDependencyResolver()
+{
+	PortageDependencyResolver* resolver = new PortageDependencyResolver();
+	resolver->setSettingsObject( portageSettings );
+	resolver->setPackageLoader( createPackageLoader() );
+	return resolver;
+}
+
 } // namespace
@@ -27,6 +27,8 @@
 namespace libpakt {
 
 class PortageSettings;
+class PortageMetadataCache;
+class PortageReverseDependencyIndex;
 
 /**
  * A concrete BackendFactory implementation returning objects
@@ -38,18 +40,27 @@ public:
 	PortageBackend();
 	//! Return the PortageSettings object containing the global configuration.
 	PortageSettings* settings();
+	PortageReverseDependencyIndex* reverseDependencyIndex();
 
 	bool hasLoaderClasses()    { return true; }
 	bool hasInstallerClasses() { return false; }
 	bool hasConfigClasses()    { return false; }
+	int workerThreadCount();
 
 	PackageList* createPackageList();
 	PackageCategory* createPackageCategory();
+	PackageSelector* createPackageSelector();
+	PackageSearchIndex* createPackageSearchIndex();
 	InitialLoader* createInitialLoader();
 	PackageLoader* createPackageLoader();
+	DependencyResolver* createDependencyResolver();
 
 private:
 	PortageSettings* portageSettings;
+	//! The ebuild details cache shared by all package loaders, created on demand.
+	PortageMetadataCache* metadataCache;
+	//! The dependents of installed packages, maintained by the initial loader.
+	PortageReverseDependencyIndex* installedDependents;
 	~PortageBackend();
 };
 
@@ -0,0 +1,224 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jakob Petsovits <jpetso@gmx.at>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Reports how many bytes of heap memory a PortagePackageVersion takes,
+ * on a synthetic tree of 30000 versions. For comparison, the same is
+ * done with a record laid out like PortagePackageVersion was before it
+ * got its compact form (one QString or QStringList per detail and four
+ * QRegExp members for comparing versions).
+ *
+ * Usage: versionmemorybenchmark [versioncount]
+ */
+
+#include "portage/core/portagepackage.h"
+#include "portage/core/portagepackageversion.h"
+#include "portage/core/portagecategory.h"
+
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qregexp.h>
+#include <qmap.h>
+#include <qvaluevector.h>
+
+#include <ksharedptr.h>
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_VERSIONCOUNT   30000
+#define VERSIONSPERPACKAGE     10
+#define PACKAGESPERCATEGORY    30
+
+using namespace libpakt;
+
+
+/**
+ * The members of PortagePackageVersion (and PackageVersion) as they were
+ * before the compact record, with the same regular expressions.
+ */
+class OldVersionRecord : public KShared
+{
+public:
+	OldVersionRecord( Package* parent, const QString& version )
+		: m_parent( parent ), m_version( version ),
+		  rxNumber("\\d+"),
+		  rxRevision("-r(\\d+)$"),
+		  rxSuffix("_(alpha|beta|pre|rc|p)(\\d?)(?:-r\\d+)?$"),
+		  rxTrailingChar("\\d([a-z])(?:_(?:alpha|beta|pre|rc|p)\\d?)?(?:-r\\d+)?$")
+	{
+		m_installed = false;
+		m_overlay = false;
+		m_hasDetailedInfo = false;
+		m_size = 0;
+		m_isHardMasked = false;
+	}
+	virtual ~OldVersionRecord() {};
+
+	Package* m_parent;
+	QString m_version;
+	QString m_date;
+	bool m_installed;
+	bool m_overlay;
+	QString m_description;
+	QString m_homepage;
+	QString m_slot;
+	QStringList m_licenses;
+	QStringList m_keywords;
+	QStringList m_useflags;
+	QStringList m_acceptedKeywords;
+	bool m_hasDetailedInfo;
+	long m_size;
+	bool m_isHardMasked;
+
+	QRegExp rxNumber, rxRevision, rxSuffix, rxTrailingChar;
+};
+
+
+/**
+ * Returns the number of bytes that are currently allocated on the heap.
+ */
+static long allocatedBytes()
+{
+	return mallinfo().uordblks;
+}
+
+/**
+ * Returns the version string of the given synthetic version,
+ * with a mix of plain, revision and suffix versions.
+ */
+static QString versionString( uint index )
+{
+	switch( index % 4 )
+	{
+	case 0:
+		return QString("1.%1").arg( index );
+	case 1:
+		return QString("1.%1-r1").arg( index );
+	case 2:
+		return QString("2.%1_beta2").arg( index );
+	default:
+		return QString("2.%1b").arg( index );
+	}
+}
+
+/**
+ * Creates the packages that the versions are inserted into,
+ * so that the packages themselves aren't measured.
+ */
+static QValueVector<PortagePackage*> createPackages( uint versionCount )
+{
+	uint packageCount =
+		(versionCount + VERSIONSPERPACKAGE - 1) / VERSIONSPERPACKAGE;
+	QValueVector<PortagePackage*> packages( packageCount );
+
+	for( uint i = 0; i < packageCount; i++ )
+	{
+		packages[i] = new PortagePackage(
+			new PortageCategory( "cat",
+				QString("synthetic%1").arg(i / PACKAGESPERCATEGORY) ),
+			QString("package%1").arg(i) );
+	}
+	return packages;
+}
+
+/**
+ * Inserts the synthetic versions into the packages, with the details
+ * that the Portage cache provides for most versions.
+ */
+static void insertVersions( QValueVector<PortagePackage*>& packages,
+                            uint versionCount )
+{
+	for( uint i = 0; i < versionCount; i++ )
+	{
+		PortagePackageVersion* version =
+			packages[i / VERSIONSPERPACKAGE]->insertVersion( versionString(i) );
+
+		version->setDescription( QString("Synthetic package number %1")
+		                         .arg(i / VERSIONSPERPACKAGE) );
+		version->setHomepage( "http://www.example.org/" );
+		version->setSlot( "0" );
+		version->setLicenses( QStringList::split( ' ', "GPL-2" ) );
+		version->setKeywords( QStringList::split( ' ', "x86 ~amd64 ~ppc" ) );
+		version->setUseflags( QStringList::split( ' ', "ssl nls -debug" ) );
+		version->setHasDetailedInfo( true );
+	}
+}
+
+/**
+ * Does the same as insertVersions() with the old record layout.
+ * The strings were not shared in the old layout, as each of them has been
+ * read from an ebuild separately, so they are created for each version.
+ */
+static void insertOldVersions( QValueVector<PortagePackage*>& packages,
+                               QValueVector< QMap<QString,OldVersionRecord*> >& maps,
+                               uint versionCount )
+{
+	for( uint i = 0; i < versionCount; i++ )
+	{
+		uint packageIndex = i / VERSIONSPERPACKAGE;
+		OldVersionRecord* version =
+			new OldVersionRecord( packages[packageIndex], versionString(i) );
+		maps[packageIndex].insert( version->m_version, version );
+
+		version->m_description = QString("Synthetic package number %1")
+		                         .arg( packageIndex );
+		version->m_homepage = QString("http://www.example.org/");
+		version->m_slot = QString("0");
+		version->m_licenses = QStringList::split( ' ', QString("GPL-2") );
+		version->m_keywords = QStringList::split( ' ', QString("x86 ~amd64 ~ppc") );
+		version->m_useflags = QStringList::split( ' ', QString("ssl nls -debug") );
+		version->m_hasDetailedInfo = true;
+	}
+}
+
+int main( int argc, char** argv )
+{
+	uint versionCount = DEFAULT_VERSIONCOUNT;
+	if( argc > 1 )
+		versionCount = atoi( argv[1] );
+	if( versionCount == 0 ) {
+		fprintf( stderr, "Usage: %s [versioncount]\n", argv[0] );
+		return 1;
+	}
+
+	QValueVector<PortagePackage*> packages = createPackages( versionCount );
+	QValueVector< QMap<QString,OldVersionRecord*> > maps( packages.count() );
+
+	long startBytes = allocatedBytes();
+	insertOldVersions( packages, maps, versionCount );
+	long oldBytes = allocatedBytes() - startBytes;
+
+	startBytes = allocatedBytes();
+	insertVersions( packages, versionCount );
+	long newBytes = allocatedBytes() - startBytes;
+
+	printf( "%u versions in %u packages\n", versionCount, packages.count() );
+	printf( "before: %ld bytes, %.1f bytes per version "
+	        "(sizeof: %u bytes)\n",
+	        oldBytes, (double) oldBytes / versionCount,
+	        (uint) sizeof(OldVersionRecord) );
+	printf( "after:  %ld bytes, %.1f bytes per version "
+	        "(sizeof: %u bytes)\n",
+	        newBytes, (double) newBytes / versionCount,
+	        (uint) sizeof(PortagePackageVersion) );
+
+	return 0;
+}
@@ -63,6 +63,7 @@ PakooView::PakooView( QWidget *parent )
 : DCOPObject("pakooIface"), QWidget(parent)
 {
 	m_backend = new PortageBackend();
+	m_partialPackages = NULL;
 
 	// Overall layout
 
@@ -159,6 +160,15 @@ PakooView::PakooView( QWidget *parent )
 	m_viewAreas->raiseWidget( m_packageView );
 }
 
+/**
+ * Delete the package list that is shown while loading, if loading
+ * hasn't finished yet.
+ */
+PakooView::~PakooView()
+{
+	delete m_partialPackages;
+}
+
 /**
  * Initialize the backend, tree structure, and stuff.
  */
@@ -168,9 +178,13 @@ void PakooView::initData()
 	m_packages = m_backend->createPackageList();
 	initialLoader->setPackageList( m_packages );
 
+	// display the installed packages while the rest is still loading
+	connect( initialLoader, SIGNAL( partiallyLoaded(PackageList*) ),
+	         this,            SLOT( showPartialPackageList(PackageList*) )
+	);
 	// display the packages when loaded
 	connect( initialLoader, SIGNAL( finishedLoading(PackageList*) ),
-	         m_treeView,      SLOT( setPackageList(PackageList*) )
+	         this,            SLOT( showPackageList(PackageList*) )
 	);
 	// hide the progress bar when it's done
 	connect( initialLoader, SIGNAL( finishedLoading(PackageList*) ),
@@ -214,6 +228,31 @@ void PakooView::showSection( int sectionIndex )
 	}
 }
 
+/**
+ * Show a part of the packages while the initial loader is still busy.
+ * The list is taken over and deleted when the complete list is shown.
+ */
+void PakooView::showPartialPackageList( PackageList* packages )
+{
+	delete m_partialPackages;
+	m_partialPackages = packages;
+	m_treeView->setPackageList( packages );
+}
+
+/**
+ * Show the complete package list, and delete the partial one that has
+ * been shown while loading. The package views have switched to the
+ * new list by then, and keep their own references to the old packages
+ * for as long as they need them.
+ */
+void PakooView::showPackageList( PackageList* packages )
+{
+	m_treeView->setPackageList( packages );
+
+	delete m_partialPackages;
+	m_partialPackages = NULL;
+}
+
 /**
  * Size hint for the central view.
  */
@@ -57,8 +57,12 @@ class QWidgetStack;
 class PakooView : public QWidget, public pakooIface
 {
 	Q_OBJECT
+	// signals of libpakt objects use the unqualified type name
+	typedef libpakt::PackageList PackageList;
+
 public:
 	PakooView( QWidget *parent );
+	~PakooView();
 
 	void quit();
 
@@ -105,6 +109,8 @@ protected:
 
 private slots:
 	void showSection( int sectionIndex );
+	void showPartialPackageList( PackageList* packages );
+	void showPackageList( PackageList* packages );
 
 private:
 	enum SectionType {
@@ -123,6 +129,12 @@ private:
 	 * It is filled in loadPortageTree().
 	 */
 	libpakt::PackageList* m_packages;
+	/**
+	 * The installed packages that are shown while m_packages is still
+	 * being loaded. Deleted as soon as m_packages is shown instead,
+	 * which only releases the list's references to the packages.
+	 */
+	libpakt::PackageList* m_partialPackages;
 
 	QMap<int,SectionType> m_sectionIndexes;
 };
@@ -25,18 +25,53 @@
 #include <kiconloader.h>
 #include <kdebug.h>
 
+#include <qtimer.h>
+#include <qmap.h>
+#include <qtl.h>
+
 #include <backendfactory.h>
 #include <base/core/packagelist.h>
 #include <base/core/package.h>
 #include <base/core/packageversion.h>
 #include <base/core/packagecategory.h>
 #include <base/core/packageselector.h>
+#include <base/core/packagesearchindex.h>
+#include <base/core/packagesearchindexbuilder.h>
 #include <base/loader/packageloader.h>
 #include <base/loader/multiplepackageloader.h>
 
 
 namespace libpakt {
 
+/**
+ * If at most this many packages are shown, all category items are opened
+ * right away. Otherwise, package items are only created when the user
+ * opens their category item.
+ */
+#define MAXOPENPACKAGES 500
+
+
+/**
+ * A list view item that knows its position in the flat index
+ * of the PackageListView. For category items, the index refers
+ * to m_categoryRows, for package items to m_packageRows.
+ */
+class PackageListView::IndexedItem : public KListViewItem
+{
+public:
+	IndexedItem( QListView* parent, const QString& text, uint index )
+		: KListViewItem( parent, text ), m_index( index ) {}
+	IndexedItem( QListViewItem* parent, const QString& text, uint index )
+		: KListViewItem( parent, text ), m_index( index ) {}
+
+	uint index() const { return m_index; }
+	void setIndex( uint index ) { m_index = index; }
+
+private:
+	uint m_index;
+};
+
+
 /**
  * Initialize this object.
  *
@@ -64,9 +99,8 @@ PackageListView::PackageListView( QWidget* parent, const char* name,
 		this,            SLOT( displayPackageDetails(Package*) )
 	);
 	connect(
-		m_multiplePackageLoader->packageLoader(),
-			  SIGNAL( packageLoaded(Package*) ),
-		this, SLOT( displayPackageDetails(Package*) )
+		m_multiplePackageLoader, SIGNAL( packageLoaded(Package*) ),
+		this,                    SLOT( displayPackageDetails(Package*) )
 	);
 
 	// Emit selectionChanged(Package*) when a package is loaded
@@ -89,6 +123,8 @@ PackageListView::PackageListView( QWidget* parent, const char* name,
 	m_currentPackage = NULL;
 
 	m_packageSelector = m_backend->createPackageSelector();
+	m_searchIndex = m_backend->createPackageSearchIndex();
+	m_searchIndexBuilder = NULL;
 
 	m_loadedPackageCount = 0;
 	m_installedPackageCount = 0;
@@ -116,23 +152,41 @@ PackageListView::PackageListView( QWidget* parent, const char* name,
 		this, SLOT( emitSelectionChanged(QListViewItem*) )
 	);
 
-	// Add the versions only when the user wants to see them, which brings
-	// a) slightly better performance, and b) better column auto-resizing.
+	// Load the details of visible packages first. The priorities are
+	// updated shortly after scrolling, not for every single step.
+	m_prioritizeTimer = new QTimer( this );
+	connect(
+		m_prioritizeTimer, SIGNAL( timeout() ),
+		this,              SLOT( prioritizeVisiblePackages() )
+	);
 	connect(
-		this, SIGNAL( expanded(QListViewItem*)         ),
-		this, SLOT( insertVersionItems(QListViewItem*) )
+		this, SIGNAL( contentsMoving(int,int) ),
+		this, SLOT( schedulePrioritizing() )
+	);
+
+	// Add packages and versions only when the user wants to see them,
+	// which brings a) much better performance when showing lots of packages,
+	// and b) better column auto-resizing.
+	connect(
+		this, SIGNAL( expanded(QListViewItem*)       ),
+		this, SLOT( insertChildItems(QListViewItem*) )
 	);
 }
 
 /**
- * The deconstructor aborts and waits for the PackageScanner,
- * if it's running, so that it can safely be deleted.
+ * The deconstructor aborts and waits for the PackageScanner
+ * and the PackageSearchIndexBuilder, if they're running,
+ * so that they can safely be deleted.
  */
 PackageListView::~PackageListView()
 {
+	abortBuildingSearchIndex();
 	if( m_packageSelector != NULL ) {
 		delete m_packageSelector;
 	}
+	if( m_searchIndex != NULL ) {
+		delete m_searchIndex;
+	}
 	if( m_packageLoader != NULL ) {
 		delete m_packageLoader;
 	}
@@ -156,6 +210,16 @@ PackageSelector* PackageListView::packageSelector()
 	return m_packageSelector;
 }
 
+/**
+ * Retrieve the search index over all packages of the package list,
+ * which is kept up to date with the package details that are loaded
+ * by the list view.
+ */
+PackageSearchIndex* PackageListView::searchIndex()
+{
+	return m_searchIndex;
+}
+
 /**
  * Get the number of installed packages which are currently shown
  * in the list view.
@@ -187,12 +251,94 @@ int PackageListView::totalPackageCount()
  * Calling this function will not cause an update of the view.
  * If you want that, please use an additional call of refreshView().
  *
+ * The search index is rebuilt by a PackageSearchIndexBuilder in the
+ * background. Until it has finished, searches don't find anything,
+ * and searchIndexChanged() is emitted when the new index is ready.
+ *
  * @see setPackageSelector
  * @see refreshView
  */
 void PackageListView::setPackageList( PackageList& allPackages )
 {
+	abortBuildingSearchIndex();
+
 	*m_allPackages = allPackages;
+
+	// the old index points to the packages of the old list
+	m_searchIndex->clear();
+
+	// the package list is only iterated in the main thread
+	QValueVector<Package*> packages;
+	packages.reserve( m_allPackages->count() );
+
+	PackageList::iterator packageIteratorEnd = m_allPackages->end();
+	for( PackageList::iterator packageIterator = m_allPackages->begin();
+	     packageIterator != packageIteratorEnd; ++packageIterator )
+	{
+		packages.append( (*packageIterator).data() );
+	}
+
+	m_searchIndexBuilder = new PackageSearchIndexBuilder(
+		m_backend->createPackageSearchIndex(), packages );
+	connect(
+		m_searchIndexBuilder, SIGNAL( finished(IJob::JobResult) ),
+		this,                 SLOT( searchIndexBuilt(IJob::JobResult) )
+	);
+	m_searchIndexBuilder->start( QThread::LowestPriority );
+}
+
+/**
+ * Abort the PackageSearchIndexBuilder, if there is one, and delete it
+ * together with the index that it has been building.
+ */
+void PackageListView::abortBuildingSearchIndex()
+{
+	if( m_searchIndexBuilder == NULL )
+		return;
+
+	PackageSearchIndexBuilder* builder = m_searchIndexBuilder;
+	m_searchIndexBuilder = NULL;
+
+	// the job's deconstructor processes pending events,
+	// including its finished() signal
+	builder->disconnect( this );
+	builder->abortAndWait();
+	delete builder->index();
+	delete builder;
+	m_updatedSearchPackages.clear();
+}
+
+/**
+ * Called when the PackageSearchIndexBuilder has finished. The new index
+ * replaces the current one, and gets the details of the packages that
+ * have been loaded while it was being built.
+ */
+void PackageListView::searchIndexBuilt( IJob::JobResult result )
+{
+	if( m_searchIndexBuilder == NULL )
+		return;
+
+	// make sure that the thread has really returned
+	m_searchIndexBuilder->wait();
+
+	PackageSearchIndex* index = m_searchIndexBuilder->index();
+	m_searchIndexBuilder->deleteLater();
+	m_searchIndexBuilder = NULL;
+
+	if( result != IJob::Success ) {
+		delete index;
+		m_updatedSearchPackages.clear();
+		return;
+	}
+
+	delete m_searchIndex;
+	m_searchIndex = index;
+
+	for( uint i = 0; i < m_updatedSearchPackages.count(); i++ )
+		m_searchIndex->updatePackage( m_updatedSearchPackages[i] );
+	m_updatedSearchPackages.clear();
+
+	emit searchIndexChanged();
 }
 
 /**
@@ -225,21 +371,11 @@ bool PackageListView::hasInstalledVersion( const QListViewItem* packageItem )
 	}
 	else // we got a package item, depth 1
 	{
-		// retrieve the package and category strings from the ListView
-		const QString& categoryString = packageItem->parent()->text(0);
-
-		// see if the category exists
-		if( m_categories.contains(categoryString) == false )
+		int row = rowOfItem( packageItem );
+		if( row == -1 )
 			return false;
 
-		// the category exists, see if the package exists
-		const QString& packageString = packageItem->text(0);
-		PackageViewCategory& cat = m_categories[categoryString];
-		if( cat.packageItems.contains(packageString) == false )
-			return false;
-
-		// the package exists, return if it's installed
-		return cat.packageItems[packageString].installed;
+		return m_packageRows[row].installed;
 	}
 }
 
@@ -249,47 +385,43 @@ bool PackageListView::hasInstalledVersion( const QListViewItem* packageItem )
  */
 void PackageListView::emitSelectionChanged( QListViewItem* item )
 {
-	QListViewItem* categoryItem;
-
-	if( item->depth() == 0 ) { // we got a category item
-		categoryItem = item;
-	}
-	else if( item->depth() == 1 ) { // we got a package item
-		categoryItem = item->parent();
-	}
-	else { // nothing of the previous ones, so it's a version item
-		categoryItem = item->parent()->parent();
-	}
-
-	PackageCategory* packageCategory = m_backend->createPackageCategory();
-	//TODO: We want user visible names, and not this:
-	packageCategory->loadFromUniqueName( categoryItem->text(0) );
-	PackageCategory* category; // which will be a copy of the above
+	if( item == NULL )
+		return;
 
 	// emit the right signal
 	if( item->depth() == 0 )  // we got a category item
 	{
-		emit selectionChanged( category );
+		uint categoryIndex = static_cast<IndexedItem*>(item)->index();
+		if( categoryIndex >= m_categoryRows.count() )
+			return;
+
+		const PackageViewCategory& cat = m_categoryRows[categoryIndex];
+		emit selectionChanged(
+			m_packageRows[cat.firstPackage].package->category() );
 	}
 	else if( item->depth() == 1 ) // we got a package item
 	{
-		const QString& packageName = item->text(0);
-		category = m_backend->createPackageCategory();
-		*category = *packageCategory;
-		Package* package = m_shownPackages->package( category, packageName );
+		int row = rowOfItem( item );
+		if( row == -1 ) // should not happen, but just to make sure
+			return;
+
+		Package* package = m_packageRows[row].package;
 
 		// Retrieve the package's detail info (description and hasUpdates).
 		// The signal is emitted when it's done - mind the connection which
 		// has been set up in the constructor.
+		prioritizeVisiblePackages();
+		m_currentPackage = package;
 		m_packageLoader->setPackage( package );
 		m_packageLoader->start();
 	}
 	else // nothing of the previous ones, so it's a version item
 	{
-		const QString& packageName = item->parent()->text(0);
-		category = m_backend->createPackageCategory();
-		*category = *packageCategory;
-		Package* package = m_shownPackages->package( category, packageName );
+		int row = rowOfItem( item->parent() );
+		if( row == -1 ) // should not happen, but just to make sure
+			return;
+
+		Package* package = m_packageRows[row].package;
 
 		const QString& versionString = item->text(0);
 		if( package->containsVersion(versionString) )
@@ -316,109 +448,390 @@ void PackageListView::abortLoadingPackageDetails()
 }
 
 /**
- * Clear and refill the ListView with those package items that
+ * Update the ListView so that it contains those package items that
  * are defined by the list of all packages and the PackageSelector.
+ *
+ * Items of packages that have already been shown are kept, together with
+ * their descriptions and version items, and only the items of packages
+ * that are new or not selected anymore are inserted or removed.
+ * The package details loader is only restarted if the shown packages
+ * have actually changed.
  */
 void PackageListView::refreshView()
 {
-	abortLoadingPackageDetails();
-
-	//if( m_parallelScanning == true )
-	//{
-		//TODO: bring back?
-		// also start a thread for scanning the installed packages,
-		// because they are more important and need hasUpdates first.
-		//packageInstalledScanner->startScanningCategory(
-		//	this, tree, categoryName, subcategoryName
-		//);
-	//}
-
-	// reset everything
-	m_categories.clear();
-	this->clear(); emit cleared();
-	m_loadedPackageCount = 0;
-	m_installedPackageCount = 0;
-	m_totalPackageCount = 0;
-
 	// Get the list of shown packages
+	PackageList* shownPackages = m_backend->createPackageList();
 	m_packageSelector->setSourceList( m_allPackages );
-	m_packageSelector->setDestinationList( m_shownPackages );
+	m_packageSelector->setDestinationList( shownPackages );
 	if( m_packageSelector->perform() == IJob::Failure ) {
 		kdDebug() << i18n( "PackageListView debug output",
 			"PackageListView::refreshView(): "
 			"Failed to select shown packages" )
 			<< endl;
+		delete shownPackages;
 		return;
 	}
 
+
+	// Build the new flat index of the shown packages, taking over rows
+	// of the current one for packages that are still shown. The package
+	// list is sorted by unique name, so the packages of each category
+	// come one after another.
+
+	QValueVector<PackageViewCategory> categoryRows;
+	QValueVector<PackageViewPackage> packageRows;
+	QValueVector<PackageIndexEntry> packageIndex;
+	packageRows.reserve( shownPackages->count() );
+	packageIndex.reserve( shownPackages->count() );
+
+	QValueVector<bool> keptCategories( m_categoryRows.count(), false );
+	QValueVector<bool> keptPackages( m_packageRows.count(), false );
+	uint keptPackageCount = 0;
+
+	QMap<PackageCategory*,uint> oldCategories;
+	for( uint i = 0; i < m_categoryRows.count(); i++ ) {
+		oldCategories.insert(
+			m_packageRows[m_categoryRows[i].firstPackage].package->category(),
+			i
+		);
+	}
+
+	PackageCategory* currentCategory = NULL;
+	PackageViewPackage pkg;
+
+	PackageList::iterator packageIteratorEnd = shownPackages->end();
+
+	for( PackageList::iterator packageIterator = shownPackages->begin();
+	     packageIterator != packageIteratorEnd; ++packageIterator )
+	{
+		Package* package = (*packageIterator).data();
+		int oldRow = rowOfPackage( package );
+
+		if( oldRow == -1 ) {
+			pkg.item = NULL;
+			pkg.package = package;
+			pkg.installed = package->containsInstalledVersion();
+			pkg.containsVersions = false;
+			pkg.hasDetails = false;
+		}
+		else {
+			pkg = m_packageRows[oldRow];
+			keptPackages[oldRow] = true;
+			keptPackageCount++;
+
+			bool installed = package->containsInstalledVersion();
+			if( installed != pkg.installed ) {
+				pkg.installed = installed;
+				if( pkg.item != NULL )
+					updatePackagePixmap( pkg );
+			}
+		}
+
+		if( package->category() != currentCategory )
+		{
+			currentCategory = package->category();
+
+			PackageViewCategory cat;
+			cat.item = NULL;
+			cat.firstPackage = packageRows.count();
+			cat.packageCount = 0;
+			cat.containsPackages = false;
+
+			QMap<PackageCategory*,uint>::iterator categoryIterator =
+				oldCategories.find( currentCategory );
+
+			if( categoryIterator != oldCategories.end() ) {
+				cat.item = m_categoryRows[*categoryIterator].item;
+				cat.containsPackages =
+					m_categoryRows[*categoryIterator].containsPackages;
+				keptCategories[*categoryIterator] = true;
+			}
+			categoryRows.append( cat );
+		}
+		categoryRows.back().packageCount++;
+
+		PackageIndexEntry entry;
+		entry.package = package;
+		entry.row = packageRows.count();
+		packageIndex.append( entry );
+
+		packageRows.append( pkg );
+	}
+
+	if( keptPackageCount == m_packageRows.count()
+	    && keptPackageCount == packageRows.count() )
+	{
+		// same packages as before, nothing to do
+		delete shownPackages;
+		return;
+	}
+
+	qHeapSort( packageIndex );
+
+
+	// The details loader works on the list of shown packages, so it has
+	// to be restarted with the new one. Packages whose details have
+	// already been loaded are skipped quickly when it runs again.
+	m_multiplePackageLoader->abortAndWait();
+
+	m_packageIndex = packageIndex;
+	if( m_currentPackage != NULL && rowOfPackage(m_currentPackage) == -1 ) {
+		m_packageLoader->abortAndWait();
+		m_currentPackage = NULL;
+	}
+
+	// Remove the items of packages and categories that are not shown anymore
+	if( keptPackageCount == 0 ) {
+		this->clear(); emit cleared();
+	}
+	else {
+		for( uint i = 0; i < m_packageRows.count(); i++ ) {
+			if( keptPackages[i] == false && m_packageRows[i].item != NULL )
+				delete m_packageRows[i].item;
+		}
+		for( uint i = 0; i < m_categoryRows.count(); i++ ) {
+			if( keptCategories[i] == false && m_categoryRows[i].item != NULL )
+				delete m_categoryRows[i].item;
+		}
+	}
+
+	m_categoryRows = categoryRows;
+	m_packageRows = packageRows;
+
+	delete m_shownPackages;
+	m_shownPackages = shownPackages;
+
 	// scan the package descriptions (in an extra thread)
 	m_multiplePackageLoader->setPackageList( m_shownPackages );
 	m_multiplePackageLoader->start();
 
 
-	// Insert packages under their right category in the ListView.
-	// If the category doesn't exist yet, then a check ensures that
-	// it is created before insertPackageItem() creates the package item.
+	// The kept items have moved to other positions in the index
+	m_loadedPackageCount = 0;
+	m_installedPackageCount = 0;
+	m_totalPackageCount = m_packageRows.count();
 
-	QListViewItem *catItem;
-	QString categoryName, uniqueCategoryName;
-	PackageList::iterator packageIteratorEnd = m_shownPackages->end();
+	for( uint row = 0; row < m_packageRows.count(); row++ )
+	{
+		PackageViewPackage& shownPackage = m_packageRows[row];
 
-	for( PackageList::iterator packageIterator = m_shownPackages->begin();
-	     packageIterator != packageIteratorEnd; ++packageIterator )
+		if( shownPackage.item != NULL )
+			static_cast<IndexedItem*>(shownPackage.item)->setIndex( row );
+
+		if( shownPackage.installed )
+			m_installedPackageCount++;
+		if( shownPackage.hasDetails )
+			m_loadedPackageCount++;
+	}
+
+
+	// Insert the missing category and package items. Package items of
+	// a new category are created when its item is opened, which happens
+	// right away if there are not too many of them.
+
+	bool openCategories = ( m_categoryRows.count() == 1
+		|| m_packageRows.count() <= MAXOPENPACKAGES );
+
+	for( uint i = 0; i < m_categoryRows.count(); i++ )
 	{
-		//TODO: We want user visible names in categoryName.
-		//      See emitSelectionChanged().
-		categoryName = (*packageIterator)->category()->uniqueName();
-		uniqueCategoryName = (*packageIterator)->category()->uniqueName();
+		PackageViewCategory& cat = m_categoryRows[i];
 
-		if( m_categories.contains(uniqueCategoryName) == false )
-		{
-			catItem = new KListViewItem( this, categoryName );
-			catItem->setExpandable( true );
-			catItem->setOpen( true );
-			catItem->setPixmap( 0, pxCategoryItem );
-			m_categories[uniqueCategoryName].item = catItem;
+		if( keptPackageCount == 0 ) {
+			cat.item = NULL;
+			cat.containsPackages = false;
+		}
+
+		if( cat.item != NULL ) {
+			static_cast<IndexedItem*>(cat.item)->setIndex( i );
+		}
+		else {
+			//TODO: We want user visible names in here.
+			cat.item = new IndexedItem( this,
+				m_packageRows[cat.firstPackage].package->category()->uniqueName(),
+				i
+			);
+			cat.item->setExpandable( true );
+			cat.item->setPixmap( 0, pxCategoryItem );
+		}
+
+		if( cat.containsPackages ) {
+			insertPackageItems( i ); // only adds the new packages
+		}
+		else if( openCategories ) {
+			insertPackageItems( i );
+			cat.item->setOpen( true );
 		}
-		insertPackageItem(
-			m_categories[uniqueCategoryName].item, *(*packageIterator)
-		);
 	}
 
+	// the items have been laid out when the timer fires
+	schedulePrioritizing();
+
 	emit contentsChanged();
 
 } // end of refreshView(...)
 
+/**
+ * Insert the package items of a category into the view, for those
+ * packages that don't have an item yet.
+ * This function does not insert version child items.
+ *
+ * @param categoryIndex  The index of the category in m_categoryRows.
+ */
+void PackageListView::insertPackageItems( uint categoryIndex )
+{
+	PackageViewCategory& cat = m_categoryRows[categoryIndex];
+	cat.containsPackages = true;
+
+	uint rowEnd = cat.firstPackage + cat.packageCount;
+
+	for( uint row = cat.firstPackage; row < rowEnd; row++ ) {
+		if( m_packageRows[row].item == NULL )
+			insertPackageItem( cat.item, row );
+	}
+}
+
 /**
  * Insert a package item into the view.
  * This function does not insert version child items.
  *
  * @param parent  Parent item of the package one. This will most likely be
  *                a category item.
- * @param package  The package whose data is used for creating the item.
+ * @param row  The index of the package in m_packageRows.
  */
-void PackageListView::insertPackageItem( QListViewItem* parent,
-                                         Package& package )
+void PackageListView::insertPackageItem( QListViewItem* parent, uint row )
 {
+	PackageViewPackage& pkg = m_packageRows[row];
+
 	// create the package item
-	QListViewItem* packageItem = new KListViewItem( parent, package.name() );
+	QListViewItem* packageItem =
+		new IndexedItem( parent, pkg.package->name(), row );
 	packageItem->setExpandable( true );
-
-	PackageViewPackage& pkg =
-		m_categories[parent->text(0)].packageItems[package.name()];
 	pkg.item = packageItem;
-	pkg.containsVersions = false;
-	pkg.hasDetails = false;
+	updatePackagePixmap( pkg );
+
+	// the details might have been loaded before the item existed
+	if( pkg.hasDetails )
+		packageItem->setText( 1, pkg.package->shortDescription() );
+}
+
+/**
+ * Retrieve the index in m_packageRows that belongs to a package item.
+ * Returns -1 if the item is not a package item of this view.
+ */
+int PackageListView::rowOfItem( const QListViewItem* item ) const
+{
+	if( item == NULL || item->depth() != 1 )
+		return -1;
+
+	uint row = static_cast<const IndexedItem*>(item)->index();
+	if( row >= m_packageRows.count() || m_packageRows[row].item != item )
+		return -1;
+
+	return row;
+}
+
+/**
+ * Retrieve the index in m_packageRows that belongs to a package.
+ * Returns -1 if the package is not shown in this view.
+ */
+int PackageListView::rowOfPackage( Package* package ) const
+{
+	// binary search in the index that is sorted by package pointers
+	int low = 0;
+	int high = (int) m_packageIndex.count() - 1;
 
-	if( package.containsInstalledVersion() ) {
-		packageItem->setPixmap( 0, pxPackageItemInstalled );
-		pkg.installed = true;
-		m_installedPackageCount++;
+	while( low <= high )
+	{
+		int middle = (low + high) / 2;
+		const PackageIndexEntry& entry = m_packageIndex[middle];
+
+		if( entry.package == package )
+			return entry.row;
+		else if( entry.package < package )
+			low = middle + 1;
+		else
+			high = middle - 1;
 	}
-	else {
-		packageItem->setPixmap( 0, pxPackageItem );
+	return -1;
+}
+
+/**
+ * Retrieve the package that belongs to a package or version item,
+ * for loading its details.
+ * Returns NULL for category items, unknown items and packages
+ * whose details are already displayed.
+ */
+Package* PackageListView::packageOfItem( QListViewItem* item )
+{
+	if( item == NULL || item->depth() == 0 )
+		return NULL;
+
+	if( item->depth() == 2 ) // version item
+		item = item->parent();
+
+	int row = rowOfItem( item );
+	if( row == -1 || m_packageRows[row].hasDetails == true )
+		return NULL;
+
+	return m_packageRows[row].package;
+}
+
+/**
+ * Update the loading priorities a short moment from now.
+ * Called repeatedly while scrolling, which just restarts the timer.
+ */
+void PackageListView::schedulePrioritizing()
+{
+	m_prioritizeTimer->start( 50, true );
+}
+
+/**
+ * Tell the MultiplePackageLoader to load the details of the selected
+ * package and of the package items in the visible part of the view
+ * before the other ones. Packages that have been scrolled out of view
+ * go back to their normal position in the loading order.
+ */
+void PackageListView::prioritizeVisiblePackages()
+{
+	QValueList<Package*> packages;
+
+	Package* package = packageOfItem( currentItem() );
+	if( package != NULL )
+		packages.append( package );
+
+	// itemRect() returns an invalid rectangle for invisible items
+	for( QListViewItem* item = itemAt( QPoint(0, 0) );
+	     item != NULL && itemRect(item).isValid(); item = item->itemBelow() )
+	{
+		if( item->depth() != 1 )
+			continue;
+
+		package = packageOfItem( item );
+		if( package != NULL )
+			packages.append( package );
+	}
+
+	m_multiplePackageLoader->setPriorityPackages( packages );
+}
+
+/**
+ * Insert the child items of an item that has just been opened:
+ * package items for category items, and version items for package items.
+ *
+ * @param item  The parent item whose child items should be created.
+ */
+void PackageListView::insertChildItems( QListViewItem* item )
+{
+	if( item->depth() == 0 ) { // category item
+		uint categoryIndex = static_cast<IndexedItem*>(item)->index();
+		if( categoryIndex < m_categoryRows.count() ) {
+			insertPackageItems( categoryIndex );
+			schedulePrioritizing();
+		}
+	}
+	else if( item->depth() == 1 ) { // package item
+		insertVersionItems( item );
 	}
-	m_totalPackageCount++;
 }
 
 /**
@@ -429,27 +842,18 @@ void PackageListView::insertPackageItem( QListViewItem* parent,
  */
 void PackageListView::insertVersionItems( QListViewItem* packageItem )
 {
-	if( packageItem->depth() != 1 ) // not a package item
+	int row = rowOfItem( packageItem );
+	if( row == -1 ) // should not happen, but just to make sure
 		return;
 
-	QListViewItem* categoryItem = packageItem->parent();
-	PackageCategory* category = m_backend->createPackageCategory();
-	category->loadFromUniqueName( categoryItem->text(0) );
-
-	Package* package = m_shownPackages->package(
-		category,
-		packageItem->text(0) // package name
-	);
+	Package* package = m_packageRows[row].package;
 
 	// get description, maskedness and Co.
 	m_packageLoader->setPackage( package );
 	m_packageLoader->perform();
 	this->displayPackageDetails( package );
 
-	PackageViewCategory& pvcategory =
-		m_categories[package->category()->uniqueName()];
-	PackageViewPackage& pkg =
-		pvcategory.packageItems[package->name()];
+	PackageViewPackage& pkg = m_packageRows[row];
 
 	if( pkg.containsVersions == true )
 		return;
@@ -491,26 +895,50 @@ void PackageListView::displayPackageDetails( Package* package )
 	if( package == NULL || !package->containsVersions() )
 		return;
 
-	PackageViewPackage& pkg =
-		m_categories[ package->category()->uniqueName() ]
-			.packageItems[ package->name() ];
+	if( m_searchIndexBuilder != NULL )
+		m_updatedSearchPackages.append( package );
+	else
+		m_searchIndex->updatePackage( package );
+
+	int row = rowOfPackage( package );
+	if( row == -1 )
+		return;
+
+	PackageViewPackage& pkg = m_packageRows[row];
 
-	if( pkg.hasDetails == true || pkg.item == NULL )
+	if( pkg.hasDetails == true )
 		return;
 	else
 		pkg.hasDetails = true;
 
-	pkg.item->setText( 1, package->shortDescription() );
+	// packages without an item get their details displayed
+	// when the item is created
+	if( pkg.item != NULL ) {
+		pkg.item->setText( 1, package->shortDescription() );
+		updatePackagePixmap( pkg );
+	}
 
-	if( package->canUpdate() ) {
-		pkg.item->setPixmap( 0, pxPackageItemUpdatable );
+	if( package->canUpdate() )
 		emit foundUpgradablePackage(package);
-	}
 
 	m_loadedPackageCount++;
 	//emit contentsChanged(); // NOT. try it out, if you want.
 }
 
+/**
+ * Set the icon of a package item, depending on whether the package
+ * is installed and, if its details have been loaded, can be updated.
+ */
+void PackageListView::updatePackagePixmap( PackageViewPackage& pkg )
+{
+	if( pkg.hasDetails && pkg.package->canUpdate() )
+		pkg.item->setPixmap( 0, pxPackageItemUpdatable );
+	else if( pkg.installed )
+		pkg.item->setPixmap( 0, pxPackageItemInstalled );
+	else
+		pkg.item->setPixmap( 0, pxPackageItem );
+}
+
 /**
  * Get the name of the current category filter of the list view.
  * Returns QString::null if all packages from the portage tree are shown.
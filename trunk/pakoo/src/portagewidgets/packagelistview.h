@@ -23,10 +23,14 @@
 
 #include <klistview.h>
 
-#include <qmap.h>
+#include <base/core/ijob.h>
+
+#include <qvaluevector.h>
 #include <qstring.h>
 #include <qpixmap.h>
 
+class QTimer;
+
 
 namespace libpakt {
 
@@ -36,12 +40,21 @@ class Package;
 class PackageVersion;
 class PackageCategory;
 class PackageSelector;
+class PackageSearchIndex;
+class PackageSearchIndexBuilder;
 class PackageLoader;
 class MultiplePackageLoader;
 
 /**
  * A KListView with additional functions to handle portage tree packages.
  *
+ * The shown packages are kept in a flat index, and list view items are
+ * only created for what the user can see: package items are added when
+ * their category item is opened, and version items when their package
+ * item is opened. If many packages are shown, the category items start
+ * out closed, so showing all packages of the tree only creates one item
+ * per category.
+ *
  * @short Widget to display a list of packages and versions.
  */
 class PackageListView : public KListView
@@ -53,6 +66,7 @@ public:
 	~PackageListView();
 
 	PackageSelector* packageSelector();
+	PackageSearchIndex* searchIndex();
 
 	int installedPackageCount();
 	int totalPackageCount();
@@ -101,27 +115,65 @@ signals:
 	 * (exactly when the description text is displayed, too).
 	 */
 	void foundUpgradablePackage( Package* package );
+	/**
+	 * Emitted if the search index has been rebuilt for a new
+	 * package list, so that searches should be done again.
+	 */
+	void searchIndexChanged();
 
 
 private slots:
-	void insertVersionItems( QListViewItem* packageItem );
+	void insertChildItems( QListViewItem* item );
 	void displayPackageDetails( Package* package );
+	void searchIndexBuilt( IJob::JobResult result );
+	void schedulePrioritizing();
+	void prioritizeVisiblePackages();
 
 private:
+	class IndexedItem;
 
+	/**
+	 * A row of the flat package index. The list view item is only
+	 * created when the category of the package is opened.
+	 */
 	struct PackageViewPackage {
-		QListViewItem* item;
+		QListViewItem* item; // NULL as long as the item hasn't been created
+		Package* package;
 		bool installed; // true if the package has at least one installed version
 		bool containsVersions; // true if its version child items have already been added
 		bool hasDetails;  // true if the package details have already been loaded
 	};
 
+	/**
+	 * A category of the flat package index, containing the packages
+	 * from firstPackage to firstPackage + packageCount - 1.
+	 */
 	struct PackageViewCategory {
 		QListViewItem* item;
-		QMap<QString,PackageViewPackage> packageItems;
+		uint firstPackage;
+		uint packageCount;
+		bool containsPackages; // true if its package child items have already been added
+	};
+
+	/**
+	 * An entry of the index for looking up rows by package pointer.
+	 */
+	struct PackageIndexEntry {
+		Package* package;
+		uint row;
+		bool operator<( const PackageIndexEntry& other ) const {
+			return package < other.package;
+		}
 	};
 
-	void insertPackageItem( QListViewItem* parent, Package& package );
+	void insertPackageItems( uint categoryIndex );
+	void insertPackageItem( QListViewItem* parent, uint row );
+	void insertVersionItems( QListViewItem* packageItem );
+	void updatePackagePixmap( PackageViewPackage& pkg );
+	void abortBuildingSearchIndex();
+	int rowOfItem( const QListViewItem* item ) const;
+	int rowOfPackage( Package* package ) const;
+	Package* packageOfItem( QListViewItem* item );
 
 	/**
 	 * The backend factory that creates some objects that are used here.
@@ -131,9 +183,12 @@ private:
 	/** TODO: get arch outta here */
 	QString m_arch;
 
-	/** A map of category structs, containing
-	 * additional info about the item. */
-	QMap<QString,PackageViewCategory> m_categories;
+	/** The shown categories, in the order of the shown packages. */
+	QValueVector<PackageViewCategory> m_categoryRows;
+	/** The shown packages, in the order of m_shownPackages. */
+	QValueVector<PackageViewPackage> m_packageRows;
+	/** The rows of m_packageRows, sorted by package pointer. */
+	QValueVector<PackageIndexEntry> m_packageIndex;
 	/** The list of all available packages. */
 	PackageList* m_allPackages;
 	/** The list of all packages that are shown in the ListView. */
@@ -141,6 +196,14 @@ private:
 	/** The object that filters out the shown packages from the
 	 * complete package list. */
 	PackageSelector* m_packageSelector;
+	/** The search index over all available packages. */
+	PackageSearchIndex* m_searchIndex;
+	/** The job that builds a new search index in the background,
+	 * or NULL if there is none running. */
+	PackageSearchIndexBuilder* m_searchIndexBuilder;
+	/** Packages that have got new details while the search index
+	 * was being built, and need to be updated in there afterwards. */
+	QValueVector<Package*> m_updatedSearchPackages;
 
 	/** A MultiplePackageLoader object that retrieves missing
 	 * package information for all installed packages. */
@@ -149,6 +212,10 @@ private:
 	 * package information for one single package. */
 	PackageLoader* m_packageLoader;
 
+	/** Delays updating the loading priorities while the view
+	 * is being scrolled. */
+	QTimer* m_prioritizeTimer;
+
 	/** The currently selected package. */
 	Package* m_currentPackage;
 
@@ -22,6 +22,9 @@
 
 #include <qlistview.h>
 
+#include <base/core/packageselector.h>
+#include <base/core/packagesearchindex.h>
+
 
 namespace libpakt {
 
@@ -52,27 +55,86 @@ void PackageSearchLine::setFilter(
 	filter = packageFilter;
 }
 
+/**
+ * Overloaded to search the package index instead of the list view items.
+ * If the search text has changed, the list view's PackageSelector gets
+ * the matching packages as filter, and the list view is refreshed.
+ */
+void PackageSearchLine::updateSearch( const QString& s )
+{
+	PackageListView* view = (PackageListView*) this->listView();
+	if( view == NULL )
+		return;
+
+	QString searchText = s.isNull() ? text() : s;
+	searchText = searchText.simplifyWhiteSpace();
+
+	if( searchText == m_searchText )
+		return;
+
+	m_searchText = searchText;
+	applySearchFilter( view->packageSelector() );
+	view->refreshView();
+}
+
+/**
+ * Set the package set filter of a PackageSelector to the packages
+ * matching the current search text, or remove it if the search text
+ * is empty. Call this for every new selector of the list view,
+ * so that the search keeps applying.
+ */
+void PackageSearchLine::applySearchFilter( PackageSelector* selector )
+{
+	PackageListView* view = (PackageListView*) this->listView();
+	if( view == NULL || selector == NULL )
+		return;
+
+	selector->clearPackageSetFilters();
+
+	if( m_searchText.isEmpty() == false ) {
+		selector->addPackageSetFilter( PackageSelector::Include,
+			view->searchIndex()->find(m_searchText) );
+	}
+}
+
+/**
+ * Look up the current search text again, for example because the list
+ * view's search index has changed, and refresh the list view with the
+ * new results. Nothing is done if there is no search text.
+ */
+void PackageSearchLine::refreshSearch()
+{
+	PackageListView* view = (PackageListView*) this->listView();
+	if( view == NULL || m_searchText.isEmpty() )
+		return;
+
+	applySearchFilter( view->packageSelector() );
+	view->refreshView();
+}
+
 /**
  * Overloaded to include version items and to filter for package properties.
+ * The search text itself has already been applied by the PackageSelector,
+ * so all packages that are shown do match it.
  */
 bool PackageSearchLine::itemMatches(
 	const QListViewItem* item, const QString& s ) const
 {
 	switch( item->depth() )
 	{
-	case 0: // never include category items
-		return false;
+	case 0: // category items are shown if they contain packages
+		return true;
 	case 2: // include all wanted version items
 		return itemMatches( item->parent(), s );
 
-	default: // search in package items, optionally with filter
+	default: // package items, optionally with filter
 		if( filter == Installed )
 		{
 			PackageListView* view = (PackageListView*) this->listView();
 			if( view->hasInstalledVersion(item) == false )
 				return false;
 		}
-		return KListViewSearchLine::itemMatches( item, s );
+		return true;
 	}
 }
 
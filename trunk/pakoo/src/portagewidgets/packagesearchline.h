@@ -28,10 +28,17 @@
 
 namespace libpakt {
 
+class PackageSelector;
+
 /**
  * A KListViewSearchLine customized to work with a PackageListView.
- * It mainly overloads the item matching function to display the right
- * items (always show version items, filtering capabilities).
+ * Instead of testing the text of each list view item, it looks up
+ * the search text in the list view's PackageSearchIndex, which also
+ * covers package descriptions and packages without items. The results
+ * are set as package set filter of the list view's PackageSelector,
+ * so the list view only shows matching packages. The item matching
+ * function is overloaded to display the right items (always show
+ * version items, filtering capabilities).
  *
  * @short A KListViewSearchLine customized to work with a PackageListView.
  */
@@ -48,12 +55,17 @@ public:
 public slots:
 	void setFilter( PackageSearchLine::Filter packageFilter );
 	void setListView( PackageListView* lv );
+	void updateSearch( const QString& s = QString::null );
+	void applySearchFilter( PackageSelector* selector );
+	void refreshSearch();
 
 protected:
 	bool itemMatches(const QListViewItem *item, const QString &s) const;
 
 private:
 	Filter filter;
+	//! The search text that has last been applied to the list view.
+	QString m_searchText;
 };
 
 }
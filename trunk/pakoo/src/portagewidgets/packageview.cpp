@@ -74,16 +74,11 @@ PackageView::PackageView( QWidget* parent, const char* name,
 	listView = new PackageListView( this, qname + "_listView", backend );
 	searchLine->setListView( listView );
 
-	QValueList<int> searchColumns;
-	searchColumns.append( 0 );
-	searchLine->setSearchColumns( searchColumns );
-
 	connect( filterCombo, SIGNAL(activated(int)), this, SLOT(updateFilter()) );
 	connect( listView, SIGNAL(packageSelectorChanged(PackageSelector*)),
 	         this, SLOT(updatePackageSelector(PackageSelector*))  );
-	connect( listView, SIGNAL(cleared()), searchLine, SLOT(clear())  );
-	connect( listView, SIGNAL(contentsChanged()),
-	         searchLine, SLOT(updateSearch())   );
+	connect( listView, SIGNAL(searchIndexChanged()),
+	         searchLine, SLOT(refreshSearch()) );
 	/*
 	connect( listView, SIGNAL(cleared()),
 	         this, SLOT(enableFilterUpdatable(false)) );
@@ -111,10 +106,13 @@ void PackageView::updateFilter()
 }
 
 /**
- * Ensure that the ListView's PackageSelector follows the search filter combo.
+ * Ensure that the ListView's PackageSelector follows the search filter combo
+ * and the search text.
  */
 void PackageView::updatePackageSelector( PackageSelector* selector )
 {
+	searchLine->applySearchFilter( selector );
+
 	switch( filterCombo->currentItem() )
 	{
 	case 0: // "All Packages"